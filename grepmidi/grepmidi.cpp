@@ -6,329 +6,296 @@
 //  (C) Copyright 1999/2000 Werner Schweer (ws@seh.de)
 //=========================================================
 
+#include <algorithm>
+#include <atomic>
+#include <ctype.h>
+#include <dirent.h>
+#include <limits.h>
+#include <mutex>
 #include <stdio.h>
 #include <stdlib.h>
-#include <unistd.h>
 #include <string.h>
+#include <string>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
 
-#define XCHG_SHORT(x) ((((x)&0xFF)<<8) | (((x)>>8)&0xFF))
-#ifdef __i486__
-#define XCHG_LONG(x) \
-     ({ int __value; \
-        asm ("bswap %1; movl %1,%0" : "=g" (__value) : "r" (x)); \
-       __value; })
-#else
-#define XCHG_LONG(x) ((((x)&0xFF)<<24) | \
-		      (((x)&0xFF00)<<8) | \
-		      (((x)&0xFF0000)>>8) | \
-		      (((x)>>24)&0xFF))
-#endif
-
-#if __BYTE_ORDER == __LITTLE_ENDIAN
-#define BE_SHORT(x) XCHG_SHORT(x)
-#define BE_LONG(x) XCHG_LONG(x)
-#else
-#define BE_SHORT(x) x
-#define BE_LONG(x) x
-#endif
-
+#include "midifile.h"
+#include "midiindex.h"
+#include "query.h"
 
-int cpos;
-bool printName = false;
-const char* curName;
+static bool printName = false;
+static bool listOnly = false;
+static bool countOnly = false;
+static bool recurse = false;
+static Query query;
+static MidiIndex* midiIndex = 0;
 
 //---------------------------------------------------------
-//   readLong
+//   Job
+//    one file, the output is kept until all files before
+//    it are printed
 //---------------------------------------------------------
 
-int readLong(FILE* f)
+struct Job
 {
-	int format;
-	if (fread(&format, 4, 1, f) != 1)
+	std::string path;
+	std::string out;
+	std::string err;
+	bool matched;
+	bool failed;
+	bool done;
+
+	Job(const std::string& p) : path(p), matched(false), failed(false), done(false)
 	{
-		printf("read long failed\n");
-		exit(1);
 	}
-	cpos += 4;
-	return BE_LONG(format);
-}
+};
+
+static std::vector<Job> jobs;
+static std::atomic<size_t> nextJob(0);
+static std::mutex outputMutex;
+static size_t printed = 0;
 
 //---------------------------------------------------------
-//   readShort
+//   isMidiName
 //---------------------------------------------------------
 
-int readShort(FILE* f)
+static bool isMidiName(const char* name)
 {
-	short format;
-	if (fread(&format, 2, 1, f) != 1)
+	static const char* ext[] = { ".mid", ".midi", ".kar", ".smf", ".rmi" };
+	std::string s(name);
+	for (size_t i = 0; i < s.size(); ++i)
+		s[i] = tolower((unsigned char) s[i]);
+	if (s.size() > 3 && s.compare(s.size() - 3, 3, ".gz") == 0)
+		s.resize(s.size() - 3);
+	for (size_t i = 0; i < sizeof(ext) / sizeof(*ext); ++i)
 	{
-		printf("read short failed\n");
-		exit(1);
+		size_t n = strlen(ext[i]);
+		if (s.size() > n && s.compare(s.size() - n, n, ext[i]) == 0)
+			return true;
 	}
-	cpos += 2;
-	return BE_SHORT(format);
+	return false;
 }
 
-/*---------------------------------------------------------
- *    getvl
- *    Read variable-length number (7 bits per byte, MSB first)
- *---------------------------------------------------------*/
+//---------------------------------------------------------
+//   collect
+//    directories are walked in name order so the output
+//    does not depend on the file system
+//---------------------------------------------------------
 
-int getvl(FILE* f)
+static bool collect(const std::string& path, bool top)
 {
-	int l = 0;
-	for (int i = 0; i < 8; i++)
+	struct stat st;
+	if (stat(path.c_str(), &st) == -1)
+	{
+		if (!top)
+			return false;
+		jobs.push_back(Job(path)); // reported as not found
+		return false;
+	}
+	if (!S_ISDIR(st.st_mode))
 	{
-		int c = getc(f);
-		++cpos;
-		if (c == EOF)
-			break;
-		c &= 0xff;
-		l += (c & 0x7f);
-		if (!(c & 0x80))
-			return l;
-		l <<= 7;
+		if (top || isMidiName(path.c_str()))
+			jobs.push_back(Job(path));
+		return false;
 	}
-	printf("Variable Len too long\n");
-	return -1;
+	if (!recurse)
+	{
+		fprintf(stderr, "grepmidi: %s: is a directory\n", path.c_str());
+		return true;
+	}
+	DIR* dir = opendir(path.c_str());
+	if (dir == 0)
+	{
+		fprintf(stderr, "grepmidi: %s: cannot read directory\n", path.c_str());
+		return true;
+	}
+	std::vector<std::string> names;
+	while (struct dirent* d = readdir(dir))
+	{
+		if (d->d_name[0] != '.')
+			names.push_back(d->d_name);
+	}
+	closedir(dir);
+	std::sort(names.begin(), names.end());
+	bool rv = false;
+	std::string prefix = path[path.size() - 1] == '/' ? path : path + "/";
+	for (std::vector<std::string>::const_iterator i = names.begin(); i != names.end(); ++i)
+		rv |= collect(prefix + *i, false);
+	return rv;
 }
 
 //---------------------------------------------------------
-//   skip
+//   printMeta
+//    without a query the meta text events are listed,
+//    as grepmidi always did
 //---------------------------------------------------------
 
-void skip(FILE* f, int n)
+static void printMeta(const MidiFile& mf, Job* job)
 {
-	while (n--)
+	const std::vector<MidiEvent>& el = mf.events();
+	char buffer[64];
+	for (std::vector<MidiEvent>::const_iterator i = el.begin(); i != el.end(); ++i)
 	{
-		++cpos;
-		if (getc(f) == EOF)
-		{
-			printf("skip %d failed\n", n);
-			exit(1);
-		}
+		if (i->status != 0xff || i->a < 1 || i->a > 15)
+			continue;
+		if (printName)
+			job->out += job->path + ": ";
+		snprintf(buffer, sizeof(buffer), "%02d Meta %0d: <", i->track, i->a);
+		job->out += buffer;
+		job->out.append((const char*) i->data, i->len);
+		job->out += ">\n";
 	}
+	job->matched = true;
 }
 
 //---------------------------------------------------------
-//   grepTrack
+//   printMatches
 //---------------------------------------------------------
 
-int grepTrack(FILE* f, int trackno)
+static void printMatches(const MidiFile& mf, Job* job)
 {
-	//      printf("TRACK %d\n", trackno);
-	int mtype, mlen;
-	int b;
-	char* buffer;
-
-	char tmp[4];
-	fread(tmp, 4, 1, f);
-	if (memcmp(tmp, "MTrk", 4))
-		return -5;
-	int len = readLong(f);
-	int endpos = cpos + len;
-	int runstate = -1;
-
-	for (;;)
+	std::vector<Match> ml;
+	int n = query.find(mf, (listOnly || countOnly) ? 0 : &ml, listOnly ? 1 : 0);
+	job->matched = n > 0;
+	if (listOnly)
 	{
-		/*            int nclick = */ getvl(f);
-		int me = getc(f);
-		++cpos;
-		int a = -1;
-		if ((me & 0x80) == 0)
-		{
-			if (runstate == -1)
-				return -6;
-			a = me;
-			me = runstate;
-		}
-		switch (me & 0xf0)
-		{
-			case 0x80:
-			case 0x90:
-			case 0xa0:
-			case 0xb0:
-			case 0xe0:
-				b = getc(f);
-				++cpos;
-			case 0xc0:
-			case 0xd0:
-				if (a == -1)
-				{
-					a = getc(f);
-					++cpos;
-				}
-				runstate = me;
-				break;
-			case 0xf0:
-				switch (me & 0xf)
-				{
-					case 0: // SYSEX
-						mlen = getvl(f);
-						skip(f, mlen);
-						break;
-					case 1:
-					case 2:
-					case 3:
-					case 4:
-					case 5:
-					case 6:
-						if (printName)
-							printf("%s: ", curName);
-						printf("unknown Message\n");
-						break;
-					case 7: // EOX
-					case 8: // timing clock
-					case 9: // undefined
-					case 0xa: // start
-					case 0xb: // continue
-					case 0xc: // stop
-					case 0xd: // undefined
-					case 0xe: // active sensing
-						if (printName)
-							printf("%s: ", curName);
-						printf("RT Message??\n");
-						break;
-					case 0xf: // META
-						mtype = getc(f);
-						++cpos;
-						mlen = getvl(f);
-						buffer = new char[mlen + 1];
-						if (mlen)
-						{
-							if (fread(buffer, mlen, 1, f) != 1)
-							{
-								if (printName)
-									printf("%s: ", curName);
-								printf("---meta %d too short (%d)\n", mtype, mlen);
-								exit(1);
-							}
-							cpos += mlen;
-						}
-						switch (mtype)
-						{
-							case 0x2f:
-								delete buffer;
-								goto end;
-							case 1:
-							case 2:
-							case 3:
-							case 4:
-							case 5:
-							case 6: // Marker
-							case 7:
-							case 8:
-							case 9:
-							case 10:
-							case 11:
-							case 12:
-							case 13:
-							case 14:
-							case 15:
-								buffer[mlen] = 0;
-								if (printName)
-									printf("%s: ", curName);
-								printf("%02d Meta %0d: <%s>\n", trackno, mtype, buffer);
-							default:
-								break;
-						}
-						delete buffer;
-						break;
-				}
-				break;
-		}
+		if (n)
+			job->out = job->path + "\n";
+		return;
 	}
-end:
-	if (cpos != endpos)
+	char buffer[64];
+	if (countOnly)
 	{
-		if (printName)
-			printf("%s: ", curName);
-		printf("   %d zu kurz\n", cpos - endpos);
+		snprintf(buffer, sizeof(buffer), ": %d\n", n);
+		job->out = job->path + buffer;
+		return;
+	}
+	for (std::vector<Match>::const_iterator m = ml.begin(); m != ml.end(); ++m)
+	{
+		snprintf(buffer, sizeof(buffer), ": %u: ", m->events[0]->tick);
+		job->out += job->path + buffer;
+		for (size_t i = 0; i < m->events.size(); ++i)
+		{
+			if (i)
+			{
+				snprintf(buffer, sizeof(buffer), ", %u: ", m->events[i]->tick);
+				job->out += buffer;
+			}
+			job->out += describe(*m->events[i]);
+		}
+		job->out += "\n";
 	}
-	if (endpos - cpos > 0)
-		skip(f, endpos - cpos);
-	return 0;
 }
 
 //---------------------------------------------------------
-//   grep
+//   grepMidi
 //---------------------------------------------------------
 
-int grep(FILE* f)
+static void grepMidi(Job* job)
 {
-	char tmp[4];
-
-	fread(tmp, 4, 1, f);
-	if (memcmp(tmp, "MThd", 4) != 0)
-		return -2;
-	int len = readLong(f);
-	if (len < 6)
-		return -3;
-	cpos += 8;
-	int format = readShort(f);
-	int ntracks = readShort(f);
-	readShort(f); // division
-	if (len > 6)
-		skip(f, len - 6); /* skip the excess */
-	int rv = 0;
-	switch (format)
+	std::string key;
+	struct stat st;
+	if (midiIndex && stat(job->path.c_str(), &st) == 0)
 	{
-		case 0: rv = grepTrack(f, 0);
-			break;
-		case 1:
-			for (int i = 0; i < ntracks; i++)
+		char buffer[PATH_MAX];
+		if (realpath(job->path.c_str(), buffer))
+			key = buffer;
+	}
+	if (!key.empty() && !query.empty())
+	{
+		FileSummary s;
+		if (midiIndex->lookup(key, st, &s) && !query.mayMatch(s))
+		{
+			if (s.error)
 			{
-				rv = grepTrack(f, i);
-				if (rv != 0)
-					return rv;
+				job->failed = true;
+				job->err = MidiFile::errorString(s.error);
 			}
-			break;
-		default:
-			return -4;
+			else if (countOnly)
+				job->out = job->path + ": 0\n";
+			return;
+		}
 	}
 
-	return 0;
+	MidiFile mf;
+	int rv = mf.load(job->path.c_str());
+	if (!key.empty() && rv != MidiFile::NOT_FOUND)
+	{
+		FileSummary s;
+		s.build(mf, rv);
+		midiIndex->store(key, st, s);
+	}
+	if (rv != MidiFile::OK)
+	{
+		job->failed = true;
+		job->err = MidiFile::errorString(rv);
+		if (rv == MidiFile::NOT_FOUND)
+			return;
+	}
+	if (query.empty())
+		printMeta(mf, job);
+	else
+		printMatches(mf, job);
 }
 
 //---------------------------------------------------------
-//   grep
+//   worker
+//    takes the next file, then prints every finished one
+//    that is next in line
 //---------------------------------------------------------
 
-int grepMidi(const char* name)
+static void worker()
 {
-	curName = name;
-	const char*p = strrchr(name, '.');
-	FILE* f;
-	if (p && strcmp(p, ".gz") == 0)
-	{
-		char buffer[512];
-		sprintf(buffer, "gunzip < %s", name);
-		f = popen(buffer, "r");
-	}
-	else
+	for (;;)
 	{
-		p = 0;
-		f = fopen(name, "r");
+		size_t i = nextJob++;
+		if (i >= jobs.size())
+			return;
+		grepMidi(&jobs[i]);
+		std::lock_guard<std::mutex> lock(outputMutex);
+		jobs[i].done = true;
+		while (printed < jobs.size() && jobs[printed].done)
+		{
+			Job& j = jobs[printed++];
+			if (!j.out.empty())
+				fwrite(j.out.data(), j.out.size(), 1, stdout);
+			if (j.failed)
+			{
+				fflush(stdout);
+				fprintf(stderr, "grepmidi: %s: %s\n", j.path.c_str(), j.err.c_str());
+			}
+			std::string().swap(j.out);
+		}
 	}
-	if (f == 0)
-		return -1;
-	cpos = 0;
-	int rc = grep(f);
-	if (p)
-		pclose(f);
-	else
-		fclose(f);
-	return rc;
 }
 
 //---------------------------------------------------------
 //   usage
 //---------------------------------------------------------
 
-void usage(const char* fname, const char* txt)
+static void usage(const char* fname)
 {
-	fprintf(stderr, "%s: %s\n", fname, txt);
-	//      fprintf(stderr, "usage:\n");
+	fprintf(stderr, "usage: %s [options] file ...\n", fname);
+	fprintf(stderr, "   -e  query  search for an event pattern, see below\n");
+	fprintf(stderr, "   -i  file   keep file summaries in an index to skip files quickly\n");
+	fprintf(stderr, "   -j  n      files read in parallel (default: number of cpus)\n");
+	fprintf(stderr, "   -r         search directories recursively\n");
+	fprintf(stderr, "   -l         only list the files that match\n");
+	fprintf(stderr, "   -c         print the number of matches per file\n");
+	fprintf(stderr, "   -f         print the file name with each meta event\n");
+	fprintf(stderr, "   -h         this help\n");
+	fprintf(stderr, "without -e the meta text events are printed\n");
+	fprintf(stderr, "patterns:\n");
+	fprintf(stderr, "   note <pitch|range> [vel range] [ch range]   e.g. note C3-G3 vel 100-127\n");
+	fprintf(stderr, "   cc <n|range> [val range] [ch range]\n");
+	fprintf(stderr, "   prog <n|range> [ch range]\n");
+	fprintf(stderr, "   bend [ch range]\n");
+	fprintf(stderr, "   sysex <hex bytes>   ?? matches any byte, * any run\n");
+	fprintf(stderr, "   text <word|\"words\">\n");
+	fprintf(stderr, "joined by 'then' (in this order) or 'and' (all of them), limited by\n");
+	fprintf(stderr, "   within <n> [ticks|beats]   and   in <from-to> [ticks|beats]\n");
 }
 
 //---------------------------------------------------------
@@ -337,43 +304,83 @@ void usage(const char* fname, const char* txt)
 
 int main(int argc, char* argv[])
 {
+	int threads = std::thread::hardware_concurrency();
+	const char* indexPath = 0;
 	int c;
-	while ((c = getopt(argc, argv, "f")) != EOF)
+	while ((c = getopt(argc, argv, "e:i:j:rlcfh")) != EOF)
 	{
 		switch (c)
 		{
-			case 'f': printName = true;
+			case 'e':
+				if (query.parse(optarg))
+				{
+					fprintf(stderr, "grepmidi: bad query: %s\n", query.error().c_str());
+					return 2;
+				}
 				break;
-			default: usage(argv[0], "bad argument");
-				return -1;
-		}
-	}
-	argc -= optind;
-	++argc;
-	const char* p = 0;
-	for (int i = 1; i < argc; ++i)
-	{
-		switch (grepMidi(argv[i]))
-		{
-			case 0: break;
-			case -1: p = "not found";
+			case 'i': indexPath = optarg;
 				break;
-			case -2: p = "no 'MThd': not a midi file";
+			case 'j': threads = atoi(optarg);
 				break;
-			case -3: p = "file too short";
+			case 'r': recurse = true;
 				break;
-			case -4: p = "bad file type";
+			case 'l': listOnly = true;
 				break;
-			case -5: p = "no 'MTrk': not a midi file";
+			case 'c': countOnly = true;
 				break;
-			case -6: p = "no running state";
+			case 'f': printName = true;
 				break;
-			default:
-				printf("was??\n");
-				return -1;
+			case 'h': usage(argv[0]);
+				return 0;
+			default: usage(argv[0]);
+				return 2;
 		}
 	}
-	if (p)
-		printf("Error: <%s>\n", p);
-	return 0;
+	if (optind == argc)
+	{
+		usage(argv[0]);
+		return 2;
+	}
+	if ((listOnly || countOnly) && query.empty())
+	{
+		fprintf(stderr, "grepmidi: -l and -c need a query\n");
+		return 2;
+	}
+
+	bool failed = false;
+	for (int i = optind; i < argc; ++i)
+		failed |= collect(argv[i], true);
+
+	MidiIndex index(indexPath ? indexPath : "");
+	if (indexPath)
+	{
+		if (index.load())
+			fprintf(stderr, "grepmidi: %s: cannot read index, rebuilding it\n", indexPath);
+		midiIndex = &index;
+	}
+
+	threads = std::max(1, std::min(threads, (int) jobs.size()));
+	std::vector<std::thread> pool;
+	for (int i = 1; i < threads; ++i)
+		pool.push_back(std::thread(worker));
+	worker();
+	for (size_t i = 0; i < pool.size(); ++i)
+		pool[i].join();
+
+	if (indexPath && index.dirty() && index.save())
+	{
+		fprintf(stderr, "grepmidi: %s: cannot write index\n", indexPath);
+		failed = true;
+	}
+
+	bool matched = false;
+	for (std::vector<Job>::const_iterator i = jobs.begin(); i != jobs.end(); ++i)
+	{
+		matched |= i->matched;
+		failed |= i->failed;
+	}
+	// like grep: 0 on a match, 1 on none, 2 on errors
+	if (failed)
+		return 2;
+	return matched || query.empty() ? 0 : 1;
 }
@@ -0,0 +1,343 @@
+//=========================================================
+//  OOMidi
+//  OpenOctave Midi and Audio Editor
+//
+//  grepmidi: mapped standard midi file reader
+//=========================================================
+
+#include <algorithm>
+#include <ctype.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "midifile.h"
+
+//---------------------------------------------------------
+//   MidiFile
+//---------------------------------------------------------
+
+MidiFile::MidiFile()
+: m_data(0), m_size(0), m_mapped(false), m_format(0), m_tracks(0), m_division(0)
+{
+}
+
+MidiFile::~MidiFile()
+{
+	close();
+}
+
+//---------------------------------------------------------
+//   close
+//---------------------------------------------------------
+
+void MidiFile::close()
+{
+	if (m_mapped)
+		munmap(const_cast<unsigned char*> (m_data), m_size);
+	m_data = 0;
+	m_size = 0;
+	m_mapped = false;
+	m_buffer.clear();
+	m_events.clear();
+}
+
+//---------------------------------------------------------
+//   readLong / readShort / getvl
+//---------------------------------------------------------
+
+static inline unsigned readLong(const unsigned char* p)
+{
+	return (p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+static inline unsigned readShort(const unsigned char* p)
+{
+	return (p[0] << 8) | p[1];
+}
+
+static inline bool getvl(const unsigned char*& p, const unsigned char* end, unsigned* val)
+{
+	unsigned l = 0;
+	for (int i = 0; i < 4 && p < end; ++i)
+	{
+		unsigned c = *p++;
+		l = (l << 7) | (c & 0x7f);
+		if (!(c & 0x80))
+		{
+			*val = l;
+			return true;
+		}
+	}
+	return false;
+}
+
+//---------------------------------------------------------
+//   tickLess
+//    stable merge of the tracks keeps the file order
+//    for events on the same tick
+//---------------------------------------------------------
+
+static bool tickLess(const MidiEvent& a, const MidiEvent& b)
+{
+	return a.tick < b.tick;
+}
+
+//---------------------------------------------------------
+//   load
+//---------------------------------------------------------
+
+int MidiFile::load(const char* path)
+{
+	close();
+	const char* ext = strrchr(path, '.');
+	if (ext && strcmp(ext, ".gz") == 0)
+	{
+		// no way to map a compressed file, read it through gunzip
+		std::string cmd("gunzip < '");
+		for (const char* s = path; *s; ++s)
+		{
+			if (*s == '\'')
+				cmd += "'\\''";
+			else
+				cmd += *s;
+		}
+		cmd += "' 2>/dev/null";
+		FILE* f = popen(cmd.c_str(), "r");
+		if (f == 0)
+			return NOT_FOUND;
+		unsigned char buffer[65536];
+		size_t n;
+		while ((n = fread(buffer, 1, sizeof(buffer), f)) > 0)
+			m_buffer.insert(m_buffer.end(), buffer, buffer + n);
+		if (pclose(f) != 0 && m_buffer.empty())
+			return NOT_FOUND;
+		m_data = m_buffer.empty() ? 0 : &m_buffer[0];
+		m_size = m_buffer.size();
+	}
+	else
+	{
+		int fd = open(path, O_RDONLY);
+		if (fd == -1)
+			return NOT_FOUND;
+		struct stat st;
+		if (fstat(fd, &st) == -1 || !S_ISREG(st.st_mode))
+		{
+			::close(fd);
+			return NOT_FOUND;
+		}
+		m_size = st.st_size;
+		if (m_size)
+		{
+			void* p = mmap(0, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (p == MAP_FAILED)
+			{
+				::close(fd);
+				return NOT_FOUND;
+			}
+			madvise(p, m_size, MADV_SEQUENTIAL);
+			m_data = (const unsigned char*) p;
+			m_mapped = true;
+		}
+		::close(fd);
+	}
+
+	const unsigned char* p = m_data;
+	const unsigned char* end = m_data + m_size;
+	if (m_size < 8 || memcmp(p, "MThd", 4) != 0)
+		return NO_MTHD;
+	unsigned len = readLong(p + 4);
+	p += 8;
+	if (len < 6 || len > (unsigned) (end - p))
+		return TOO_SHORT;
+	m_format = readShort(p);
+	m_tracks = readShort(p + 2);
+	m_division = readShort(p + 4);
+	p += len; // skip the excess
+	if (m_format > 1)
+		return BAD_TYPE;
+	if (m_format == 0)
+		m_tracks = 1;
+
+	// a rough guess keeps the event list from growing in small steps
+	m_events.reserve(m_size / 3);
+	int rv = OK;
+	for (int i = 0; i < m_tracks && rv == OK; ++i)
+		rv = readTrack(p, end, i);
+	// what was read up to an error stays usable
+	if (m_tracks > 1)
+		std::stable_sort(m_events.begin(), m_events.end(), tickLess);
+	return rv;
+}
+
+//---------------------------------------------------------
+//   readTrack
+//---------------------------------------------------------
+
+int MidiFile::readTrack(const unsigned char*& p, const unsigned char* end, int track)
+{
+	if (end - p < 8 || memcmp(p, "MTrk", 4) != 0)
+		return NO_MTRK;
+	unsigned len = readLong(p + 4);
+	p += 8;
+	const unsigned char* tend = p + len;
+	if (len > (unsigned) (end - p))
+		tend = end; // read what is there, truncated files are common
+	int runstate = -1;
+	unsigned tick = 0;
+
+	while (p < tend)
+	{
+		unsigned delta;
+		if (!getvl(p, tend, &delta) || p >= tend)
+			return TRUNCATED;
+		tick += delta;
+		MidiEvent ev;
+		ev.tick = tick;
+		ev.track = track;
+		ev.a = 0;
+		ev.b = 0;
+		ev.data = 0;
+		ev.len = 0;
+
+		int me = *p;
+		if (me & 0x80)
+			++p;
+		else
+		{
+			if (runstate == -1)
+				return NO_RUNNING_STATUS;
+			me = runstate;
+		}
+		ev.status = me;
+		switch (me & 0xf0)
+		{
+			case 0x80:
+			case 0x90:
+			case 0xa0:
+			case 0xb0:
+			case 0xe0:
+				if (tend - p < 2)
+					return TRUNCATED;
+				ev.a = p[0];
+				ev.b = p[1];
+				p += 2;
+				runstate = me;
+				break;
+			case 0xc0:
+			case 0xd0:
+				if (tend - p < 1)
+					return TRUNCATED;
+				ev.a = p[0];
+				p += 1;
+				runstate = me;
+				break;
+			case 0xf0:
+				if (me == 0xf0 || me == 0xf7)
+				{
+					unsigned l;
+					if (!getvl(p, tend, &l) || l > (unsigned) (tend - p))
+						return TRUNCATED;
+					ev.status = 0xf0;
+					ev.data = p;
+					ev.len = l;
+					p += l;
+				}
+				else if (me == 0xff)
+				{
+					unsigned l;
+					if (p >= tend)
+						return TRUNCATED;
+					ev.a = *p++;
+					if (!getvl(p, tend, &l) || l > (unsigned) (tend - p))
+						return TRUNCATED;
+					ev.data = p;
+					ev.len = l;
+					p += l;
+					if (ev.a == 0x2f)
+					{
+						p = tend;
+						continue;
+					}
+				}
+				else
+					continue; // realtime messages do not belong in a file
+				break;
+		}
+		m_events.push_back(ev);
+	}
+	p = tend;
+	return OK;
+}
+
+//---------------------------------------------------------
+//   errorString
+//---------------------------------------------------------
+
+const char* MidiFile::errorString(int rv)
+{
+	switch (rv)
+	{
+		case OK: return "ok";
+		case NOT_FOUND: return "not found";
+		case NO_MTHD: return "no 'MThd': not a midi file";
+		case TOO_SHORT: return "file too short";
+		case BAD_TYPE: return "bad file type";
+		case NO_MTRK: return "no 'MTrk': not a midi file";
+		case NO_RUNNING_STATUS: return "no running state";
+		case TRUNCATED: return "track truncated";
+	}
+	return "unknown error";
+}
+
+//---------------------------------------------------------
+//   pitchName
+//    same naming as the editor, 60 is C3
+//---------------------------------------------------------
+
+static const char* noteNames[] = {
+	"C", "C#", "D", "D#", "E", "F", "F#", "G", "G#", "A", "A#", "B"
+};
+
+std::string pitchName(int pitch)
+{
+	char buffer[16];
+	snprintf(buffer, sizeof(buffer), "%s%d", noteNames[pitch % 12], pitch / 12 - 2);
+	return buffer;
+}
+
+//---------------------------------------------------------
+//   namePitch
+//---------------------------------------------------------
+
+int namePitch(const char* s)
+{
+	static const int steps[] = { 9, 11, 0, 2, 4, 5, 7 }; // a..g
+	int c = tolower(*s);
+	if (c < 'a' || c > 'g')
+		return -1;
+	int pitch = steps[c - 'a'];
+	++s;
+	if (*s == '#')
+	{
+		++pitch;
+		++s;
+	}
+	else if (*s == 'b' && (s[1] == '-' || isdigit(s[1])))
+	{
+		--pitch;
+		++s;
+	}
+	char* e;
+	long octave = strtol(s, &e, 10);
+	if (e == s || *e)
+		return -1;
+	long v = (octave + 2) * 12 + pitch;
+	if (v < 0 || v > 127)
+		return -1;
+	return v;
+}
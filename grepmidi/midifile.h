@@ -0,0 +1,103 @@
+//=========================================================
+//  OOMidi
+//  OpenOctave Midi and Audio Editor
+//
+//  grepmidi: mapped standard midi file reader
+//=========================================================
+
+#ifndef __GREPMIDI_MIDIFILE_H__
+#define __GREPMIDI_MIDIFILE_H__
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+//---------------------------------------------------------
+//   MidiEvent
+//    data points into the file image, valid as long as
+//    the MidiFile lives
+//---------------------------------------------------------
+
+struct MidiEvent
+{
+	unsigned tick;
+	unsigned short track;
+	unsigned char status; // 0xf0 sysex, 0xff meta
+	unsigned char a;      // note, controller, program, meta type
+	unsigned char b;      // velocity, value
+	const unsigned char* data;
+	unsigned len;
+
+	int type() const
+	{
+		return status >= 0xf0 ? status : (status & 0xf0);
+	}
+	int channel() const
+	{
+		return status & 0xf;
+	}
+};
+
+//---------------------------------------------------------
+//   MidiFile
+//    Maps a file, .gz files are read through gunzip, and
+//    decodes all tracks into one list sorted by tick.
+//---------------------------------------------------------
+
+class MidiFile
+{
+public:
+	enum Error
+	{
+		OK = 0, NOT_FOUND = -1, NO_MTHD = -2, TOO_SHORT = -3, BAD_TYPE = -4,
+		NO_MTRK = -5, NO_RUNNING_STATUS = -6, TRUNCATED = -7
+	};
+
+private:
+	const unsigned char* m_data;
+	size_t m_size;
+	bool m_mapped;
+	std::vector<unsigned char> m_buffer;
+	std::vector<MidiEvent> m_events;
+	int m_format;
+	int m_tracks;
+	int m_division;
+
+	MidiFile(const MidiFile&);
+	MidiFile& operator=(const MidiFile&);
+
+	int readTrack(const unsigned char*& p, const unsigned char* end, int track);
+
+public:
+	MidiFile();
+	~MidiFile();
+
+	//! returns an Error, the events read before one stay
+	int load(const char* path);
+	void close();
+
+	const std::vector<MidiEvent>& events() const
+	{
+		return m_events;
+	}
+	int format() const
+	{
+		return m_format;
+	}
+	int tracks() const
+	{
+		return m_tracks;
+	}
+	int division() const
+	{
+		return m_division;
+	}
+
+	static const char* errorString(int);
+};
+
+std::string pitchName(int pitch);
+//! note name like C3 or f#-1 to pitch, -1 if it is none
+int namePitch(const char* s);
+
+#endif
@@ -0,0 +1,202 @@
+//=========================================================
+//  OOMidi
+//  OpenOctave Midi and Audio Editor
+//
+//  grepmidi: persistent per file summaries
+//=========================================================
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "midifile.h"
+#include "midiindex.h"
+
+// bump when FileSummary or the record layout changes
+static const char indexMagic[8] = { 'G', 'M', 'I', 'D', 'X', 0, 0, 1 };
+
+//---------------------------------------------------------
+//   FileSummary
+//---------------------------------------------------------
+
+FileSummary::FileSummary()
+{
+	memset(this, 0, sizeof(*this));
+}
+
+//---------------------------------------------------------
+//   any
+//---------------------------------------------------------
+
+bool FileSummary::any(const uint32_t* bits, int lo, int hi)
+{
+	if (lo < 0)
+		lo = 0;
+	if (hi > 127)
+		hi = 127;
+	for (int i = lo; i <= hi; ++i)
+	{
+		if ((i & 31) == 0 && i + 31 <= hi)
+		{
+			if (bits[i >> 5])
+				return true;
+			i += 31;
+		}
+		else if (test(bits, i))
+			return true;
+	}
+	return false;
+}
+
+//---------------------------------------------------------
+//   build
+//---------------------------------------------------------
+
+void FileSummary::build(const MidiFile& mf, int rv)
+{
+	*this = FileSummary();
+	error = rv;
+	division = mf.division();
+	const std::vector<MidiEvent>& el = mf.events();
+	if (!el.empty())
+		lastTick = el.back().tick;
+	for (std::vector<MidiEvent>::const_iterator i = el.begin(); i != el.end(); ++i)
+	{
+		switch (i->type())
+		{
+			case 0x90:
+				if (i->b)
+					set(notes, i->a & 0x7f);
+				break;
+			case 0xb0:
+				set(controllers, i->a & 0x7f);
+				break;
+			case 0xc0:
+				set(programs, i->a & 0x7f);
+				break;
+			case 0xe0:
+				flags |= HAS_BEND;
+				break;
+			case 0xf0:
+				flags |= HAS_SYSEX;
+				continue;
+			case 0xff:
+				if (i->a >= 1 && i->a <= 15)
+					flags |= HAS_TEXT;
+				continue;
+		}
+		channels |= 1u << i->channel();
+	}
+}
+
+//---------------------------------------------------------
+//   MidiIndex
+//---------------------------------------------------------
+
+MidiIndex::MidiIndex(const std::string& path)
+: m_path(path), m_dirty(false)
+{
+}
+
+//---------------------------------------------------------
+//   load
+//---------------------------------------------------------
+
+bool MidiIndex::load()
+{
+	FILE* f = fopen(m_path.c_str(), "r");
+	if (f == 0)
+		return access(m_path.c_str(), F_OK) == 0;
+	char magic[sizeof(indexMagic)];
+	if (fread(magic, sizeof(magic), 1, f) != 1 || memcmp(magic, indexMagic, sizeof(magic)) != 0)
+	{
+		// written by another version, start over
+		fclose(f);
+		m_dirty = true;
+		return false;
+	}
+	std::string name;
+	for (;;)
+	{
+		uint32_t len;
+		Entry e;
+		if (fread(&len, sizeof(len), 1, f) != 1)
+			break;
+		name.resize(len);
+		if (len > 65536 || (len && fread(&name[0], len, 1, f) != 1)
+			|| fread(&e, sizeof(e), 1, f) != 1)
+		{
+			m_entries.clear();
+			m_dirty = true;
+			fclose(f);
+			return true;
+		}
+		m_entries[name] = e;
+	}
+	fclose(f);
+	return false;
+}
+
+//---------------------------------------------------------
+//   save
+//---------------------------------------------------------
+
+bool MidiIndex::save()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	std::string tmp = m_path + ".tmp";
+	FILE* f = fopen(tmp.c_str(), "w");
+	if (f == 0)
+		return true;
+	bool rv = fwrite(indexMagic, sizeof(indexMagic), 1, f) != 1;
+	for (std::unordered_map<std::string, Entry>::const_iterator i = m_entries.begin();
+		 !rv && i != m_entries.end(); ++i)
+	{
+		uint32_t len = i->first.size();
+		rv = fwrite(&len, sizeof(len), 1, f) != 1
+			|| fwrite(i->first.data(), len, 1, f) != 1
+			|| fwrite(&i->second, sizeof(i->second), 1, f) != 1;
+	}
+	if (fclose(f) != 0)
+		rv = true;
+	if (!rv)
+		rv = rename(tmp.c_str(), m_path.c_str()) != 0;
+	if (rv)
+		unlink(tmp.c_str());
+	else
+		m_dirty = false;
+	return rv;
+}
+
+//---------------------------------------------------------
+//   lookup
+//---------------------------------------------------------
+
+bool MidiIndex::lookup(const std::string& file, const struct stat& st, FileSummary* summary)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	std::unordered_map<std::string, Entry>::const_iterator i = m_entries.find(file);
+	if (i == m_entries.end())
+		return false;
+	const Entry& e = i->second;
+	if (e.size != st.st_size || e.mtime != st.st_mtim.tv_sec || e.mtimeNsec != st.st_mtim.tv_nsec)
+		return false;
+	*summary = e.summary;
+	return true;
+}
+
+//---------------------------------------------------------
+//   store
+//---------------------------------------------------------
+
+void MidiIndex::store(const std::string& file, const struct stat& st, const FileSummary& summary)
+{
+	Entry e;
+	e.size = st.st_size;
+	e.mtime = st.st_mtim.tv_sec;
+	e.mtimeNsec = st.st_mtim.tv_nsec;
+	e.summary = summary;
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_entries[file] = e;
+	m_dirty = true;
+}
@@ -0,0 +1,101 @@
+//=========================================================
+//  OOMidi
+//  OpenOctave Midi and Audio Editor
+//
+//  grepmidi: persistent per file summaries
+//=========================================================
+
+#ifndef __GREPMIDI_MIDIINDEX_H__
+#define __GREPMIDI_MIDIINDEX_H__
+
+#include <stdint.h>
+#include <sys/stat.h>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+class MidiFile;
+
+//---------------------------------------------------------
+//   FileSummary
+//    what a file contains, coarse enough to stay small and
+//    exact enough to rule out most files for a query
+//---------------------------------------------------------
+
+struct FileSummary
+{
+	enum Flags
+	{
+		HAS_SYSEX = 1, HAS_BEND = 2, HAS_TEXT = 4
+	};
+	uint32_t notes[4];    // pitches with a note on
+	uint32_t controllers[4];
+	uint32_t programs[4];
+	uint32_t channels;    // channels with any channel event
+	uint32_t flags;
+	uint32_t lastTick;
+	uint16_t division;
+	int16_t error;        // MidiFile::Error of the last load
+
+	FileSummary();
+	void build(const MidiFile&, int rv);
+
+	static bool test(const uint32_t* bits, int i)
+	{
+		return bits[i >> 5] & (1u << (i & 31));
+	}
+	static void set(uint32_t* bits, int i)
+	{
+		bits[i >> 5] |= 1u << (i & 31);
+	}
+	//! true if any bit in lo..hi is set
+	static bool any(const uint32_t* bits, int lo, int hi);
+};
+
+//---------------------------------------------------------
+//   MidiIndex
+//    Keyed by path and checked against size and mtime, so
+//    a changed file is read again. Shared by the workers.
+//---------------------------------------------------------
+
+class MidiIndex
+{
+	struct Entry
+	{
+		int64_t size;
+		int64_t mtime;
+		int64_t mtimeNsec;
+		FileSummary summary;
+	};
+
+	std::string m_path;
+	std::unordered_map<std::string, Entry> m_entries;
+	std::mutex m_mutex;
+	bool m_dirty;
+
+	MidiIndex(const MidiIndex&);
+	MidiIndex& operator=(const MidiIndex&);
+
+public:
+	MidiIndex(const std::string& path);
+
+	//! a missing file is an empty index, return true on error
+	bool load();
+	//! written to a temporary file renamed over the old one,
+	//! return true on error
+	bool save();
+	bool dirty() const
+	{
+		return m_dirty;
+	}
+	size_t size() const
+	{
+		return m_entries.size();
+	}
+
+	//! false if there is no entry for the file as st describes it
+	bool lookup(const std::string& file, const struct stat& st, FileSummary* summary);
+	void store(const std::string& file, const struct stat& st, const FileSummary& summary);
+};
+
+#endif
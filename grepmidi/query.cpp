@@ -0,0 +1,536 @@
+//=========================================================
+//  OOMidi
+//  OpenOctave Midi and Audio Editor
+//
+//  grepmidi: event pattern queries
+//=========================================================
+
+#include <algorithm>
+#include <ctype.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "midiindex.h"
+#include "query.h"
+
+//---------------------------------------------------------
+//   tokenize
+//    whitespace separated, double quotes group words
+//---------------------------------------------------------
+
+static bool tokenize(const std::string& s, std::vector<std::string>* tokens)
+{
+	size_t i = 0;
+	while (i < s.size())
+	{
+		if (isspace((unsigned char) s[i]))
+		{
+			++i;
+			continue;
+		}
+		std::string t;
+		if (s[i] == '"')
+		{
+			size_t e = s.find('"', i + 1);
+			if (e == std::string::npos)
+				return true;
+			// keep the quote so a quoted keyword stays a word
+			t = s.substr(i, e - i);
+			i = e + 1;
+		}
+		else
+		{
+			while (i < s.size() && !isspace((unsigned char) s[i]))
+				t += s[i++];
+		}
+		tokens->push_back(t);
+	}
+	return false;
+}
+
+//---------------------------------------------------------
+//   parseNumber
+//---------------------------------------------------------
+
+static bool parseNumber(const std::string& s, bool pitch, int* v)
+{
+	if (s.empty())
+		return false;
+	if (pitch)
+	{
+		int p = namePitch(s.c_str());
+		if (p != -1)
+		{
+			*v = p;
+			return true;
+		}
+	}
+	char* e;
+	long n = strtol(s.c_str(), &e, 0);
+	if (*e || n < 0 || n > INT_MAX)
+		return false;
+	*v = n;
+	return true;
+}
+
+//---------------------------------------------------------
+//   parseRange
+//    n, lo-hi, for pitches also note names as in C3-G#3
+//---------------------------------------------------------
+
+static bool parseRange(const std::string& s, bool pitch, Range* r)
+{
+	int lo, hi;
+	if (parseNumber(s, pitch, &lo))
+	{
+		*r = Range(lo, lo);
+		return true;
+	}
+	// names with negative octaves contain a '-' too, try every split
+	for (size_t i = s.find('-', 1); i != std::string::npos; i = s.find('-', i + 1))
+	{
+		if (parseNumber(s.substr(0, i), pitch, &lo) && parseNumber(s.substr(i + 1), pitch, &hi) && lo <= hi)
+		{
+			*r = Range(lo, hi);
+			return true;
+		}
+	}
+	return false;
+}
+
+//---------------------------------------------------------
+//   Clause::matches
+//---------------------------------------------------------
+
+static bool matchBytes(const int* p, const int* pe, const unsigned char* d, const unsigned char* de)
+{
+	for (; p != pe; ++p)
+	{
+		if (*p == -2)
+		{
+			for (const unsigned char* s = d; s <= de; ++s)
+			{
+				if (matchBytes(p + 1, pe, s, de))
+					return true;
+			}
+			return false;
+		}
+		if (d == de || (*p != -1 && *p != *d))
+			return false;
+		++d;
+	}
+	return true; // the pattern only has to match the start
+}
+
+bool Clause::matches(const MidiEvent& ev) const
+{
+	int type = ev.type();
+	if (type < 0xf0 && !channel.contains(ev.channel()))
+		return false;
+	switch (kind)
+	{
+		case NOTE:
+			return type == 0x90 && ev.b && a.contains(ev.a) && b.contains(ev.b);
+		case CC:
+			return type == 0xb0 && a.contains(ev.a) && b.contains(ev.b);
+		case PROG:
+			return type == 0xc0 && a.contains(ev.a);
+		case BEND:
+			return type == 0xe0;
+		case SYSEX:
+			return type == 0xf0 && matchBytes(bytes.data(), bytes.data() + bytes.size(), ev.data, ev.data + ev.len);
+		case TEXT:
+		{
+			if (type != 0xff || ev.a < 1 || ev.a > 15 || ev.len < text.size())
+				return false;
+			const char* d = (const char*) ev.data;
+			for (size_t i = 0; i + text.size() <= ev.len; ++i)
+			{
+				size_t k = 0;
+				while (k < text.size() && tolower((unsigned char) d[i + k]) == text[k])
+					++k;
+				if (k == text.size())
+					return true;
+			}
+			return false;
+		}
+	}
+	return false;
+}
+
+//---------------------------------------------------------
+//   Clause::mayMatch
+//---------------------------------------------------------
+
+bool Clause::mayMatch(const FileSummary& s) const
+{
+	if (kind != SYSEX && kind != TEXT)
+	{
+		bool ch = false;
+		for (int i = channel.lo; i <= channel.hi && i < 16; ++i)
+			ch = ch || (s.channels & (1u << i));
+		if (!ch)
+			return false;
+	}
+	switch (kind)
+	{
+		case NOTE: return FileSummary::any(s.notes, a.lo, a.hi);
+		case CC: return FileSummary::any(s.controllers, a.lo, a.hi);
+		case PROG: return FileSummary::any(s.programs, a.lo, a.hi);
+		case BEND: return s.flags & FileSummary::HAS_BEND;
+		case SYSEX: return s.flags & FileSummary::HAS_SYSEX;
+		case TEXT: return s.flags & FileSummary::HAS_TEXT;
+	}
+	return true;
+}
+
+//---------------------------------------------------------
+//   Query
+//---------------------------------------------------------
+
+Query::Query()
+: m_sequence(true), m_within(0), m_beats(false), m_from(0), m_to(UINT_MAX), m_rangeBeats(false)
+{
+}
+
+//---------------------------------------------------------
+//   parse
+//---------------------------------------------------------
+
+bool Query::parse(const std::string& s)
+{
+	std::vector<std::string> tl;
+	m_clauses.clear();
+	if (tokenize(s, &tl))
+	{
+		m_error = "unterminated quote";
+		return true;
+	}
+	std::string joiner;
+	bool joined = true;
+	size_t i = 0;
+	while (i < tl.size())
+	{
+		const std::string& t = tl[i++];
+		if (t == "then" || t == "and")
+		{
+			if (m_clauses.empty() || i == tl.size() || (!joiner.empty() && joiner != t))
+			{
+				m_error = "'" + t + "' has to join two patterns, do not mix 'then' and 'and'";
+				return true;
+			}
+			joiner = t;
+			joined = true;
+			continue;
+		}
+		if (t == "within" || t == "in")
+		{
+			if (i == tl.size())
+			{
+				m_error = "'" + t + "' needs a value";
+				return true;
+			}
+			Range r;
+			if (!parseRange(tl[i], false, &r) || (t == "within" && r.lo != r.hi))
+			{
+				m_error = "bad value '" + tl[i] + "' for '" + t + "'";
+				return true;
+			}
+			++i;
+			bool beats = i < tl.size() && (tl[i] == "beats" || tl[i] == "beat");
+			if (beats)
+				++i;
+			else if (i < tl.size() && (tl[i] == "ticks" || tl[i] == "tick"))
+				++i;
+			if (t == "within")
+			{
+				m_within = r.lo;
+				m_beats = beats;
+			}
+			else
+			{
+				m_from = r.lo;
+				m_to = r.hi;
+				m_rangeBeats = beats;
+			}
+			continue;
+		}
+		if (!joined)
+		{
+			m_error = "missing 'then' or 'and' before '" + t + "'";
+			return true;
+		}
+
+		Clause c;
+		c.channel = Range(0, 15);
+		bool pitch = false;
+		if (t == "note")
+		{
+			c.kind = Clause::NOTE;
+			c.b = Range(1, 127);
+			pitch = true;
+		}
+		else if (t == "cc")
+			c.kind = Clause::CC;
+		else if (t == "prog")
+			c.kind = Clause::PROG;
+		else if (t == "bend")
+			c.kind = Clause::BEND;
+		else if (t == "sysex")
+			c.kind = Clause::SYSEX;
+		else if (t == "text")
+			c.kind = Clause::TEXT;
+		else
+		{
+			m_error = "unknown pattern '" + t + "'";
+			return true;
+		}
+
+		if (c.kind == Clause::NOTE || c.kind == Clause::CC || c.kind == Clause::PROG)
+		{
+			if (i == tl.size() || !parseRange(tl[i], pitch, &c.a) || c.a.hi > 127)
+			{
+				m_error = "'" + t + "' needs a value or range from 0 to 127";
+				return true;
+			}
+			++i;
+		}
+		else if (c.kind == Clause::SYSEX)
+		{
+			for (; i < tl.size(); ++i)
+			{
+				const std::string& b = tl[i];
+				if (b == "*")
+					c.bytes.push_back(-2);
+				else if (b == "??" || b == "..")
+					c.bytes.push_back(-1);
+				else if (b.size() <= 4 && isxdigit((unsigned char) b[b.size() - 1]))
+				{
+					char* e;
+					long v = strtol(b.c_str(), &e, 16);
+					if (*e || v < 0 || v > 0xff)
+						break;
+					c.bytes.push_back(v);
+				}
+				else
+					break;
+			}
+			// the event data starts after the f0
+			if (!c.bytes.empty() && c.bytes[0] == 0xf0)
+				c.bytes.erase(c.bytes.begin());
+		}
+		else if (c.kind == Clause::TEXT)
+		{
+			if (i == tl.size())
+			{
+				m_error = "'text' needs a string";
+				return true;
+			}
+			const std::string& s = tl[i++];
+			c.text = s[0] == '"' ? s.substr(1) : s;
+			for (size_t k = 0; k < c.text.size(); ++k)
+				c.text[k] = tolower((unsigned char) c.text[k]);
+		}
+
+		// optional qualifiers
+		while (i + 1 < tl.size())
+		{
+			const std::string& q = tl[i];
+			Range r;
+			if (q == "ch" && c.kind != Clause::SYSEX && c.kind != Clause::TEXT)
+			{
+				if (!parseRange(tl[i + 1], false, &r) || r.lo < 1 || r.hi > 16)
+				{
+					m_error = "channels go from 1 to 16";
+					return true;
+				}
+				c.channel = Range(r.lo - 1, r.hi - 1);
+			}
+			else if ((q == "vel" && c.kind == Clause::NOTE) || (q == "val" && c.kind == Clause::CC))
+			{
+				if (!parseRange(tl[i + 1], false, &r) || r.hi > 127)
+				{
+					m_error = "'" + q + "' needs a value or range from 0 to 127";
+					return true;
+				}
+				c.b = r;
+			}
+			else
+				break;
+			i += 2;
+		}
+		m_clauses.push_back(c);
+		joined = false;
+	}
+	if (m_clauses.empty() || joined)
+	{
+		m_error = m_clauses.empty() ? "empty query" : "missing pattern after '" + joiner + "'";
+		return true;
+	}
+	m_sequence = joiner != "and";
+	m_error.clear();
+	return false;
+}
+
+//---------------------------------------------------------
+//   mayMatch
+//---------------------------------------------------------
+
+bool Query::mayMatch(const FileSummary& s) const
+{
+	unsigned from = m_rangeBeats ? m_from * s.division : m_from;
+	if (from > s.lastTick)
+		return false;
+	for (std::vector<Clause>::const_iterator i = m_clauses.begin(); i != m_clauses.end(); ++i)
+	{
+		if (!i->mayMatch(s))
+			return false;
+	}
+	return true;
+}
+
+//---------------------------------------------------------
+//   find
+//    With "then" every event matching the first pattern
+//    starts a try and the earliest event for each next
+//    pattern is taken, which finds a match if there is
+//    one. With "and" the nearest event of each other
+//    pattern has to be within the window.
+//---------------------------------------------------------
+
+static bool tickLess(const MidiEvent* a, unsigned tick)
+{
+	return a->tick < tick;
+}
+
+int Query::find(const MidiFile& mf, std::vector<Match>* matches, int limit) const
+{
+	const std::vector<MidiEvent>& el = mf.events();
+	unsigned division = mf.division();
+	unsigned from = m_rangeBeats ? m_from * division : m_from;
+	unsigned to = m_rangeBeats && m_to != UINT_MAX ? m_to * division : m_to;
+	unsigned within = m_within == 0 ? UINT_MAX : (m_beats ? m_within * division : m_within);
+
+	size_t n = m_clauses.size();
+	std::vector<std::vector<const MidiEvent*> > hits(n);
+	for (std::vector<MidiEvent>::const_iterator i = el.begin(); i != el.end(); ++i)
+	{
+		if (i->tick < from || i->tick > to)
+			continue;
+		for (size_t k = 0; k < n; ++k)
+		{
+			if (m_clauses[k].matches(*i))
+				hits[k].push_back(&*i);
+		}
+	}
+	for (size_t k = 0; k < n; ++k)
+	{
+		if (hits[k].empty())
+			return 0;
+	}
+
+	int count = 0;
+	Match m;
+	for (std::vector<const MidiEvent*>::const_iterator s = hits[0].begin(); s != hits[0].end(); ++s)
+	{
+		unsigned start = (*s)->tick;
+		m.events.assign(1, *s);
+		for (size_t k = 1; k < n; ++k)
+		{
+			const std::vector<const MidiEvent*>& h = hits[k];
+			if (m_sequence)
+			{
+				// the next event after the previous one, events are in file order
+				std::vector<const MidiEvent*>::const_iterator e =
+					std::upper_bound(h.begin(), h.end(), m.events.back());
+				if (e == h.end() || (*e)->tick - start > within)
+					break;
+				m.events.push_back(*e);
+			}
+			else
+			{
+				// the closest one on either side of the start
+				std::vector<const MidiEvent*>::const_iterator e =
+					std::lower_bound(h.begin(), h.end(), start, tickLess);
+				if (e == h.end() || (e != h.begin() && start - e[-1]->tick < (*e)->tick - start))
+					--e;
+				unsigned d = (*e)->tick > start ? (*e)->tick - start : start - (*e)->tick;
+				if (d > within)
+					break;
+				m.events.push_back(*e);
+			}
+		}
+		if (m.events.size() != n)
+			continue;
+		++count;
+		if (matches)
+			matches->push_back(m);
+		if (limit && count >= limit)
+			break;
+	}
+	return count;
+}
+
+//---------------------------------------------------------
+//   describe
+//---------------------------------------------------------
+
+std::string describe(const MidiEvent& ev)
+{
+	char buffer[128];
+	int ch = ev.channel() + 1;
+	switch (ev.type())
+	{
+		case 0x80:
+			snprintf(buffer, sizeof(buffer), "note off %s ch %d", pitchName(ev.a).c_str(), ch);
+			break;
+		case 0x90:
+			if (ev.b)
+				snprintf(buffer, sizeof(buffer), "note %s vel %d ch %d", pitchName(ev.a).c_str(), ev.b, ch);
+			else
+				snprintf(buffer, sizeof(buffer), "note off %s ch %d", pitchName(ev.a).c_str(), ch);
+			break;
+		case 0xa0:
+			snprintf(buffer, sizeof(buffer), "polyat %s %d ch %d", pitchName(ev.a).c_str(), ev.b, ch);
+			break;
+		case 0xb0:
+			snprintf(buffer, sizeof(buffer), "cc %d val %d ch %d", ev.a, ev.b, ch);
+			break;
+		case 0xc0:
+			snprintf(buffer, sizeof(buffer), "prog %d ch %d", ev.a, ch);
+			break;
+		case 0xd0:
+			snprintf(buffer, sizeof(buffer), "aftertouch %d ch %d", ev.a, ch);
+			break;
+		case 0xe0:
+			snprintf(buffer, sizeof(buffer), "bend %d ch %d", ((ev.b << 7) | ev.a) - 8192, ch);
+			break;
+		case 0xf0:
+		{
+			std::string s("sysex f0");
+			for (unsigned i = 0; i < ev.len && i < 16; ++i)
+			{
+				snprintf(buffer, sizeof(buffer), " %02x", ev.data[i]);
+				s += buffer;
+			}
+			if (ev.len > 16)
+				s += " ...";
+			return s;
+		}
+		case 0xff:
+		{
+			std::string s;
+			snprintf(buffer, sizeof(buffer), "meta %d <", ev.a);
+			s = buffer;
+			if (ev.a >= 1 && ev.a <= 15)
+				s.append((const char*) ev.data, ev.len);
+			return s + ">";
+		}
+		default:
+			buffer[0] = 0;
+			break;
+	}
+	return buffer;
+}
@@ -0,0 +1,107 @@
+//=========================================================
+//  OOMidi
+//  OpenOctave Midi and Audio Editor
+//
+//  grepmidi: event pattern queries
+//=========================================================
+
+#ifndef __GREPMIDI_QUERY_H__
+#define __GREPMIDI_QUERY_H__
+
+#include <string>
+#include <vector>
+
+#include "midifile.h"
+
+struct FileSummary;
+
+//---------------------------------------------------------
+//   Range
+//---------------------------------------------------------
+
+struct Range
+{
+	int lo;
+	int hi;
+
+	Range(int l = 0, int h = 127) : lo(l), hi(h)
+	{
+	}
+	bool contains(int v) const
+	{
+		return v >= lo && v <= hi;
+	}
+};
+
+//---------------------------------------------------------
+//   Clause
+//    one event pattern
+//---------------------------------------------------------
+
+struct Clause
+{
+	enum Kind
+	{
+		NOTE, CC, PROG, BEND, SYSEX, TEXT
+	};
+	Kind kind;
+	Range a;       // pitch, controller, program
+	Range b;       // velocity, value
+	Range channel; // 0 based
+	std::vector<int> bytes; // sysex pattern, -1 is any byte, -2 any run
+	std::string text;       // lower case
+
+	bool matches(const MidiEvent&) const;
+	bool mayMatch(const FileSummary&) const;
+};
+
+//---------------------------------------------------------
+//   Match
+//---------------------------------------------------------
+
+struct Match
+{
+	std::vector<const MidiEvent*> events;
+};
+
+//---------------------------------------------------------
+//   Query
+//    clauses joined by "then" have to follow each other,
+//    clauses joined by "and" only have to be there, both
+//    within the window if one is given
+//---------------------------------------------------------
+
+class Query
+{
+	std::vector<Clause> m_clauses;
+	bool m_sequence;
+	unsigned m_within; // 0 is no limit
+	bool m_beats;      // within is in quarter notes
+	unsigned m_from;
+	unsigned m_to;
+	bool m_rangeBeats;
+	std::string m_error;
+
+public:
+	Query();
+
+	//! return true on error, see error()
+	bool parse(const std::string&);
+	const std::string& error() const
+	{
+		return m_error;
+	}
+	bool empty() const
+	{
+		return m_clauses.empty();
+	}
+
+	//! false if the summary rules out any match
+	bool mayMatch(const FileSummary&) const;
+	//! stops after limit matches, 0 is all
+	int find(const MidiFile&, std::vector<Match>* matches, int limit = 0) const;
+};
+
+std::string describe(const MidiEvent&);
+
+#endif
@@ -233,6 +233,12 @@ void AbstractMidiEditor::removePart(int sn)/*{{{*/
 
 void AbstractMidiEditor::songChanged(int type)/*{{{*/
 {
+	songChanged(SongChange(type));
+}/*}}}*/
+
+void AbstractMidiEditor::songChanged(const SongChange& change)/*{{{*/
+{
+	int type = change.flags();
 	if (type)
 	{
 		if (type & (SC_PART_REMOVED | SC_PART_MODIFIED
@@ -247,7 +253,7 @@ void AbstractMidiEditor::songChanged(int type)/*{{{*/
 			}
 		}
 		if (canvas)
-			canvas->songChanged(type);
+			canvas->songChanged(change);
 
 		if (type & (SC_PART_REMOVED | SC_PART_MODIFIED
 				| SC_PART_INSERTED | SC_TRACK_REMOVED))
@@ -11,6 +11,7 @@
 ///#include "sig.h"
 #include "al/sig.h"
 #include "cobject.h"
+#include "songchange.h"
 #include <QList>
 
 class QGridLayout;
@@ -55,6 +56,7 @@ protected:
 
 public slots:
     void songChanged(int type);
+    void songChanged(const SongChange&);
     void setCurDrumInstrument(int instr);
 
     virtual void updateHScrollRange()
@@ -402,9 +402,9 @@ Composer::Composer(QMainWindow* parent, const char* name)
 	connect(song, SIGNAL(markerChanged(int)), SLOT(markerChanged(int)));
 	connect(song, SIGNAL(songChanged(int)), SLOT(songChanged(int)));
 	connect(song, SIGNAL(composerViewChanged()), SLOT(composerViewChanged()));
-    connect(song, SIGNAL(punchinChanged(bool)), canvas, SLOT(update()));
-    connect(song, SIGNAL(punchoutChanged(bool)), canvas, SLOT(update()));
-    connect(song, SIGNAL(loopChanged(bool)), canvas, SLOT(update()));
+    connect(song, SIGNAL(punchinChanged(bool)), canvas, SLOT(invalidateContent()));
+    connect(song, SIGNAL(punchoutChanged(bool)), canvas, SLOT(invalidateContent()));
+    connect(song, SIGNAL(loopChanged(bool)), canvas, SLOT(invalidateContent()));
 	connect(canvas, SIGNAL(followEvent(int)), hscroll, SLOT(setOffset(int)));
 	connect(canvas, SIGNAL(selectionChanged()), SIGNAL(selectionChanged()));
 	connect(canvas, SIGNAL(dropSongFile(const QString&)), SIGNAL(dropSongFile(const QString&)));
@@ -59,6 +59,8 @@
 #include "traverso_shared/AddRemoveCtrlValues.h"
 #include "traverso_shared/CommandGroup.h"
 #include "CreateTrackDialog.h"
+#include "PartTileCache.h"
+#include "midirecordbuffer.h"
 
 
 class CurveNodeSelection
@@ -325,6 +327,8 @@ ComposerCanvas::ComposerCanvas(int* r, QWidget* parent, int sx, int sy)
 	automation.controllerState = doNothing;
 	automation.moveController = false;
 	_curveNodeSelection = new CurveNodeSelection;
+	m_tileCache = new PartTileCache(this);
+	connect(m_tileCache, SIGNAL(tileReady()), SLOT(invalidateContent()));
 	partsChanged();
 }
 
@@ -2799,28 +2803,6 @@ void ComposerCanvas::drawWavePart(QPainter& p, const QRect& bb, WavePart* wp, co
 	QColor waveFill(config.partWaveColors[i]);
 	QColor waveEdge = QColor(211,193,224);
 	
-	//printf("ComposerCanvas::drawWavePart bb.x:%d bb.y:%d bb.w:%d bb.h:%d  pr.x:%d pr.y:%d pr.w:%d pr.h:%d\n",
-	//  bb.x(), bb.y(), bb.width(), bb.height(), _pr.x(), _pr.y(), _pr.width(), _pr.height());
-	QPolygonF m_monoPolygonTop;
-	QPolygonF m_monoPolygonBottom;
-	
-	QPolygonF m_stereoOnePolygonTop;
-	QPolygonF m_stereoOnePolygonBottom;
-
-	QPolygonF m_stereoTwoPolygonTop;
-	QPolygonF m_stereoTwoPolygonBottom;
-	
-	int firstIn = 1;
-	int stereoOneFirstIn = 1;
-	int stereoTwoFirstIn = 1;
-	
-	p.setPen(QColor(255,0,0));
-
-	QColor green = QColor(49, 175, 197);
-	QColor yellow = QColor(127,12,128);
-	QColor red = QColor(197, 49, 87);
-	QColor rms_color = QColor(0,19,23);
-	
 	if(wp->selected())
 		waveFill = QColor(config.partColors[i]);
 	
@@ -2842,339 +2824,12 @@ void ComposerCanvas::drawWavePart(QPainter& p, const QRect& bb, WavePart* wp, co
 	int x2 = 1;
 	int x1 = rr.x() > pr.x() ? rr.x() : pr.x();
 	x2 += rr.right() < pr.right() ? rr.right() : pr.right();
-	//printf("x1 = %d, x2 = %d\n", x1, x2);
 	if (x1 < 0)
 		x1 = 0;
 	if (x2 > width())
 		x2 = width();
-	int hh = pr.height();
-	int h = hh / 2;
-	int y = pr.y() + h;
-	int drawLines = 1;
-	EventList* el = wp->events();
-	for (iEvent e = el->begin(); e != el->end(); ++e)/*{{{*/
-	{
-		
-		int cc = hh % 2 ? 0 : 1;
-		Event event = e->second;
-		SndFileR f = event.sndFile();
-		if (f.isNull())
-			continue;
-		unsigned channels = f.channels();
-		if (channels == 0)
-		{
-			printf("drawWavePart: channels==0! %s\n", f.name().toLatin1().constData());
-			continue;
-		}
-
-		//printf("SndFileR samples=%d channels=%d event samplepos=%d clipframes=%d event lenframe=%d, event.frame=%d part_start=%d part_length=%d\n", 
-		//		f.samples(), f.channels(), event.spos(), clipframes, event.lenFrame(), event.frame(), wp->frame(), wp->lenFrame());
-
-		int xScale;
-		int pos;
-		int tickstep = rmapxDev(1);
-		int postick = tempomap.frame2tick(wp->frame() + event.frame());
-		int eventx = mapx(postick);
-		int drawoffset;
-		if ((x1 - eventx) < 0)
-			drawoffset = 0;
-		else
-			drawoffset = rmapxDev(x1 - eventx);
-		postick += drawoffset;
-		pos = event.spos() + tempomap.tick2frame(postick) - wp->frame() - event.frame();
-
-		int i;
-		if (x1 < eventx)
-			i = eventx;
-		else
-			i = x1;
-		int ex = mapx(tempomap.frame2tick(wp->frame() + event.frame() + event.lenFrame()));
-		if (ex > x2)
-			ex = x2;
-		if (h < 41)
-		{
-			//
-			//    combine multi channels into one waveform
-			//
-			//printf("ComposerCanvas::drawWavePart i:%d ex:%d\n", i, ex);  // REMOVE Tim.
-			if(drawLines == 0)
-			{
-				for (; i < ex; i++)//{{{
-				{
-					int hm = hh / 2;
-					SampleV sa[channels];
-					xScale = tempomap.deltaTick2frame(postick, postick + tickstep);
-					f.read(sa, xScale, pos);
-					postick += tickstep;
-					pos += xScale;
-					int peak = 0;
-					int rms = 0;
-					for (unsigned k = 0; k < channels; ++k)
-					{
-						if (sa[k].peak > peak)
-							peak = sa[k].peak;
-						rms += sa[k].rms;
-					}
-					rms /= channels;
-					peak = (peak * (hh - 2)) >> 9;
-					rms = (rms * (hh - 2)) >> 9;
-					
-					p.setPen(green);
-					
-					p.drawLine(i, y - peak - cc, i, y + peak);
-					p.setPen(rms_color);
-					p.drawLine(i, y - rms - cc, i, y + rms);
-				
-					if(peak >= (hm - 2))
-					{
-						p.setPen(QColor(255,0,0));
-						p.drawLine(i, y - peak - cc, i, y - peak - cc + 1);
-						p.drawLine(i, y + peak - 1, i, y + peak);
-					}	
-				}//}}}
-			}
-			else
-			{
-				int hm = 0;
-				for (; i < ex; i++)//{{{//drawMonoWave
-				{
-					if(firstIn == 1)
-					{
-						m_monoPolygonTop.append(QPointF(i, y));
-						m_monoPolygonBottom.append(QPointF(i, y));
-						firstIn = 0;
-					}
-					hm = hh / 2;
-					SampleV sa[channels];
-					xScale = tempomap.deltaTick2frame(postick, postick + tickstep);
-					
-					if(xmag <= -301)/*{{{*/
-					{
-						if( i % 10==1 || i % 10==2 || i % 10==3 || i % 10==4 || i % 10==5 || i % 10 == 7 || i % 10==8 || i % 10==9)
-						{ 
-							postick += tickstep;
-							pos += xScale;
-	  						continue;
-	 					}
-					}
-					else if(xmag <= -41)
-					{
-						if( i % 10==1 || i % 10==2 || i % 10==4 || i % 10==5 || i % 10 == 7 || i % 10==8)
-						{ 
-							postick += tickstep;
-							pos += xScale;
-	  						continue;
-	 					}
-					}
-					else if(xmag <= -15)
-					{
-						if( i % 2==0)
-						{ 
-							postick += tickstep;
-							pos += xScale;
-	  						continue;
-	 					}
-					}/*}}}*/
-					f.read(sa, xScale, pos); //this read is slow
-					postick += tickstep;
-					pos += xScale;
-					int peak = 0;
-					int rms = 0;
-					for (unsigned k = 0; k < channels; ++k)
-					{
-						if (sa[k].peak > peak)
-							peak = sa[k].peak;
-						rms += sa[k].rms;
-					}
-					rms /= channels;
-					peak = (peak * (hh - 2)) >> 9;
-					rms = (rms * (hh - 2)) >> 9;
-				
-					m_monoPolygonTop.append(QPointF(i, y-peak));
-					m_monoPolygonBottom.append(QPointF(i, y+peak));
-					
-					if(peak >= (hm - 2))
-					{
-						p.drawLine(i, y - peak - cc, i, y - peak - cc + 1);
-						p.drawLine(i, y + peak - 1, i, y + peak);
-					}
-					
-				}//}}}
-				m_monoPolygonTop.append(QPointF(i, y));
-				m_monoPolygonBottom.append(QPointF(i, y));
-				
-				p.setPen(Qt::NoPen);//this is the outline of the wave
-				p.setBrush(waveFill);//waveFill);//this is the fill color of the wave
-				
-				p.drawPolygon(m_monoPolygonTop);
-				p.drawPolygon(m_monoPolygonBottom);
-				firstIn = 1;
-				
-			}
-		}
-		else
-		{
-			//
-			//  multi channel display
-			//
-			int hm = hh / (channels * 2);
-			int cliprange = 1;
-			//TODO: I need to base the calculation for clipping on the actual sample and db and not on the height of the track.
-			if(hm < 50)
-				cliprange = 2;
-			else if(hm >= 50 && hm <= 200)
-				cliprange = 3;
-			else if(hm < 300)
-				cliprange = 5;
-			else
-				cliprange = 6;
+	m_tileCache->drawWave(p, wp, pr, x1, x2, waveFill, xmag, xpos + rmapx(xorg));
 
-			int cc = hh % (channels * 2) ? 0 : 1;
-			//printf("channels = %d, pr = %d, h = %d, hh = %d, hm = %d\n", channels, pr.height(), h, hh, hm);
-			//printf("canvas height: %d\n", height());
-			if(drawLines == 0)
-			{
-				for (; i < ex; i++)//{{{ //stereo line draw mode
-				{
-					y = pr.y() + hm;
-					SampleV sa[channels];
-					xScale = tempomap.deltaTick2frame(postick, postick + tickstep);
-					f.read(sa, xScale, pos);
-					postick += tickstep;
-					pos += xScale;
-					for (unsigned k = 0; k < channels; ++k)
-					{
-						int peak = (sa[k].peak * (hm - 1)) >> 8;
-						int rms = (sa[k].rms * (hm - 1)) >> 8;
-						if(k == 0)
-						{
-							p.setPen(green);
-							p.drawLine(i, y - peak - cc, i, y + peak);
-						}
-						else
-						{
-							p.setPen(green);
-							p.drawLine(i, y - peak - cc, i, y + peak);
-							
-						}
-						//printf("peak value: %d hm value: %d\n", peak, hm);
-						if(peak >= (hm - cliprange))
-						{
-							p.setPen(QColor(255,0,0));
-							p.drawLine(i, y - peak - cc, i, y - peak - cc + 1);
-							p.drawLine(i, y + peak - 1, i, y + peak);
-						}	
-						p.setPen(rms_color);
-						p.drawLine(i, y - rms - cc, i, y + rms);
-						
-						if(k == 0)
-						{
-							p.setPen(QColor(102,177,205));
-							p.drawLine(0, y, width(), y);
-						}
-						else
-						{
-							p.setPen(QColor(213,93,93));
-							p.drawLine(0, y, width(), y);
-						}
-
-						y += 2 * hm;
-					}
-				}//}}}
-			}
-			else
-			{
-				int stereoOneY = 0;
-				int stereoTwoY = 0;
-				for (; i < ex; i++)//{{{ //stereo curve draw mode
-				{
-					y = pr.y() + hm;
-					SampleV sa[channels];
-					xScale = tempomap.deltaTick2frame(postick, postick + tickstep);
-					if(xmag <= -301)/*{{{*/
-					{
-						if( i % 10==1 || i % 10==2 || i % 10==3 || i % 10==4 || i % 10==5 || i % 10 == 7 || i % 10==8 || i % 10==9)
-						{ 
-							postick += tickstep;
-							pos += xScale;
-	  						continue;
-	 					}
-					}
-					else if(xmag <= -41)
-					{
-						if( i % 10==1 || i % 10==2 || i % 10==4 || i % 10==5 || i % 10 == 7 || i % 10==8)
-						{ 
-							postick += tickstep;
-							pos += xScale;
-	  						continue;
-	 					}
-					}
-					else if(xmag <= -15)
-					{
-						if( i % 2==0)
-						{ 
-							postick += tickstep;
-							pos += xScale;
-	  						continue;
-	 					}
-					}/*}}}*/
-					f.read(sa, xScale, pos);
-					postick += tickstep;
-					pos += xScale;
-					for (unsigned k = 0; k < channels; ++k)
-					{
-						int peak = (sa[k].peak * (hm - 1)) >> 8;
-						if(k == 0)
-						{
-							stereoOneY = y;
-							if(stereoOneFirstIn == 1)
-							{
-								m_stereoOnePolygonTop.append(QPointF(i, stereoOneY));
-								m_stereoOnePolygonBottom.append(QPointF(i, stereoOneY));
-								stereoOneFirstIn = 0;
-							}
-							m_stereoOnePolygonTop.append(QPointF(i, y-peak));
-							m_stereoOnePolygonBottom.append(QPointF(i, y+peak));
-						}
-						else
-						{
-							stereoTwoY = y;
-							if(stereoTwoFirstIn == 1)
-							{
-								m_stereoTwoPolygonTop.append(QPointF(i, stereoTwoY));
-								m_stereoTwoPolygonBottom.append(QPointF(i, stereoTwoY));
-								stereoTwoFirstIn = 0;
-							}
-							m_stereoTwoPolygonTop.append(QPointF(i, y-peak));
-							m_stereoTwoPolygonBottom.append(QPointF(i, y+peak));
-						}
-						//printf("peak value: %d hm value: %d\n", peak, hm);
-						if(peak >= (hm - cliprange))
-						{
-							p.drawLine(i, y - peak - cc, i, y - peak - cc + 1);
-							p.drawLine(i, y + peak - 1, i, y + peak);
-						}	
-
-						y += 2 * hm;
-					}
-				}//}}}
-				m_stereoOnePolygonTop.append(QPointF(i, stereoOneY));
-				m_stereoOnePolygonBottom.append(QPointF(i, stereoOneY));
-				m_stereoTwoPolygonTop.append(QPointF(i, stereoTwoY));
-				m_stereoTwoPolygonBottom.append(QPointF(i, stereoTwoY));
-				
-				p.setPen(Qt::NoPen);//this is the outline of the wave
-				p.setBrush(waveFill);//this is the fill color of the wave
-				
-				p.drawPolygon(m_stereoOnePolygonTop);
-				p.drawPolygon(m_stereoOnePolygonBottom);
-				p.drawPolygon(m_stereoTwoPolygonTop);
-				p.drawPolygon(m_stereoTwoPolygonBottom);
-				stereoOneFirstIn = 1;
-				stereoTwoFirstIn = 1;
-			}
-		}
-	}/*}}}*/
 	QColor fadeColor(config.partColors[i]);
 	fadeColor.setAlpha(120);
 	QPen greenPen(fadeColor);
@@ -3609,7 +3264,7 @@ void ComposerCanvas::pasteAutomation()/*{{{*/
 			}
 		}
 	}
-	update();
+	invalidateContent();
 }/*}}}*/
 
 //---------------------------------------------------------
@@ -4384,10 +4039,31 @@ void ComposerCanvas::drawTopItem(QPainter& p, const QRect& rect)
         }
         yy += track->height();
     }
+}
 
+//---------------------------------------------------------
+//   drawPositionLayer
+//    parts and notes as they are recorded grow with the
+//    play position, so they are drawn with it
+//---------------------------------------------------------
 
-	QRect rr = p.worldMatrix().mapRect(rect);
+void ComposerCanvas::drawPositionLayer(QPainter& p, const QRect& r)
+{
+	QRect rect = devToVirt(r);
+	setPainter(p);
+	drawRecording(p, rect);
+	Canvas::drawPositionLayer(p, r);
+}
 
+//---------------------------------------------------------
+//   drawRecording
+//---------------------------------------------------------
+
+void ComposerCanvas::drawRecording(QPainter& p, const QRect& rect)
+{
+	if (!song->record() || !audio->isPlaying())
+		return;
+	TrackList* tl = song->visibletracks();
 	unsigned int startPos = audio->getStartRecordPos().tick();
     if (song->punchin())
 		startPos = song->lpos();
@@ -4434,39 +4110,21 @@ void ComposerCanvas::drawTopItem(QPainter& p, const QRect& rect)
 				MidiTrack *mt = (MidiTrack*)track;
 				int mypos = track2Y(track);
 				QRect partRect(startPos, mypos, song->cpos()-startPos, track->height());
-				EventList newEventList;
-				MPEventList *el = mt->mpevents();
-				if (!el->size())
+				// converted at every heartbeat, held notes reach up to the play position
+				MidiRecordBuffer* rb = mt->recordBuffer();
+				EventList* el = rb->events();
+				EventList held;
+				unsigned origin = rb->origin();
+				rb->heldNotes(&held, song->cpos());
+				if (el->empty() && held.empty())
 					continue;
 
-				for (iMPEvent i = el->begin(); i != el->end(); ++i)
-				{
-					MidiPlayEvent pe = *i;
-
-					if (pe.isNote() && !pe.isNoteOff()) {
-						Event e(Note);
-						e.setPitch(pe.dataA());
-						e.setTick(pe.time()-startPos);
-						e.setLenTick(song->cpos()-pe.time());
-						e.setC(1);
-						newEventList.add(e);
-					}
-					else if (pe.isNoteOff())
-					{
-						for (iEvent i = newEventList.begin(); i != newEventList.end(); ++i)
-						{
-							Event &e = i->second;
-							if (e.pitch() == pe.dataA() && e.dataC() == 1)
-							{
-								e.setLenTick(pe.time() - e.tick()- startPos);
-								e.setC(0);
-								continue;
-							}
-						}
-					}
-				}
+				// the take's ticks start at its origin
+				int from = startPos > origin ? startPos - origin : 0;
+				int to = song->cpos() > origin ? song->cpos() - origin : 0;
 				QColor c(0,0,0);
-				drawMidiPart(p, rect, &newEventList, mt, partRect, startPos, 0, (song->cpos() - startPos), c);
+				drawMidiPart(p, rect, el, mt, partRect, origin, from, to, c);
+				drawMidiPart(p, rect, &held, mt, partRect, origin, from, to, c);
 			}
 		}
     }
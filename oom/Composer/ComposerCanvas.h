@@ -28,6 +28,7 @@ class QEvent;
 class QDragEnterEvent;
 class QPoint;
 class FadeCurve;
+class PartTileCache;
 
 #define beats     4
 
@@ -97,6 +98,7 @@ class ComposerCanvas : public Canvas
     bool unselectNodes;
 	bool show_tip;
 	bool build_icons;
+    PartTileCache* m_tileCache;
 
     AutomationObject automation;
     CurveNodeSelection* _curveNodeSelection;
@@ -153,6 +155,7 @@ class ComposerCanvas : public Canvas
     void drawAudioTrack(QPainter& p, const QRect& r, AudioTrack* track);
     void drawAutomation(QPainter& p, const QRect& r, AudioTrack* track, Track* rt=0);
     void drawTopItem(QPainter& p, const QRect& rect);
+    void drawRecording(QPainter& p, const QRect& rect);
 	void drawTooltipText(QPainter& p, const QRect& rr, int height, double lazySelNodeVal, double lazySelNodePrevVal, int lazySelNodeFrame, bool paintAsDb, CtrlList*);
 
     void checkAutomation(Track * t, const QPoint& pointer, bool addNewCtrl);
@@ -165,6 +168,7 @@ class ComposerCanvas : public Canvas
 
 protected:
     virtual void drawCanvas(QPainter&, const QRect&);
+    virtual void drawPositionLayer(QPainter&, const QRect&);
 
 signals:
     void timeChanged(unsigned);
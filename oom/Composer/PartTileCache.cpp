@@ -0,0 +1,429 @@
+//=========================================================
+//  OOMidi
+//  OpenOctave Midi and Audio Editor
+//=========================================================
+
+#include <QMetaObject>
+#include <QMutexLocker>
+#include <QPainter>
+#include <QPolygonF>
+#include <QRunnable>
+#include <QThread>
+
+#include "PartTileCache.h"
+#include "event.h"
+#include "globals.h"
+#include "part.h"
+#include "tempo.h"
+
+// total size of the cached tiles, in kbytes
+static const int CACHE_COST = 64 * 1024;
+// columns rendered beyond the tile edges, so the outline
+// of a decimated wave does not drop to zero at the seams
+static const int MARGIN = 10;
+
+//---------------------------------------------------------
+//   Job
+//    Deleted by the gui thread in collect(), so the file
+//    references it holds never change hands.
+//---------------------------------------------------------
+
+class PartTileCache::Job : public QRunnable
+{
+public:
+    PartTileCache* cache;
+    TileKey key;
+    int generation;
+    QColor fill;
+    QList<WaveSegment> segments;
+    QImage* image;
+
+    Job()
+    {
+        setAutoDelete(false);
+        image = 0;
+    }
+    virtual void run();
+};
+
+//---------------------------------------------------------
+//   tile helpers
+//    the same mapping as View::rmapx() and rmapxDev()
+//---------------------------------------------------------
+
+static int tickToColumn(int tick, float xmag)
+{
+    if (xmag < 0)
+        return (tick - xmag / 2) / (-xmag);
+    return tick * xmag;
+}
+
+static int columnsToTicks(int x, float xmag)
+{
+    if (xmag <= 0)
+        return x * (-xmag);
+    return (x + xmag / 2) / xmag;
+}
+
+static int tileIndex(int column)
+{
+    if (column < 0)
+        return (column + 1) / PartTileCache::TILE_WIDTH - 1;
+    return column / PartTileCache::TILE_WIDTH;
+}
+
+//---------------------------------------------------------
+//   skipColumn
+//    only every few columns are read when zoomed out far.
+//    Uses the absolute column, so the choice does not
+//    change while scrolling.
+//---------------------------------------------------------
+
+static bool skipColumn(int c, float xmag)
+{
+    int d = c % 10;
+    if (xmag <= -301)
+        return d != 0 && d != 6;
+    if (xmag <= -41)
+        return d == 1 || d == 2 || d == 4 || d == 5 || d == 7 || d == 8;
+    if (xmag <= -15)
+        return c % 2 == 0;
+    return false;
+}
+
+//---------------------------------------------------------
+//   renderTile
+//    draws the waveforms as filled outlines with clip
+//    marks, one outline for all channels of small tracks
+//---------------------------------------------------------
+
+static void renderTile(QImage& image, QList<WaveSegment>& segments, int firstColumn, float xmag, const QColor& fill)
+{
+    QPainter p(&image);
+    QColor red(255, 0, 0);
+    int hh = image.height();
+
+    for (int s = 0; s < segments.size(); ++s)
+    {
+        WaveSegment& seg = segments[s];
+        unsigned channels = seg.channels;
+        int n = seg.x1 - seg.x0;
+        SampleV sa[channels];
+        p.setPen(red);
+
+        if (hh / 2 < 41)
+        {
+            //
+            //    combine multi channels into one waveform
+            //
+            int y = hh / 2;
+            int hm = hh / 2;
+            int cc = hh % 2 ? 0 : 1;
+            QPolygonF top;
+            QPolygonF bottom;
+            top.append(QPointF(seg.x0 - firstColumn, y));
+            bottom.append(QPointF(seg.x0 - firstColumn, y));
+            for (int j = 0; j < n; ++j)
+            {
+                int c = seg.x0 + j;
+                if (skipColumn(c, xmag))
+                    continue;
+                int x = c - firstColumn;
+                seg.file.read(sa, seg.mag[j], seg.pos[j]);
+                int peak = 0;
+                for (unsigned k = 0; k < channels; ++k)
+                {
+                    if (sa[k].peak > peak)
+                        peak = sa[k].peak;
+                }
+                peak = (peak * (hh - 2)) >> 9;
+                top.append(QPointF(x, y - peak));
+                bottom.append(QPointF(x, y + peak));
+                if (peak >= (hm - 2))
+                {
+                    p.drawLine(x, y - peak - cc, x, y - peak - cc + 1);
+                    p.drawLine(x, y + peak - 1, x, y + peak);
+                }
+            }
+            top.append(QPointF(seg.x1 - firstColumn, y));
+            bottom.append(QPointF(seg.x1 - firstColumn, y));
+
+            p.setPen(Qt::NoPen);
+            p.setBrush(fill);
+            p.drawPolygon(top);
+            p.drawPolygon(bottom);
+        }
+        else
+        {
+            //
+            //  multi channel display
+            //
+            int hm = hh / (channels * 2);
+            int cliprange;
+            if (hm < 50)
+                cliprange = 2;
+            else if (hm <= 200)
+                cliprange = 3;
+            else if (hm < 300)
+                cliprange = 5;
+            else
+                cliprange = 6;
+            int cc = hh % (channels * 2) ? 0 : 1;
+
+            QPolygonF oneTop, oneBottom, twoTop, twoBottom;
+            int oneY = hm;
+            int twoY = 3 * hm;
+            oneTop.append(QPointF(seg.x0 - firstColumn, oneY));
+            oneBottom.append(QPointF(seg.x0 - firstColumn, oneY));
+            twoTop.append(QPointF(seg.x0 - firstColumn, twoY));
+            twoBottom.append(QPointF(seg.x0 - firstColumn, twoY));
+            for (int j = 0; j < n; ++j)
+            {
+                int c = seg.x0 + j;
+                if (skipColumn(c, xmag))
+                    continue;
+                int x = c - firstColumn;
+                seg.file.read(sa, seg.mag[j], seg.pos[j]);
+                int y = hm;
+                for (unsigned k = 0; k < channels; ++k)
+                {
+                    int peak = (sa[k].peak * (hm - 1)) >> 8;
+                    if (k == 0)
+                    {
+                        oneTop.append(QPointF(x, y - peak));
+                        oneBottom.append(QPointF(x, y + peak));
+                    }
+                    else
+                    {
+                        twoTop.append(QPointF(x, y - peak));
+                        twoBottom.append(QPointF(x, y + peak));
+                    }
+                    if (peak >= (hm - cliprange))
+                    {
+                        p.drawLine(x, y - peak - cc, x, y - peak - cc + 1);
+                        p.drawLine(x, y + peak - 1, x, y + peak);
+                    }
+                    y += 2 * hm;
+                }
+            }
+            oneTop.append(QPointF(seg.x1 - firstColumn, oneY));
+            oneBottom.append(QPointF(seg.x1 - firstColumn, oneY));
+            twoTop.append(QPointF(seg.x1 - firstColumn, twoY));
+            twoBottom.append(QPointF(seg.x1 - firstColumn, twoY));
+
+            p.setPen(Qt::NoPen);
+            p.setBrush(fill);
+            p.drawPolygon(oneTop);
+            p.drawPolygon(oneBottom);
+            if (channels > 1)
+            {
+                p.drawPolygon(twoTop);
+                p.drawPolygon(twoBottom);
+            }
+        }
+    }
+}
+
+//---------------------------------------------------------
+//   run
+//    worker thread
+//---------------------------------------------------------
+
+void PartTileCache::Job::run()
+{
+    if (cache->m_generation.loadAcquire() == generation)
+    {
+        image = new QImage(TILE_WIDTH, key.height, QImage::Format_ARGB32_Premultiplied);
+        image->fill(0);
+        renderTile(*image, segments, key.index * TILE_WIDTH, key.xmag, fill);
+    }
+    cache->finished(this);
+}
+
+//---------------------------------------------------------
+//   PartTileCache
+//---------------------------------------------------------
+
+PartTileCache::PartTileCache(QObject* parent)
+: QObject(parent)
+{
+    m_tiles.setMaxCost(CACHE_COST);
+    int threads = QThread::idealThreadCount() - 1;
+    m_pool.setMaxThreadCount(threads < 1 ? 1 : threads);
+    m_generation.storeRelease(0);
+    m_lastXmag = 0;
+}
+
+PartTileCache::~PartTileCache()
+{
+    m_pool.waitForDone();
+    qDeleteAll(m_done);
+}
+
+//---------------------------------------------------------
+//   serial
+//    changes with the events and position of the part,
+//    the tempo map and the peak files
+//---------------------------------------------------------
+
+uint PartTileCache::serial(WavePart* wp) const
+{
+    EventList* el = wp->events();
+    uint s = el->revision();
+    s = s * 31u + wp->frame();
+    s = s * 31u + wp->lenFrame();
+    s = s * 31u + tempomap.tempoSN();
+    for (iEvent e = el->begin(); e != el->end(); ++e)
+    {
+        SndFileR f = e->second.sndFile();
+        if (!f.isNull())
+            s = s * 31u + f.cacheSN();
+    }
+    return s;
+}
+
+//---------------------------------------------------------
+//   drawWave
+//    gui thread
+//---------------------------------------------------------
+
+void PartTileCache::drawWave(QPainter& p, WavePart* wp, const QRect& pr, int x1, int x2,
+        const QColor& fill, float xmag, int scroll)
+{
+    if (pr.height() <= 0 || x1 >= x2)
+        return;
+    if (xmag != m_lastXmag)
+    {
+        // whatever is still queued for the old zoom is useless
+        m_generation.fetchAndAddOrdered(1);
+        m_lastXmag = xmag;
+    }
+
+    TileKey key;
+    key.partSn = wp->sn();
+    key.xmag = xmag;
+    key.height = pr.height();
+    key.color = fill.rgba();
+    key.serial = serial(wp);
+
+    int last = tileIndex(x2 - 1 + scroll);
+    for (int k = tileIndex(x1 + scroll); k <= last; ++k)
+    {
+        key.index = k;
+        QImage* image = m_tiles.object(key);
+        if (image)
+        {
+            if (!image->isNull())
+                p.drawImage(k * TILE_WIDTH - scroll, pr.y(), *image);
+        }
+        else if (!m_pending.contains(key))
+            request(key, wp, pr, scroll);
+    }
+}
+
+//---------------------------------------------------------
+//   request
+//    Works out the file positions of every column of the
+//    tile and queues it. Tiles without any wave are
+//    cached as null images right away.
+//---------------------------------------------------------
+
+void PartTileCache::request(const TileKey& key, WavePart* wp, const QRect& pr, int scroll)
+{
+    Job* job = new Job;
+    job->cache = this;
+    job->key = key;
+    job->generation = m_generation.loadAcquire();
+    job->fill = QColor::fromRgba(key.color);
+
+    float xmag = key.xmag;
+    int tickstep = columnsToTicks(1, xmag);
+    int from = key.index * TILE_WIDTH - MARGIN;
+    int to = (key.index + 1) * TILE_WIDTH + MARGIN;
+    if (from < pr.x() + scroll)
+        from = pr.x() + scroll;
+    if (to > pr.right() + 1 + scroll)
+        to = pr.right() + 1 + scroll;
+
+    EventList* el = wp->events();
+    for (iEvent e = el->begin(); e != el->end(); ++e)
+    {
+        Event event = e->second;
+        SndFileR f = event.sndFile();
+        if (f.isNull() || f.channels() == 0)
+            continue;
+        unsigned start = wp->frame() + event.frame();
+        int eventTick = tempomap.frame2tick(start);
+        int eventx = tickToColumn(eventTick, xmag);
+        int ex = tickToColumn(tempomap.frame2tick(start + event.lenFrame()), xmag);
+        int x0 = eventx > from ? eventx : from;
+        int x1 = ex < to ? ex : to;
+        if (x0 >= x1)
+            continue;
+
+        // files at another rate are resampled while playing
+        double rate = sampleRate ? double(f.samplerate()) / sampleRate : 1.0;
+
+        WaveSegment seg;
+        seg.file = f;
+        seg.channels = f.channels();
+        seg.x0 = x0;
+        seg.x1 = x1;
+        seg.pos.resize(x1 - x0);
+        seg.mag.resize(x1 - x0);
+        for (int c = x0; c < x1; ++c)
+        {
+            int postick = eventTick + columnsToTicks(c - eventx, xmag);
+            seg.pos[c - x0] = unsigned((event.spos() + tempomap.tick2frame(postick) - start) * rate);
+            seg.mag[c - x0] = qMax(1, int(tempomap.deltaTick2frame(postick, postick + tickstep) * rate));
+        }
+        job->segments.append(seg);
+    }
+
+    if (job->segments.isEmpty())
+    {
+        m_tiles.insert(key, new QImage(), 1);
+        delete job;
+        return;
+    }
+    m_pending.insert(key);
+    m_pool.start(job);
+}
+
+//---------------------------------------------------------
+//   finished
+//    worker thread
+//---------------------------------------------------------
+
+void PartTileCache::finished(Job* job)
+{
+    QMutexLocker locker(&m_doneMutex);
+    m_done.append(job);
+    if (m_done.size() == 1)
+        QMetaObject::invokeMethod(this, "collect", Qt::QueuedConnection);
+}
+
+//---------------------------------------------------------
+//   collect
+//    gui thread, moves finished tiles into the cache
+//---------------------------------------------------------
+
+void PartTileCache::collect()
+{
+    QList<Job*> done;
+    {
+        QMutexLocker locker(&m_doneMutex);
+        done.swap(m_done);
+    }
+    for (int i = 0; i < done.size(); ++i)
+    {
+        Job* job = done[i];
+        m_pending.remove(job->key);
+        if (job->image)
+            m_tiles.insert(job->key, job->image, job->image->byteCount() / 1024 + 1);
+        delete job;
+    }
+    // skipped tiles are requested again by the repaint
+    if (!done.isEmpty())
+        emit tileReady();
+}
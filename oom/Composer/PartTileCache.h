@@ -0,0 +1,124 @@
+//=========================================================
+//  OOMidi
+//  OpenOctave Midi and Audio Editor
+//
+//  cached waveform tiles for the Composer
+//=========================================================
+
+#ifndef __PARTTILECACHE_H__
+#define __PARTTILECACHE_H__
+
+#include <QAtomicInt>
+#include <QCache>
+#include <QColor>
+#include <QImage>
+#include <QList>
+#include <QMutex>
+#include <QObject>
+#include <QRect>
+#include <QSet>
+#include <QThreadPool>
+#include <QVector>
+
+#include "wave.h"
+
+class QPainter;
+class WavePart;
+
+//---------------------------------------------------------
+//   TileKey
+//    A tile is TILE_WIDTH pixels of one part at one zoom,
+//    counted from tick 0. serial changes whenever anything
+//    the tile was drawn from changes.
+//---------------------------------------------------------
+
+struct TileKey
+{
+    int partSn;
+    int index;
+    float xmag;
+    int height;
+    QRgb color;
+    uint serial;
+
+    bool operator==(const TileKey& k) const
+    {
+        return partSn == k.partSn && index == k.index && xmag == k.xmag
+                && height == k.height && color == k.color && serial == k.serial;
+    }
+};
+
+inline uint qHash(const TileKey& k)
+{
+    return uint(k.partSn) * 31u + uint(k.index) * 131u + uint(int(k.xmag * 16.0f)) * 8191u
+            + uint(k.height) * 524287u + k.color + k.serial * 2u;
+}
+
+//---------------------------------------------------------
+//   WaveSegment
+//    one wave event within a tile. The sample position and
+//    width of every column are worked out in the gui
+//    thread, so the renderer never touches the tempo map.
+//    Segments are created and destroyed in the gui thread,
+//    the renderer only reads through file.
+//---------------------------------------------------------
+
+struct WaveSegment
+{
+    SndFileR file;
+    unsigned channels;
+    int x0, x1;              // absolute columns
+    QVector<unsigned> pos;   // per column, first frame
+    QVector<int> mag;        // per column, frames
+};
+
+//---------------------------------------------------------
+//   PartTileCache
+//    Renders the waveforms of wave parts into fixed size
+//    images on a thread pool and keeps the most recently
+//    used ones. Scrolling and playhead updates only blit
+//    images. A missing tile is queued and left empty
+//    until it is ready, then tileReady() is emitted.
+//    Tiles are never invalidated, edits change the key.
+//---------------------------------------------------------
+
+class PartTileCache : public QObject
+{
+    Q_OBJECT
+
+    class Job;
+    friend class Job;
+
+    QCache<TileKey, QImage> m_tiles;
+    QSet<TileKey> m_pending;
+    QThreadPool m_pool;
+    QAtomicInt m_generation;
+    float m_lastXmag;
+
+    QMutex m_doneMutex;
+    QList<Job*> m_done;
+
+    uint serial(WavePart* wp) const;
+    void request(const TileKey& key, WavePart* wp, const QRect& pr, int scroll);
+    void finished(Job* job);
+
+private slots:
+    void collect();
+
+signals:
+    void tileReady();
+
+public:
+    enum { TILE_WIDTH = 256 };
+
+    PartTileCache(QObject* parent = 0);
+    ~PartTileCache();
+
+    // pr is the part rectangle in device coordinates with p
+    // untransformed, x1 - x2 the columns to paint and scroll
+    // the absolute column of device x 0
+    void drawWave(QPainter& p, WavePart* wp, const QRect& pr, int x1, int x2,
+            const QColor& fill, float xmag, int scroll);
+};
+
+#endif
@@ -33,12 +33,16 @@
 #include "audio.h"
 #include "audiodev.h"
 #include "audioprefetch.h"
+#include "audiorecorder.h"
+#include "offlinerender.h"
 #include "apconfig.h"
 #include "bigtime.h"
 #include "cliplist/cliplist.h"
 #include "conf.h"
 #include "debug.h"
 #include "didyouknow.h"
+#include "dspprofiler.h"
+#include "widgets/dspprofilerview.h"
 #include "filedialog.h"
 #include "gatetime.h"
 #include "gconfig.h"
@@ -48,6 +52,7 @@
 #include "listedit.h"
 #include "marker/markerview.h"
 #include "master/masteredit.h"
+#include "meterbus.h"
 #include "metronome.h"
 #include "midiseq.h"
 #include "midiport.h"
@@ -288,6 +293,8 @@ bool OOMidi::seqStart()
 	midiMonitor->start(monitorprio);
 
 	audioPrefetch->start(pfprio);
+	// below prefetch, playback must not wait for record writes
+	audioRecorder->start(pfprio > 0 ? pfprio - 1 : 0);
 
 	audioPrefetch->msgSeek(0, true); // force
 
@@ -342,6 +349,7 @@ void OOMidi::seqStop()
 	midiSeq->stop(true);
 	audio->stop(true);
 	audioPrefetch->stop(true);
+	audioRecorder->stop(true);
     // close opened synths
     for (iMidiDevice i = midiDevices.begin(); i != midiDevices.end(); ++i)
     {
@@ -645,6 +653,9 @@ OOMidi::OOMidi(int argc, char** argv) : QMainWindow()
     toolbarComposerSettings = 0;
     toolbarSnap = 0;
 
+	meterBus = new MeterBus();
+	dspProfiler = new DspProfiler();
+	dspProfiler->setEnabled(dspProfileReport);
 	song = new Song(m_undoStack, "song");
 	song->blockSignals(true);
 	heartBeatTimer = new QTimer(this);
@@ -907,6 +918,7 @@ OOMidi::OOMidi(int argc, char** argv) : QMainWindow()
 	audioBounce2TrackAction = new QAction(QIcon(*audio_bounce_to_trackIcon), tr("Bounce to Track"), this);
 	audioBounce2FileAction = new QAction(QIcon(*audio_bounce_to_fileIcon), tr("Bounce to File"), this);
 	audioRestartAction = new QAction(QIcon(*audio_restartaudioIcon), tr("Restart Audio"), this);
+	audioDspProfilerAction = new QAction(tr("Audio Thread Profile"), this);
 
 	//-------- Automation Actions
 	autoMixerAction = new QAction(QIcon(*automation_mixerIcon), tr("Mixer Automation"), this);
@@ -1051,6 +1063,7 @@ OOMidi::OOMidi(int argc, char** argv) : QMainWindow()
 	connect(audioBounce2TrackAction, SIGNAL(triggered()), SLOT(bounceToTrack()));
 	connect(audioBounce2FileAction, SIGNAL(triggered()), SLOT(bounceToFile()));
 	connect(audioRestartAction, SIGNAL(triggered()), SLOT(seqRestart()));
+	connect(audioDspProfilerAction, SIGNAL(triggered()), SLOT(showDspProfiler()));
 
 	//-------- Automation connections
 	connect(autoMixerAction, SIGNAL(triggered()), SLOT(switchMixerAutomation()));
@@ -1106,6 +1119,7 @@ OOMidi::OOMidi(int argc, char** argv) : QMainWindow()
 	midiSeq = new MidiSeq("Midi");
 	audio = new Audio();
 	audioPrefetch = new AudioPrefetch("Prefetch");
+	audioRecorder = new AudioRecorder("Recorder");
 	//Define the MidiMonitor
 	midiMonitor = new MidiMonitor("MidiMonitor");
 
@@ -1217,6 +1231,7 @@ OOMidi::OOMidi(int argc, char** argv) : QMainWindow()
 	menu_audio->addAction(audioBounce2FileAction);
 	menu_audio->addSeparator();
 	menu_audio->addAction(audioRestartAction);
+	menu_audio->addAction(audioDspProfilerAction);
 
 
 	//-------------------------------------------------------------
@@ -1321,6 +1336,7 @@ OOMidi::OOMidi(int argc, char** argv) : QMainWindow()
 
 	transport = new Transport(this, "transport");
 	bigtime = 0;
+	dspProfilerView = 0;
 
 	QClipboard* cb = QApplication::clipboard();
 	connect(cb, SIGNAL(dataChanged()), SLOT(clipboardChanged()));
@@ -1445,9 +1461,56 @@ void OOMidi::loadInitialProject()
 	changeConfig(false);
 	readInstrumentTemplates();
 	song->update();
+	if (!offlineRenderDir.isEmpty())
+		QTimer::singleShot(0, this, SLOT(renderStemsAndQuit()));
 	//qDebug("Leaving OOMidi::loadInitialProject~~~~~~~~~~~~~~~~~~~~~~~~~~");
 }
 
+//---------------------------------------------------------
+//   renderStemsAndQuit
+//    command line offline render (-R). Every audio track
+//    except inputs, and every output, is written as a
+//    stem into offlineRenderDir, then we exit.
+//---------------------------------------------------------
+
+void OOMidi::renderStemsAndQuit()
+{
+	QDir dir(offlineRenderDir);
+	if (!dir.exists() && !dir.mkpath("."))
+	{
+		fprintf(stderr, "OOMidi: cannot create render directory <%s>\n", offlineRenderDir.toLocal8Bit().constData());
+		qApp->exit(1);
+		return;
+	}
+
+	OfflineRender render;
+	bool err = false;
+	int idx = 0;
+	TrackList* tl = song->tracks();
+	for (iTrack it = tl->begin(); it != tl->end(); ++it)
+	{
+		Track* t = *it;
+		if (t->isMidiTrack() || t->type() == Track::AUDIO_INPUT)
+			continue;
+		QString name = t->name();
+		name.replace(QRegExp("[^A-Za-z0-9_.-]"), "_");
+		QString path = dir.filePath(QString("%1-%2.wav").arg(++idx, 3, 10, QChar('0')).arg(name));
+		err |= render.addStem((AudioTrack*) t, path);
+	}
+
+	unsigned endFrame = Pos(song->len(), true).frame();
+	printf("OOMidi: rendering %d stems, %u frames\n", render.stems(), endFrame);
+	QTime timer;
+	timer.start();
+	err |= render.render(0, endFrame);
+	int ms = timer.elapsed();
+	if (ms > 0)
+		printf("OOMidi: render took %.1f s, %.1f x realtime\n", ms / 1000.0, (endFrame * 1000.0 / sampleRate) / ms);
+	if (err)
+		fprintf(stderr, "OOMidi: render failed, the stems in <%s> are incomplete\n", offlineRenderDir.toLocal8Bit().constData());
+	qApp->exit(err ? 1 : 0);
+}
+
 void OOMidi::lsStartupFailed()
 {
 	//qDebug("Entering OOMidi::lsStartupFailed~~~~~~~~~~~~~~~~~~~~~~~~~~");
@@ -1458,6 +1521,8 @@ void OOMidi::lsStartupFailed()
 	changeConfig(false);
 	readInstrumentTemplates();
 	song->update();
+	if (!offlineRenderDir.isEmpty())
+		QTimer::singleShot(0, this, SLOT(renderStemsAndQuit()));
 	//qDebug("Leaving OOMidi::lsStartupFailed~~~~~~~~~~~~~~~~~~~~~~~~~~");
 }
 
@@ -2461,9 +2526,16 @@ void OOMidi::closeEvent(QCloseEvent* event)
 	// p3.3.47
 	delete midiMonitor;
 	delete audioPrefetch;
+	delete audioRecorder;
 	delete audio;
 	delete midiSeq;
 	delete song;
+	delete meterBus;
+	meterBus = 0;
+	if (dspProfileReport)
+		fprintf(stderr, "%s", dspProfiler->report(20).toLocal8Bit().constData());
+	delete dspProfiler;
+	dspProfiler = 0;
 
 	qApp->quit();
 }
@@ -4664,6 +4736,18 @@ void OOMidi::toggleBigTime(bool checked)
 	showBigtime(checked);
 }
 
+//---------------------------------------------------------
+//   showDspProfiler
+//---------------------------------------------------------
+
+void OOMidi::showDspProfiler()
+{
+	if (dspProfilerView == 0)
+		dspProfilerView = new DspProfilerView(this);
+	dspProfilerView->show();
+	dspProfilerView->raise();
+}
+
 //---------------------------------------------------------
 //   bigtimeClosed
 //---------------------------------------------------------
@@ -44,6 +44,7 @@ class Part;
 class PartList;
 class Transport;
 class BigTime;
+class DspProfilerView;
 class Composer;
 class Instrument;
 class PopupMenu;
@@ -154,6 +155,7 @@ class OOMidi : public QMainWindow
 
     // Audio Menu Actions
     QAction *audioBounce2TrackAction, *audioBounce2FileAction, *audioRestartAction;
+    QAction *audioDspProfilerAction;
 
     // Automation Menu Actions
     QAction *autoMixerAction, *autoSnapshotAction, *autoClearAction;
@@ -174,6 +176,7 @@ class OOMidi : public QMainWindow
 
     Transport* transport;
     BigTime* bigtime;
+    DspProfilerView* dspProfilerView;
     EditInstrument* editInstrument;
 	Performer* performer;
 
@@ -385,6 +388,7 @@ private slots:
     void takeAutomationSnapshot();
     void clearAutomation();
     void bigtimeClosed();
+    void showDspProfiler();
     void mixer1Closed();
     void mixer2Closed();
     void markerClosed();
@@ -395,6 +399,7 @@ private slots:
 	void performerClosed();
 	void loadInitialProject();
 	void lsStartupFailed();
+	void renderStemsAndQuit();
 
 
 public slots:
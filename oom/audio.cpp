@@ -9,6 +9,7 @@
 #include <cmath>
 #include <errno.h>
 
+#include <QMessageBox>
 #include <QSocketNotifier>
 
 #include "app.h"
@@ -20,8 +21,10 @@
 #include "alsamidi.h"
 //#include "driver/alsamidi.h"   // p4.0.2
 #include "audioprefetch.h"
+#include "audiorecorder.h"
 #include "plugin.h"
 #include "audio.h"
+#include "dspprofiler.h"
 #include "wave.h"
 #include "midictrl.h"
 #include "midiseq.h"
@@ -31,6 +34,8 @@
 #include "gconfig.h"
 #include "pos.h"
 #include "ticksynth.h"
+#include "meterbus.h"
+#include "midirecordbuffer.h"
 
 extern double curTime();
 Audio* audio;
@@ -46,7 +51,7 @@ extern unsigned int volatile midiExtSyncTicks;
 const char* seqMsgList[] = {
 	"SEQM_ADD_TRACK", "SEQM_REMOVE_TRACK", "SEQM_CHANGE_TRACK", "SEQM_MOVE_TRACK",
 	"SEQM_ADD_PART", "SEQM_REMOVE_PART", "SEQM_REMOVE_PART_LIST", "SEQM_CHANGE_PART",
-	"SEQM_ADD_EVENT", "SEQM_REMOVE_EVENT", "SEQM_CHANGE_EVENT",
+	"SEQM_ADD_EVENT", "SEQM_REMOVE_EVENT", "SEQM_CHANGE_EVENT", "SEQM_REPLACE_EVENTS",
 	"SEQM_ADD_TEMPO", "SEQM_SET_TEMPO", "SEQM_REMOVE_TEMPO", "SEQM_REMOVE_TEMPO_RANGE", 
 	"SEQM_ADD_SIG", "SEQM_REMOVE_SIG",
 	"SEQM_SET_GLOBAL_TEMPO",
@@ -66,12 +71,13 @@ const char* seqMsgList[] = {
 	"SEQM_UPDATE_SOLO_STATES",
 	"MIDI_SHOW_INSTR_GUI",
 	"AUDIO_RECORD",
-	"AUDIO_ROUTEADD", "AUDIO_ROUTEREMOVE", "AUDIO_REMOVEROUTES",
+	"AUDIO_ROUTEADD", "AUDIO_ROUTEREMOVE", "AUDIO_REMOVEROUTES", "AUDIO_ROUTECHANGES",
 	"AUDIO_VOL", "AUDIO_PAN",
 	"AUDIO_ADDPLUGIN",
 	"AUDIO_SET_SEG_SIZE",
 	"AUDIO_SET_PREFADER", "AUDIO_SET_CHANNELS",
 	"AUDIO_SET_PLUGIN_CTRL_VAL",
+	"AUDIO_SET_PLUGIN_CTRL_VALS",
 	"AUDIO_SWAP_CONTROLLER_IDX",
 	"AUDIO_CLEAR_CONTROLLER_EVENTS",
 	"AUDIO_SEEK_PREV_AC_EVENT",
@@ -99,6 +105,7 @@ Audio::Audio()
 	recording = false;
 	idle = false;
 	_freewheel = false;
+	_renderSavedFreewheel = false;
 	_bounce = false;
 	//loopPassed    = false;
 	_loopFrame = 0;
@@ -319,6 +326,7 @@ void Audio::shutdown()
 void Audio::process(unsigned frames)
 {
 	if (!checkAudioDevice()) return;
+	DspCycleProbe cycleProbe(frames);
 	if (msg)
 	{
 		processMsg(msg);
@@ -421,7 +429,11 @@ void Audio::process(unsigned frames)
 	if (isPlaying())
 	{
 		if (!freewheel())
+		{
 			audioPrefetch->msgTick();
+			if (recording)
+				audioRecorder->msgTick();
+		}
 
 		if (_bounce && _pos >= song->rPos())
 		{
@@ -517,7 +529,12 @@ void Audio::process(unsigned frames)
 
 	process1(samplePos, offset, frames);
 	for (iAudioOutput i = ol->begin(); i != ol->end(); ++i)
+	{
+		DspProbe probe(*i, DspProfiler::OUTPUT);
 		(*i)->processWrite();
+	}
+	if (meterBus)
+		meterBus->publish(song->tracks());
 	if (isPlaying())
 	{
 		_pos += frames;
@@ -525,6 +542,69 @@ void Audio::process(unsigned frames)
 	}
 }
 
+//---------------------------------------------------------
+//   renderStart
+//    Offline render. The driver thread is kept idle by the
+//    caller while the render thread calls renderCycle().
+//    Freewheel makes wave tracks read their files directly
+//    instead of through the prefetch fifos.
+//---------------------------------------------------------
+
+void Audio::renderStart(unsigned frame)
+{
+	_pos = Pos(frame, false);
+	curTickPos = _pos.tick();
+	nextTickPos = curTickPos;
+	_renderSavedFreewheel = _freewheel;
+	_freewheel = true;
+	_loopCount = 0;
+	state = PLAY;
+}
+
+//---------------------------------------------------------
+//   renderCycle
+//    the playing part of process() without the driver
+//---------------------------------------------------------
+
+void Audio::renderCycle(unsigned frames)
+{
+	DspCycleProbe cycleProbe(frames);
+	AuxList* al = song->auxs();
+	for (unsigned i = 0; i < al->size(); ++i)
+	{
+		AudioAux* a = (AudioAux*) ((*al)[i]);
+		float** dst = a->sendBuffer();
+		for (int ch = 0; ch < a->channels(); ++ch)
+			memset(dst[ch], 0, sizeof (float) * segmentSize);
+	}
+
+	unsigned samplePos = _pos.frame();
+	Pos ppp(_pos);
+	ppp += frames;
+	nextTickPos = ppp.tick();
+
+	syncFrame = samplePos;
+	syncTime = curTime();
+	frameOffset = 0;
+
+	process1(samplePos, 0, frames);
+
+	_pos += frames;
+	curTickPos = nextTickPos;
+}
+
+//---------------------------------------------------------
+//   renderStop
+//---------------------------------------------------------
+
+void Audio::renderStop()
+{
+	stopRolling();
+	_freewheel = _renderSavedFreewheel;
+	// wave tracks read around the prefetch fifos, refill them
+	audioPrefetch->msgSeek(_pos.frame(), true);
+}
+
 //---------------------------------------------------------
 //   process1
 //---------------------------------------------------------
@@ -621,6 +701,19 @@ void Audio::processMsg(AudioMsg* msg)
 		case AUDIO_REMOVEROUTES: // p3.3.55
 			removeAllRoutes(msg->sroute, msg->droute);
 			break;
+		case AUDIO_ROUTECHANGES:
+		{
+			const RouteChangeList* cl = (const RouteChangeList*) msg->p1;
+			for (int i = 0; i < cl->size(); ++i)
+			{
+				const RouteChange& c = cl->at(i);
+				if (c.add)
+					addRoute(c.src, c.dst);
+				else
+					removeRoute(c.src, c.dst);
+			}
+			break;
+		}
 		case AUDIO_VOL:
 			msg->snode->setVolume(msg->dval);
 			//TODO: hook this and send midi cc to bcf2000
@@ -651,6 +744,9 @@ void Audio::processMsg(AudioMsg* msg)
 			// p3.3.43
 			msg->snode->setPluginCtrlVal(msg->ival, msg->dval);
 			break;
+		case AUDIO_SET_PLUGIN_CTRL_VALS:
+			msg->plugin->applyControllers();
+			break;
 		case AUDIO_SWAP_CONTROLLER_IDX:
 			msg->snode->swapControllerIDX(msg->a, msg->b);
 			break;
@@ -847,29 +943,6 @@ void Audio::seek(const Pos& p)
 	write(sigFd, "G", 1); // signal seek to gui
 }
 
-//---------------------------------------------------------
-//   writeTick
-//    called from audio prefetch thread context
-//    write another buffer to soundfile
-//---------------------------------------------------------
-
-void Audio::writeTick()
-{
-	AudioOutput* ao = song->bounceOutput;
-	if (ao && song->outputs()->find(ao) != song->outputs()->end())
-	{
-		if (ao->recordFlag())
-			ao->record();
-	}
-	WaveTrackList* tl = song->waves();
-	for (iWaveTrack t = tl->begin(); t != tl->end(); ++t)
-	{
-		WaveTrack* track = *t;
-		if (track->recordFlag())
-			track->record();
-	}
-}
-
 //---------------------------------------------------------
 //   startRolling
 //---------------------------------------------------------
@@ -1066,6 +1139,10 @@ void Audio::recordStop()
 		printf("recordStop - startRecordPos=%d\n", startRecordPos.tick());
 	audio->msgIdle(true); // gain access to all data structures
 
+	// write what is still queued before the files are closed
+	audioRecorder->msgFlush();
+	int dropped = audioRecorder->report();
+
 	song->startUndo();
 	WaveTrackList* wl = song->waves();
 
@@ -1089,19 +1166,31 @@ void Audio::recordStop()
 	for (iMidiTrack it = ml->begin(); it != ml->end(); ++it)
 	{
 		MidiTrack* mt = *it;
-		MPEventList* mpel = mt->mpevents();
-		EventList* el = mt->events();
+		MidiRecordBuffer* rb = mt->recordBuffer();
 
 		//---------------------------------------------------
-		//    resolve NoteOff events, Controller etc.
+		//    the take was converted while recording, only
+		//    cycled takes are resolved here
 		//---------------------------------------------------
 
-		//buildMidiEventList(el, mpel, mt, config.division, true);
-		// Do SysexMeta. Do loops.
-		buildMidiEventList(el, mpel, mt, config.division, true, true);
-		song->cmdAddRecordedEvents(mt, el, startRecordPos.tick());
-		el->clear();
-		mpel->clear();
+		rb->process(mt, endRecordPos.tick());
+		if (_loopCount > 0)
+		{
+			MPEventList* mpel = mt->mpevents();
+			EventList* el = mt->events();
+			rb->copyTo(mpel);
+			// Do SysexMeta. Do loops.
+			buildMidiEventList(el, mpel, mt, config.division, true, true);
+			song->cmdAddRecordedEvents(mt, el, startRecordPos.tick());
+			el->clear();
+			mpel->clear();
+		}
+		else
+		{
+			rb->finish();
+			song->cmdAddRecordedTake(mt, rb, startRecordPos.tick());
+		}
+		rb->clear();
 	}
 
 	//
@@ -1126,6 +1215,13 @@ void Audio::recordStop()
 	audio->msgIdle(false);
 	song->endUndo(0);
 	song->setRecord(false);
+
+	if (dropped)
+	{
+		QMessageBox::warning(oom, QString("OOMidi"),
+				QString("%1 audio buffers were dropped while recording.\n"
+				"The disk could not keep up, the recording has gaps.").arg(dropped));
+	}
 }
 
 //---------------------------------------------------------
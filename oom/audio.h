@@ -31,6 +31,7 @@ class MidiPort;
 class EventList;
 class MidiInstrument;
 class MidiTrack;
+struct MidiEventView;
 
 //---------------------------------------------------------
 //   AudioMsgId
@@ -43,6 +44,7 @@ enum
     SEQM_ADD_TRACK, SEQM_REMOVE_TRACK, SEQM_CHANGE_TRACK, SEQM_MOVE_TRACK,
     SEQM_ADD_PART, SEQM_REMOVE_PART, SEQM_REMOVE_PART_LIST, SEQM_CHANGE_PART,
     SEQM_ADD_EVENT, SEQM_ADD_EVENT_CHECK, SEQM_REMOVE_EVENT, SEQM_CHANGE_EVENT,
+    SEQM_REPLACE_EVENTS,
     SEQM_ADD_TEMPO, SEQM_SET_TEMPO, SEQM_REMOVE_TEMPO, SEQM_REMOVE_TEMPO_RANGE, SEQM_ADD_SIG, SEQM_REMOVE_SIG,
     SEQM_SET_GLOBAL_TEMPO,
     SEQM_UNDO, SEQM_REDO,
@@ -62,13 +64,14 @@ enum
     MIDI_SHOW_INSTR_GUI,
     MIDI_SHOW_INSTR_NATIVE_GUI,
     AUDIO_RECORD,
-    AUDIO_ROUTEADD, AUDIO_ROUTEREMOVE, AUDIO_REMOVEROUTES,
+    AUDIO_ROUTEADD, AUDIO_ROUTEREMOVE, AUDIO_REMOVEROUTES, AUDIO_ROUTECHANGES,
     AUDIO_VOL, AUDIO_PAN,
     AUDIO_ADDPLUGIN,
     AUDIO_IDLEPLUGIN,
     AUDIO_SET_SEG_SIZE,
     AUDIO_SET_PREFADER, AUDIO_SET_CHANNELS,
     AUDIO_SET_PLUGIN_CTRL_VAL,
+    AUDIO_SET_PLUGIN_CTRL_VALS,
     AUDIO_SWAP_CONTROLLER_IDX,
     AUDIO_CLEAR_CONTROLLER_EVENTS,
     AUDIO_SEEK_PREV_AC_EVENT,
@@ -83,6 +86,18 @@ enum
 
 extern const char* seqMsgList[]; // for debug
 
+//---------------------------------------------------------
+//   PartEventsEdit
+//    events of one part swapped by SEQM_REPLACE_EVENTS
+//---------------------------------------------------------
+
+struct PartEventsEdit
+{
+    Part* part;
+    QList<Event> remove;
+    QList<Event> add;
+};
+
 //---------------------------------------------------------
 //   Msg
 //---------------------------------------------------------
@@ -144,6 +159,7 @@ private:
     bool recording; // recording is active
     bool idle; // do nothing in idle mode
     bool _freewheel;
+    bool _renderSavedFreewheel; // freewheel state before renderStart()
     bool _bounce;
     //bool loopPassed;
     unsigned _loopFrame; // Startframe of loop if in LOOP mode. Not quite the same as left marker !
@@ -190,6 +206,8 @@ private:
     void process1(unsigned samplePos, unsigned offset, unsigned samples);
 
     void collectEvents(MidiTrack*, unsigned int startTick, unsigned int endTick);
+    void collectEvent(MidiTrack*, const MidiEventView&, unsigned offset, int defaultPort, int& channel,
+            MPEventList* playEvents, MPEventList* stuckNotes);
 
 public:
     Audio();
@@ -201,7 +219,11 @@ public:
     void process(unsigned frames);
     bool sync(int state, unsigned frame);
     void shutdown();
-    void writeTick();
+
+    // offline render, gui thread with audio idle
+    void renderStart(unsigned frame);
+    void renderCycle(unsigned frames);
+    void renderStop();
 
     // transport:
     bool start();
@@ -249,6 +271,7 @@ public:
     void msgAddEventCheck(Track*, Event&, bool u = true, bool doCtrls = true, bool doClones = false, bool waitRead = true);
     //void msgDeleteEvent(Event&, Part*, bool u = true);
     void msgDeleteEvent(Event&, Part*, bool u = true, bool doCtrls = true, bool doClones = false, bool waitRead = true);
+    void msgReplaceEvents(const QList<PartEventsEdit>&, bool u = true, bool doCtrls = true);
     //void msgChangeEvent(Event&, Event&, Part*, bool u = true);
     void msgChangeEvent(Event&, Event&, Part*, bool u = true, bool doCtrls = true, bool doClones = false, bool waitRead = true);
     void msgScanAlsaMidiPorts();
@@ -272,6 +295,7 @@ public:
     void msgRemoveRoutes1(Route, Route); // p3.3.55
     void msgAddRoute(Route, Route);
     void msgAddRoute1(Route, Route);
+    void msgChangeRoutes(const RouteChangeList&);
     void msgAddPlugin(AudioTrack*, int idx, BasePlugin* plugin);
     void msgIdlePlugin(AudioTrack*, BasePlugin* plugin);
     void msgSetMute(AudioTrack*, bool val);
@@ -293,6 +317,7 @@ public:
     void msgBounce();
     //void msgSetPluginCtrlVal(BasePlugin* /*plugin*/, int /*param*/, double /*val*/);
     void msgSetPluginCtrlVal(AudioTrack*, int /*param*/, double /*val*/, bool waitRead = true);
+    void msgSetPluginCtrlVals(BasePlugin*);
     void msgSwapControllerIDX(AudioTrack*, int, int);
     void msgClearControllerEvents(AudioTrack*, int);
     void msgSeekPrevACEvent(AudioTrack*, int);
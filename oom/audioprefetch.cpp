@@ -95,11 +95,7 @@ void AudioPrefetch::processMsg1(const void* m)
 	switch (msg->id)
 	{
 		case PREFETCH_TICK:
-			if (audio->isRecording())
-			{
-				//puts("writeTick");
-				audio->writeTick();
-			}
+			// Recorded audio is written by the AudioRecorder thread.
 			// Indicate do not seek file before each read.
 			// Changed by Tim. p3.3.17
 			//prefetch();
@@ -0,0 +1,322 @@
+//=========================================================
+//  OOMidi
+//  OpenOctave Midi and Audio Editor
+//=========================================================
+
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "audiorecorder.h"
+#include "globals.h"
+#include "track.h"
+#include "song.h"
+#include "wave.h"
+#include "midirecordbuffer.h"
+
+enum
+{
+    RECORD_TICK, RECORD_FLUSH
+};
+
+// frames per channel merged into one write
+static const unsigned STAGE_FRAMES = 32768;
+// bytes reserved at a time ahead of the write position
+static const off_t PREALLOC_CHUNK = 16 * 1024 * 1024;
+
+//---------------------------------------------------------
+//   RecorderMsg
+//---------------------------------------------------------
+
+struct RecorderMsg : public ThreadMsg
+{
+};
+
+AudioRecorder* audioRecorder;
+
+//---------------------------------------------------------
+//   AudioRecorder
+//---------------------------------------------------------
+
+AudioRecorder::AudioRecorder(const char* name)
+: Thread(name)
+{
+    m_stageFrames = 0;
+    for (int ch = 0; ch < MAX_CHANNELS; ++ch)
+        m_stage[ch] = 0;
+    m_tickPending.storeRelease(0);
+    m_flushPending.storeRelease(0);
+}
+
+//---------------------------------------------------------
+//   ~AudioRecorder
+//---------------------------------------------------------
+
+AudioRecorder::~AudioRecorder()
+{
+    closeFiles();
+    for (int ch = 0; ch < MAX_CHANNELS; ++ch)
+        free(m_stage[ch]);
+}
+
+//---------------------------------------------------------
+//   readMsg
+//---------------------------------------------------------
+
+static void readMsgR(void* p, void*)
+{
+    AudioRecorder* at = (AudioRecorder*) p;
+    at->readMsg1(sizeof (RecorderMsg));
+}
+
+//---------------------------------------------------------
+//   start
+//---------------------------------------------------------
+
+void AudioRecorder::start(int priority)
+{
+    // segmentSize is known by now
+    m_stageFrames = STAGE_FRAMES < segmentSize ? segmentSize : STAGE_FRAMES;
+    for (int ch = 0; ch < MAX_CHANNELS; ++ch)
+    {
+        free(m_stage[ch]);
+        m_stage[ch] = 0;
+        if (posix_memalign((void**) &m_stage[ch], 16, sizeof (float) * m_stageFrames))
+        {
+            printf("AudioRecorder::start: could not allocate stage buffer\n");
+            m_stage[ch] = 0;
+        }
+    }
+    clearPollFd();
+    addPollFd(toThreadFdr, POLLIN, ::readMsgR, this, 0);
+    Thread::start(priority);
+}
+
+//---------------------------------------------------------
+//   processMsg
+//---------------------------------------------------------
+
+void AudioRecorder::processMsg1(const void* m)
+{
+    const RecorderMsg* msg = (RecorderMsg*) m;
+    switch (msg->id)
+    {
+        case RECORD_TICK:
+            // allow the next tick to be queued while we write
+            m_tickPending.fetchAndStoreOrdered(0);
+            writeTick(false);
+            break;
+        case RECORD_FLUSH:
+            writeTick(true);
+            closeFiles();
+            m_flushPending.fetchAndStoreOrdered(0);
+            break;
+        default:
+            printf("AudioRecorder::processMsg1: unknown message\n");
+    }
+}
+
+//---------------------------------------------------------
+//   msgTick
+//    called from audio RT context. At most one tick is
+//    queued at any time.
+//---------------------------------------------------------
+
+void AudioRecorder::msgTick()
+{
+    if (!m_tickPending.testAndSetOrdered(0, 1))
+        return;
+    RecorderMsg msg;
+    msg.id = RECORD_TICK;
+    if (sendMsg1(&msg, sizeof (msg)))
+    {
+        printf("AudioRecorder::msgTick(): send failed!\n");
+        m_tickPending.fetchAndStoreOrdered(0);
+    }
+}
+
+//---------------------------------------------------------
+//   msgFlush
+//    gui thread. Writes everything still queued and
+//    returns when the record files are complete.
+//---------------------------------------------------------
+
+void AudioRecorder::msgFlush()
+{
+    if (!isRunning())
+    {
+        writeTick(true);
+        closeFiles();
+        return;
+    }
+    m_flushPending.fetchAndStoreOrdered(1);
+    RecorderMsg msg;
+    msg.id = RECORD_FLUSH;
+    while (sendMsg1(&msg, sizeof (msg)))
+    {
+        printf("AudioRecorder::msgFlush::sleep(1)\n");
+        sleep(1);
+    }
+    while (m_flushPending.loadAcquire())
+        usleep(1000);
+}
+
+//---------------------------------------------------------
+//   writeTick
+//---------------------------------------------------------
+
+void AudioRecorder::writeTick(bool flush)
+{
+    // top up the midi record pools, the audio thread takes
+    // from them without allocating
+    MidiTrackList* ml = song->midis();
+    for (iMidiTrack t = ml->begin(); t != ml->end(); ++t)
+    {
+        if ((*t)->recordFlag())
+            (*t)->recordBuffer()->reserve();
+    }
+
+    if (!m_stage[MAX_CHANNELS - 1])
+        return;
+    // wait for an eighth of the fifo before writing
+    int minBlocks = flush ? 1 : fifoLength / 8;
+    if (minBlocks < 1)
+        minBlocks = 1;
+
+    AudioOutput* ao = song->bounceOutput;
+    if (ao && song->outputs()->find(ao) != song->outputs()->end())
+    {
+        if (ao->recordFlag())
+            writeTrack(ao, minBlocks);
+    }
+    WaveTrackList* tl = song->waves();
+    for (iWaveTrack t = tl->begin(); t != tl->end(); ++t)
+    {
+        WaveTrack* track = *t;
+        if (track->recordFlag())
+            writeTrack(track, minBlocks);
+    }
+}
+
+//---------------------------------------------------------
+//   writeTrack
+//---------------------------------------------------------
+
+void AudioRecorder::writeTrack(AudioTrack* track, int minBlocks)
+{
+    int blocks = track->recordFifo()->getCount();
+    if (blocks < minBlocks)
+        return;
+    SndFile* sf = track->recFile();
+    if (sf)
+        preallocate(sf, blocks * segmentSize);
+    track->record(m_stage, m_stageFrames, minBlocks);
+}
+
+//---------------------------------------------------------
+//   preallocate
+//    reserves disk space ahead of the frames about to be
+//    written. FALLOC_FL_KEEP_SIZE leaves the file size
+//    alone, so libsndfile does not notice.
+//---------------------------------------------------------
+
+void AudioRecorder::preallocate(SndFile* sf, unsigned frames)
+{
+    QHash<SndFile*, Prealloc>::iterator i = m_prealloc.find(sf);
+    if (i == m_prealloc.end())
+    {
+        Prealloc p;
+        p.fd = ::open(sf->path().toLocal8Bit().constData(), O_WRONLY);
+        p.reserved = 0;
+        p.written = 0;
+        i = m_prealloc.insert(sf, p);
+    }
+    Prealloc& p = i.value();
+    p.written += off_t(frames) * sf->channels() * sizeof (float);
+    if (p.fd == -1)
+        return;
+    while (p.written + PREALLOC_CHUNK / 2 > p.reserved)
+    {
+        if (fallocate(p.fd, FALLOC_FL_KEEP_SIZE, p.reserved, PREALLOC_CHUNK))
+        {
+            if (debugMsg)
+                perror("AudioRecorder: fallocate");
+            ::close(p.fd);
+            p.fd = -1;
+            return;
+        }
+        p.reserved += PREALLOC_CHUNK;
+    }
+}
+
+//---------------------------------------------------------
+//   closeFiles
+//    Space reserved past the end of a file stays allocated
+//    after close, give back what the take did not use.
+//---------------------------------------------------------
+
+void AudioRecorder::closeFiles()
+{
+    for (QHash<SndFile*, Prealloc>::iterator i = m_prealloc.begin(); i != m_prealloc.end(); ++i)
+    {
+        Prealloc& p = i.value();
+        if (p.fd == -1)
+            continue;
+        struct stat st;
+        if (fstat(p.fd, &st) == 0 && st.st_size < p.reserved)
+        {
+            if (fallocate(p.fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, st.st_size, p.reserved - st.st_size)
+                    && ftruncate(p.fd, st.st_size))
+            {
+                if (debugMsg)
+                    perror("AudioRecorder: release preallocated space");
+            }
+        }
+        ::close(p.fd);
+    }
+    m_prealloc.clear();
+}
+
+//---------------------------------------------------------
+//   reportTrack
+//---------------------------------------------------------
+
+static int reportTrack(AudioTrack* track)
+{
+    Fifo* fifo = track->recordFifo();
+    int dropped = fifo->overruns();
+    if (dropped)
+        printf("OOMidi: recording <%s> dropped %d buffers, fifo high water %d of %d\n",
+               track->name().toLatin1().constData(), dropped, fifo->highWater(), fifo->size());
+    else if (debugMsg)
+        printf("AudioRecorder: <%s> fifo high water %d of %d\n",
+               track->name().toLatin1().constData(), fifo->highWater(), fifo->size());
+    fifo->resetStats();
+    return dropped;
+}
+
+//---------------------------------------------------------
+//   report
+//    gui thread, after msgFlush() with audio idle. Prints
+//    the fifo statistics of all recording tracks and
+//    returns the number of buffers lost.
+//---------------------------------------------------------
+
+int AudioRecorder::report()
+{
+    int dropped = 0;
+    AudioOutput* ao = song->bounceOutput;
+    if (ao && ao->recordFlag() && song->outputs()->find(ao) != song->outputs()->end())
+        dropped += reportTrack(ao);
+    WaveTrackList* tl = song->waves();
+    for (iWaveTrack t = tl->begin(); t != tl->end(); ++t)
+    {
+        WaveTrack* track = *t;
+        if (track->recordFlag() || song->bounceTrack == track)
+            dropped += reportTrack(track);
+    }
+    return dropped;
+}
@@ -0,0 +1,66 @@
+//=========================================================
+//  OOMidi
+//  OpenOctave Midi and Audio Editor
+//
+//  writes recorded audio from the track fifos to disk
+//=========================================================
+
+#ifndef __AUDIORECORDER_H__
+#define __AUDIORECORDER_H__
+
+#include <sys/types.h>
+#include <QAtomicInt>
+#include <QHash>
+
+#include "globaldefs.h"
+#include "thread.h"
+
+class AudioTrack;
+class SndFile;
+
+//---------------------------------------------------------
+//   AudioRecorder
+//    Drains the record fifos of all armed tracks. This used
+//    to be done by the prefetch thread between its reads,
+//    so heavy recording could starve playback. Fifo buffers
+//    are only written once enough of them are queued, and
+//    consecutive buffers are merged into one large write.
+//    Record files are preallocated ahead of the write
+//    position to keep them contiguous on disk. Each tick
+//    also tops up the chunk pools of armed midi tracks.
+//---------------------------------------------------------
+
+class AudioRecorder : public Thread
+{
+    struct Prealloc
+    {
+        int fd;          // -1 if the filesystem can not preallocate
+        off_t reserved;  // bytes reserved so far
+        off_t written;   // bytes written so far
+    };
+
+    float* m_stage[MAX_CHANNELS];
+    unsigned m_stageFrames;
+    QHash<SndFile*, Prealloc> m_prealloc;
+    QAtomicInt m_tickPending;  // set while a tick is queued
+    QAtomicInt m_flushPending; // set while a flush is queued
+
+    virtual void processMsg1(const void*);
+    void writeTick(bool flush);
+    void writeTrack(AudioTrack* track, int minBlocks);
+    void preallocate(SndFile* sf, unsigned frames);
+    void closeFiles();
+
+public:
+    AudioRecorder(const char* name);
+    ~AudioRecorder();
+    virtual void start(int);
+
+    void msgTick();
+    void msgFlush();
+    int report();
+};
+
+extern AudioRecorder* audioRecorder;
+
+#endif
@@ -36,6 +36,7 @@ AudioTrack::AudioTrack(TrackType t)
 {
 	_processed = false;
 	_haveData = false;
+	_renderTap = 0;
 	_sendMetronome = false;
 	_prefader = false;
 	_efxPipe = new Pipeline();
@@ -66,6 +67,7 @@ AudioTrack::AudioTrack(const AudioTrack& t, bool cloneParts)
 	_totalOutChannels = t._totalOutChannels; // Is either MAX_CHANNELS, or custom value (used by syntis).
 	_processed = false;
 	_haveData = false;
+	_renderTap = 0;
 	_sendMetronome = t._sendMetronome;
 	_controller = t._controller;
 	_prefader = t._prefader;
@@ -1242,6 +1244,7 @@ AudioOutput::AudioOutput()
 {
 	for (int i = 0; i < MAX_CHANNELS; ++i)
 		jackPorts[i] = 0;
+	_renderBuffers = 0;
 }
 
 AudioOutput::AudioOutput(const AudioOutput& t, bool cloneParts)
@@ -1250,6 +1253,7 @@ AudioOutput::AudioOutput(const AudioOutput& t, bool cloneParts)
 	for (int i = 0; i < MAX_CHANNELS; ++i)
 		jackPorts[i] = t.jackPorts[i];
 	_nframes = t._nframes;
+	_renderBuffers = 0;
 }
 
 //---------------------------------------------------------
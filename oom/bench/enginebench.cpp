@@ -0,0 +1,495 @@
+//=========================================================
+//  OOMidi
+//  OpenOctave Midi and Audio Editor
+//
+//  headless engine benchmark
+//=========================================================
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <vector>
+#include <sndfile.h>
+
+#include <QApplication>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QStringList>
+
+#include "config.h"
+#include "al/dsp.h"
+#include "app.h"
+#include "audio.h"
+#include "audiodev.h"
+#include "ctrl.h"
+#include "dspprofiler.h"
+#include "event.h"
+#include "gconfig.h"
+#include "globals.h"
+#include "part.h"
+#include "pos.h"
+#include "route.h"
+#include "song.h"
+#include "sync.h"
+#include "track.h"
+#include "wave.h"
+
+extern bool initDummyAudio();
+extern void initIcons();
+extern void initMidiController();
+extern void initMetronome();
+extern void initShortCuts();
+extern void readConfiguration();
+
+static int benchCycles = 1000;
+static int warmupCycles = 50;
+static bool printProfile = false;
+static FILE* out = stdout;
+static QString workDir;
+static QStringList waveFiles;
+
+//---------------------------------------------------------
+//   now
+//    microseconds
+//---------------------------------------------------------
+
+static inline double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000.0 + ts.tv_nsec / 1000.0;
+}
+
+//---------------------------------------------------------
+//   percentile
+//    of a sorted list
+//---------------------------------------------------------
+
+static double percentile(const std::vector<double>& v, double p)
+{
+    size_t i = size_t(p * v.size());
+    return v[std::min(i, v.size() - 1)];
+}
+
+//---------------------------------------------------------
+//   newSong
+//    the default template, clean so nothing asks to save
+//---------------------------------------------------------
+
+static void newSong()
+{
+    song->dirty = false;
+    oom->loadProjectFile(oomGlobalShare + QString("/templates/default.oom"), true, true);
+    song->dirty = false;
+}
+
+//---------------------------------------------------------
+//   masterOutput
+//---------------------------------------------------------
+
+static AudioOutput* masterOutput()
+{
+    OutputList* ol = song->outputs();
+    return ol->empty() ? 0 : (AudioOutput*) ol->front();
+}
+
+//---------------------------------------------------------
+//   makeWaveFiles
+//    a few stereo files long enough for the whole run,
+//    returns true on error
+//---------------------------------------------------------
+
+static bool makeWaveFiles()
+{
+    unsigned frames = (benchCycles + warmupCycles + 1) * segmentSize;
+    std::vector<float> l(frames), r(frames);
+    for (int n = 0; n < 4; ++n)
+    {
+        double f = 110.0 * (n + 1) / sampleRate;
+        for (unsigned i = 0; i < frames; ++i)
+        {
+            l[i] = 0.25f * sinf(2.0 * M_PI * f * i);
+            r[i] = 0.25f * sinf(2.0 * M_PI * f * 1.5 * i);
+        }
+        QString path = QDir(workDir).filePath(QString("tone%1.wav").arg(n));
+        SndFile* sf = new SndFile(path);
+        sf->setFormat(SF_FORMAT_WAV | SF_FORMAT_FLOAT, 2, sampleRate);
+        if (sf->openWrite())
+        {
+            fprintf(stderr, "oom_bench: cannot create <%s>\n", path.toLocal8Bit().constData());
+            delete sf;
+            return true;
+        }
+        float* buffer[2] = { &l[0], &r[0] };
+        sf->write(2, buffer, frames);
+        delete sf;
+        waveFiles.append(path);
+    }
+    return false;
+}
+
+//---------------------------------------------------------
+//   addWaveTrack
+//---------------------------------------------------------
+
+static WaveTrack* addWaveTrack(int n)
+{
+    WaveTrack* track = (WaveTrack*) song->addTrack(Track::WAVE, false);
+    QString path = waveFiles[n % waveFiles.size()];
+    oom->importWaveToTrack(path, 0, track);
+    return track;
+}
+
+//---------------------------------------------------------
+//   scenarios
+//    each builds its song on top of the default template
+//---------------------------------------------------------
+
+static void buildWaveTracks()
+{
+    for (int i = 0; i < 200; ++i)
+        addWaveTrack(i);
+}
+
+static void buildMidiEvents()
+{
+    const int tracks = 16;
+    const unsigned barTicks = config.division * 4;
+    const int bars = Pos((benchCycles + warmupCycles) * segmentSize, false).tick() / barTicks + 1;
+    const int perBar = 50000 / tracks;
+
+    for (int t = 0; t < tracks; ++t)
+    {
+        MidiTrack* track = (MidiTrack*) song->addTrack(Track::MIDI, false);
+        MidiPart* part = new MidiPart(track);
+        part->setTick(0);
+        part->setLenTick(bars * barTicks);
+        for (int b = 0; b < bars; ++b)
+        {
+            for (int i = 0; i < perBar; ++i)
+            {
+                Event e(Note);
+                e.setTick(b * barTicks + unsigned(i) * barTicks / perBar);
+                e.setPitch(36 + (i * 7 + t) % 60);
+                e.setVelo(64 + i % 64);
+                e.setLenTick(config.division / 8 + 1);
+                part->addEvent(e);
+            }
+        }
+        audio->msgAddPart(part, false);
+    }
+    song->setLen(bars * barTicks);
+}
+
+static void buildAutomation()
+{
+    QList<AudioTrack*> tracks;
+    for (int i = 0; i < 32; ++i)
+        tracks.append(addWaveTrack(i));
+
+    unsigned frames = (benchCycles + warmupCycles) * segmentSize;
+    audio->msgIdle(true);
+    for (int i = 0; i < tracks.size(); ++i)
+    {
+        AudioTrack* track = tracks[i];
+        CtrlListList* cll = track->controller();
+        iCtrlList vol = cll->find(AC_VOLUME);
+        iCtrlList pan = cll->find(AC_PAN);
+        for (unsigned frame = 0; frame < frames; frame += 128)
+        {
+            double phase = 2.0 * M_PI * (frame + i * 997) / sampleRate;
+            if (vol != cll->end())
+                vol->second->add(frame, 0.5 + 0.4 * sin(phase));
+            if (pan != cll->end())
+                pan->second->add(frame, 0.8 * sin(phase * 0.37));
+        }
+        track->setAutomationType(AUTO_READ);
+    }
+    audio->msgIdle(false);
+}
+
+static void buildBusChain()
+{
+    const int depth = 64;
+    AudioOutput* master = masterOutput();
+    QList<AudioTrack*> busses;
+    for (int i = 0; i < depth; ++i)
+        busses.append((AudioTrack*) song->addTrackByName(QString("bus%1").arg(i), Track::AUDIO_BUSS, -1, false, false));
+    for (int i = 0; i + 1 < depth; ++i)
+        audio->msgAddRoute(Route(busses[i], -1), Route(busses[i + 1], -1));
+    if (master)
+        audio->msgAddRoute(Route(busses.back(), -1), Route(master, -1));
+
+    for (int i = 0; i < 8; ++i)
+    {
+        WaveTrack* track = addWaveTrack(i);
+        if (master)
+            audio->msgRemoveRoute(Route(track, -1), Route(master, -1));
+        audio->msgAddRoute(Route(track, -1), Route(busses.front(), -1));
+    }
+}
+
+struct Scenario
+{
+    const char* name;
+    const char* description;
+    void (*build)();
+};
+
+static const Scenario scenarios[] = {
+    { "wave200", "200 stereo wave tracks", buildWaveTracks },
+    { "midi50k", "50000 midi events per bar on 16 tracks", buildMidiEvents },
+    { "automation", "32 wave tracks, volume and pan automated every 128 frames", buildAutomation },
+    { "busdepth", "8 wave tracks through a chain of 64 busses", buildBusChain },
+};
+static const int nScenarios = sizeof(scenarios) / sizeof(*scenarios);
+
+//---------------------------------------------------------
+//   measure
+//    drives the engine like the offline render, one
+//    segment per cycle from the song start, and reports
+//    the cycle times as one json line
+//---------------------------------------------------------
+
+static void measure(const QString& name)
+{
+    // the audio thread walks the compact copies the gui keeps
+    MidiTrackList* ml = song->midis();
+    for (ciMidiTrack i = ml->begin(); i != ml->end(); ++i)
+    {
+        PartList* pl = (*i)->parts();
+        for (iPart ip = pl->begin(); ip != pl->end(); ++ip)
+            ip->second->events()->updateCompactStore();
+    }
+
+    std::vector<double> times;
+    times.reserve(benchCycles);
+    if (dspProfiler)
+    {
+        dspProfiler->setEnabled(printProfile);
+        dspProfiler->reset();
+    }
+
+    audio->msgIdle(true);
+    audio->renderStart(0);
+    for (int i = 0; i < warmupCycles; ++i)
+        audio->renderCycle(segmentSize);
+    for (int i = 0; i < benchCycles; ++i)
+    {
+        double t = now();
+        audio->renderCycle(segmentSize);
+        times.push_back(now() - t);
+    }
+    audio->renderStop();
+    audio->msgIdle(false);
+
+    double budget = segmentSize * 1000000.0 / sampleRate;
+    double sum = 0.0;
+    int overruns = 0;
+    for (size_t i = 0; i < times.size(); ++i)
+    {
+        sum += times[i];
+        if (times[i] > budget)
+            ++overruns;
+    }
+    std::sort(times.begin(), times.end());
+    double mean = sum / times.size();
+
+    QString n(name);
+    n.replace('\\', "\\\\").replace('"', "\\\"");
+    fprintf(out, "{\"scenario\": \"%s\", \"version\": \"%s\", \"sampleRate\": %d, \"segmentSize\": %u, "
+            "\"tracks\": %d, \"cycles\": %d, \"budget_us\": %.1f, \"mean_us\": %.2f, \"p50_us\": %.2f, "
+            "\"p90_us\": %.2f, \"p99_us\": %.2f, \"p999_us\": %.2f, \"max_us\": %.2f, \"load\": %.4f, "
+            "\"overruns\": %d}\n",
+            n.toUtf8().constData(), VERSION, sampleRate, segmentSize,
+            int(song->tracks()->size()), benchCycles, budget, mean,
+            percentile(times, 0.5), percentile(times, 0.9), percentile(times, 0.99),
+            percentile(times, 0.999), times.back(), mean / budget, overruns);
+    fflush(out);
+    fprintf(stderr, "oom_bench: %-12s mean %8.1f us  p99 %8.1f us  max %8.1f us  load %5.1f%%\n",
+            name.toLocal8Bit().constData(), mean, percentile(times, 0.99), times.back(), 100.0 * mean / budget);
+
+    if (printProfile && dspProfiler)
+    {
+        dspProfiler->calibrate();
+        fprintf(stderr, "%s", dspProfiler->report(10).toLocal8Bit().constData());
+        dspProfiler->setEnabled(false);
+    }
+}
+
+//---------------------------------------------------------
+//   usage
+//---------------------------------------------------------
+
+static void usage(const char* prog)
+{
+    fprintf(stderr, "usage: %s [options] [scenario|song.oom]...\n", prog);
+    fprintf(stderr, "   -c  n    measured cycles per run (default %d)\n", benchCycles);
+    fprintf(stderr, "   -w  n    warmup cycles (default %d)\n", warmupCycles);
+    fprintf(stderr, "   -b  n    segment size in frames (default: dummy audio config)\n");
+    fprintf(stderr, "   -r  n    sample rate (default: dummy audio config)\n");
+    fprintf(stderr, "   -o  file append the results to file instead of stdout\n");
+    fprintf(stderr, "   -p       print the top consumers of every run\n");
+    fprintf(stderr, "   -h       this help\n");
+    fprintf(stderr, "scenarios, all if none and no song is given:\n");
+    for (int i = 0; i < nScenarios; ++i)
+        fprintf(stderr, "   %-12s %s\n", scenarios[i].name, scenarios[i].description);
+    fprintf(stderr, "one json object per run and line is written.\n");
+}
+
+//---------------------------------------------------------
+//   main
+//---------------------------------------------------------
+
+int main(int argc, char* argv[])
+{
+    Q_INIT_RESOURCE(oom);
+
+    int bufSize = 0;
+    int rate = 0;
+    const char* outPath = 0;
+    int c;
+    while ((c = getopt(argc, argv, "c:w:b:r:o:ph")) != EOF)
+    {
+        switch (c)
+        {
+            case 'c': benchCycles = atoi(optarg);
+                break;
+            case 'w': warmupCycles = atoi(optarg);
+                break;
+            case 'b': bufSize = atoi(optarg);
+                break;
+            case 'r': rate = atoi(optarg);
+                break;
+            case 'o': outPath = optarg;
+                break;
+            case 'p': printProfile = true;
+                break;
+            case 'h': usage(argv[0]);
+                return 0;
+            default: usage(argv[0]);
+                return 1;
+        }
+    }
+    if (benchCycles < 1 || warmupCycles < 0)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    QStringList runs;
+    for (int i = optind; i < argc; ++i)
+        runs.append(QString(argv[i]));
+    if (runs.isEmpty())
+    {
+        for (int i = 0; i < nScenarios; ++i)
+            runs.append(QString(scenarios[i].name));
+    }
+
+    if (outPath)
+    {
+        out = fopen(outPath, "a");
+        if (!out)
+        {
+            perror(outPath);
+            return 1;
+        }
+    }
+
+    // no window system needed
+    if (qgetenv("QT_QPA_PLATFORM").isEmpty())
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+
+    oomUser = QDir::homePath();
+    oomGlobalLib = QString(LIBDIR);
+    oomGlobalShare = QString(SHAREDIR);
+    oomProject = oomProjectInitPath;
+    oomInstruments = oomGlobalShare + QDir::separator() + QString("instruments");
+
+    initMidiController();
+    int qargc = 1;
+    QApplication app(qargc, argv);
+    initShortCuts();
+    readConfiguration();
+    oomUserInstruments = config.userInstrumentsDir;
+
+    // always the template, no sampler, no splash
+    config.startMode = 1;
+    config.showSplashScreen = false;
+    config.lsClientStartLS = false;
+    config.lsClientAutoStart = false;
+    if (bufSize > 0)
+        config.dummyAudioBufSize = bufSize;
+    if (rate > 0)
+        config.dummyAudioSampleRate = rate;
+
+    AL::initDsp();
+    initDummyAudio();
+    realTimeScheduling = false;
+    useJackTransport.setValue(false);
+    fifoLength = 131072 / config.dummyAudioBufSize;
+
+    initIcons();
+    initMetronome();
+
+    oom = new OOMidi(1, argv);
+    if (!oom->seqStart())
+        return 1;
+
+    workDir = QDir::temp().filePath(QString("oom_bench-%1").arg(getpid()));
+    QDir().mkpath(workDir);
+
+    int rv = 0;
+    for (int r = 0; r < runs.size(); ++r)
+    {
+        const QString& run = runs[r];
+        if (run.endsWith(".oom"))
+        {
+            if (!QFileInfo(run).exists())
+            {
+                fprintf(stderr, "oom_bench: no such song <%s>\n", run.toLocal8Bit().constData());
+                rv = 1;
+                continue;
+            }
+            song->dirty = false;
+            oom->loadProjectFile(run, false, true);
+            measure(QFileInfo(run).completeBaseName());
+            continue;
+        }
+        const Scenario* s = 0;
+        for (int i = 0; i < nScenarios; ++i)
+        {
+            if (run == scenarios[i].name)
+                s = &scenarios[i];
+        }
+        if (!s)
+        {
+            fprintf(stderr, "oom_bench: unknown scenario <%s>\n", run.toLocal8Bit().constData());
+            rv = 1;
+            continue;
+        }
+        if (waveFiles.isEmpty() && makeWaveFiles())
+        {
+            rv = 1;
+            break;
+        }
+        newSong();
+        s->build();
+        measure(run);
+    }
+
+    song->dirty = false;
+    oom->seqStop();
+    for (int i = 0; i < waveFiles.size(); ++i)
+        QFile::remove(waveFiles[i]);
+    QDir().rmdir(workDir);
+    if (out != stdout)
+        fclose(out);
+    // the gui objects are not torn down, exit right away
+    _exit(rv);
+}
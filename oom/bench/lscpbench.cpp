@@ -0,0 +1,137 @@
+//=========================================================
+//  OOMidi
+//  OpenOctave Midi and Audio Editor
+//
+//  sampler channel loading benchmark
+//=========================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QTimer>
+
+#include "network/lsasyncclient.h"
+#include "lsmockserver.h"
+
+static int channels = 120;
+static int maps = 30;
+static int patches = 16;
+static int latency = 1;
+static int inFlight = LSAsyncClient::DEFAULT_IN_FLIGHT;
+static int servePort = -1;
+
+//---------------------------------------------------------
+//   requests
+//    channels tracks spread over maps instruments
+//---------------------------------------------------------
+
+static QList<LSChannelRequest> requests()
+{
+    QList<LSChannelRequest> list;
+    for (int i = 0; i < channels; ++i)
+    {
+        LSChannelRequest r;
+        int map = i % qMax(1, maps);
+        r.trackId = i + 1;
+        r.name = QString("Track %1").arg(i + 1);
+        r.mapName = QString("Instrument %1").arg(map);
+        r.engine = "SFZ";
+        r.filename = QString("/sounds/instrument%1/default.sfz").arg(map);
+        r.index = 0;
+        for (int p = 0; p < patches; ++p)
+        {
+            LSPatchMapping m;
+            m.bank = 0;
+            m.prog = p;
+            m.engine = "SFZ";
+            m.filename = QString("/sounds/instrument%1/patch%2.sfz").arg(map).arg(p);
+            m.index = 0;
+            m.volume = 1.0;
+            m.loadmode = 0;
+            m.name = QString("Patch %1").arg(p);
+            r.patches.append(m);
+        }
+        list.append(r);
+    }
+    return list;
+}
+
+//---------------------------------------------------------
+//   usage
+//---------------------------------------------------------
+
+static void usage(const char* prog)
+{
+    fprintf(stderr, "usage: %s [options]\n", prog);
+    fprintf(stderr, "   -n  n    sampler channels to create (default %d)\n", channels);
+    fprintf(stderr, "   -m  n    distinct instrument maps (default %d)\n", maps);
+    fprintf(stderr, "   -P  n    patches per map (default %d)\n", patches);
+    fprintf(stderr, "   -l  ms   reply latency of the stand-in (default %d)\n", latency);
+    fprintf(stderr, "   -f  n    commands in flight, 1 waits for every reply (default %d)\n", inFlight);
+    fprintf(stderr, "   -S  port only run the LSCP stand-in on port, for pointing oom at it\n");
+    fprintf(stderr, "   -h       this help\n");
+}
+
+//---------------------------------------------------------
+//   main
+//---------------------------------------------------------
+
+int main(int argc, char* argv[])
+{
+    int c;
+    while ((c = getopt(argc, argv, "n:m:P:l:f:S:h")) != EOF)
+    {
+        switch (c)
+        {
+            case 'n': channels = atoi(optarg);
+                break;
+            case 'm': maps = atoi(optarg);
+                break;
+            case 'P': patches = atoi(optarg);
+                break;
+            case 'l': latency = atoi(optarg);
+                break;
+            case 'f': inFlight = atoi(optarg);
+                break;
+            case 'S': servePort = atoi(optarg);
+                break;
+            case 'h': usage(argv[0]);
+                return 0;
+            default: usage(argv[0]);
+                return 1;
+        }
+    }
+
+    QCoreApplication app(argc, argv);
+    LSMockServer server;
+    server.setLatency(latency);
+    if (!server.listen(servePort > 0 ? servePort : 0))
+    {
+        fprintf(stderr, "cannot listen on port %d\n", servePort);
+        return 1;
+    }
+    if (servePort > 0)
+    {
+        fprintf(stderr, "LSCP stand-in listening on localhost:%d\n", server.port());
+        return app.exec();
+    }
+
+    LSAsyncClient client("localhost", server.port());
+    client.setMaxInFlight(inFlight);
+    QObject::connect(&client, SIGNAL(batchFinished(int, int)), &app, SLOT(quit()));
+    QTimer::singleShot(60000, &app, SLOT(quit()));
+
+    QElapsedTimer timer;
+    timer.start();
+    client.loadChannels(requests());
+    app.exec();
+    qint64 ms = timer.elapsed();
+
+    fprintf(stdout, "{\"bench\":\"lscp_load\",\"channels\":%d,\"maps\":%d,\"patches\":%d,"
+            "\"latency_ms\":%d,\"in_flight\":%d,\"ms\":%lld,\"commands\":%d,\"created\":%d}\n",
+            channels, maps, patches, latency, inFlight, (long long) ms, server.commands(), server.channels());
+    return server.channels() == channels ? 0 : 1;
+}
@@ -0,0 +1,375 @@
+//=========================================================
+//  OOMidi
+//  OpenOctave Midi and Audio Editor
+//
+//  LSCP stand-in for LinuxSampler
+//=========================================================
+
+#include <QHostAddress>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTimer>
+
+#include "lsmockserver.h"
+
+//---------------------------------------------------------
+//   LSMockServer
+//---------------------------------------------------------
+
+LSMockServer::LSMockServer(QObject* parent)
+: QObject(parent)
+{
+    m_latency = 0;
+    m_commands = 0;
+    m_engines << "GIG" << "SFZ" << "SF2";
+    clear();
+
+    m_server = new QTcpServer(this);
+    connect(m_server, SIGNAL(newConnection()), this, SLOT(newConnection()));
+    m_timer = new QTimer(this);
+    m_timer->setSingleShot(true);
+    connect(m_timer, SIGNAL(timeout()), this, SLOT(sendDue()));
+    m_clock.start();
+}
+
+bool LSMockServer::listen(quint16 port)
+{
+    return m_server->listen(QHostAddress::LocalHost, port);
+}
+
+quint16 LSMockServer::port() const
+{
+    return m_server->serverPort();
+}
+
+//---------------------------------------------------------
+//   clear
+//    sampler state after RESET
+//---------------------------------------------------------
+
+void LSMockServer::clear()
+{
+    m_midiDevice = false;
+    m_audioDevice = false;
+    m_midiPorts.clear();
+    m_audioChannels.clear();
+    m_maps.clear();
+    m_nextMap = 0;
+    m_mapEntries = 0;
+    m_channels.clear();
+    m_nextChannel = 0;
+}
+
+//---------------------------------------------------------
+//   connections
+//---------------------------------------------------------
+
+void LSMockServer::newConnection()
+{
+    while (QTcpSocket* s = m_server->nextPendingConnection())
+    {
+        m_buffers.insert(s, QByteArray());
+        connect(s, SIGNAL(readyRead()), this, SLOT(readCommands()));
+        connect(s, SIGNAL(disconnected()), this, SLOT(dropConnection()));
+    }
+}
+
+void LSMockServer::dropConnection()
+{
+    QTcpSocket* s = (QTcpSocket*) sender();
+    m_buffers.remove(s);
+    s->deleteLater();
+}
+
+void LSMockServer::readCommands()
+{
+    QTcpSocket* s = (QTcpSocket*) sender();
+    QByteArray& buffer = m_buffers[s];
+    buffer += s->readAll();
+    int pos = 0;
+    int eol;
+    while ((eol = buffer.indexOf('\n', pos)) >= 0)
+    {
+        QByteArray line = buffer.mid(pos, eol - pos).trimmed();
+        pos = eol + 1;
+        if (line.isEmpty() || line.startsWith('#'))
+            continue;
+        if (line == "QUIT")
+        {
+            s->disconnectFromHost();
+            break;
+        }
+        ++m_commands;
+        Outgoing out;
+        out.socket = s;
+        out.due = m_clock.elapsed() + m_latency;
+        out.data = execute(line);
+        m_outgoing.append(out);
+    }
+    buffer.remove(0, pos);
+    sendDue();
+}
+
+//---------------------------------------------------------
+//   sendDue
+//---------------------------------------------------------
+
+void LSMockServer::sendDue()
+{
+    qint64 now = m_clock.elapsed();
+    while (!m_outgoing.isEmpty() && m_outgoing.front().due <= now)
+    {
+        Outgoing out = m_outgoing.takeFirst();
+        if (out.socket)
+            out.socket->write(out.data);
+    }
+    if (!m_outgoing.isEmpty())
+        m_timer->start(int(m_outgoing.front().due - now));
+}
+
+//---------------------------------------------------------
+//   tokenize
+//    split on blanks, 'quoted strings' with \ escapes are
+//    one token without the quotes
+//---------------------------------------------------------
+
+QStringList LSMockServer::tokenize(const QByteArray& line)
+{
+    QStringList tokens;
+    QByteArray cur;
+    bool quoted = false;
+    bool have = false;
+    for (int i = 0; i < line.size(); ++i)
+    {
+        char c = line[i];
+        if (quoted)
+        {
+            if (c == '\\' && i + 1 < line.size())
+                cur += line[++i];
+            else if (c == '\'')
+                quoted = false;
+            else
+                cur += c;
+        }
+        else if (c == '\'')
+        {
+            quoted = true;
+            have = true;
+        }
+        else if (c == ' ')
+        {
+            if (have)
+                tokens.append(QString::fromUtf8(cur));
+            cur.clear();
+            have = false;
+        }
+        else
+        {
+            cur += c;
+            have = true;
+        }
+    }
+    if (have)
+        tokens.append(QString::fromUtf8(cur));
+    return tokens;
+}
+
+//---------------------------------------------------------
+//   param
+//    value of KEY=value among the tokens
+//---------------------------------------------------------
+
+QString LSMockServer::param(const QStringList& tokens, const char* key)
+{
+    QString prefix = QString(key) + "=";
+    for (int i = 0; i < tokens.size(); ++i)
+    {
+        if (tokens[i].startsWith(prefix))
+        {
+            QString v = tokens[i].mid(prefix.size());
+            if (v.size() >= 2 && v.startsWith('\'') && v.endsWith('\''))
+                v = v.mid(1, v.size() - 2);
+            return v;
+        }
+    }
+    return QString();
+}
+
+//---------------------------------------------------------
+//   execute
+//    return the complete reply for one command line
+//---------------------------------------------------------
+
+QByteArray LSMockServer::execute(const QByteArray& line)
+{
+    static const QByteArray ok("OK\r\n");
+    QStringList t = tokenize(line);
+    QString cmd = t.mid(0, 3).join(" ");
+    int n = t.size();
+
+    if (cmd == "GET SERVER INFO")
+        return "DESCRIPTION: LSCP stand-in\r\nVERSION: 1.0.0\r\nPROTOCOL_VERSION: 1.5\r\n.\r\n";
+
+    if (t.value(0) == "RESET")
+    {
+        clear();
+        return ok;
+    }
+
+    if (cmd == "GET MIDI_INPUT_DEVICE" && n == 5 && t[3] == "INFO")
+    {
+        if (!m_midiDevice || t[4] != "0")
+            return "ERR:0:There is no midi input device with index " + t[4].toUtf8() + ".\r\n";
+        return "DRIVER: JACK\r\nACTIVE: true\r\nNAME: 'LinuxSampler'\r\nPORTS: "
+                + QByteArray::number(m_midiPorts.size()) + "\r\n.\r\n";
+    }
+    if (cmd == "GET AUDIO_OUTPUT_DEVICE" && n == 5 && t[3] == "INFO")
+    {
+        if (!m_audioDevice || t[4] != "0")
+            return "ERR:0:There is no audio output device with index " + t[4].toUtf8() + ".\r\n";
+        return "DRIVER: JACK\r\nACTIVE: true\r\nCHANNELS: " + QByteArray::number(m_audioChannels.size())
+                + "\r\nSAMPLERATE: 48000\r\n.\r\n";
+    }
+    if (cmd == "GET MIDI_INPUT_PORT" && n == 6)
+    {
+        int p = t[5].toInt();
+        if (!m_midiDevice || p < 0 || p >= m_midiPorts.size())
+            return "ERR:0:There is no midi input port with index " + t[5].toUtf8() + ".\r\n";
+        return "NAME: " + m_midiPorts[p].toUtf8() + "\r\n.\r\n";
+    }
+    if (cmd == "GET AUDIO_OUTPUT_CHANNEL" && n == 6)
+    {
+        int c = t[5].toInt();
+        if (!m_audioDevice || c < 0 || c >= m_audioChannels.size())
+            return "ERR:0:There is no audio output channel with index " + t[5].toUtf8() + ".\r\n";
+        return "NAME: " + m_audioChannels[c].toUtf8() + "\r\nIS_MIX_CHANNEL: false\r\n.\r\n";
+    }
+
+    if (cmd == "CREATE MIDI_INPUT_DEVICE JACK")
+    {
+        m_midiDevice = true;
+        int ports = qMax(1, param(t, "PORTS").toInt());
+        m_midiPorts.clear();
+        for (int i = 0; i < ports; ++i)
+            m_midiPorts.append(QString("midi_in_%1").arg(i));
+        return "OK[0]\r\n";
+    }
+    if (cmd == "CREATE AUDIO_OUTPUT_DEVICE JACK")
+    {
+        m_audioDevice = true;
+        int channels = qMax(1, param(t, "CHANNELS").toInt());
+        m_audioChannels.clear();
+        for (int i = 0; i < channels; ++i)
+            m_audioChannels.append(QString::number(i));
+        return "OK[0]\r\n";
+    }
+    if (cmd == "SET MIDI_INPUT_DEVICE_PARAMETER 0" && m_midiDevice)
+    {
+        int ports = param(t, "PORTS").toInt();
+        while (m_midiPorts.size() < ports)
+            m_midiPorts.append(QString("midi_in_%1").arg(m_midiPorts.size()));
+        while (m_midiPorts.size() > ports && ports > 0)
+            m_midiPorts.removeLast();
+        return ok;
+    }
+    if (cmd == "SET AUDIO_OUTPUT_DEVICE_PARAMETER 0" && m_audioDevice)
+    {
+        int channels = param(t, "CHANNELS").toInt();
+        while (m_audioChannels.size() < channels)
+            m_audioChannels.append(QString::number(m_audioChannels.size()));
+        while (m_audioChannels.size() > channels && channels > 0)
+            m_audioChannels.removeLast();
+        return ok;
+    }
+    if (cmd == "SET MIDI_INPUT_PORT_PARAMETER 0" && n == 5)
+    {
+        int p = t[3].toInt();
+        if (p < 0 || p >= m_midiPorts.size())
+            return "ERR:0:There is no midi input port with index " + t[3].toUtf8() + ".\r\n";
+        m_midiPorts[p] = param(t, "NAME");
+        return ok;
+    }
+    if (cmd == "SET AUDIO_OUTPUT_CHANNEL_PARAMETER 0" && n == 5)
+    {
+        int c = t[3].toInt();
+        if (c < 0 || c >= m_audioChannels.size())
+            return "ERR:0:There is no audio output channel with index " + t[3].toUtf8() + ".\r\n";
+        m_audioChannels[c] = param(t, "NAME");
+        return ok;
+    }
+
+    if (line == "LIST MIDI_INSTRUMENT_MAPS")
+    {
+        QStringList ids;
+        for (QMap<int, QString>::const_iterator i = m_maps.begin(); i != m_maps.end(); ++i)
+            ids.append(QString::number(i.key()));
+        return ids.join(",").toUtf8() + "\r\n";
+    }
+    if (cmd == "GET MIDI_INSTRUMENT_MAP" && n == 5)
+    {
+        int id = t[4].toInt();
+        if (!m_maps.contains(id))
+            return "ERR:0:There is no midi instrument map " + t[4].toUtf8() + ".\r\n";
+        return "NAME: '" + m_maps[id].toUtf8() + "'\r\nDEFAULT: false\r\n.\r\n";
+    }
+    if (cmd == "ADD MIDI_INSTRUMENT_MAP")
+    {
+        int id = m_nextMap++;
+        m_maps.insert(id, t.value(2));
+        return "OK[" + QByteArray::number(id) + "]\r\n";
+    }
+    if (t.value(0) == "MAP" && t.value(1) == "MIDI_INSTRUMENT")
+    {
+        int i = t.value(2) == "NON_MODAL" ? 3 : 2;
+        if (!m_maps.contains(t.value(i).toInt()))
+            return "ERR:0:There is no midi instrument map " + t.value(i).toUtf8() + ".\r\n";
+        ++m_mapEntries;
+        return ok;
+    }
+
+    if (line == "ADD CHANNEL")
+    {
+        int id = m_nextChannel++;
+        m_channels.insert(id, QString());
+        return "OK[" + QByteArray::number(id) + "]\r\n";
+    }
+    if (cmd == "REMOVE CHANNEL" && n == 3)
+    {
+        if (!m_channels.remove(t[2].toInt()))
+            return "ERR:0:There is no sampler channel " + t[2].toUtf8() + ".\r\n";
+        return ok;
+    }
+    if (t.value(0) == "LOAD" && t.value(1) == "ENGINE" && n == 4)
+    {
+        int chan = t[3].toInt();
+        if (!m_channels.contains(chan))
+            return "ERR:0:There is no sampler channel " + t[3].toUtf8() + ".\r\n";
+        if (!m_engines.contains(t[2]))
+            return "ERR:0:There is no engine " + t[2].toUtf8() + ".\r\n";
+        m_channels[chan] = t[2];
+        return ok;
+    }
+    if (t.value(0) == "LOAD" && t.value(1) == "INSTRUMENT")
+    {
+        if (!m_channels.contains(t.value(n - 1).toInt()))
+            return "ERR:0:There is no sampler channel " + t.value(n - 1).toUtf8() + ".\r\n";
+        return ok;
+    }
+    if (t.value(0) == "SET" && t.value(1) == "CHANNEL" && n >= 5)
+    {
+        if (!m_channels.contains(t[3].toInt()))
+            return "ERR:0:There is no sampler channel " + t[3].toUtf8() + ".\r\n";
+        return ok;
+    }
+
+    if (line == "LIST AVAILABLE_ENGINES")
+        return m_engines.join(",").toUtf8() + "\r\n";
+    if (cmd == "GET ENGINE INFO" && n == 4)
+    {
+        if (!m_engines.contains(t[3]))
+            return "ERR:0:There is no engine " + t[3].toUtf8() + ".\r\n";
+        return "DESCRIPTION: '" + t[3].toUtf8() + " stand-in'\r\nVERSION: 1.0\r\n.\r\n";
+    }
+
+    return "ERR:0:Unknown command.\r\n";
+}
@@ -0,0 +1,101 @@
+//=========================================================
+//  OOMidi
+//  OpenOctave Midi and Audio Editor
+//
+//  LSCP stand-in for LinuxSampler
+//=========================================================
+
+#ifndef __LSMOCKSERVER_H__
+#define __LSMOCKSERVER_H__
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QList>
+#include <QMap>
+#include <QObject>
+#include <QPointer>
+#include <QStringList>
+
+class QTcpServer;
+class QTcpSocket;
+class QTimer;
+
+//---------------------------------------------------------
+//   LSMockServer
+//    Answers the part of LSCP oom uses: devices and their
+//    ports, instrument maps, channels and engines. Nothing
+//    is loaded, the state only lives long enough to give
+//    plausible replies.
+//
+//    Each reply leaves latency ms after its command came
+//    in, in order, so a client waiting for every reply
+//    pays the latency per command and a pipelining one
+//    about once.
+//---------------------------------------------------------
+
+class LSMockServer : public QObject
+{
+    Q_OBJECT
+
+    struct Outgoing
+    {
+        QPointer<QTcpSocket> socket;
+        qint64 due;
+        QByteArray data;
+    };
+
+    QTcpServer* m_server;
+    QTimer* m_timer;
+    QElapsedTimer m_clock;
+    QHash<QTcpSocket*, QByteArray> m_buffers;
+    QList<Outgoing> m_outgoing;
+    int m_latency;
+    int m_commands;
+
+    bool m_midiDevice;
+    bool m_audioDevice;
+    QStringList m_midiPorts;
+    QStringList m_audioChannels;
+    QMap<int, QString> m_maps;
+    int m_nextMap;
+    int m_mapEntries;
+    QMap<int, QString> m_channels; // id -> engine
+    int m_nextChannel;
+    QStringList m_engines;
+
+    LSMockServer(const LSMockServer&);
+    LSMockServer& operator=(const LSMockServer&);
+
+    QByteArray execute(const QByteArray& line);
+    void clear();
+    static QStringList tokenize(const QByteArray& line);
+    static QString param(const QStringList& tokens, const char* key);
+
+private slots:
+    void newConnection();
+    void readCommands();
+    void dropConnection();
+    void sendDue();
+
+public:
+    LSMockServer(QObject* parent = 0);
+
+    //! like QTcpServer::listen(), returns true once listening
+    bool listen(quint16 port = 0);
+    quint16 port() const;
+    void setLatency(int ms)
+    {
+        m_latency = ms;
+    }
+    int commands() const
+    {
+        return m_commands;
+    }
+    int channels() const
+    {
+        return m_channels.size();
+    }
+};
+
+#endif
@@ -0,0 +1,630 @@
+//=========================================================
+//  OOMidi
+//  OpenOctave Midi and Audio Editor
+//
+//  micro benchmarks of the realtime primitives
+//=========================================================
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <vector>
+
+#include <QString>
+
+#include "al/dsp.h"
+#include "ctrl.h"
+#include "gconfig.h"
+#include "globals.h"
+#include "node.h"
+#include "sig.h"
+#include "tempo.h"
+
+static int repetitions = 30;
+static int warmups = 3;
+static double sampleUs = 2000.0; // target length of one sample
+static const char* filter = 0;
+static FILE* out = stdout;
+
+static volatile double sink; // keeps results alive
+
+// busses and synths go beyond the stereo of a track
+enum { MAX_BENCH_CHANNELS = 8 };
+
+//---------------------------------------------------------
+//   now
+//    nanoseconds
+//---------------------------------------------------------
+
+static inline double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+//---------------------------------------------------------
+//   Rand
+//    small deterministic generator, the same inputs on
+//    every run and build
+//---------------------------------------------------------
+
+class Rand
+{
+    unsigned m_state;
+
+public:
+    Rand(unsigned seed = 12345)
+    {
+        m_state = seed;
+    }
+    unsigned next()
+    {
+        m_state = m_state * 1664525u + 1013904223u;
+        return m_state >> 8;
+    }
+    float uniform()
+    {
+        return (next() & 0xffff) / 32768.0f - 1.0f;
+    }
+};
+
+//---------------------------------------------------------
+//   run
+//    Body::operator() does one call and returns a value
+//    to keep. The number of calls per sample is chosen so
+//    a sample takes about sampleUs, then warmups samples
+//    are thrown away and repetitions samples reported.
+//    items is the work of one call, frames times
+//    channels or lookups, for a per item figure.
+//---------------------------------------------------------
+
+template<class Body> static void run(const char* bench, const QString& params, double items, Body& body)
+{
+    if (filter && !strstr(bench, filter))
+        return;
+
+    double acc = 0.0;
+    long inner = 1;
+    for (;;)
+    {
+        double t = now();
+        for (long i = 0; i < inner; ++i)
+            acc += body();
+        double dt = now() - t;
+        if (dt >= sampleUs * 1000.0 || inner >= (1L << 30))
+            break;
+        if (dt < sampleUs * 10.0)
+            inner *= 8;
+        else
+            inner = long(inner * sampleUs * 1000.0 / dt) + 1;
+    }
+
+    std::vector<double> samples;
+    for (int r = 0; r < warmups + repetitions; ++r)
+    {
+        double t = now();
+        for (long i = 0; i < inner; ++i)
+            acc += body();
+        double ns = (now() - t) / inner;
+        if (r >= warmups)
+            samples.push_back(ns);
+    }
+    sink = acc;
+
+    std::sort(samples.begin(), samples.end());
+    double sum = 0.0;
+    for (size_t i = 0; i < samples.size(); ++i)
+        sum += samples[i];
+    double mean = sum / samples.size();
+    double var = 0.0;
+    for (size_t i = 0; i < samples.size(); ++i)
+        var += (samples[i] - mean) * (samples[i] - mean);
+    double stddev = samples.size() > 1 ? sqrt(var / (samples.size() - 1)) : 0.0;
+    double median = samples[samples.size() / 2];
+    double p90 = samples[std::min(samples.size() - 1, size_t(samples.size() * 0.9))];
+
+    fprintf(out, "{\"bench\": \"%s\", \"params\": {%s}, \"reps\": %d, \"calls\": %ld, "
+            "\"min_ns\": %.2f, \"median_ns\": %.2f, \"mean_ns\": %.2f, \"p90_ns\": %.2f, "
+            "\"stddev_ns\": %.2f, \"median_ns_per_item\": %.4f}\n",
+            bench, params.toLatin1().constData(), repetitions, inner,
+            samples.front(), median, mean, p90, stddev, median / items);
+    fflush(out);
+    fprintf(stderr, "%-24s %-36s %12.1f ns  +-%5.1f%%  %8.3f ns/item\n",
+            bench, params.toLatin1().constData(), median,
+            mean > 0.0 ? 100.0 * stddev / mean : 0.0, median / items);
+}
+
+//---------------------------------------------------------
+//   Buffers
+//    planar channels of random samples, aligned like the
+//    buffers of the tracks
+//---------------------------------------------------------
+
+struct Buffers
+{
+    int channels;
+    unsigned frames;
+    float* ch[MAX_BENCH_CHANNELS];
+
+    Buffers(int c, unsigned n, unsigned seed)
+    {
+        channels = c;
+        frames = n;
+        Rand rnd(seed);
+        for (int i = 0; i < channels; ++i)
+        {
+            if (posix_memalign((void**) &ch[i], 16, sizeof (float) * n))
+            {
+                fprintf(stderr, "cannot allocate %u frames for channel %d\n", n, i);
+                exit(1);
+            }
+            for (unsigned k = 0; k < n; ++k)
+                ch[i][k] = rnd.uniform();
+        }
+    }
+    ~Buffers()
+    {
+        for (int i = 0; i < channels; ++i)
+            free(ch[i]);
+    }
+};
+
+//---------------------------------------------------------
+//   dsp kernels
+//---------------------------------------------------------
+
+struct DspPeak
+{
+    Buffers& src;
+    DspPeak(Buffers& s) : src(s) {}
+    double operator()()
+    {
+        float p = 0.0f;
+        for (int i = 0; i < src.channels; ++i)
+            p = AL::dsp->peak(src.ch[i], src.frames, p);
+        return p;
+    }
+};
+
+struct DspGain
+{
+    Buffers& dst;
+    bool up;
+    DspGain(Buffers& d) : dst(d), up(false) {}
+    double operator()()
+    {
+        // alternating gains keep the values bounded
+        up = !up;
+        for (int i = 0; i < dst.channels; ++i)
+            AL::dsp->applyGainToBuffer(dst.ch[i], dst.frames, up ? 1.5f : 1.0f / 1.5f);
+        return dst.ch[0][0];
+    }
+};
+
+struct DspMixWithGain
+{
+    Buffers& dst;
+    Buffers& src;
+    bool up;
+    DspMixWithGain(Buffers& d, Buffers& s) : dst(d), src(s), up(false) {}
+    double operator()()
+    {
+        up = !up;
+        for (int i = 0; i < dst.channels; ++i)
+            AL::dsp->mixWithGain(dst.ch[i], src.ch[i], dst.frames, up ? 0.5f : -0.5f);
+        return dst.ch[0][0];
+    }
+};
+
+struct DspMix
+{
+    Buffers& dst;
+    Buffers& src;
+    bool add;
+    DspMix(Buffers& d, Buffers& s) : dst(d), src(s), add(false) {}
+    double operator()()
+    {
+        // mix the source in and out again
+        add = !add;
+        for (int i = 0; i < dst.channels; ++i)
+        {
+            if (add)
+                AL::dsp->mix(dst.ch[i], src.ch[i], dst.frames);
+            else
+                AL::dsp->mixWithGain(dst.ch[i], src.ch[i], dst.frames, -1.0f);
+        }
+        return dst.ch[0][0];
+    }
+};
+
+struct DspCpy
+{
+    Buffers& dst;
+    Buffers& src;
+    DspCpy(Buffers& d, Buffers& s) : dst(d), src(s) {}
+    double operator()()
+    {
+        for (int i = 0; i < dst.channels; ++i)
+            AL::dsp->cpy(dst.ch[i], src.ch[i], dst.frames);
+        return dst.ch[0][0];
+    }
+};
+
+static void benchDsp()
+{
+    static const unsigned sizes[] = { 64, 256, 1024, 4096 };
+    static const int chans[] = { 1, 2, 8 };
+    for (unsigned s = 0; s < sizeof(sizes) / sizeof(*sizes); ++s)
+    {
+        for (unsigned c = 0; c < sizeof(chans) / sizeof(*chans); ++c)
+        {
+            unsigned n = sizes[s];
+            int ch = chans[c];
+            QString params = QString("\"frames\": %1, \"channels\": %2").arg(n).arg(ch);
+            double items = double(n) * ch;
+            Buffers a(ch, n, 1), b(ch, n, 2);
+
+            DspPeak peak(a);
+            run("dsp.peak", params, items, peak);
+            DspGain gain(a);
+            run("dsp.applyGainToBuffer", params, items, gain);
+            DspMixWithGain mixg(a, b);
+            run("dsp.mixWithGain", params, items, mixg);
+            DspMix mix(a, b);
+            run("dsp.mix", params, items, mix);
+            DspCpy cpy(a, b);
+            run("dsp.cpy", params, items, cpy);
+        }
+    }
+}
+
+//---------------------------------------------------------
+//   fifo
+//    one segment through the prefetch fifo, put() on the
+//    writer side, get() on the reader side
+//---------------------------------------------------------
+
+struct FifoRoundTrip
+{
+    Fifo& fifo;
+    Buffers& src;
+    unsigned pos;
+    FifoRoundTrip(Fifo& f, Buffers& s) : fifo(f), src(s), pos(0) {}
+    double operator()()
+    {
+        float* dst[MAX_BENCH_CHANNELS];
+        unsigned p;
+        fifo.put(src.channels, src.frames, src.ch, pos);
+        fifo.get(src.channels, src.frames, dst, &p);
+        pos += src.frames;
+        return dst[0][0] + p;
+    }
+};
+
+struct FifoBurst
+{
+    Fifo& fifo;
+    Buffers& src;
+    int depth;
+    FifoBurst(Fifo& f, Buffers& s, int d) : fifo(f), src(s), depth(d) {}
+    double operator()()
+    {
+        float* dst[MAX_BENCH_CHANNELS];
+        unsigned p = 0;
+        for (int i = 0; i < depth; ++i)
+            fifo.put(src.channels, src.frames, src.ch, i);
+        double acc = 0.0;
+        for (int i = 0; i < depth; ++i)
+        {
+            fifo.get(src.channels, src.frames, dst, &p);
+            acc += dst[0][0];
+        }
+        return acc + p;
+    }
+};
+
+static void benchFifo()
+{
+    static const unsigned sizes[] = { 64, 256, 1024, 4096 };
+    static const int chans[] = { 1, 2, 8 };
+    for (unsigned s = 0; s < sizeof(sizes) / sizeof(*sizes); ++s)
+    {
+        for (unsigned c = 0; c < sizeof(chans) / sizeof(*chans); ++c)
+        {
+            unsigned n = sizes[s];
+            int ch = chans[c];
+            fifoLength = 131072 / n;
+            Fifo fifo;
+            Buffers src(ch, n, 3);
+            QString params = QString("\"frames\": %1, \"channels\": %2").arg(n).arg(ch);
+
+            FifoRoundTrip rt(fifo, src);
+            run("fifo.putGet", params, double(n) * ch, rt);
+
+            // the prefetch thread fills ahead by whole blocks
+            int depth = std::min(fifo.size() - 1, 16);
+            FifoBurst burst(fifo, src, depth);
+            run("fifo.burst", params + QString(", \"depth\": %1").arg(depth), double(n) * ch * depth, burst);
+        }
+    }
+}
+
+//---------------------------------------------------------
+//   tempo and signature
+//---------------------------------------------------------
+
+struct Lookups
+{
+    enum { N = 1024 };
+    unsigned v[N];
+    Lookups(unsigned range, unsigned seed)
+    {
+        Rand rnd(seed);
+        for (int i = 0; i < N; ++i)
+            v[i] = rnd.next() % range;
+    }
+};
+
+struct Tick2Frame
+{
+    TempoList& tl;
+    Lookups& in;
+    Tick2Frame(TempoList& t, Lookups& l) : tl(t), in(l) {}
+    double operator()()
+    {
+        unsigned acc = 0;
+        for (int i = 0; i < Lookups::N; ++i)
+            acc += tl.tick2frame(in.v[i]);
+        return acc;
+    }
+};
+
+struct Frame2Tick
+{
+    TempoList& tl;
+    Lookups& in;
+    Frame2Tick(TempoList& t, Lookups& l) : tl(t), in(l) {}
+    double operator()()
+    {
+        unsigned acc = 0;
+        for (int i = 0; i < Lookups::N; ++i)
+            acc += tl.frame2tick(in.v[i]);
+        return acc;
+    }
+};
+
+static void benchTempo()
+{
+    static const int changes[] = { 1, 10, 100, 1000, 10000 };
+    for (unsigned c = 0; c < sizeof(changes) / sizeof(*changes); ++c)
+    {
+        TempoList tl;
+        Rand rnd(4);
+        for (int i = 1; i < changes[c]; ++i)
+            tl.addTempo(i * config.division, 300000 + rnd.next() % 400000);
+        unsigned ticks = (changes[c] + 16) * config.division;
+        unsigned frames = tl.tick2frame(ticks);
+        QString params = QString("\"changes\": %1").arg(changes[c]);
+
+        Lookups tk(ticks, 5);
+        Tick2Frame t2f(tl, tk);
+        run("tempo.tick2frame", params, Lookups::N, t2f);
+
+        Lookups fr(frames, 6);
+        Frame2Tick f2t(tl, fr);
+        run("tempo.frame2tick", params, Lookups::N, f2t);
+    }
+}
+
+struct TickValues
+{
+    SigList& sl;
+    Lookups& in;
+    TickValues(SigList& s, Lookups& l) : sl(s), in(l) {}
+    double operator()()
+    {
+        unsigned acc = 0;
+        for (int i = 0; i < Lookups::N; ++i)
+        {
+            int bar, beat;
+            unsigned tick;
+            sl.tickValues(in.v[i], &bar, &beat, &tick);
+            acc += bar + beat + tick;
+        }
+        return acc;
+    }
+};
+
+struct Bar2Tick
+{
+    SigList& sl;
+    Lookups& in;
+    Bar2Tick(SigList& s, Lookups& l) : sl(s), in(l) {}
+    double operator()()
+    {
+        unsigned acc = 0;
+        for (int i = 0; i < Lookups::N; ++i)
+            acc += sl.bar2tick(in.v[i], 0, 0);
+        return acc;
+    }
+};
+
+struct Raster
+{
+    SigList& sl;
+    Lookups& in;
+    Raster(SigList& s, Lookups& l) : sl(s), in(l) {}
+    double operator()()
+    {
+        unsigned acc = 0;
+        for (int i = 0; i < Lookups::N; ++i)
+            acc += sl.raster(in.v[i], 0);
+        return acc;
+    }
+};
+
+static void benchSig()
+{
+    static const int changes[] = { 1, 10, 100, 1000 };
+    for (unsigned c = 0; c < sizeof(changes) / sizeof(*changes); ++c)
+    {
+        SigList sl;
+        for (int i = 1; i < changes[c]; ++i)
+            sl.add(sl.bar2tick(i * 4, 0, 0), 2 + i % 6, 4);
+        int bars = changes[c] * 4 + 16;
+        unsigned ticks = sl.bar2tick(bars, 0, 0);
+        QString params = QString("\"changes\": %1").arg(changes[c]);
+
+        Lookups tk(ticks, 7);
+        TickValues tv(sl, tk);
+        run("sig.tickValues", params, Lookups::N, tv);
+        Raster ra(sl, tk);
+        run("sig.raster", params, Lookups::N, ra);
+
+        Lookups br(bars, 8);
+        Bar2Tick b2t(sl, br);
+        run("sig.bar2tick", params, Lookups::N, b2t);
+    }
+}
+
+//---------------------------------------------------------
+//   automation
+//    CtrlList::value() once per cycle in play order, as
+//    the audio thread does, and at random positions
+//---------------------------------------------------------
+
+struct CtrlSequential
+{
+    CtrlList& cl;
+    unsigned end;
+    unsigned frame;
+    CtrlSequential(CtrlList& c, unsigned e) : cl(c), end(e), frame(0) {}
+    double operator()()
+    {
+        double acc = 0.0;
+        for (int i = 0; i < Lookups::N; ++i)
+        {
+            acc += cl.value(frame);
+            frame += 256;
+            if (frame >= end)
+                frame = 0;
+        }
+        return acc;
+    }
+};
+
+struct CtrlRandom
+{
+    CtrlList& cl;
+    Lookups& in;
+    CtrlRandom(CtrlList& c, Lookups& l) : cl(c), in(l) {}
+    double operator()()
+    {
+        double acc = 0.0;
+        for (int i = 0; i < Lookups::N; ++i)
+            acc += cl.value(in.v[i]);
+        return acc;
+    }
+};
+
+static void benchCtrl()
+{
+    static const int points[] = { 16, 1000, 100000 };
+    for (unsigned p = 0; p < sizeof(points) / sizeof(*points); ++p)
+    {
+        CtrlList cl(AC_VOLUME);
+        Rand rnd(9);
+        unsigned frame = 0;
+        for (int i = 0; i < points[p]; ++i)
+        {
+            cl.add(frame, (rnd.next() & 0xffff) / 65536.0);
+            frame += 64 + rnd.next() % 4096;
+        }
+        QString params = QString("\"points\": %1").arg(points[p]);
+
+        CtrlSequential seq(cl, frame);
+        run("ctrl.value.sequential", params, Lookups::N, seq);
+        Lookups fr(frame, 10);
+        CtrlRandom rand(cl, fr);
+        run("ctrl.value.random", params, Lookups::N, rand);
+    }
+}
+
+//---------------------------------------------------------
+//   usage
+//---------------------------------------------------------
+
+static void usage(const char* prog)
+{
+    fprintf(stderr, "usage: %s [options]\n", prog);
+    fprintf(stderr, "   -r  n    measured samples per case (default %d)\n", repetitions);
+    fprintf(stderr, "   -w  n    warmup samples per case (default %d)\n", warmups);
+    fprintf(stderr, "   -t  us   length of one sample (default %.0f)\n", sampleUs);
+    fprintf(stderr, "   -f  str  run the cases whose name contains str, e.g. dsp. or tempo.\n");
+    fprintf(stderr, "   -o  file append the results to file instead of stdout\n");
+    fprintf(stderr, "   -h       this help\n");
+    fprintf(stderr, "one json object per case and line is written, a table to stderr.\n");
+}
+
+//---------------------------------------------------------
+//   main
+//---------------------------------------------------------
+
+int main(int argc, char* argv[])
+{
+    const char* outPath = 0;
+    int c;
+    while ((c = getopt(argc, argv, "r:w:t:f:o:h")) != EOF)
+    {
+        switch (c)
+        {
+            case 'r': repetitions = atoi(optarg);
+                break;
+            case 'w': warmups = atoi(optarg);
+                break;
+            case 't': sampleUs = atof(optarg);
+                break;
+            case 'f': filter = optarg;
+                break;
+            case 'o': outPath = optarg;
+                break;
+            case 'h': usage(argv[0]);
+                return 0;
+            default: usage(argv[0]);
+                return 1;
+        }
+    }
+    if (repetitions < 1 || warmups < 0 || sampleUs <= 0.0)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+    if (outPath)
+    {
+        out = fopen(outPath, "a");
+        if (!out)
+        {
+            perror(outPath);
+            return 1;
+        }
+    }
+
+    sampleRate = 48000;
+    AL::initDsp();
+
+    benchDsp();
+    benchFifo();
+    benchTempo();
+    benchSig();
+    benchCtrl();
+
+    AL::exitDsp();
+    if (out != stdout)
+        fclose(out);
+    return 0;
+}
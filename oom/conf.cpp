@@ -894,6 +894,10 @@ void readConfiguration(Xml& xml, bool readOnlySequencer)/*{{{*/
 					config.useProjectSaveDialog = xml.parseInt();
 				else if (tag == "useAutoCrossFades")
 					config.useAutoCrossFades = xml.parseInt();
+				else if (tag == "undoMemoryLimit")
+					config.undoMemoryLimit = xml.parseInt();
+				else if (tag == "resampleCacheSize")
+					config.resampleCacheSize = xml.parseInt();
 				else if(tag == "lsClientHost")
 				{
 					config.lsClientHost = xml.parse1();
@@ -1246,6 +1250,8 @@ void OOMidi::writeGlobalConfiguration(int level, Xml& xml) const
 	xml.intTag(level, "projectStoreInFolder", config.projectStoreInFolder);
 	xml.intTag(level, "useProjectSaveDialog", config.useProjectSaveDialog);
 	xml.intTag(level, "useAutoCrossFades", config.useAutoCrossFades);
+	xml.intTag(level, "undoMemoryLimit", config.undoMemoryLimit);
+	xml.intTag(level, "resampleCacheSize", config.resampleCacheSize);
 	xml.intTag(level, "midiInputDevice", midiInputPorts);
 	xml.intTag(level, "midiInputChannel", midiInputChannel);
 	xml.intTag(level, "midiRecordType", midiRecordType);
@@ -300,63 +300,52 @@ void CtrlList::read(Xml& xml)
 				break;
 			case Xml::Text:
 			{
-				int len = tag.length();
+				// frame value pairs, read straight from the document
+				const char* p = xml.textBegin();
+				const char* end = xml.textEnd();
 				int frame;
 				double val;
 
-				int i = 0;
 				for (;;)
 				{
-					while (i < len && (tag[i] == ',' || tag[i] == ' ' || tag[i] == '\n'))
-						++i;
-					if (i == len)
+					while (p < end && (*p == ',' || *p == ' ' || *p == '\n'))
+						++p;
+					if (p == end)
 						break;
 
-					QString fs;
-					while (i < len && tag[i] != ' ')
-					{
-						fs.append(tag[i]);
-						++i;
-					}
-					if (i == len)
+					const char* fs = p;
+					while (p < end && *p != ' ')
+						++p;
+					if (p == end)
 						break;
 
-					// Works OK, but only because if current locale fails it falls back on 'C' locale.
-					// So, let's skip the fallback and force use of 'C' locale.
-					frame = loc.toInt(fs, &ok);
+					frame = Xml::toInt(fs, p, &ok);
 					if (!ok)
 					{
-						printf("CtrlList::read failed reading frame string: %s\n", fs.toLatin1().constData());
+						printf("CtrlList::read failed reading frame string: %s\n", QByteArray(fs, p - fs).constData());
 						break;
 					}
 
-					while (i < len && (tag[i] == ' ' || tag[i] == '\n'))
-						++i;
-					if (i == len)
+					while (p < end && (*p == ' ' || *p == '\n'))
+						++p;
+					if (p == end)
 						break;
 
-					QString vs;
-					while (i < len && tag[i] != ' ' && tag[i] != ',')
-					{
-						vs.append(tag[i]);
-						++i;
-					}
+					const char* vs = p;
+					while (p < end && *p != ' ' && *p != ',')
+						++p;
 
-					// Works OK, but only because if current locale fails it falls back on 'C' locale.
-					// So, let's skip the fallback and force use of 'C' locale.
-					//val = vs.toDouble(&ok);
-					val = loc.toDouble(vs, &ok);
+					// always in the 'C' locale
+					val = Xml::toDouble(vs, p, &ok);
 					if (!ok)
 					{
-						printf("CtrlList::read failed reading value string: %s\n", vs.toLatin1().constData());
+						printf("CtrlList::read failed reading value string: %s\n", QByteArray(vs, p - vs).constData());
 						break;
 					}
 
-					//printf("CtrlList::read i:%d len:%d fs:%s frame %d: vs:%s val %f \n", i, len, fs.toLatin1().constData(), frame, vs.toLatin1().constData(), val);
-
 					add(frame, val);
 
-					if (i == len)
+					if (p == end)
 						break;
 				}
 			}
@@ -66,6 +66,15 @@ static int computeVal(MidiController* mc, int y, int height)
 //---------------------------------------------------------
 
 CEvent::CEvent(Event e, MidiPart* pt, int v, bool sel)
+{
+	set(e, pt, v, sel);
+}
+
+//---------------------------------------------------------
+//   set
+//---------------------------------------------------------
+
+void CEvent::set(const Event& e, MidiPart* pt, int v, bool sel)
 {
 	_event = e;
 	_part = pt;
@@ -131,7 +140,10 @@ CtrlCanvas::CtrlCanvas(AbstractMidiEditor* e, QWidget* parent, int xmag,
 	_cnum = CTRL_VELOCITY;
 	_dnum = CTRL_VELOCITY;
 	_didx = CTRL_VELOCITY;
+	m_itemsFrom = 0;
+	m_itemsTo = 0;
 	connect(song, SIGNAL(posChanged(int, unsigned, bool)), this, SLOT(setPos(int, unsigned, bool)));
+	setContentCache(true);
 
 	setMouseTracking(true);
 	if (editor->parts()->empty())
@@ -143,7 +155,7 @@ CtrlCanvas::CtrlCanvas(AbstractMidiEditor* e, QWidget* parent, int xmag,
 	{
 		setCurTrackAndPart();
 	}
-	connect(song, SIGNAL(songChanged(int)), SLOT(songChanged(int)));
+	song->subscribe(this, SLOT(songChanged(const SongChange&)));
 
 	curDrumInstrument = editor->curDrumInstrument();
 	//printf("CtrlCanvas::CtrlCanvas curDrumInstrument:%d\n", curDrumInstrument);
@@ -153,13 +165,24 @@ CtrlCanvas::CtrlCanvas(AbstractMidiEditor* e, QWidget* parent, int xmag,
     updateItems();
 }
 
+//---------------------------------------------------------
+//   ~CtrlCanvas
+//---------------------------------------------------------
+
+CtrlCanvas::~CtrlCanvas()
+{
+	items.clearDelete();
+	for (size_t i = 0; i < m_freeItems.size(); ++i)
+		delete m_freeItems[i];
+}
+
 void CtrlCanvas::heartBeat()
 {
 	int mode = midiMonitor->feedbackMode();
 	if(mode != m_feedbackMode)
 	{
 		m_feedbackMode = mode;
-		update();
+		invalidateContent();
 	}
 }
 
@@ -241,17 +264,14 @@ void CtrlCanvas::setPos(int idx, unsigned val, bool adjustScrollbar)/*{{{*/
 	}
     pos[idx] = val;
 
-        // FIXME: redrawing this rectangle wipes out the controller lane
-        // items when cursor passes over them.
-        // Redrawing the whole view fixes that for now, but it could be a cpu hog ?
-//	redraw(QRect(x, 0, w, height()));
-        update();
+	// the lane itself is cached, only the markers move
+	updatePositionLayer(QRect(x - 2, 0, w + 4, height()));
 }/*}}}*/
 
 void CtrlCanvas::toggleCollapsed(bool val)
 {
 	m_collapsed = val;
-	update();
+	invalidateContent();
 }
 
 //---------------------------------------------------------
@@ -403,8 +423,57 @@ void CtrlCanvas::songChanged(int type)
 		//return;
 	}
 
-    updateItems();
+	// A plain selection change only flips the selected flags.
+	if ((type & ~SC_SELECTION) || changed)
+		updateItems();
+	else
+	{
+		updateSelection();
+		redraw();
+	}
+}
+
+void CtrlCanvas::songChanged(const SongChange& change)
+{
+	int type = change.flags();
+	// Event edits known to miss this lane, like recording
+	// another controller, change nothing here.
+	if ((type & (SC_EVENT_INSERTED | SC_EVENT_REMOVED | SC_EVENT_MODIFIED))
+			&& !(type & ~(SC_EVENT_INSERTED | SC_EVENT_REMOVED | SC_EVENT_MODIFIED | SC_MIDI_CONTROLLER))
+			&& !change.isVague() && !touchesItems(change))
+		return;
+	songChanged(type);
+}
 
+//---------------------------------------------------------
+//   touchesItems
+//    true if the change may have touched an event this
+//    lane shows
+//---------------------------------------------------------
+
+bool CtrlCanvas::touchesItems(const SongChange& change)
+{
+	bool parts = false;
+	for (iPart p = editor->parts()->begin(); p != editor->parts()->end(); ++p)
+	{
+		if (change.touchesPart(p->second->sn()))
+		{
+			parts = true;
+			break;
+		}
+	}
+	if (!parts)
+		return false;
+	if (_cnum == CTRL_VELOCITY && !change.touchesTicks(m_itemsFrom, m_itemsTo))
+		return false;
+	if (!change.allEvents())
+		return true;
+	foreach(const Event& e, change.events())
+	{
+		if (_cnum == CTRL_VELOCITY ? e.type() == Note : (e.type() == Controller && e.dataA() == _didx))
+			return true;
+	}
+	return false;
 }
 
 //---------------------------------------------------------
@@ -480,69 +549,153 @@ void CtrlCanvas::partControllers(const MidiPart* part, int num, int* dnum, int*
 
 void CtrlCanvas::updateItems()/*{{{*/
 {
-	items.clearDelete();
+	buildItems();
+	redraw();
+}/*}}}*/
 
-    if (!editor->parts()->empty())
-	{
-		MidiPart* cPart = static_cast<MidiPart*>(editor->curCanvasPart());
-        QList<Event> selEvents = editor->getSelectedEvents();
-		for (iPart p = editor->parts()->begin(); p != editor->parts()->end(); ++p)
-        {
-			Event last;
-			CEvent* lastce = 0;
+//---------------------------------------------------------
+//   newItem
+//    takes a recycled CEvent if there is one
+//---------------------------------------------------------
+
+CEvent* CtrlCanvas::newItem(const Event& e, MidiPart* part, int v, bool sel)
+{
+	if (m_freeItems.empty())
+		return new CEvent(e, part, v, sel);
+	CEvent* ce = m_freeItems.back();
+	m_freeItems.pop_back();
+	ce->set(e, part, v, sel);
+	return ce;
+}
+
+//---------------------------------------------------------
+//   itemsCoverView
+//---------------------------------------------------------
 
-			MidiPart* part = (MidiPart*) (p->second);
-			EventList* el = part->events();
-			MidiController* mc;
-			MidiCtrlValList* mcvl;
-			partControllers(part, _cnum, 0, 0, &mc, &mcvl);
-			unsigned len = part->lenTick();
-			bool isPart = (cPart && cPart == part);
-			if(multiPartSelectionAction && multiPartSelectionAction->isChecked())
-                isPart = true;
+bool CtrlCanvas::itemsCoverView() const
+{
+	return mapxDev(0) >= m_itemsFrom && mapxDev(width()) <= m_itemsTo;
+}
 
+//---------------------------------------------------------
+//   buildItems
+//    Makes the items for the visible ticks plus one screen
+//    width either side, so scrolling only rebuilds once
+//    the view leaves that range (see pdraw()). A controller
+//    lane also gets the last event before the range, which
+//    sets the value the range starts with, and the first
+//    one after it, which ends the last segment. Selection
+//    is read from the events, which carry the same flag the
+//    editor items show.
+//---------------------------------------------------------
 
-			for (iEvent i = el->begin(); i != el->end(); ++i)
-            {
+void CtrlCanvas::buildItems()/*{{{*/
+{
+	for (iCEvent i = items.begin(); i != items.end(); ++i)
+		m_freeItems.push_back(*i);
+	items.clear();
+
+	int from = mapxDev(0);
+	int to = mapxDev(width());
+	int margin = to - from;
+	if (margin < 0)
+		margin = 0;
+	m_itemsFrom = from - margin < 0 ? 0 : from - margin;
+	m_itemsTo = to + margin;
+
+	if (editor->parts()->empty())
+		return;
+
+	MidiPart* cPart = static_cast<MidiPart*>(editor->curCanvasPart());
+	bool multi = multiPartSelectionAction && multiPartSelectionAction->isChecked();
+	for (iPart p = editor->parts()->begin(); p != editor->parts()->end(); ++p)
+	{
+		MidiPart* part = (MidiPart*) (p->second);
+		unsigned ptick = part->tick();
+		unsigned len = part->lenTick();
+		if (ptick >= (unsigned) m_itemsTo || ptick + len <= (unsigned) m_itemsFrom)
+			continue;
+		unsigned lfrom = (unsigned) m_itemsFrom > ptick ? m_itemsFrom - ptick : 0;
+		unsigned lto = m_itemsTo - ptick;
+
+		EventList* el = part->events();
+		MidiController* mc;
+		MidiCtrlValList* mcvl;
+		partControllers(part, _cnum, 0, 0, &mc, &mcvl);
+		bool isPart = multi || (cPart && cPart == part);
+		iEvent start = el->lower_bound(lfrom);
+
+		if (_cnum == CTRL_VELOCITY)
+		{
+			for (iEvent i = start; i != el->end() && i->first < lto; ++i)
+			{
 				Event e = i->second;
 				// Added by T356. Do not add events which are past the end of the part.
 				if (e.tick() >= len)
 					break;
-                bool sel = (isPart && (!selEvents.isEmpty() && selEvents.contains(e)));//false;//(isPart && editor->isEventSelected(e));
+				if (e.type() != Note)
+					continue;
+				bool sel = isPart && e.selected();
+				// curDrumInstrument -1 would allow ALL drum note velocities to be shown.
+				// But currently the drum list ALWAYS has a selected item so this is not supposed to happen.
+				if (curDrumInstrument == -1 || e.dataA() == curDrumInstrument)
+					items.add(newItem(e, part, e.velo(), sel));
+			}
+			continue;
+		}
 
-				if (_cnum == CTRL_VELOCITY && e.type() == Note)
-				{
-					//printf("CtrlCanvas::updateItems CTRL_VELOCITY curDrumInstrument:%d\n", curDrumInstrument);
-					if (curDrumInstrument == -1)
-					{
-						// This is interesting - it would allow ALL drum note velocities to be shown.
-						// But currently the drum list ALWAYS has a selected item so this is not supposed to happen.
-						items.add(new CEvent(e, part, e.velo(), sel));
-					}
-					else if (e.dataA() == curDrumInstrument) //same note
-						items.add(new CEvent(e, part, e.velo(), sel));
-				}
-				else if (e.type() == Controller && e.dataA() == _didx)
-				{
-					if (mcvl && last.empty())
-					{
-						lastce = new CEvent(Event(), part, mcvl->value(part->tick()));
-						items.add(lastce);
-					}
-					if (lastce)
-						lastce->setEX(e.tick());
-					lastce = new CEvent(e, part, e.dataB());
-					lastce->setEX(-1);
-					items.add(lastce);
-					last = e;
-				}
+		CEvent* lastce = 0;
+		for (iEvent i = start; i != el->begin();)
+		{
+			--i;
+			const Event& e = i->second;
+			if (e.type() == Controller && e.dataA() == _didx)
+			{
+				lastce = newItem(e, part, e.dataB());
+				lastce->setEX(-1);
+				items.add(lastce);
+				break;
+			}
+		}
+		for (iEvent i = start; i != el->end(); ++i)
+		{
+			Event e = i->second;
+			if (e.tick() >= len)
+				break;
+			if (e.type() != Controller || e.dataA() != _didx)
+				continue;
+			if (mcvl && !lastce)
+			{
+				lastce = newItem(Event(), part, mcvl->value(part->tick()));
+				items.add(lastce);
 			}
+			if (lastce)
+				lastce->setEX(e.tick());
+			lastce = newItem(e, part, e.dataB());
+			lastce->setEX(-1);
+			items.add(lastce);
+			if (i->first >= lto)
+				break;
 		}
 	}
+}/*}}}*/
 
+//---------------------------------------------------------
+//   updateSelection
+//---------------------------------------------------------
 
-    redraw();
-}/*}}}*/
+void CtrlCanvas::updateSelection()
+{
+	MidiPart* cPart = static_cast<MidiPart*>(editor->curCanvasPart());
+	bool multi = multiPartSelectionAction && multiPartSelectionAction->isChecked();
+	for (iCEvent i = items.begin(); i != items.end(); ++i)
+	{
+		CEvent* ce = *i;
+		Event e = ce->event();
+		bool isPart = multi || (cPart && cPart == ce->part());
+		ce->setSelected(isPart && !e.empty() && e.type() == Note && e.selected());
+	}
+}
 
 //---------------------------------------------------------
 //   newValRamp
@@ -721,7 +874,7 @@ void CtrlCanvas::viewMousePressEvent(QMouseEvent* event)/*{{{*/
 			int val = act->data().toInt();
     		midiMonitor->setFeedbackMode(static_cast<FeedbackMode>(val));
 			m_feedbackMode = val;
-			update();
+			invalidateContent();
 		}
 		return;
 	}
@@ -1369,16 +1522,13 @@ void CtrlCanvas::pdrawItems(QPainter& p, const QRect& rect, const MidiPart* part
 
 void CtrlCanvas::pdraw(QPainter& p, const QRect& rect)/*{{{*/
 {
-
-	int x = rect.x() - 1; // compensate for 3 pixel line width
-	int y = rect.y();
-	int w = rect.width() + 2;
-	int h = rect.height();
-
 	//---------------------------------------------------
 	// draw the grid
 	//---------------------------------------------------
 
+	if (!itemsCoverView())
+		buildItems();
+
 	p.save();
 	View::pdraw(p, rect);
 	p.restore();
@@ -1408,9 +1558,35 @@ void CtrlCanvas::pdraw(QPainter& p, const QRect& rect)/*{{{*/
 	}
 
 	//---------------------------------------------------
-	//    draw marker
+	//    draw lasso
 	//---------------------------------------------------
 
+	if (!m_collapsed && drag == DRAG_LASSO)
+	{
+		QColor outlineColor = QColor(config.partColors[curPart->colorIndex()]);
+		QColor fillColor = QColor(config.partWaveColors[curPart->colorIndex()]);
+		fillColor.setAlpha(127);
+		setPainter(p);
+		QPen mypen2 = QPen(outlineColor, 2, Qt::SolidLine);
+		mypen2.setCosmetic(true);
+		p.setPen(mypen2);
+		p.setBrush(QBrush(fillColor));
+		p.drawRect(lasso);
+	}
+}/*}}}*/
+
+//---------------------------------------------------------
+//   drawPositionLayer
+//    markers, drawn over the cached lane
+//---------------------------------------------------------
+
+void CtrlCanvas::drawPositionLayer(QPainter& p, const QRect& rect)
+{
+	int x = rect.x() - 1; // compensate for 3 pixel line width
+	int y = rect.y();
+	int w = rect.width() + 2;
+	int h = rect.height();
+
 	int xp = mapx(pos[1]);
 	if ((song->loop() || song->punchin()) && xp >= x && xp < x + w)
 	{
@@ -1438,24 +1614,7 @@ void CtrlCanvas::pdraw(QPainter& p, const QRect& rect)/*{{{*/
 		p.setPen(QColor(0, 186, 255));
 		p.drawLine(xp, y, xp, y + h);
 	}
-
-	//---------------------------------------------------
-	//    draw lasso
-	//---------------------------------------------------
-
-	if (!m_collapsed && drag == DRAG_LASSO)
-	{
-		QColor outlineColor = QColor(config.partColors[curPart->colorIndex()]);
-		QColor fillColor = QColor(config.partWaveColors[curPart->colorIndex()]);
-		fillColor.setAlpha(127);
-		setPainter(p);
-		QPen mypen2 = QPen(outlineColor, 2, Qt::SolidLine);
-		mypen2.setCosmetic(true);
-		p.setPen(mypen2);
-		p.setBrush(QBrush(fillColor));
-		p.drawRect(lasso);
-	}
-}/*}}}*/
+}
 
 //---------------------------------------------------------
 //   drawOverlay
@@ -9,6 +9,7 @@
 #define __CTRLCANVAS_H__
 
 #include <list>
+#include <vector>
 
 #include <QTimer>
 
@@ -16,6 +17,7 @@
 #include "toolbars/tools.h"
 #include "midictrl.h"
 #include "event.h"
+#include "songchange.h"
 
 class QMouseEvent;
 class QEvent;
@@ -43,6 +45,7 @@ class CEvent
 
 public:
     CEvent(Event e, MidiPart* part, int v, bool sel = false);
+    void set(const Event& e, MidiPart* part, int v, bool sel = false);
 
     Event event() const
     {
@@ -144,6 +147,7 @@ class CtrlCanvas : public View
     virtual void draw(QPainter&, const QRect&);
     virtual void pdraw(QPainter&, const QRect&);
     virtual void drawOverlay(QPainter& p, const QRect&);
+    virtual void drawPositionLayer(QPainter& p, const QRect&);
     virtual QRect overlayRect() const;
 
     void changeValRamp(int x1, int x2, int y1, int y2);
@@ -154,6 +158,17 @@ class CtrlCanvas : public View
 
     bool setCurTrackAndPart();
     void pdrawItems(QPainter&, const QRect&, const MidiPart*, bool, bool);
+
+    // items are only made for the ticks around the visible
+    // range, see buildItems()
+    std::vector<CEvent*> m_freeItems;
+    int m_itemsFrom, m_itemsTo;
+
+    CEvent* newItem(const Event& e, MidiPart* part, int v, bool sel = false);
+    void buildItems();
+    bool itemsCoverView() const;
+    void updateSelection();
+    bool touchesItems(const SongChange&);
     void partControllers(const MidiPart*, int, int*, int*, MidiController**, MidiCtrlValList**);
 
 
@@ -195,6 +210,7 @@ protected:
 
 private slots:
     void songChanged(int type);
+    void songChanged(const SongChange&);
     void setCurDrumInstrument(int);
 
 public slots:
@@ -216,7 +232,7 @@ signals:
 public:
     CtrlCanvas(AbstractMidiEditor*, QWidget* parent, int,
             const char* name = 0, CtrlPanel* pnl = 0);
-	~CtrlCanvas(){}
+	~CtrlCanvas();
 
     void setPanel(CtrlPanel* pnl)
     {
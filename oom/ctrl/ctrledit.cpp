@@ -98,7 +98,7 @@ void CtrlEdit::updateHeight(int h)
 	//qDebug("CtrlEdit::updateHeight: %d", h);
 	setFixedHeight(h);
 	canvas->setFixedHeight(h);
-	canvas->update();
+	canvas->invalidateContent();
 	m_collapsedHeight = h;
 }
 
@@ -108,7 +108,7 @@ void CtrlEdit::setMinHeight(int h)
 //	qDebug("CtrlEdit::setMinHeight(%d)", h);
 	setFixedHeight(h);
 	canvas->setFixedHeight(h);
-	canvas->update();
+	canvas->invalidateContent();
 	
 	//Notify the handle
 	emit minHeightChanged(h);
@@ -137,7 +137,7 @@ void CtrlEdit::collapsedCalled(bool val)
 		setSizePolicy(QSizePolicy(QSizePolicy::Expanding, QSizePolicy::Fixed));
 		setFixedHeight(20);
 		canvas->setFixedHeight(20);
-		canvas->update();
+		canvas->invalidateContent();
 	}
 	else
 	{
@@ -147,7 +147,7 @@ void CtrlEdit::collapsedCalled(bool val)
 		//	qDebug("CtrlEdit::collapsedCalled: old val: %d setting: %d, maxheioght: %d", m_collapsedHeight, m_minheight, m_maxheight);
 			setFixedHeight(m_maxheight);
 			canvas->setFixedHeight(m_maxheight);
-			canvas->update();
+			canvas->invalidateContent();
 			//Update collapsedHeight?
 			m_collapsedHeight =  m_maxheight;
 		}
@@ -156,7 +156,7 @@ void CtrlEdit::collapsedCalled(bool val)
 		//	qDebug("CtrlEdit::collapsedCalled using m_collapsedHeight~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~%d", m_collapsedHeight);
 			setFixedHeight(m_collapsedHeight);
 			canvas->setFixedHeight(m_collapsedHeight);
-			canvas->update();
+			canvas->invalidateContent();
 		}
 	}
 	m_collapsed = val;
@@ -16,6 +16,8 @@
 #include <unistd.h>
 #include <jack/midiport.h>
 #include <string.h>
+#include <QByteArray>
+#include <QSet>
 
 #include "audio.h"
 #include "globals.h"
@@ -26,6 +28,7 @@
 #include "tempo.h"
 #include "sync.h"
 #include "utils.h"
+#include "dspprofiler.h"
 
 #include "midi.h"
 #include "mididev.h"
@@ -483,10 +486,71 @@ static int graph_callback(void*)
 	return 0;
 }
 
+//---------------------------------------------------------
+//   portConnections
+//    the jack connections of one of our ports
+//---------------------------------------------------------
+
+static QSet<QByteArray> portConnections(jack_client_t* client, jack_port_t* port)
+{
+	QSet<QByteArray> connections;
+	const char** ports = jack_port_get_all_connections(client, port);
+	if (ports)
+	{
+		for (const char** pn = ports; *pn; ++pn)
+			connections.insert(QByteArray(*pn));
+		free(ports);
+	}
+	return connections;
+}
+
+//---------------------------------------------------------
+//   diffPortRoutes
+//    Compares the jack connections of one port with the
+//    routes we have for it and appends the differences to
+//    changes. own is our side of the route, channel -1
+//    matches routes on any channel.
+//---------------------------------------------------------
+
+static void diffPortRoutes(const QSet<QByteArray>& connections, const RouteList* rl,
+		const Route& own, int channel, bool ownIsSource, RouteChangeList& changes)
+{
+	QSet<QByteArray> routed;
+	for (ciRoute r = rl->begin(); r != rl->end(); ++r)
+	{
+		if (channel != -1 && r->channel != channel)
+			continue;
+		QByteArray name = r->name().toLatin1();
+		routed.insert(name);
+		if (connections.contains(name))
+			continue;
+		if (debugMsg)
+			qDebug("JackAudioDevice::graphChanged: remove port: %s, from %s", name.constData(), own.name().toUtf8().constData());
+		if (ownIsSource)
+			changes.append(RouteChange(own, *r, false));
+		else
+			changes.append(RouteChange(*r, own, false));
+	}
+	for (QSet<QByteArray>::const_iterator c = connections.begin(); c != connections.end(); ++c)
+	{
+		if (routed.contains(*c))
+			continue;
+		Route port(c->constData(), false, channel, Route::JACK_ROUTE);
+		if (ownIsSource)
+			changes.append(RouteChange(own, port, true));
+		else
+			changes.append(RouteChange(port, own, true));
+	}
+}
+
 //---------------------------------------------------------
 //   JackAudioDevice::graphChanged
 //    this is called from song in gui context triggered
 //    by graph_callback()
+//    All differences between the jack graph and our routes
+//    are collected first and applied in one audio message.
+//    Every message blocks the gui until the next cycle, so
+//    sending one per change froze it on large sessions.
 //---------------------------------------------------------
 
 void JackAudioDevice::graphChanged()
@@ -494,6 +558,9 @@ void JackAudioDevice::graphChanged()
 	if (JACK_DEBUG)
 		printf("graphChanged()\n");
 	if (!checkJackClient(_client)) return;
+
+	RouteChangeList changes;
+
 	InputList* il = song->inputs();
 	for (iAudioInput ii = il->begin(); ii != il->end(); ++ii)
 	{
@@ -504,99 +571,8 @@ void JackAudioDevice::graphChanged()
 			jack_port_t* port = (jack_port_t*) (it->jackPort(channel));
 			if (port == 0)
 				continue;
-			const char** ports = jack_port_get_all_connections(_client, port);
-			RouteList* rl = it->inRoutes();
-
-			//---------------------------------------
-			// check for disconnects
-			//---------------------------------------
-
-			bool erased = true;
-			// limit set to 20 iterations for disconnects, don't know how to make it go
-			// the "right" amount
-			while(erased)//for (int i = 0; i < 20; i++)
-			{
-				erased = false;
-				//for (iRoute irl = rl->begin(); irl != rl->end(); ++irl)
-				for(int r = 0; r < rl->size(); r++)
-				{
-					Route src = rl->at(r);
-					if (src.channel != channel)
-						continue;
-					QString name = src.name();
-					QByteArray ba = name.toLatin1();
-					const char* portName = ba.constData();
-					//printf("portname=%s\n", portName);
-					bool found = false;
-					const char** pn = ports;
-					while (pn && *pn)
-					{
-						if (strcmp(*pn, portName) == 0)
-						{
-							found = true;
-							break;
-						}
-						++pn;
-					}
-					//FIXME: This is the code that removes the route from the input track if jack dies
-					if (!found)
-					{
-						//Just remove the route from the list now
-						//src = rl->takeAt(r);
-						if(debugMsg)
-							qDebug("JackAudioDevice::graphChanged: remove port: %s, from %s", portName, it->name().toUtf8().constData());
-						audio->msgRemoveRoute1(
-								src,
-								//Route(portName, false, channel, Route::JACK_ROUTE),
-								Route(it, channel)
-								);
-						erased = true;
-						break;
-					}
-				}
-				//if (!erased)
-				//	break;
-			}
-
-			//---------------------------------------
-			// check for connects
-			//---------------------------------------
-
-			if (ports)
-			{
-				const char** pn = ports;
-				while (*pn)
-				{
-					bool found = false;
-					for (iRoute irl = rl->begin(); irl != rl->end(); ++irl)
-					{
-						if (irl->channel != channel)
-							continue;
-						QString name = irl->name();
-						QByteArray ba = name.toLatin1();
-						const char* portName = ba.constData();
-						if (strcmp(*pn, portName) == 0)
-						{
-							found = true;
-							break;
-						}
-					}
-					if (!found)
-					{
-						audio->msgAddRoute1(
-								Route(*pn, false, channel, Route::JACK_ROUTE),
-								Route(it, channel)
-								);
-					}
-					++pn;
-				}
-
-				// p3.3.37
-				//delete ports;
-				free(ports);
-
-				ports = NULL;
-			}
+			diffPortRoutes(portConnections(_client, port), it->inRoutes(),
+					Route(it, channel), channel, false, changes);
 		}
 	}
 	OutputList* ol = song->outputs();
@@ -609,92 +585,8 @@ void JackAudioDevice::graphChanged()
 			jack_port_t* port = (jack_port_t*) (it->jackPort(channel));
 			if (port == 0)
 				continue;
-			const char** ports = jack_port_get_all_connections(_client, port);
-			RouteList* rl = it->outRoutes();
-
-			//---------------------------------------
-			// check for disconnects
-			//---------------------------------------
-
-			bool erased = true;
-			// limit set to 20 iterations for disconnects, don't know how to make it go
-			// the "right" amount
-			while (erased)//int i = 0; i < 20; i++)
-			{
-				erased = false;
-				//for (iRoute irl = rl->begin(); irl != rl->end(); ++irl)
-				for(int r = 0; r < rl->size(); r++)
-				{
-					Route dst = rl->at(r);
-					if (dst.channel != channel)
-						continue;
-					QString name = dst.name();
-					QByteArray ba = name.toLatin1();
-					const char* portName = ba.constData();
-					bool found = false;
-					const char** pn = ports;
-					while (pn && *pn)
-					{
-						if (strcmp(*pn, portName) == 0)
-						{
-							found = true;
-							break;
-						}
-						++pn;
-					}
-					if (!found)
-					{
-						//Just remove the route from the list now
-						//src = rl->takeAt(r);
-						audio->msgRemoveRoute1(
-								Route(it, channel),
-								dst
-								//Route(portName, false, channel, Route::JACK_ROUTE)
-								);
-						erased = true;
-						break;
-					}
-				}
-				//if (!erased)
-				//	break;
-			}
-
-			//---------------------------------------
-			// check for connects
-			//---------------------------------------
-
-			if (ports)
-			{
-				const char** pn = ports;
-				while (*pn)
-				{
-					bool found = false;
-					for (iRoute irl = rl->begin(); irl != rl->end(); ++irl)
-					{
-						if (irl->channel != channel)
-							continue;
-						QString name = irl->name();
-						QByteArray ba = name.toLatin1();
-						const char* portName = ba.constData();
-						if (strcmp(*pn, portName) == 0)
-						{
-							found = true;
-							break;
-						}
-					}
-					if (!found)
-					{
-						audio->msgAddRoute1(Route(it, channel), Route(*pn, false, channel, Route::JACK_ROUTE));
-					}
-					++pn;
-				}
-
-				// p3.3.37
-				//delete ports;
-				free(ports);
-
-				ports = NULL;
-			}
+			diffPortRoutes(portConnections(_client, port), it->outRoutes(),
+					Route(it, channel), channel, true, changes);
 		}
 	}
 
@@ -704,202 +596,41 @@ void JackAudioDevice::graphChanged()
 		if (md->deviceType() != MidiDevice::JACK_MIDI)
 			continue;
 
-		//---------------------------------------
-		// outputs
-		//---------------------------------------
-
 		if (md->rwFlags() & 1) // Writable
 		{
-			// p3.3.55
 			jack_port_t* port = (jack_port_t*) md->outClientPort();
 			if (port != 0)
-			{
-				//printf("graphChanged() valid out client port\n"); // p3.3.55
-
-				const char** ports = jack_port_get_all_connections(_client, port);
-
-				RouteList* rl = md->outRoutes();
-
-				//---------------------------------------
-				// check for disconnects
-				//---------------------------------------
-
-				bool erased = true;
-				// limit set to 20 iterations for disconnects, don't know how to make it go
-				// the "right" amount
-				//for (int i = 0; i < 20; i++)
-				while(erased)
-				{
-					erased = false;
-					//for (iRoute irl = rl->begin(); irl != rl->end(); ++irl)
-					for(int r = 0; r < rl->size(); r++)
-					{
-						Route dst = rl->at(r);
-						QString name = dst.name();
-						QByteArray ba = name.toLatin1();
-						const char* portName = ba.constData();
-						bool found = false;
-						const char** pn = ports;
-						while (pn && *pn)
-						{
-							if (strcmp(*pn, portName) == 0)
-							{
-								found = true;
-								break;
-							}
-							++pn;
-						}
-						if (!found)
-						{
-							//Just remove the route
-							//src = rl->takeAt(r);
-							audio->msgRemoveRoute1(	
-								Route(md, -1),
-								dst
-								//Route(portName, false, -1, Route::JACK_ROUTE)
-							);
-							erased = true;
-							break;
-						}
-					}
-					//if (!erased)
-					//	break;
-				}
-
-				//---------------------------------------
-				// check for connects
-				//---------------------------------------
-
-				if (ports)
-				{
-					const char** pn = ports;
-					while (*pn)
-					{
-						bool found = false;
-						for (iRoute irl = rl->begin(); irl != rl->end(); ++irl)
-						{
-							QString name = irl->name();
-							QByteArray ba = name.toLatin1();
-							const char* portName = ba.constData();
-							if (strcmp(*pn, portName) == 0)
-							{
-								found = true;
-								break;
-							}
-						}
-						if (!found)
-						{
-							audio->msgAddRoute1(Route(md, -1), Route(*pn, false, -1, Route::JACK_ROUTE));
-						}
-						++pn;
-					}
-
-					// Done with ports. Free them.
-					free(ports);
-				}
-			}
+				diffPortRoutes(portConnections(_client, port), md->outRoutes(),
+						Route(md, -1), -1, true, changes);
 		}
-
-
-		//------------------------
-		// Inputs
-		//------------------------
-
 		if (md->rwFlags() & 2) // Readable
 		{
-			// p3.3.55
 			jack_port_t* port = (jack_port_t*) md->inClientPort();
 			if (port != 0)
-			{
-				//printf("graphChanged() valid in client port\n"); // p3.3.55
-				const char** ports = jack_port_get_all_connections(_client, port);
-
-				RouteList* rl = md->inRoutes();
-
-				//---------------------------------------
-				// check for disconnects
-				//---------------------------------------
-
-				bool erased = true;
-				// limit set to 20 iterations for disconnects, don't know how to make it go
-				// the "right" amount
-				//for (int i = 0; i < 20; i++)
-				while(erased)
-				{
-					erased = false;
-					//for (iRoute irl = rl->begin(); irl != rl->end(); ++irl)
-					for(int r = 0; r < rl->size(); r++)
-					{
-						Route src = rl->at(r);
-						QString name = src.name();
-						QByteArray ba = name.toLatin1();
-						const char* portName = ba.constData();
-						bool found = false;
-						const char** pn = ports;
-						while (pn && *pn)
-						{
-							if (strcmp(*pn, portName) == 0)
-							{
-								found = true;
-								break;
-							}
-							++pn;
-						}
-						if (!found)
-						{
-							//src = rl->takeAt(r);
-							audio->msgRemoveRoute1(
-								//Route(portName, false, -1, Route::JACK_ROUTE),
-								src,
-								Route(md, -1));
-							erased = true;
-							break;
-						}
-					}
-					//if (!erased)
-					//	break;
-				}
-
-				//---------------------------------------
-				// check for connects
-				//---------------------------------------
-
-				if (ports)
-				{
-					const char** pn = ports;
-					while (*pn)
-					{
-						bool found = false;
-						for (iRoute irl = rl->begin(); irl != rl->end(); ++irl)
-						{
-							QString name = irl->name();
-							QByteArray ba = name.toLatin1();
-							const char* portName = ba.constData();
-							if (strcmp(*pn, portName) == 0)
-							{
-								found = true;
-								break;
-							}
-						}
-						if (!found)
-						{
-							audio->msgAddRoute1(Route(*pn, false, -1, Route::JACK_ROUTE), Route(md, -1));
-						}
-						++pn;
-					}
-					// Done with ports. Free them.
-					free(ports);
-				}
-			}
+				diffPortRoutes(portConnections(_client, port), md->inRoutes(),
+						Route(md, -1), -1, false, changes);
 		}
 	}
+
+	if (changes.isEmpty())
+		return;
+	if (debugMsg)
+		printf("JackAudioDevice::graphChanged: %d route changes\n", changes.size());
+	audio->msgChangeRoutes(changes);
 }
 
-//static int xrun_callback(void*)
-//      {
-//      printf("JACK: xrun\n");
-//      return 0;
-//      }
+//---------------------------------------------------------
+//   xrun_callback
+//---------------------------------------------------------
+
+static int xrun_callback(void*)
+{
+	if (debugMsg)
+		printf("JACK: xrun\n");
+	if (dspProfiler)
+		dspProfiler->xrun();
+	return 0;
+}
 
 //---------------------------------------------------------
 //   register
@@ -921,7 +652,7 @@ void JackAudioDevice::registerClient()
 	jack_set_port_connect_callback(_client, port_connect_callback, 0);
 
 	jack_set_graph_order_callback(_client, graph_callback, 0);
-	//      jack_set_xrun_callback(client, xrun_callback, 0);
+	jack_set_xrun_callback(_client, xrun_callback, 0);
 	jack_set_freewheel_callback(_client, freewheel_callback, 0);
 }
 
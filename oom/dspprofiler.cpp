@@ -0,0 +1,492 @@
+//=========================================================
+//  OOMidi
+//  OpenOctave Midi and Audio Editor
+//
+//  audio thread time profiler
+//=========================================================
+
+#include <string.h>
+#include <algorithm>
+
+#include "dspprofiler.h"
+#include "globals.h"
+#include "song.h"
+#include "track.h"
+#include "plugin.h"
+#include "utils.h"
+
+DspProfiler* dspProfiler = 0;
+
+//---------------------------------------------------------
+//   hashKey
+//---------------------------------------------------------
+
+static inline unsigned hashKey(const void* key, int kind)
+{
+    quint64 k = quint64(quintptr(key)) ^ (quint64(kind) << 59);
+    k ^= k >> 29;
+    k *= 0xbf58476d1ce4e5b9ULL;
+    k ^= k >> 32;
+    return unsigned(k);
+}
+
+//---------------------------------------------------------
+//   bucket
+//    log2 of the ticks
+//---------------------------------------------------------
+
+static inline int bucket(qint64 ticks)
+{
+    if (ticks <= 1)
+        return 0;
+    int b = 63 - __builtin_clzll(quint64(ticks));
+    return b < DspProfiler::HIST_BUCKETS ? b : DspProfiler::HIST_BUCKETS - 1;
+}
+
+static bool statOrder(const DspStat& a, const DspStat& b)
+{
+    return a.totalMs > b.totalMs;
+}
+
+//---------------------------------------------------------
+//   DspProfiler
+//---------------------------------------------------------
+
+DspProfiler::DspProfiler()
+{
+    m_depth = 0;
+    m_cycle = 1;
+    m_cycleStart = 0;
+    m_ntouched = 0;
+    m_ringPos = 0;
+    m_lastCapture = 0;
+    memset(m_ring, 0, sizeof(m_ring));
+    memset(m_capture, 0, sizeof(m_capture));
+    m_captureSeq.storeRelease(0);
+    m_captures.storeRelease(0);
+    m_enabled.storeRelease(0);
+    m_resetRequest.storeRelease(0);
+    m_xrunPending.storeRelease(0);
+    m_xruns.storeRelease(0);
+    clearAll();
+
+    // first estimate of the tick rate, calibrate() refines it
+    m_calTime = curTime();
+    m_calTicks = dspTicks();
+    double t;
+    while ((t = curTime()) - m_calTime < 0.002)
+        ;
+    m_ticksPerMs.storeRelease(int((dspTicks() - m_calTicks) / ((t - m_calTime) * 1000.0)));
+}
+
+//---------------------------------------------------------
+//   setEnabled
+//---------------------------------------------------------
+
+void DspProfiler::setEnabled(bool f)
+{
+    m_enabled.storeRelease(f);
+}
+
+//---------------------------------------------------------
+//   clearAll
+//    cycle thread, or before it runs
+//---------------------------------------------------------
+
+void DspProfiler::clearAll()
+{
+    for (int i = 0; i < MAX_ENTRIES; ++i)
+    {
+        Entry& e = m_entries[i];
+        e.seq.fetchAndAddOrdered(1);
+        e.key.storeRelease(0);
+        e.kind = 0;
+        e.count = 0;
+        e.total = 0;
+        e.max = 0;
+        memset(e.hist, 0, sizeof(e.hist));
+        e.stamp = 0;
+        e.cycleTicks = 0;
+        e.seq.fetchAndAddOrdered(1);
+    }
+    memset(m_ring, 0, sizeof(m_ring));
+    m_ringPos = 0;
+    m_ntouched = 0;
+}
+
+//---------------------------------------------------------
+//   entry
+//    returns 0 if the table is full
+//---------------------------------------------------------
+
+DspProfiler::Entry* DspProfiler::entry(const void* key, int kind)
+{
+    unsigned h = hashKey(key, kind);
+    for (int i = 0; i < MAX_ENTRIES; ++i)
+    {
+        Entry* e = &m_entries[(h + i) & (MAX_ENTRIES - 1)];
+        void* k = e->key.loadAcquire();
+        if (k == key && e->kind == kind)
+            return e;
+        if (k == 0)
+        {
+            e->kind = kind;
+            e->key.storeRelease(const_cast<void*>(key));
+            return e;
+        }
+    }
+    return 0;
+}
+
+//---------------------------------------------------------
+//   account
+//---------------------------------------------------------
+
+void DspProfiler::account(const void* key, int kind, qint64 ticks)
+{
+    Entry* e = entry(key, kind);
+    if (!e)
+        return;
+    e->seq.fetchAndAddOrdered(1);
+    ++e->count;
+    e->total += ticks;
+    if (ticks > e->max)
+        e->max = ticks;
+    ++e->hist[bucket(ticks)];
+    e->seq.fetchAndAddOrdered(1);
+
+    if (kind == CYCLE)
+        return;
+    if (e->stamp != m_cycle)
+    {
+        e->stamp = m_cycle;
+        e->cycleTicks = 0;
+        if (m_ntouched < MAX_TOUCHED)
+            m_touched[m_ntouched++] = e - m_entries;
+    }
+    e->cycleTicks += ticks;
+}
+
+//---------------------------------------------------------
+//   begin
+//---------------------------------------------------------
+
+void DspProfiler::begin(const void* key, int kind)
+{
+    if (m_depth < MAX_DEPTH)
+    {
+        Frame& f = m_stack[m_depth];
+        f.key = key;
+        f.kind = kind;
+        f.child = 0;
+        f.start = dspTicks();
+    }
+    ++m_depth;
+}
+
+//---------------------------------------------------------
+//   end
+//    the time of nested probes is taken out and handed to
+//    the enclosing one
+//---------------------------------------------------------
+
+void DspProfiler::end()
+{
+    if (m_depth <= 0)
+        return;
+    --m_depth;
+    if (m_depth >= MAX_DEPTH)
+        return;
+    Frame& f = m_stack[m_depth];
+    qint64 elapsed = dspTicks() - f.start;
+    account(f.key, f.kind, elapsed - f.child);
+    if (m_depth > 0 && m_depth <= MAX_DEPTH)
+        m_stack[m_depth - 1].child += elapsed;
+}
+
+//---------------------------------------------------------
+//   beginCycle
+//---------------------------------------------------------
+
+void DspProfiler::beginCycle()
+{
+    if (m_resetRequest.loadAcquire())
+    {
+        m_resetRequest.storeRelease(0);
+        clearAll();
+    }
+    ++m_cycle;
+    m_ntouched = 0;
+    m_depth = 0;
+    m_cycleStart = dspTicks();
+}
+
+//---------------------------------------------------------
+//   endCycle
+//    records the cycle and its top consumers in the ring
+//---------------------------------------------------------
+
+void DspProfiler::endCycle(unsigned frames)
+{
+    qint64 ticks = dspTicks() - m_cycleStart;
+    account(this, CYCLE, ticks);
+
+    CycleRecord& r = m_ring[m_ringPos];
+    m_ringPos = (m_ringPos + 1) % CYCLE_HISTORY;
+    r.start = m_cycleStart;
+    r.ticks = ticks;
+    r.frames = frames;
+    r.overrun = sampleRate && ticks > qint64(frames) * m_ticksPerMs.loadAcquire() * 1000 / sampleRate;
+    r.n = 0;
+    for (int i = 0; i < m_ntouched; ++i)
+    {
+        const Entry& e = m_entries[m_touched[i]];
+        int pos = r.n;
+        while (pos > 0 && r.keyTicks[pos - 1] < e.cycleTicks)
+            --pos;
+        if (pos >= CYCLE_TOP)
+            continue;
+        int last = r.n < CYCLE_TOP ? r.n++ : CYCLE_TOP - 1;
+        for (int j = last; j > pos; --j)
+        {
+            r.key[j] = r.key[j - 1];
+            r.kind[j] = r.kind[j - 1];
+            r.keyTicks[j] = r.keyTicks[j - 1];
+        }
+        r.key[pos] = e.key.loadAcquire();
+        r.kind[pos] = e.kind;
+        r.keyTicks[pos] = e.cycleTicks;
+    }
+
+    bool xrunSeen = m_xrunPending.loadAcquire() && m_xrunPending.fetchAndStoreOrdered(0);
+    // an overloaded system would capture every cycle
+    if (xrunSeen || (r.overrun && m_cycle - m_lastCapture >= CYCLE_HISTORY))
+        capture();
+}
+
+//---------------------------------------------------------
+//   capture
+//    ring in order, oldest cycle first
+//---------------------------------------------------------
+
+void DspProfiler::capture()
+{
+    m_lastCapture = m_cycle;
+    m_captureSeq.fetchAndAddOrdered(1);
+    for (int i = 0; i < CYCLE_HISTORY; ++i)
+        m_capture[i] = m_ring[(m_ringPos + i) % CYCLE_HISTORY];
+    m_captureSeq.fetchAndAddOrdered(1);
+    m_captures.ref();
+}
+
+//---------------------------------------------------------
+//   xrun
+//    called by the driver, from its own thread
+//---------------------------------------------------------
+
+void DspProfiler::xrun()
+{
+    m_xruns.ref();
+    m_xrunPending.storeRelease(1);
+}
+
+//---------------------------------------------------------
+//   calibrate
+//    called from the gui heartbeat, measures the tick rate
+//    over all the time since startup
+//---------------------------------------------------------
+
+void DspProfiler::calibrate()
+{
+    double t = curTime();
+    if (t - m_calTime < 1.0)
+        return;
+    m_ticksPerMs.storeRelease(int((dspTicks() - m_calTicks) / ((t - m_calTime) * 1000.0)));
+}
+
+double DspProfiler::ticksPerUs() const
+{
+    int t = m_ticksPerMs.loadAcquire();
+    return t > 0 ? t / 1000.0 : 1.0;
+}
+
+//---------------------------------------------------------
+//   reset
+//    done by the cycle thread at its next cycle
+//---------------------------------------------------------
+
+void DspProfiler::reset()
+{
+    if (enabled())
+        m_resetRequest.storeRelease(1);
+    else
+        clearAll();
+}
+
+//---------------------------------------------------------
+//   name
+//    pointers are only compared, the object may be gone
+//---------------------------------------------------------
+
+QString DspProfiler::name(const void* key, int kind) const
+{
+    switch (kind)
+    {
+        case CYCLE:
+            return QString("audio cycle");
+        case MIDI:
+            return QString("midi collection");
+        default:
+            break;
+    }
+    TrackList* tl = song->tracks();
+    for (ciTrack it = tl->begin(); it != tl->end(); ++it)
+    {
+        Track* t = *it;
+        if (kind == TRACK && t == key)
+            return t->name();
+        if (kind == OUTPUT && t == key)
+            return t->name() + QString(" (write)");
+        if (kind == PLUGIN && !t->isMidiTrack())
+        {
+            Pipeline* pl = ((AudioTrack*) t)->efxPipe();
+            if (!pl)
+                continue;
+            for (iPluginI ip = pl->begin(); ip != pl->end(); ++ip)
+            {
+                if (*ip && *ip == key)
+                    return t->name() + QString(": ") + (*ip)->name();
+            }
+        }
+    }
+    return QString("(deleted)");
+}
+
+//---------------------------------------------------------
+//   stats
+//    all entries, the most time consuming first
+//---------------------------------------------------------
+
+QList<DspStat> DspProfiler::stats() const
+{
+    QList<DspStat> list;
+    double tpu = ticksPerUs();
+    for (int i = 0; i < MAX_ENTRIES; ++i)
+    {
+        const Entry& e = m_entries[i];
+        int count = 0;
+        qint64 total = 0, max = 0;
+        int hist[HIST_BUCKETS];
+        const void* key = 0;
+        int kind = 0;
+        bool valid = false;
+        for (int retry = 0; retry < 4 && !valid; ++retry)
+        {
+            int s1 = e.seq.loadAcquire();
+            if (s1 & 1)
+                continue;
+            key = e.key.loadAcquire();
+            kind = e.kind;
+            count = e.count;
+            total = e.total;
+            max = e.max;
+            memcpy(hist, e.hist, sizeof(hist));
+            valid = e.seq.loadAcquire() == s1;
+        }
+        if (!valid || !key || !count)
+            continue;
+
+        DspStat st;
+        st.name = name(key, kind);
+        st.kind = kind;
+        st.count = count;
+        st.totalMs = total / tpu / 1000.0;
+        st.avgUs = total / tpu / count;
+        st.maxUs = max / tpu;
+        int b = 0;
+        for (int n = 0; b < HIST_BUCKETS; ++b)
+        {
+            n += hist[b];
+            if (n * 100LL >= count * 99LL)
+                break;
+        }
+        st.p99Us = qMin(double(2LL << qMin(b, 62)) / tpu, st.maxUs);
+        list.append(st);
+    }
+    std::sort(list.begin(), list.end(), statOrder);
+    return list;
+}
+
+//---------------------------------------------------------
+//   report
+//    text table of the top consumers
+//---------------------------------------------------------
+
+QString DspProfiler::report(int top) const
+{
+    QList<DspStat> list = stats();
+    QString s;
+    for (int i = 0; i < list.size(); ++i)
+    {
+        const DspStat& st = list[i];
+        if (st.kind != CYCLE)
+            continue;
+        s += QString("DSP profile: %1 cycles, avg %2 us, max %3 us, %4 xruns\n")
+                .arg(st.count).arg(st.avgUs, 0, 'f', 1).arg(st.maxUs, 0, 'f', 1).arg(xruns());
+        list.removeAt(i);
+        break;
+    }
+    s += QString("%1 %2 %3 %4 %5  %6\n").arg("total ms", 10).arg("avg us", 9).arg("p99 us", 9)
+            .arg("max us", 9).arg("count", 9).arg("name");
+    for (int i = 0; i < list.size() && i < top; ++i)
+    {
+        const DspStat& st = list[i];
+        s += QString("%1 %2 %3 %4 %5  %6\n")
+                .arg(st.totalMs, 10, 'f', 1)
+                .arg(st.avgUs, 9, 'f', 1)
+                .arg(st.p99Us, 9, 'f', 1)
+                .arg(st.maxUs, 9, 'f', 1)
+                .arg(st.count, 9)
+                .arg(st.name);
+    }
+    return s;
+}
+
+//---------------------------------------------------------
+//   captureReport
+//    the cycles before the last xrun, newest last
+//---------------------------------------------------------
+
+QString DspProfiler::captureReport() const
+{
+    CycleRecord cap[CYCLE_HISTORY];
+    bool valid = false;
+    for (int retry = 0; retry < 4 && !valid; ++retry)
+    {
+        int s1 = m_captureSeq.loadAcquire();
+        if (s1 & 1)
+            continue;
+        memcpy(cap, m_capture, sizeof(cap));
+        valid = m_captureSeq.loadAcquire() == s1;
+    }
+    if (!valid || !m_captures.loadAcquire())
+        return QString("no xrun captured\n");
+
+    double tpu = ticksPerUs();
+    QString s;
+    for (int i = 0; i < CYCLE_HISTORY; ++i)
+    {
+        const CycleRecord& r = cap[i];
+        if (!r.frames)
+            continue;
+        double budget = sampleRate ? r.frames * 1000000.0 / sampleRate : 0.0;
+        s += QString("%1: %2 us of %3 us%4\n")
+                .arg(i - CYCLE_HISTORY + 1, 3)
+                .arg(r.ticks / tpu, 0, 'f', 1)
+                .arg(budget, 0, 'f', 1)
+                .arg(r.overrun ? QString("  OVERRUN") : QString());
+        for (int j = 0; j < r.n; ++j)
+            s += QString("      %1 us  %2\n").arg(r.keyTicks[j] / tpu, 9, 'f', 1).arg(name(r.key[j], r.kind[j]));
+    }
+    return s;
+}
@@ -0,0 +1,241 @@
+//=========================================================
+//  OOMidi
+//  OpenOctave Midi and Audio Editor
+//
+//  audio thread time profiler
+//=========================================================
+
+#ifndef __DSPPROFILER_H__
+#define __DSPPROFILER_H__
+
+#include <time.h>
+
+#include <QAtomicInt>
+#include <QAtomicPointer>
+#include <QList>
+#include <QString>
+
+//---------------------------------------------------------
+//   dspTicks
+//    time stamp counter where there is one, else
+//    nanoseconds
+//---------------------------------------------------------
+
+static inline qint64 dspTicks()
+{
+#if defined(__i386__) || defined(__x86_64__)
+    return (qint64) __builtin_ia32_rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return qint64(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+#endif
+}
+
+//---------------------------------------------------------
+//   DspStat
+//    gui side summary of one entry
+//---------------------------------------------------------
+
+struct DspStat
+{
+    QString name;
+    int kind;
+    int count;
+    double totalMs;
+    double avgUs;
+    double maxUs;
+    double p99Us; // upper bound, the histogram is log2
+};
+
+//---------------------------------------------------------
+//   DspProfiler
+//    Times the work of every audio cycle: each track's
+//    copyData()/addData(), each plugin's process(), the
+//    midi collection and the output writes. Nested probes
+//    are subtracted, a track's time excludes its plugins
+//    and the tracks routed into it.
+//
+//    Entries live in a fixed table written only by the
+//    thread running the cycle, the jack process thread or
+//    the offline render thread, never both at once. Each
+//    entry has its own sequence counter so the gui reads a
+//    consistent copy without locking.
+//
+//    The last CYCLE_HISTORY cycles with their top
+//    consumers are kept in a ring. When jack reports an
+//    xrun, or a cycle exceeds its period, the ring is
+//    frozen into the capture at the end of the next cycle.
+//---------------------------------------------------------
+
+class DspProfiler
+{
+public:
+    enum Kind { CYCLE, TRACK, PLUGIN, MIDI, OUTPUT };
+    enum
+    {
+        MAX_ENTRIES = 512, HIST_BUCKETS = 32, MAX_DEPTH = 32,
+        MAX_TOUCHED = 256, CYCLE_HISTORY = 64, CYCLE_TOP = 8
+    };
+
+    struct CycleRecord
+    {
+        qint64 start;
+        qint64 ticks;
+        unsigned frames;
+        bool overrun;
+        int n;
+        const void* key[CYCLE_TOP];
+        int kind[CYCLE_TOP];
+        qint64 keyTicks[CYCLE_TOP];
+    };
+
+private:
+    struct Entry
+    {
+        QAtomicPointer<void> key; // set last, 0 if free
+        int kind;
+        QAtomicInt seq; // odd while the writer is inside
+        int count;
+        qint64 total;
+        qint64 max;
+        int hist[HIST_BUCKETS];
+
+        // cycle thread only
+        unsigned stamp;
+        qint64 cycleTicks;
+    };
+
+    struct Frame
+    {
+        const void* key;
+        int kind;
+        qint64 start;
+        qint64 child;
+    };
+
+    Entry m_entries[MAX_ENTRIES];
+
+    // cycle thread
+    Frame m_stack[MAX_DEPTH];
+    int m_depth;
+    unsigned m_cycle;
+    qint64 m_cycleStart;
+    int m_touched[MAX_TOUCHED];
+    int m_ntouched;
+    CycleRecord m_ring[CYCLE_HISTORY];
+    int m_ringPos;
+    unsigned m_lastCapture;
+
+    CycleRecord m_capture[CYCLE_HISTORY];
+    QAtomicInt m_captureSeq;
+    QAtomicInt m_captures;
+
+    QAtomicInt m_enabled;
+    QAtomicInt m_resetRequest;
+    QAtomicInt m_xrunPending;
+    QAtomicInt m_xruns;
+    QAtomicInt m_ticksPerMs;
+
+    // gui thread, calibration of the tick rate
+    qint64 m_calTicks;
+    double m_calTime;
+
+    DspProfiler(const DspProfiler&);
+    DspProfiler& operator=(const DspProfiler&);
+
+    Entry* entry(const void* key, int kind);
+    void account(const void* key, int kind, qint64 ticks);
+    void clearAll();
+    void capture();
+    double ticksPerUs() const;
+    QString name(const void* key, int kind) const;
+
+public:
+    DspProfiler();
+
+    bool enabled() const
+    {
+        return m_enabled.loadAcquire();
+    }
+    void setEnabled(bool f);
+
+    // cycle thread
+    void beginCycle();
+    void endCycle(unsigned frames);
+    void begin(const void* key, int kind);
+    void end();
+
+    // any thread
+    void xrun();
+    int xruns() const
+    {
+        return m_xruns.loadAcquire();
+    }
+    //! changes whenever a new capture was taken
+    int captures() const
+    {
+        return m_captures.loadAcquire();
+    }
+
+    // gui thread
+    void calibrate();
+    void reset();
+    QList<DspStat> stats() const;
+    QString report(int top) const;
+    QString captureReport() const;
+};
+
+//---------------------------------------------------------
+//   DspProbe
+//    times its scope if the profiler is on
+//---------------------------------------------------------
+
+extern DspProfiler* dspProfiler;
+
+class DspProbe
+{
+    bool m_on;
+
+public:
+    DspProbe(const void* key, int kind)
+    {
+        m_on = dspProfiler && dspProfiler->enabled();
+        if (m_on)
+            dspProfiler->begin(key, kind);
+    }
+
+    ~DspProbe()
+    {
+        if (m_on)
+            dspProfiler->end();
+    }
+};
+
+//---------------------------------------------------------
+//   DspCycleProbe
+//---------------------------------------------------------
+
+class DspCycleProbe
+{
+    bool m_on;
+    unsigned m_frames;
+
+public:
+    DspCycleProbe(unsigned frames)
+    {
+        m_frames = frames;
+        m_on = dspProfiler && dspProfiler->enabled();
+        if (m_on)
+            dspProfiler->beginCycle();
+    }
+
+    ~DspCycleProbe()
+    {
+        if (m_on)
+            dspProfiler->endCycle(m_frames);
+    }
+};
+
+#endif
+
@@ -28,6 +28,7 @@ EventBase::EventBase(EventType t)
 	Pos::setType(_type == Wave ? FRAMES : TICKS);
 	refCount = 0;
 	_selected = false;
+	_list = 0;
 	m_leftclip = 0;
 	m_rightclip = 0;
 }
@@ -37,6 +38,7 @@ EventBase::EventBase(const EventBase& ev)
 {
 	refCount = 0;
 	_selected = ev._selected;
+	_list = 0; // a clone is in no list yet
 	_type = ev._type;
 	m_leftclip = ev.m_leftclip;
 	m_rightclip = ev.m_rightclip;
@@ -63,6 +65,19 @@ void EventBase::dump(int n) const
 	PosLen::dump(n + 2);
 }
 
+//---------------------------------------------------------
+//   edited
+//    An event was changed in place. If it is in a list, the
+//    list's revision has to move so its compact store is
+//    rebuilt. Events not in a list yet cost nothing.
+//---------------------------------------------------------
+
+static inline void edited(const EventBase* ev)
+{
+	if (ev->list())
+		ev->list()->modified();
+}
+
 //---------------------------------------------------------
 //   clone
 //---------------------------------------------------------
@@ -242,9 +257,20 @@ void Event::setSelected(bool val)
 	ev->_selected = val;
 }
 
+EventList* Event::list() const
+{
+	return ev->_list;
+}
+
+void Event::setList(EventList* l)
+{
+	ev->_list = l;
+}
+
 void Event::move(int offset)
 {
 	ev->move(offset);
+	edited(ev);
 }
 
 //void Event::read(Xml& xml)            { ev->read(xml); }
@@ -322,11 +348,13 @@ int Event::pitch() const
 void Event::setA(int val)
 {
 	ev->setA(val);
+	edited(ev);
 }
 
 void Event::setPitch(int val)
 {
 	ev->setA(val);
+	edited(ev);
 }
 
 int Event::dataB() const
@@ -342,11 +370,13 @@ int Event::velo() const
 void Event::setB(int val)
 {
 	ev->setB(val);
+	edited(ev);
 }
 
 void Event::setVelo(int val)
 {
 	ev->setB(val);
+	edited(ev);
 }
 
 int Event::dataC() const
@@ -362,11 +392,13 @@ int Event::veloOff() const
 void Event::setC(int val)
 {
 	ev->setC(val);
+	edited(ev);
 }
 
 void Event::setVeloOff(int val)
 {
 	ev->setC(val);
+	edited(ev);
 }
 
 const unsigned char* Event::data() const
@@ -382,6 +414,7 @@ int Event::dataLen() const
 void Event::setData(const unsigned char* data, int len)
 {
 	ev->setData(data, len);
+	edited(ev);
 }
 
 const EvData Event::eventData() const
@@ -482,6 +515,7 @@ void Event::readAudio(WavePart* part, unsigned offset, float** bpp, int channels
 void Event::setTick(unsigned val)
 {
 	ev->setTick(val);
+	edited(ev);
 }
 
 unsigned Event::tick() const
@@ -497,16 +531,19 @@ unsigned Event::frame() const
 void Event::setFrame(unsigned val)
 {
 	ev->setFrame(val);
+	edited(ev);
 }
 
 void Event::setLenTick(unsigned val)
 {
 	ev->setLenTick(val);
+	edited(ev);
 }
 
 void Event::setLenFrame(unsigned val)
 {
 	ev->setLenFrame(val);
+	edited(ev);
 }
 
 unsigned Event::lenTick() const
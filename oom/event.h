@@ -12,6 +12,8 @@
 #include <map>
 //#include <samplerate.h>
 #include <sys/types.h>
+#include <QAtomicInt>
+#include <QAtomicPointer>
 
 #include "wave.h"   // wg. SndFile
 #include "pos.h"
@@ -26,6 +28,8 @@ class QString;
 
 class Xml;
 class EventBase;
+class MidiEventStore;
+class EventList;
 //class AudioConverter;
 class WavePart;
 
@@ -63,6 +67,9 @@ public:
     int getRefCount() const;
     bool selected() const;
     void setSelected(bool val);
+    //! the list in place changes are reported to, see EventList
+    EventList* list() const;
+    void setList(EventList* l);
     void move(int offset);
 
     void read(Xml& xml);
@@ -132,25 +139,58 @@ typedef std::pair <iEvent, iEvent> EventRange;
 //---------------------------------------------------------
 //   EventList
 //    tick sorted list of events
+//
+//    Every change through add(), move(), erase() or clear()
+//    bumps the revision. For midi parts the gui thread keeps
+//    a compact copy of the list current with
+//    updateCompactStore(), which the audio thread uses
+//    instead of walking the map while its revision matches.
+//
+//    An event knows the list it was last added to, setting
+//    it in place bumps that list's revision too. Lists
+//    sharing events, like the copy an undo step keeps, only
+//    claim them back when their store is rebuilt; Song makes
+//    sure that happens when it swaps such a list in.
 //---------------------------------------------------------
 
 class EventList : public EL
 {
     int ref; // number of references to this EventList
     int aref; // number of active references (exclude undo list)
+    QAtomicInt _revision;
+    QAtomicPointer<MidiEventStore> _store;
     void deselect();
 
+    void touch()
+    {
+        _revision.fetchAndAddOrdered(1);
+    }
+
+    void release(Event& e)
+    {
+        if (e.list() == this)
+            e.setList(0);
+    }
+    void release(iEvent first, iEvent last)
+    {
+        for (iEvent i = first; i != last; ++i)
+            release(i->second);
+    }
+    void claim();
+
 public:
 
     EventList()
     {
         ref = 0;
         aref = 0;
+        _revision.storeRelease(0);
+        _store.storeRelease(0);
     }
 
-    ~EventList()
-    {
-    }
+    EventList(const EventList&);
+    EventList& operator=(const EventList&);
+    ~EventList();
 
     void incRef(int n)
     {
@@ -175,8 +215,47 @@ public:
     iEvent find(const Event&);
     iEvent add(Event& event);
     void move(Event& event, unsigned tick);
+    void erase(iEvent i)
+    {
+        touch();
+        release(i->second);
+        EL::erase(i);
+    }
+    void erase(iEvent first, iEvent last)
+    {
+        touch();
+        release(first, last);
+        EL::erase(first, last);
+    }
+    void clear()
+    {
+        touch();
+        release(begin(), end());
+        EL::clear();
+    }
+    //! exchange the events, not the references
+    void swap(EventList& el)
+    {
+        touch();
+        el.touch();
+        EL::swap(el);
+        claim();
+        el.claim();
+    }
     void dump() const;
     void read(Xml& xml, const char* name, bool midi);
+
+    int revision() const
+    {
+        return _revision.loadAcquire();
+    }
+    //! an event of this list was changed in place
+    void modified()
+    {
+        touch();
+    }
+    const MidiEventStore* compactStore() const;
+    void updateCompactStore();
 };
 
 #endif
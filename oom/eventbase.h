@@ -29,6 +29,7 @@ class EventBase : public PosLen
 protected:
     int refCount;
     bool _selected;
+    EventList* _list; // list whose revision in place changes bump
 	int m_rightclip; //The amount of the sample remove on the right
 	int m_leftclip; //Same as above for the left
 
@@ -65,6 +66,16 @@ public:
         _selected = val;
     }
 
+    EventList* list() const
+    {
+        return _list;
+    }
+
+    void setList(EventList* l)
+    {
+        _list = l;
+    }
+
     void move(int offset);
 
     virtual void read(Xml&) = 0;
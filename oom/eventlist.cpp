@@ -8,8 +8,52 @@
 
 #include "tempo.h"
 #include "event.h"
+#include "midieventstore.h"
 #include "xml.h"
 
+//---------------------------------------------------------
+//   EventList
+//    a copy shares the compact store until either changes
+//---------------------------------------------------------
+
+EventList::EventList(const EventList& el)
+: EL(el)
+{
+	ref = el.ref;
+	aref = el.aref;
+	_revision.storeRelease(el.revision());
+	MidiEventStore* store = el._store.loadAcquire();
+	if (store)
+		store->ref();
+	_store.storeRelease(store);
+}
+
+EventList& EventList::operator=(const EventList& el)
+{
+	if (this == &el)
+		return *this;
+	release(begin(), end());
+	EL::operator=(el);
+	ref = el.ref;
+	aref = el.aref;
+	MidiEventStore* store = el._store.loadAcquire();
+	if (store)
+		store->ref();
+	MidiEventStore* old = _store.fetchAndStoreOrdered(store);
+	if (old)
+		old->deref();
+	_revision.storeRelease(el.revision());
+	return *this;
+}
+
+EventList::~EventList()
+{
+	release(begin(), end());
+	MidiEventStore* store = _store.fetchAndStoreOrdered(0);
+	if (store)
+		store->deref();
+}
+
 //---------------------------------------------------------
 //   readEventList
 //---------------------------------------------------------
@@ -50,6 +94,8 @@ void EventList::read(Xml& xml, const char* name, bool midi)
 
 iEvent EventList::add(Event& event)
 {
+	touch();
+	event.setList(this);
 	// Added by T356. An event list containing wave events should be sorted by
 	//  frames. WaveTrack::fetchData() relies on the sorting order, and
 	//  there was a bug that waveparts were sometimes muted because of
@@ -75,6 +121,8 @@ void EventList::move(Event& event, unsigned tick)
 {
 	iEvent i = find(event);
 	erase(i);
+	touch();
+	event.setList(this);
 
 	// Added by T356.
 	if (event.type() == Wave)
@@ -114,3 +162,56 @@ void EventList::dump() const
 		i->second.dump();
 }
 
+
+//---------------------------------------------------------
+//   compactStore
+//    returns 0 if there is no store matching the current
+//    revision, the caller then walks the map.
+//    May be called from the audio thread.
+//---------------------------------------------------------
+
+const MidiEventStore* EventList::compactStore() const
+{
+	const MidiEventStore* store = _store.loadAcquire();
+	if (store && store->revision() == revision())
+		return store;
+	return 0;
+}
+
+//---------------------------------------------------------
+//   claim
+//    makes in place changes of all events bump this list
+//---------------------------------------------------------
+
+void EventList::claim()
+{
+	for (iEvent i = begin(); i != end(); ++i)
+		i->second.setList(this);
+}
+
+//---------------------------------------------------------
+//   updateCompactStore
+//    rebuild the compact store if the list has changed.
+//    Short lists play as fast from the map and get none.
+//    gui thread only
+//---------------------------------------------------------
+
+void EventList::updateCompactStore()
+{
+	int rev = revision();
+	MidiEventStore* old = _store.loadAcquire();
+	if (old && old->revision() == rev)
+		return;
+	MidiEventStore* store = 0;
+	if (size() >= MidiEventStore::MIN_EVENTS)
+	{
+		// events shared with a copy may still report to it
+		claim();
+		store = new MidiEventStore(this, revision());
+	}
+	else if (!old)
+		return;
+	_store.fetchAndStoreOrdered(store);
+	if (old)
+		old->deref();
+}
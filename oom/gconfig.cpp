@@ -722,6 +722,8 @@ GlobalConfigValues config = {
 	QString(QString("/usr/local/lib64/vst:/usr/lib64/vst:/usr/local/lib/vst:/usr/lib/vst:").append(QDir::homePath()).append(QDir::separator()).append(".vst")),
 	0, //Default audio raster index
 	1, //Default midi raster index
-	true //Use auto crossfades
+	true, //Use auto crossfades
+	64, //Undo history memory limit in MB
+	256 //Resampled audio cache in MB
 };
 
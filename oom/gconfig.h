@@ -166,6 +166,8 @@ struct GlobalConfigValues
 	int audioRaster;
 	int midiRaster;
 	bool useAutoCrossFades;
+	int undoMemoryLimit; // MB of undo history kept, 0 - unlimited
+	int resampleCacheSize; // MB of resampled audio kept, 0 - convert while playing only
 };
 
 extern GlobalConfigValues config;
@@ -90,12 +90,14 @@ QString routePath = configPath + QString("/routes");
 QString oomInstruments;
 QString oomUserInstruments;
 QString gJackSessionUUID;
+QString offlineRenderDir;
 
 QString lastWavePath(".");
 QString lastMidiPath(".");
 
 bool debugMode = false;
 bool debugMsg = false;
+bool dspProfileReport = false;
 bool midiInputTrace = false;
 bool midiOutputTrace = false;
 bool realTimeScheduling = false;
@@ -262,6 +264,7 @@ QHash<int, QPixmap> g_trackDragImageList;
 int vuColorStrip = 0; //default vuColor is gradient
 bool lsClientStarted = false;
 LSClient* lsClient = 0;
+LSAsyncClient* lsAsyncClient = 0;
 LSThread* gLSThread = 0;
 bool gUpdateAuxes = false;
 TrackManager* trackManager;
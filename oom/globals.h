@@ -28,6 +28,7 @@ class QIcon;
 class QColor;
 class QPixmap;
 class LSClient;
+class LSAsyncClient;
 class TrackManager;
 class LSThread;
 
@@ -63,6 +64,7 @@ extern QString routePath;
 extern QString oomInstruments;
 extern QString oomUserInstruments;
 extern QString gJackSessionUUID;
+extern QString offlineRenderDir; // -R: render stems here and quit
 
 extern QString lastWavePath;
 extern QString lastMidiPath;
@@ -72,6 +74,7 @@ extern bool midiInputTrace;
 extern bool midiOutputTrace;
 extern bool debugMsg;
 extern bool debugSync;
+extern bool dspProfileReport; // -T: print the audio thread profile
 extern bool loadPlugins;
 extern bool loadVST;
 extern bool loadDSSI;
@@ -198,6 +201,7 @@ extern QHash<int, QPixmap> g_trackDragImageList;
 extern int vuColorStrip;
 extern bool lsClientStarted;
 extern LSClient* lsClient;
+extern LSAsyncClient* lsAsyncClient;
 extern bool gUpdateAuxes;
 extern TrackManager* trackManager;
 extern QList<QPair<int, QString> > gInputList;
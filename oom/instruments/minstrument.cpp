@@ -32,12 +32,21 @@
 #include "midictrl.h"
 #include "gconfig.h"
 #include "song.h"
+#include "patchgroupmenu.h"
 
 MidiInstrumentList midiInstruments;
 MidiInstrument* genericMidiInstrument;
 
 static const char* gmdrumname = "GM-drums";
 
+// item data of the lazily filled group folders in populatePatchModel()
+enum {
+	PatchGroupRole = Qt::UserRole + 1,
+	PatchChannelRole,
+	PatchSongTypeRole,
+	PatchDrumRole
+};
+
 //---------------------------------------------------------
 //   string2sysex
 //---------------------------------------------------------
@@ -314,6 +323,7 @@ void MidiInstrument::init()
 	MidiController* prog = new MidiController("Program", CTRL_PROGRAM, 0, 0xffffff, 0);
 	_controller->add(prog);
 	_dirty = false;
+	m_patchIndexValid = false;
 }
 
 MidiInstrument::MidiInstrument()
@@ -428,6 +438,8 @@ MidiInstrument& MidiInstrument::assign(const MidiInstrument& ins)
 		}
 	}
 
+	invalidatePatchIndex();
+
 	_name = ins._name;
 	_filePath = ins._filePath;
 	m_keymaps = ins.m_keymaps;
@@ -766,6 +778,7 @@ void MidiInstrument::read(Xml& xml)
 	int base = 10;
 	_nullvalue = -1;
 	m_keymaps.clear();
+	invalidatePatchIndex();
 	for (;;)
 	{
 		Xml::Token token = xml.parse();
@@ -919,19 +932,47 @@ void MidiInstrument::write(int level, Xml& xml)
 }
 
 //---------------------------------------------------------
-//   getPatchName
+//   buildPatchIndex
 //---------------------------------------------------------
 
-QString MidiInstrument::getPatchName(int channel, int prog, MType mode, bool drum)/*{{{*/
+void MidiInstrument::buildPatchIndex()
 {
-	int pr = prog & 0xff;
-	if (prog == CTRL_VAL_UNKNOWN || pr == 0xff)
-		return "<unknown>";
+	m_progIndex.clear();
+	m_patchCache.clear();
+	for (ciPatchGroup i = pg.begin(); i != pg.end(); ++i)
+	{
+		const PatchList& pl = (*i)->patches;
+		for (ciPatch ipl = pl.begin(); ipl != pl.end(); ++ipl)
+			m_progIndex[(*ipl)->prog & 0xff].append(*ipl);
+	}
+	m_patchIndexValid = true;
+}
+
+//---------------------------------------------------------
+//   lookupPatch
+//    first patch in group order matching the program,
+//    the banks significant for mode and the drum flags.
+//    Misses are cached too.
+//---------------------------------------------------------
+
+Patch* MidiInstrument::lookupPatch(int channel, int prog, MType mode, bool drum)
+{
+	bool drumchan = channel == 9;
+	qint64 key = (qint64(prog & 0xffffff))
+			| (qint64(mode) << 24)
+			| (qint64(drumchan) << 32)
+			| (qint64(drum) << 33);
 
+	if (!m_patchIndexValid)
+		buildPatchIndex();
+	QHash<qint64, Patch*>::const_iterator ic = m_patchCache.constFind(key);
+	if (ic != m_patchCache.constEnd())
+		return ic.value();
+
+	int pr = prog & 0xff;
 	int hbank = (prog >> 16) & 0xff;
 	int lbank = (prog >> 8) & 0xff;
 	int tmask = 1;
-	bool drumchan = channel == 9;
 	bool hb = false;
 	bool lb = false;
 	switch (mode)
@@ -946,8 +987,6 @@ QString MidiInstrument::getPatchName(int channel, int prog, MType mode, bool dru
 			tmask = 4;
 			break;
 		case MT_GM:
-			if (drumchan)
-				return gmdrumname;
 			tmask = 1;
 			break;
 		default:
@@ -955,22 +994,46 @@ QString MidiInstrument::getPatchName(int channel, int prog, MType mode, bool dru
 			lb = true; // LSB bank matters
 			break;
 	}
-	for (ciPatchGroup i = pg.begin(); i != pg.end(); ++i)
+
+	Patch* rv = 0;
+	QHash<int, QList<Patch*> >::const_iterator ip = m_progIndex.constFind(pr);
+	if (ip != m_progIndex.constEnd())
 	{
-		const PatchList& pl = (*i)->patches;
-		for (ciPatch ipl = pl.begin(); ipl != pl.end(); ++ipl)
+		const QList<Patch*>& pl = ip.value();
+		for (int k = 0; k < pl.size(); ++k)
 		{
-			const Patch* mp = *ipl;
+			Patch* mp = pl.at(k);
 			if ((mp->typ & tmask)
-					&& (pr == mp->prog)
 					&& ((drum && mode != MT_GM) ||
 					(mp->drum == drumchan))
 
 					&& (hbank == mp->hbank || !hb || mp->hbank == -1)
 					&& (lbank == mp->lbank || !lb || mp->lbank == -1))
-				return mp->name;
+			{
+				rv = mp;
+				break;
+			}
 		}
 	}
+	m_patchCache.insert(key, rv);
+	return rv;
+}
+
+//---------------------------------------------------------
+//   getPatchName
+//---------------------------------------------------------
+
+QString MidiInstrument::getPatchName(int channel, int prog, MType mode, bool drum)/*{{{*/
+{
+	int pr = prog & 0xff;
+	if (prog == CTRL_VAL_UNKNOWN || pr == 0xff)
+		return "<unknown>";
+	if (mode == MT_GM && channel == 9)
+		return gmdrumname;
+
+	const Patch* mp = lookupPatch(channel, prog, mode, drum);
+	if (mp)
+		return mp->name;
 	return "<unknown>";
 }/*}}}*/
 
@@ -979,51 +1042,10 @@ Patch* MidiInstrument::getPatch(int channel, int prog, MType mode, bool drum)/*{
 	int pr = prog & 0xff;
 	if (prog == CTRL_VAL_UNKNOWN || pr == 0xff)
 		return 0;
+	if (mode == MT_GM && channel == 9)
+		return 0;
 
-	int hbank = (prog >> 16) & 0xff;
-	int lbank = (prog >> 8) & 0xff;
-	int tmask = 1;
-	bool drumchan = channel == 9;
-	bool hb = false;
-	bool lb = false;
-	switch (mode)
-	{
-		case MT_GS:
-			tmask = 2;
-			hb = true;
-			break;
-		case MT_XG:
-			hb = true;
-			lb = true;
-			tmask = 4;
-			break;
-		case MT_GM:
-			if (drumchan)
-				return 0;
-			tmask = 1;
-			break;
-		default:
-			hb = true; // MSB bank matters
-			lb = true; // LSB bank matters
-			break;
-	}
-	for (ciPatchGroup i = pg.begin(); i != pg.end(); ++i)
-	{
-		const PatchList& pl = (*i)->patches;
-		for (ciPatch ipl = pl.begin(); ipl != pl.end(); ++ipl)
-		{
-			Patch* mp = *ipl;
-			if ((mp->typ & tmask)
-					&& (pr == mp->prog)
-					&& ((drum && mode != MT_GM) ||
-					(mp->drum == drumchan))
-
-					&& (hbank == mp->hbank || !hb || mp->hbank == -1)
-					&& (lbank == mp->lbank || !lb || mp->lbank == -1))
-				return mp;
-		}
-	}
-	return 0;
+	return lookupPatch(channel, prog, mode, drum);
 }/*}}}*/
 
 //---------------------------------------------------------
@@ -1051,33 +1073,12 @@ void MidiInstrument::populatePatchPopup(QMenu* menu, int chan, MType songType, b
 	}
 	if (pg.size() > 1)
 	{
-		for (ciPatchGroup i = pg.begin(); i != pg.end(); ++i)
+		// the group submenus add their patches when they are first shown
+		for (int i = 0; i < (int)pg.size(); ++i)
 		{
-			PatchGroup* pgp = *i;
-			QMenu* pm = menu->addMenu(pgp->name);
+			PatchGroupMenu* pm = new PatchGroupMenu(pg[i]->name, this, i, chan, songType, drum, menu);
 			pm->setFont(config.fonts[0]);
-			const PatchList& pl = pgp->patches;
-			QString& gname = pgp->name;
-			for (ciPatch ipl = pl.begin(); ipl != pl.end(); ++ipl)
-			{
-				const Patch* mp = *ipl;
-				if ((mp->typ & mask) &&
-						((drum && songType != MT_GM) ||
-						(mp->drum == drumchan)))
-				{
-					int id = ((mp->hbank & 0xff) << 16)
-							+ ((mp->lbank & 0xff) << 8) + (mp->prog & 0xff);
-					QAction* act = pm->addAction(mp->name);
-					//act->setCheckable(true);
-					QString strId = QString::number(id);
-					QStringList _data = (QStringList() << strId << gname);
-					//_data->append(strId);
-					//_data->append(gname);
-					//act->setData(id);
-					act->setData(_data);
-				}
-
-			}
+			menu->addMenu(pm);
 		}
 	}
 	else if (pg.size() == 1)
@@ -1128,33 +1129,23 @@ void MidiInstrument::populatePatchModel(QStandardItemModel* model, int chan, MTy
 	}
 	if (pg.size() > 1)
 	{
-		for (ciPatchGroup i = pg.begin(); i != pg.end(); ++i)
+		// Only the group folders are created here, each with an empty
+		// placeholder row so it can be expanded. The view calls
+		// populatePatchGroup() when a folder is expanded.
+		for (int i = 0; i < (int)pg.size(); ++i)
 		{
-			PatchGroup* pgp = *i;
+			PatchGroup* pgp = pg[i];
 			QList<QStandardItem*> folder;
 			QStandardItem* noop = new QStandardItem("");
 			QStandardItem *dir = new QStandardItem(pgp->name);
 			QFont f = dir->font();
 			f.setBold(true);
 			dir->setFont(f);
-			const PatchList& pl = pgp->patches;
-			for (ciPatch ipl = pl.begin(); ipl != pl.end(); ++ipl)
-			{
-				const Patch* mp = *ipl;
-				if ((mp->typ & mask) && ((drum && songType != MT_GM) || (mp->drum == drumchan)))
-				{
-					int id = ((mp->hbank & 0xff) << 16) + ((mp->lbank & 0xff) << 8) + (mp->prog & 0xff);
-					QList<QStandardItem*> row;
-					QString strId = QString::number(id);
-					QStandardItem* idItem = new QStandardItem(strId);
-					QStandardItem* nItem = new QStandardItem(mp->name);
-					nItem->setToolTip(QString(pgp->name+":\n    "+mp->name));
-					row.append(nItem);
-					row.append(idItem);
-					dir->appendRow(row);
-				}
-
-			}
+			dir->setData(i, PatchGroupRole);
+			dir->setData(chan, PatchChannelRole);
+			dir->setData((int)songType, PatchSongTypeRole);
+			dir->setData(drum, PatchDrumRole);
+			dir->appendRow(QList<QStandardItem*>() << new QStandardItem("") << new QStandardItem(""));
 			folder.append(dir);
 			folder.append(noop);
 			model->appendRow(folder);
@@ -1184,6 +1175,103 @@ void MidiInstrument::populatePatchModel(QStandardItemModel* model, int chan, MTy
 	}
 }
 
+//---------------------------------------------------------
+//   populatePatchGroup
+//    add the patches of one group to a submenu
+//---------------------------------------------------------
+
+void MidiInstrument::populatePatchGroup(QMenu* menu, int group, int chan, MType songType, bool drum)
+{
+	if (group < 0 || group >= (int)pg.size())
+		return;
+	int mask = 0;
+	bool drumchan = chan == 9;
+	switch (songType)
+	{
+		case MT_XG: mask = 4;
+			break;
+		case MT_GS: mask = 2;
+			break;
+		case MT_GM: mask = 1;
+			break;
+		case MT_UNKNOWN: mask = 7;
+			break;
+	}
+	PatchGroup* pgp = pg[group];
+	const PatchList& pl = pgp->patches;
+	QString& gname = pgp->name;
+	for (ciPatch ipl = pl.begin(); ipl != pl.end(); ++ipl)
+	{
+		const Patch* mp = *ipl;
+		if ((mp->typ & mask) &&
+				((drum && songType != MT_GM) ||
+				(mp->drum == drumchan)))
+		{
+			int id = ((mp->hbank & 0xff) << 16)
+					+ ((mp->lbank & 0xff) << 8) + (mp->prog & 0xff);
+			QAction* act = menu->addAction(mp->name);
+			QString strId = QString::number(id);
+			QStringList _data = (QStringList() << strId << gname);
+			act->setData(_data);
+		}
+	}
+}
+
+//---------------------------------------------------------
+//   populatePatchGroup
+//    fill a folder created by populatePatchModel(),
+//    returns false if it is not a folder or already filled
+//---------------------------------------------------------
+
+bool MidiInstrument::populatePatchGroup(QStandardItem* dir)
+{
+	QVariant g = dir->data(PatchGroupRole);
+	if (!g.isValid())
+		return false;
+	int group = g.toInt();
+	if (group < 0 || group >= (int)pg.size())
+		return false;
+	int chan = dir->data(PatchChannelRole).toInt();
+	MType songType = (MType)dir->data(PatchSongTypeRole).toInt();
+	bool drum = dir->data(PatchDrumRole).toBool();
+	dir->setData(QVariant(), PatchGroupRole);
+
+	int mask = 0;
+	bool drumchan = chan == 9;
+	switch (songType)
+	{
+		case MT_XG: mask = 4;
+			break;
+		case MT_GS: mask = 2;
+			break;
+		case MT_GM: mask = 1;
+			break;
+		case MT_UNKNOWN: mask = 7;
+			break;
+	}
+
+	PatchGroup* pgp = pg[group];
+	dir->removeRows(0, dir->rowCount());
+	const PatchList& pl = pgp->patches;
+	for (ciPatch ipl = pl.begin(); ipl != pl.end(); ++ipl)
+	{
+		const Patch* mp = *ipl;
+		if ((mp->typ & mask) && ((drum && songType != MT_GM) || (mp->drum == drumchan)))
+		{
+			int id = ((mp->hbank & 0xff) << 16) + ((mp->lbank & 0xff) << 8) + (mp->prog & 0xff);
+			QList<QStandardItem*> row;
+			QString strId = QString::number(id);
+			QStandardItem* idItem = new QStandardItem(strId);
+			QStandardItem* nItem = new QStandardItem(mp->name);
+			nItem->setToolTip(QString(pgp->name+":\n    "+mp->name));
+			row.append(nItem);
+			row.append(idItem);
+			dir->appendRow(row);
+		}
+	}
+	return true;
+}
+
 bool MidiInstrument::fileSave()/*{{{*/
 {
 	if(_filePath.isEmpty())
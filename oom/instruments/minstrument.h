@@ -16,6 +16,7 @@
 
 class MidiPort;
 class QMenu;
+class QStandardItem;
 class QStandardItemModel;
 class MidiPlayEvent;
 class Xml;
@@ -108,7 +109,16 @@ class MidiInstrument
 	double m_panValue;
 	double m_verbValue;
 
+	// patches by program number in group order, and the result of every
+	// lookup made since the last edit, keyed by channel type, mode and
+	// bank/program. Both are rebuilt lazily after invalidatePatchIndex().
+	QHash<int, QList<Patch*> > m_progIndex;
+	QHash<qint64, Patch*> m_patchCache;
+	bool m_patchIndexValid;
+
     void init();
+	void buildPatchIndex();
+	Patch* lookupPatch(int channel, int prog, MType mode, bool drum);
 
 protected:
     EventList* _midiInit;
@@ -283,11 +293,23 @@ public:
     virtual Patch* getPatch(int, int, MType, bool);
     virtual void populatePatchPopup(QMenu*, int, MType, bool);
 	virtual void populatePatchModel(QStandardItemModel*, int, MType, bool);
+	void populatePatchGroup(QMenu*, int group, int, MType, bool);
+	bool populatePatchGroup(QStandardItem* folder);
     void read(Xml&);
     void write(int level, Xml&);
 
+	// must be called after patches were added, removed or changed
+	void invalidatePatchIndex()
+	{
+		m_patchIndexValid = false;
+		m_progIndex.clear();
+		m_patchCache.clear();
+	}
+
+    // mutable access, assume the caller is going to edit the patches
     PatchGroupList* groups()
     {
+        invalidatePatchIndex();
         return &pg;
     }
 	void setDefaultPan(double p)
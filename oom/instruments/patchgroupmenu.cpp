@@ -0,0 +1,35 @@
+//=========================================================
+//  OOMidi
+//  OpenOctave Midi and Audio Editor
+//=========================================================
+
+#include "patchgroupmenu.h"
+#include "minstrument.h"
+
+//---------------------------------------------------------
+//   PatchGroupMenu
+//---------------------------------------------------------
+
+PatchGroupMenu::PatchGroupMenu(const QString& title, MidiInstrument* instr, int group, int channel, MType songType, bool drum, QWidget* parent)
+: QMenu(title, parent)
+{
+    m_instrument = instr;
+    m_group = group;
+    m_channel = channel;
+    m_songType = songType;
+    m_drum = drum;
+    m_populated = false;
+    connect(this, SIGNAL(aboutToShow()), SLOT(populate()));
+}
+
+//---------------------------------------------------------
+//   populate
+//---------------------------------------------------------
+
+void PatchGroupMenu::populate()
+{
+    if (m_populated)
+        return;
+    m_populated = true;
+    m_instrument->populatePatchGroup(this, m_group, m_channel, m_songType, m_drum);
+}
@@ -0,0 +1,39 @@
+//=========================================================
+//  OOMidi
+//  OpenOctave Midi and Audio Editor
+//=========================================================
+
+#ifndef __PATCHGROUPMENU_H__
+#define __PATCHGROUPMENU_H__
+
+#include <QMenu>
+
+#include "globaldefs.h"
+
+class MidiInstrument;
+
+//---------------------------------------------------------
+//   PatchGroupMenu
+//    submenu of MidiInstrument::populatePatchPopup() that
+//    adds the patches of its group when first shown
+//---------------------------------------------------------
+
+class PatchGroupMenu : public QMenu
+{
+    Q_OBJECT
+
+    MidiInstrument* m_instrument;
+    int m_group;
+    int m_channel;
+    MType m_songType;
+    bool m_drum;
+    bool m_populated;
+
+private slots:
+    void populate();
+
+public:
+    PatchGroupMenu(const QString& title, MidiInstrument*, int group, int channel, MType songType, bool drum, QWidget* parent = 0);
+};
+
+#endif
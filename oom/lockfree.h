@@ -0,0 +1,162 @@
+//=========================================================
+//  OOMidi
+//  OpenOctave Midi and Audio Editor
+//
+//  lock free helpers shared between the gui, prefetch
+//  and audio threads
+//=========================================================
+
+#ifndef __LOCKFREE_H__
+#define __LOCKFREE_H__
+
+#include <QAtomicInt>
+#include <unistd.h>
+
+//---------------------------------------------------------
+//   LockFreeFifo
+//    single producer / single consumer ring buffer.
+//    put() is only called from the writer thread,
+//    get()/peek()/remove() only from the reader thread.
+//    The capacity is rounded up to a power of two.
+//---------------------------------------------------------
+
+template <class T> class LockFreeFifo
+{
+    T* m_fifo;
+    int m_size;
+    int m_mask;
+    QAtomicInt m_widx; // only written by the writer
+    QAtomicInt m_ridx; // only written by the reader
+
+    LockFreeFifo(const LockFreeFifo&);
+    LockFreeFifo& operator=(const LockFreeFifo&);
+
+public:
+    LockFreeFifo(int capacity = 256)
+    {
+        m_size = 2;
+        while (m_size < capacity)
+            m_size <<= 1;
+        m_mask = m_size - 1;
+        m_fifo = new T[m_size];
+        m_widx.storeRelease(0);
+        m_ridx.storeRelease(0);
+    }
+
+    ~LockFreeFifo()
+    {
+        delete[] m_fifo;
+    }
+
+    // returns true on fifo overflow
+    bool put(const T& item)
+    {
+        int w = m_widx.loadAcquire();
+        if (w - m_ridx.loadAcquire() >= m_size)
+            return true;
+        m_fifo[w & m_mask] = item;
+        m_widx.storeRelease(w + 1);
+        return false;
+    }
+
+    // returns false if the fifo is empty
+    bool get(T& item)
+    {
+        int r = m_ridx.loadAcquire();
+        if (r == m_widx.loadAcquire())
+            return false;
+        item = m_fifo[r & m_mask];
+        m_ridx.storeRelease(r + 1);
+        return true;
+    }
+
+    bool peek(T& item) const
+    {
+        int r = m_ridx.loadAcquire();
+        if (r == m_widx.loadAcquire())
+            return false;
+        item = m_fifo[r & m_mask];
+        return true;
+    }
+
+    void remove()
+    {
+        m_ridx.storeRelease(m_ridx.loadAcquire() + 1);
+    }
+
+    int getSize() const
+    {
+        return m_widx.loadAcquire() - m_ridx.loadAcquire();
+    }
+
+    bool isEmpty() const
+    {
+        return getSize() == 0;
+    }
+
+    int capacity() const
+    {
+        return m_size;
+    }
+
+    // only safe when neither side is running
+    void clear()
+    {
+        m_widx.storeRelease(0);
+        m_ridx.storeRelease(0);
+    }
+};
+
+//---------------------------------------------------------
+//   ProcessGate
+//    replaces a mutex around a realtime process() call.
+//    The realtime side never blocks: enter() fails if the
+//    gate is closed. close() is called from a non realtime
+//    thread and waits until a running cycle has left.
+//---------------------------------------------------------
+
+class ProcessGate
+{
+    QAtomicInt m_open;
+    QAtomicInt m_busy;
+
+public:
+    ProcessGate()
+    {
+        m_open.storeRelease(0);
+        m_busy.storeRelease(0);
+    }
+
+    bool isOpen() const
+    {
+        return m_open.loadAcquire() != 0;
+    }
+
+    bool enter()
+    {
+        m_busy.fetchAndStoreOrdered(1);
+        if (m_open.fetchAndAddOrdered(0))
+            return true;
+        m_busy.fetchAndStoreOrdered(0);
+        return false;
+    }
+
+    void leave()
+    {
+        m_busy.fetchAndStoreOrdered(0);
+    }
+
+    void open()
+    {
+        m_open.fetchAndStoreOrdered(1);
+    }
+
+    void close()
+    {
+        m_open.fetchAndStoreOrdered(0);
+        while (m_busy.fetchAndAddOrdered(0))
+            usleep(100);
+    }
+};
+
+#endif
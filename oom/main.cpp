@@ -248,6 +248,9 @@ static void usage(const char* prog, const char* txt)
 	fprintf(stderr, "   -P  n    set audio driver real time priority to n (Dummy only, default 40. Else fixed by Jack.)\n");
 	fprintf(stderr, "   -Y  n    force midi real time priority to n (default: audio driver prio +2)\n");
 	fprintf(stderr, "   -p       don't load LADSPA plugins\n");
+	fprintf(stderr, "   -R  dir  render every audio track and output of the song as a stem into dir and quit (use with -a)\n");
+	fprintf(stderr, "            mixing runs on one core, only encoding and writing the stems uses the others\n");
+	fprintf(stderr, "   -T       profile the audio thread, print the cycles around each xrun and a summary at exit\n");
 #ifdef JACK_SESSION_SUPPORT
 	fprintf(stderr, "   -U       Jack session UUID\n");
 #endif
@@ -344,7 +347,7 @@ int main(int argc, char* argv[])
 
 	int i;
 
-	QString optstr("ahvdDmMsP:Y:l:py");
+	QString optstr("ahvdDmMsP:Y:l:pyR:T");
 #ifdef HAVE_LASH
 	optstr += QString("L");
 #endif
@@ -388,6 +391,10 @@ int main(int argc, char* argv[])
 				break;
 			case 'U': gJackSessionUUID = QString(optarg);
 				break;
+			case 'R': offlineRenderDir = QString(optarg);
+				break;
+			case 'T': dspProfileReport = true;
+				break;
 			case 'h': usage(argv[0], argv[1]);
 				return -1;
 			default: usage(argv[0], "bad argument");
@@ -0,0 +1,140 @@
+//=========================================================
+//  OOMidi
+//  OpenOctave Midi and Audio Editor
+//=========================================================
+
+#include <string.h>
+
+#include "meterbus.h"
+#include "track.h"
+
+MeterBus* meterBus = 0;
+
+//---------------------------------------------------------
+//   MeterBus
+//---------------------------------------------------------
+
+MeterBus::MeterBus()
+{
+    memset(m_buffer[0].slot, 0, sizeof(m_buffer[0].slot));
+    memset(m_buffer[1].slot, 0, sizeof(m_buffer[1].slot));
+    memset(m_gui, 0, sizeof(m_gui));
+    m_buffer[0].seq.storeRelease(0);
+    m_buffer[1].seq.storeRelease(0);
+    m_front.storeRelease(0);
+    m_highWater.storeRelease(0);
+    m_guiUsed = 0;
+}
+
+//---------------------------------------------------------
+//   allocSlot
+//    returns -1 if all slots are taken, the track then
+//    falls back to reading its meters directly
+//---------------------------------------------------------
+
+int MeterBus::allocSlot()
+{
+    int slot;
+    if (!m_freeSlots.isEmpty())
+        slot = m_freeSlots.takeLast();
+    else
+    {
+        slot = m_highWater.loadAcquire();
+        if (slot >= MAX_SLOTS)
+            return -1;
+        m_highWater.storeRelease(slot + 1);
+    }
+    memset(&m_gui[slot], 0, sizeof(MeterSnapshot));
+    return slot;
+}
+
+//---------------------------------------------------------
+//   freeSlot
+//---------------------------------------------------------
+
+void MeterBus::freeSlot(int slot)
+{
+    if (slot >= 0 && slot < MAX_SLOTS)
+        m_freeSlots.append(slot);
+}
+
+//---------------------------------------------------------
+//   publish
+//    called by the audio thread at the end of every cycle
+//---------------------------------------------------------
+
+void MeterBus::publish(TrackList* tracks)
+{
+    int b = m_front.loadAcquire() ^ 1;
+    Buffer& buf = m_buffer[b];
+
+    buf.seq.fetchAndAddOrdered(1);
+    for (ciTrack it = tracks->begin(); it != tracks->end(); ++it)
+    {
+        const Track* t = *it;
+        int slot = t->meterSlot();
+        if (slot < 0)
+            continue;
+        MeterSnapshot& ms = buf.slot[slot];
+        int chans = t->isMidiTrack() ? 0 : t->channels();
+        for (int ch = 0; ch < MAX_CHANNELS; ++ch)
+        {
+            if (ch < chans)
+            {
+                ms.peak[ch] = t->meter(ch);
+                ms.rms[ch] = t->rms(ch);
+                ms.truePeak[ch] = t->truePeak(ch);
+                ms.peakHold[ch] = t->peak(ch);
+                ms.clips[ch] = t->clips(ch);
+            }
+            else
+            {
+                ms.peak[ch] = 0.0;
+                ms.rms[ch] = 0.0;
+                ms.truePeak[ch] = 0.0;
+                ms.peakHold[ch] = 0.0;
+                ms.clips[ch] = 0;
+            }
+        }
+    }
+    buf.seq.fetchAndAddOrdered(1);
+    m_front.storeRelease(b);
+}
+
+//---------------------------------------------------------
+//   fetch
+//    called once per heartbeat before the strips read
+//    their levels. Keeps the previous snapshot if the
+//    writer keeps overtaking the copy.
+//---------------------------------------------------------
+
+void MeterBus::fetch()
+{
+    int used = m_highWater.loadAcquire();
+    for (int retry = 0; retry < 4; ++retry)
+    {
+        Buffer& buf = m_buffer[m_front.loadAcquire()];
+        int s1 = buf.seq.loadAcquire();
+        if (s1 & 1)
+            continue;
+        memcpy(m_gui, buf.slot, sizeof(MeterSnapshot) * used);
+        if (buf.seq.fetchAndAddOrdered(0) == s1)
+        {
+            m_guiUsed = used;
+            return;
+        }
+    }
+}
+
+//---------------------------------------------------------
+//   levels
+//    returns 0 if the track has no valid snapshot yet
+//---------------------------------------------------------
+
+const MeterSnapshot* MeterBus::levels(const Track* track) const
+{
+    int slot = track->meterSlot();
+    if (slot < 0 || slot >= m_guiUsed)
+        return 0;
+    return &m_gui[slot];
+}
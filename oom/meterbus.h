@@ -0,0 +1,86 @@
+//=========================================================
+//  OOMidi
+//  OpenOctave Midi and Audio Editor
+//
+//  double buffered meter snapshot published once per
+//  audio cycle and read once per gui heartbeat
+//=========================================================
+
+#ifndef __METERBUS_H__
+#define __METERBUS_H__
+
+#include <QAtomicInt>
+#include <QList>
+
+#include "globaldefs.h"
+
+class Track;
+template<class T> class tracklist;
+typedef tracklist<Track*> TrackList;
+
+//---------------------------------------------------------
+//   MeterSnapshot
+//    levels of one track as seen at the end of an audio
+//    cycle. All values are linear amplitudes.
+//---------------------------------------------------------
+
+struct MeterSnapshot
+{
+    float peak[MAX_CHANNELS];     // block peak
+    float rms[MAX_CHANNELS];      // block rms
+    float truePeak[MAX_CHANNELS]; // inter sample peak estimate
+    float peakHold[MAX_CHANNELS]; // held peak since last resetPeaks()
+    int clips[MAX_CHANNELS];      // cycles that hit full scale since last resetPeaks()
+};
+
+//---------------------------------------------------------
+//   MeterBus
+//    Every track owns a slot. The audio thread writes all
+//    slots of the back buffer and flips it to the front at
+//    the end of Audio::process(). The gui copies the front
+//    buffer once per heartbeat with fetch(); a sequence
+//    counter per buffer detects a copy torn by the writer,
+//    in which case the copy is retried. Neither side ever
+//    blocks the other.
+//
+//    allocSlot()/freeSlot() are gui thread only.
+//---------------------------------------------------------
+
+class MeterBus
+{
+    enum { MAX_SLOTS = 1024 };
+
+    struct Buffer
+    {
+        QAtomicInt seq; // odd while the writer is inside
+        MeterSnapshot slot[MAX_SLOTS];
+    };
+
+    Buffer m_buffer[2];
+    QAtomicInt m_front;     // index of the last completed buffer
+    QAtomicInt m_highWater; // slots in use are below this index
+
+    MeterSnapshot m_gui[MAX_SLOTS];
+    int m_guiUsed;
+    QList<int> m_freeSlots;
+
+    MeterBus(const MeterBus&);
+    MeterBus& operator=(const MeterBus&);
+
+public:
+    MeterBus();
+
+    int allocSlot();
+    void freeSlot(int slot);
+
+    // audio thread
+    void publish(TrackList* tracks);
+
+    // gui thread
+    void fetch();
+    const MeterSnapshot* levels(const Track* track) const;
+};
+
+extern MeterBus* meterBus;
+
+#endif
@@ -10,12 +10,14 @@
 #include <errno.h>
 #include <values.h>
 #include <assert.h>
+#include <deque>
 
 #include "song.h"
 #include "midi.h"
 #include "drummap.h"
 //#include "midiedit/drummap.h"  // p4.0.2
 #include "event.h"
+#include "midieventstore.h"
 #include "globals.h"
 #include "midictrl.h"
 #include "marker/marker.h"
@@ -31,6 +33,8 @@
 #include "midiseq.h"
 #include "gconfig.h"
 #include "ticksynth.h"
+#include "midirecordbuffer.h"
+#include "dspprofiler.h"
 
 extern void dump(const unsigned char* p, int n);
 
@@ -545,112 +549,61 @@ void buildMidiEventList(EventList* del, const MPEventList* el, MidiTrack* track,
 		}
 	} 
 
-	// Added by Tim. p3.3.8
+	//---------------------------------------------------
+	//    pair note on/off in one pass. A note off ends
+	//    the oldest sounding note of its pitch, a note off
+	//    without one is dropped.
+	//---------------------------------------------------
 
-	// The loop is a safe way to delete while iterating.
-	bool loop;
-	do
+	std::deque<Event> sounding[128];
+	for (iEvent i = mel.begin(); i != mel.end();)
 	{
-		loop = false;
-
-		for (iEvent i = mel.begin(); i != mel.end(); ++i)
+		Event ev = i->second;
+		if (!ev.isNote())
 		{
-			Event ev = i->second;
-			if (ev.isNote())
+			++i;
+			continue;
+		}
+		std::deque<Event>& sl = sounding[ev.pitch() & 0x7f];
+		if (!ev.isNoteOff())
+		{
+			sl.push_back(ev);
+			++i;
+			continue;
+		}
+		if (!sl.empty())
+		{
+			Event on = sl.front();
+			sl.pop_front();
+			int t = i->first - on.tick();
+			if (t <= 0)
 			{
-				if (ev.isNoteOff())
-				{
-					iEvent k;
-					bool found = false;
-					for (k = i; k != mel.end(); ++k)
-					{
-						Event event = k->second;
-						if (event.tick() > ev.tick())
-							break;
-						if (event.isNoteOff(ev))
-						{
-							ev.setLenTick(1);
-							ev.setVelo(event.velo());
-							ev.setVeloOff(0);
-							// Added by Tim. p3.3.8
-							//printf("buildMidiEventList: found note off: event t:%d len:%d type:%d A:%d B:%d C:%d  ev t:%d len:%d type:%d A:%d B:%d C:%d\n", event.tick(), event.lenTick(), event.type(), event.dataA(), event.dataB(), event.dataC(), ev.tick(), ev.lenTick(), ev.type(), ev.dataA(), ev.dataB(), ev.dataC());
-
-							found = true;
-							break;
-						}
-					}
-					if (!found)
-					{
-						printf("NOTE OFF without Note ON tick %d type %d  %d %d\n",
-								ev.tick(), ev.type(), ev.pitch(), ev.velo());
-					}
-					else
-					{
-						mel.erase(k);
-
-						// Changed by Tim. p3.3.8
-						//continue;
-						loop = true;
-						break;
-
-					}
-				}
-				// Added by Tim. p3.3.8
-
-				// If the event length is not zero, it means the event and its
-				//  note on/off have already been taken care of. So ignore it.
-				if (ev.lenTick() != 0)
-				{
-					continue;
-				}
-
-				iEvent k;
-				for (k = mel.lower_bound(ev.tick()); k != mel.end(); ++k)
-				{
-					Event event = k->second;
-					if (ev.isNoteOff(event))
-					{
-						int t = k->first - i->first;
-						if (t <= 0)
-						{
-							if (debugMsg)
-							{
-								printf("Note len is (%d-%d)=%d, set to 1\n",
-										k->first, i->first, k->first - i->first);
-								ev.dump();
-								event.dump();
-							}
-							t = 1;
-						}
-						ev.setLenTick(t);
-						ev.setVeloOff(event.veloOff());
-						// Added by Tim. p3.3.8
-						//printf("buildMidiEventList: set len and velOff: event t:%d len:%d type:%d A:%d B:%d C:%d  ev t:%d len:%d type:%d A:%d B:%d C:%d\n", event.tick(), event.lenTick(), event.type(), event.dataA(), event.dataB(), event.dataC(), ev.tick(), ev.lenTick(), ev.type(), ev.dataA(), ev.dataB(), ev.dataC());
-
-						break;
-					}
-				}
-				if (k == mel.end())
+				if (debugMsg)
 				{
-					printf("-no note-off! %d pitch %d velo %d\n",
-							ev.tick(), ev.pitch(), ev.velo());
-					//
-					// switch off at end of measure
-					//
-					int endTick = song->roundUpBar(ev.tick() + 1);
-					ev.setLenTick(endTick - ev.tick());
-				}
-				else
-				{
-					mel.erase(k);
-					// Added by Tim. p3.3.8
-					loop = true;
-					break;
-
+					printf("Note len is (%d-%d)=%d, set to 1\n", i->first, on.tick(), t);
+					on.dump();
+					ev.dump();
 				}
+				t = 1;
 			}
+			on.setLenTick(t);
+			on.setVeloOff(ev.veloOff());
+		}
+		mel.erase(i++);
+	}
+	for (int pitch = 0; pitch < 128; ++pitch)
+	{
+		for (std::deque<Event>::iterator i = sounding[pitch].begin(); i != sounding[pitch].end(); ++i)
+		{
+			Event ev = *i;
+			printf("-no note-off! %d pitch %d velo %d\n", ev.tick(), ev.pitch(), ev.velo());
+			//
+			// switch off at end of measure
+			//
+			int endTick = song->roundUpBar(ev.tick() + 1);
+			ev.setLenTick(endTick - ev.tick());
 		}
-	} while (loop);
+	}
 
 	for (iEvent i = mel.begin(); i != mel.end(); ++i)
 	{
@@ -857,7 +810,6 @@ void Audio::collectEvents(MidiTrack* track, unsigned int cts, unsigned int nts)
 {
 	int port = track->outPort();
 	int channel = track->outChannel();
-	int defaultPort = port;
 
 	MidiDevice* md = midiPorts[port].device();
 	MPEventList* playEvents = md->playEvents();
@@ -890,152 +842,158 @@ void Audio::collectEvents(MidiTrack* track, unsigned int cts, unsigned int nts)
 		if (etick > partLen)
 			continue;
 
-		iEvent ie = events->lower_bound(stick);
-		iEvent iend = events->lower_bound(etick);
-
-		for (; ie != iend; ++ie)
+		// Walk the compact copy of the part if the gui has one
+		// up to date, the event map otherwise.
+		MidiEventView ev;
+		const MidiEventStore* store = events->compactStore();
+		if (store)
 		{
-			Event ev = ie->second;
-			port = defaultPort; //Reset each loop
-			//
-			//  dont play any meta events
-			//
-			if (ev.type() == Meta)
-				continue;
-			if (track->type() == Track::DRUM)
+			int iend = store->lowerBound(etick);
+			for (int i = store->lowerBound(stick); i < iend; ++i)
 			{
-				int instr = ev.pitch();
-				// ignore muted drums
-				if (ev.isNote() && drumMap[instr].mute)
-					continue;
+				store->view(i, ev);
+				collectEvent(track, ev, offset, port, channel, playEvents, stuckNotes);
 			}
-			unsigned tick = ev.tick() + offset;
-			unsigned frame = tempomap.tick2frame(tick) + frameOffset;
-			switch (ev.type())
+		}
+		else
+		{
+			iEvent ie = events->lower_bound(stick);
+			iEvent iend = events->lower_bound(etick);
+			for (; ie != iend; ++ie)
 			{
-				case Note:
-				{
-					int len = ev.lenTick();
-					int pitch = ev.pitch();
-					int velo = ev.velo();
-					if (track->type() == Track::DRUM)
-					{
-						//
-						// Map drum-notes to the drum-map values
-						//
-						int instr = ev.pitch();
-						pitch = drumMap[instr].anote;
-						port = drumMap[instr].port; //This changes to non-default port
-						channel = drumMap[instr].channel;
-						velo = int(double(velo) * (double(drumMap[instr].vol) / 100.0));
-					}
-					else
-					{
-						//
-						// transpose non drum notes
-						//
-						pitch += /*(track->getTransposition() +*/ song->globalPitchShift();
-					}
-
-					if (pitch > 127)
-						pitch = 127;
-					if (pitch < 0)
-						pitch = 0;
-					velo += track->velocity;
-					velo = (velo * track->compression) / 100;
-					if (velo > 127)
-						velo = 127;
-					if (velo < 1) // no off event
-						velo = 1;
-					len = (len * track->len) / 100;
-					if (len <= 0) // dont allow zero length
-						len = 1;
-					int veloOff = ev.veloOff();
-
-					if (port == defaultPort)
-					{
-						//printf("Adding event normally: frame=%d port=%d channel=%d pitch=%d velo=%d\n",frame, port, channel, pitch, velo);
-
-						// p3.3.25
-						// If syncing to external midi sync, we cannot use the tempo map.
-						// Therefore we cannot get sub-tick resolution. Just use ticks instead of frames.
-						if (extSyncFlag.value())
-							playEvents->add(MidiPlayEvent(tick, port, channel, 0x90, pitch, velo, (Track*)track));
-						else
-							playEvents->add(MidiPlayEvent(frame, port, channel, 0x90, pitch, velo, (Track*)track));
-
-						stuckNotes->add(MidiPlayEvent(tick + len, port, channel, veloOff ? 0x80 : 0x90, pitch, veloOff, (Track*)track));
-					}
-					else
-					{ //Handle events to different port than standard.
-						MidiDevice* mdAlt = midiPorts[port].device();
-						if (mdAlt)
-						{
-							if (extSyncFlag.value())
-								mdAlt->playEvents()->add(MidiPlayEvent(tick, port, channel, 0x90, pitch, velo, (Track*)track));
-							else
-								mdAlt->playEvents()->add(MidiPlayEvent(frame, port, channel, 0x90, pitch, velo, (Track*)track));
+				ev.set(ie->second);
+				collectEvent(track, ev, offset, port, channel, playEvents, stuckNotes);
+			}
+		}
+	}
+}
 
-							mdAlt->stuckNotes()->add(MidiPlayEvent(tick + len, port, channel, veloOff ? 0x80 : 0x90, pitch, veloOff, (Track*)track));
-						}
-					}
+//---------------------------------------------------------
+//   collectEvent
+//    schedule one event of a part starting at offset
+//---------------------------------------------------------
 
-					if (velo > track->activity())
-						track->setActivity(velo);
-				}
-					break;
+void Audio::collectEvent(MidiTrack* track, const MidiEventView& ev, unsigned offset, int defaultPort, int& channel,
+		MPEventList* playEvents, MPEventList* stuckNotes)
+{
+	int port = defaultPort;
+	//
+	//  dont play any meta events
+	//
+	if (ev.type == Meta)
+		return;
+	if (track->type() == Track::DRUM)
+	{
+		int instr = ev.a;
+		// ignore muted drums
+		if (ev.type == Note && drumMap[instr].mute)
+			return;
+	}
+	unsigned tick = ev.tick + offset;
+	unsigned frame = tempomap.tick2frame(tick) + frameOffset;
+	// p3.3.25
+	// If syncing to external midi sync, we cannot use the tempo map.
+	// Therefore we cannot get sub-tick resolution. Just use ticks instead of frames.
+	unsigned time = extSyncFlag.value() ? tick : frame;
+	switch (ev.type)
+	{
+		case Note:
+		{
+			int len = ev.lenTick;
+			int pitch = ev.a;
+			int velo = ev.b;
+			if (track->type() == Track::DRUM)
+			{
+				//
+				// Map drum-notes to the drum-map values
+				//
+				int instr = ev.a;
+				pitch = drumMap[instr].anote;
+				port = drumMap[instr].port; //This changes to non-default port
+				channel = drumMap[instr].channel;
+				velo = int(double(velo) * (double(drumMap[instr].vol) / 100.0));
+			}
+			else
+			{
+				//
+				// transpose non drum notes
+				//
+				pitch += /*(track->getTransposition() +*/ song->globalPitchShift();
+			}
 
-					// Added by T356.
-				case Controller:
+			if (pitch > 127)
+				pitch = 127;
+			if (pitch < 0)
+				pitch = 0;
+			velo += track->velocity;
+			velo = (velo * track->compression) / 100;
+			if (velo > 127)
+				velo = 127;
+			if (velo < 1) // no off event
+				velo = 1;
+			len = (len * track->len) / 100;
+			if (len <= 0) // dont allow zero length
+				len = 1;
+			int veloOff = ev.c;
+
+			if (port == defaultPort)
+			{
+				//printf("Adding event normally: frame=%d port=%d channel=%d pitch=%d velo=%d\n",frame, port, channel, pitch, velo);
+				playEvents->add(MidiPlayEvent(time, port, channel, 0x90, pitch, velo, (Track*)track));
+				stuckNotes->add(MidiPlayEvent(tick + len, port, channel, veloOff ? 0x80 : 0x90, pitch, veloOff, (Track*)track));
+			}
+			else
+			{ //Handle events to different port than standard.
+				MidiDevice* mdAlt = midiPorts[port].device();
+				if (mdAlt)
 				{
-					//int len   = ev.lenTick();
-					//int pitch = ev.pitch();
-					if (track->type() == Track::DRUM)
-					{
-						int ctl = ev.dataA();
-						// Is it a drum controller event, according to the track port's instrument?
-						MidiController *mc = midiPorts[defaultPort].drumController(ctl);
-						if (mc)
-						{
-							int instr = ctl & 0x7f;
-							ctl &= ~0xff;
-							int pitch = drumMap[instr].anote & 0x7f;
-							port = drumMap[instr].port; //This changes to non-default port
-							channel = drumMap[instr].channel;
-							MidiDevice* mdAlt = midiPorts[port].device();
-							if (mdAlt)
-							{
-								// p3.3.25
-								// If syncing to external midi sync, we cannot use the tempo map.
-								// Therefore we cannot get sub-tick resolution. Just use ticks instead of frames.
-								if (extSyncFlag.value())
-									mdAlt->playEvents()->add(MidiPlayEvent(tick, port, channel, ME_CONTROLLER, ctl | pitch, ev.dataB(), (Track*)track));
-								else
-
-									mdAlt->playEvents()->add(MidiPlayEvent(frame, port, channel, ME_CONTROLLER, ctl | pitch, ev.dataB(), (Track*)track));
-
-							}
-							break;
-						}
-					}
-					// p3.3.25
-					if (extSyncFlag.value())
-						playEvents->add(MidiPlayEvent(tick, port, channel, ev, (Track*)track));
-					else
-						playEvents->add(MidiPlayEvent(frame, port, channel, ev, (Track*)track));
+					mdAlt->playEvents()->add(MidiPlayEvent(time, port, channel, 0x90, pitch, velo, (Track*)track));
+					mdAlt->stuckNotes()->add(MidiPlayEvent(tick + len, port, channel, veloOff ? 0x80 : 0x90, pitch, veloOff, (Track*)track));
 				}
-					break;
-
+			}
 
-				default:
-					if (extSyncFlag.value())
-						playEvents->add(MidiPlayEvent(tick, port, channel, ev, (Track*)track));
-					else
-						playEvents->add(MidiPlayEvent(frame, port, channel, ev, (Track*)track));
+			if (velo > track->activity())
+				track->setActivity(velo);
+		}
+			break;
 
+			// Added by T356.
+		case Controller:
+		{
+			if (track->type() == Track::DRUM)
+			{
+				int ctl = ev.a;
+				// Is it a drum controller event, according to the track port's instrument?
+				MidiController *mc = midiPorts[defaultPort].drumController(ctl);
+				if (mc)
+				{
+					int instr = ctl & 0x7f;
+					ctl &= ~0xff;
+					int pitch = drumMap[instr].anote & 0x7f;
+					port = drumMap[instr].port; //This changes to non-default port
+					channel = drumMap[instr].channel;
+					MidiDevice* mdAlt = midiPorts[port].device();
+					if (mdAlt)
+						mdAlt->playEvents()->add(MidiPlayEvent(time, port, channel, ME_CONTROLLER, ctl | pitch, ev.b, (Track*)track));
 					break;
+				}
 			}
+			playEvents->add(MidiPlayEvent(time, port, channel, ME_CONTROLLER, ev.a, ev.b, (Track*)track));
 		}
+			break;
+
+		case PAfter:
+			playEvents->add(MidiPlayEvent(time, port, channel, ME_POLYAFTER, ev.a, ev.b, (Track*)track));
+			break;
+
+		case CAfter:
+			playEvents->add(MidiPlayEvent(time, port, channel, ME_AFTERTOUCH, ev.a, 0, (Track*)track));
+			break;
+
+		default:
+			if (ev.event)
+				playEvents->add(MidiPlayEvent(time, port, channel, *ev.event, (Track*)track));
+			break;
 	}
 }
 
@@ -1050,6 +1008,7 @@ void Audio::collectEvents(MidiTrack* track, unsigned int cts, unsigned int nts)
 
 void Audio::processMidi()
 {
+	DspProbe probe(this, DspProfiler::MIDI);
 	midiBusy = true;
 	//
 	// TODO: syntis should directly write into recordEventList
@@ -1090,7 +1049,7 @@ void Audio::processMidi()
 		//
 		if (track->recordFlag())
 		{
-			MPEventList* rl = track->mpevents();
+			MidiRecordBuffer* rl = track->recordBuffer();
 			MidiPort* tport = &midiPorts[port];
 
 			RouteList* irl = track->inRoutes();
@@ -1140,7 +1099,7 @@ void Audio::processMidi()
 							}
 
 							if (recording)
-								rl->add(event);
+								rl->put(event);
 						}
 
 						dev->setSysexFIFOProcessed(true);
@@ -1297,7 +1256,7 @@ void Audio::processMidi()
 										drumRecEvent.setB(preVelo);
 										drumRecEvent.setPort(port); //rec-event to current port
 										drumRecEvent.setChannel(track->outChannel()); //rec-event to current channel
-										rl->add(drumRecEvent);
+										rl->put(drumRecEvent);
 									}
 									else
 									{
@@ -1313,7 +1272,7 @@ void Audio::processMidi()
 										drumRecEvent.setPort(port); //rec-event to current port
 
 										drumRecEvent.setChannel(track->outChannel()); //rec-event to current channel
-										rl->add(drumRecEvent);
+										rl->put(drumRecEvent);
 									}
 								}
 								else
@@ -1324,7 +1283,7 @@ void Audio::processMidi()
 									recEvent.setPort(port);
 									recEvent.setChannel(track->outChannel());
 
-									rl->add(recEvent);
+									rl->put(recEvent);
 									if (prePitch)
 										recEvent.setA(prePitch);
 									if (preVelo)
@@ -1335,6 +1294,8 @@ void Audio::processMidi()
 					}
 				}//END for loop
 			}
+			// hand this cycle's events to the gui
+			rl->commit();
 		}
 	}
 
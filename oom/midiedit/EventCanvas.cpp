@@ -36,6 +36,16 @@
 #include "traverso_shared/TConfig.h"
 
 static int NOTE_PLAY_TIME = 20;
+
+// song changes that can only affect the items of parts whose
+// event list or position changed
+static const int INCREMENTAL_CHANGES = SC_SELECTION | SC_MIDI_CONTROLLER
+	| SC_PART_INSERTED | SC_PART_REMOVED | SC_PART_MODIFIED
+	| SC_EVENT_INSERTED | SC_EVENT_REMOVED | SC_EVENT_MODIFIED
+	| SC_SIG | SC_TEMPO | SC_MUTE | SC_SOLO | SC_RECFLAG
+	| SC_MIXER_VOLUME | SC_MIXER_PAN | SC_AUTOMATION;
+
+static const int EVENT_CHANGES = SC_EVENT_INSERTED | SC_EVENT_REMOVED | SC_EVENT_MODIFIED;
 //---------------------------------------------------------
 //   EventCanvas
 //---------------------------------------------------------
@@ -49,6 +59,7 @@ EventCanvas::EventCanvas(AbstractMidiEditor* pr, QWidget* parent, int sx, int sy
 	_playEvents = false;
 	m_showcomments = false;
 	curVelo = 70;
+	m_itemsRevision = -1;
 
     //setBg(QColor(226, 229, 229));//this was the old ligh color we are moving to dark now
     setBg(QColor(63,63,63));
@@ -159,13 +170,26 @@ void EventCanvas::updateSelection()
 
 void EventCanvas::songChanged(int flags)/*{{{*/
 {
+	songChanged(SongChange(flags));
+}/*}}}*/
+
+void EventCanvas::songChanged(const SongChange& change)/*{{{*/
+{
+	int flags = change.flags();
 	// Is it simply a midi controller value adjustment? Forget it.
 	if (flags == SC_MIDI_CONTROLLER)
 		return;
 
+	// Edits that are known to miss the notes shown here, like a
+	// controller being recorded, leave the items alone. The list
+	// revision still moved, so the next real change revisits
+	// those parts.
+	if ((flags & EVENT_CHANGES) && !(flags & ~(EVENT_CHANGES | SC_MIDI_CONTROLLER))
+			&& !change.isVague() && !touchesItems(change))
+		return;
+
 	if (flags & ~SC_SELECTION)
 	{
-		_items.clear();
 		start_tick = MAXINT;
 		end_tick = 0;
 	_curPart = 0;
@@ -182,17 +206,31 @@ void EventCanvas::songChanged(int flags)/*{{{*/
 				start_tick = stick;
 			if (etick > end_tick)
 				end_tick = etick;
+		}
 
-			EventList* el = part->events();
-			for (iEvent i = el->begin(); i != el->end(); ++i)
+		if (flags & ~INCREMENTAL_CHANGES)
+			rebuildItems();
+		else
+		{
+			removeForeignItems();
+			QSet<Part*> parts;
+			for (iPart p = editor->parts()->begin(); p != editor->parts()->end(); ++p)
 			{
-				Event e = i->second;
-				if (e.isNote())
+				parts.insert(p->second);
+				updatePartItems(p->second);
+			}
+			for (QHash<Part*, PartItems>::iterator i = m_partItems.begin(); i != m_partItems.end();)
+			{
+				if (parts.contains(i.key()))
+					++i;
+				else
 				{
-					addItem(part, e);
+					dropPartItems(i.value());
+					i = m_partItems.erase(i);
 				}
 			}
 		}
+		m_itemsRevision = _items.revision();
 	}
 
 	Event event;
@@ -247,6 +285,171 @@ void EventCanvas::songChanged(int flags)/*{{{*/
 	redraw();
 }/*}}}*/
 
+//---------------------------------------------------------
+//   touchesItems
+//    true if the change may have added, removed or changed
+//    a note of one of the editor's parts
+//---------------------------------------------------------
+
+bool EventCanvas::touchesItems(const SongChange& change)
+{
+	if (!change.allEvents())
+		return true;
+	bool notes = false;
+	foreach(const Event& e, change.events())
+	{
+		if (e.isNote())
+		{
+			notes = true;
+			break;
+		}
+	}
+	if (!notes)
+		return false;
+	for (iPart p = editor->parts()->begin(); p != editor->parts()->end(); ++p)
+	{
+		if (change.touchesPart(p->second->sn()))
+			return true;
+	}
+	return false;
+}
+
+//---------------------------------------------------------
+//   rebuildItems
+//---------------------------------------------------------
+
+void EventCanvas::rebuildItems()
+{
+	_items.clear();
+	m_partItems.clear();
+	m_modelItems.clear();
+	for (iPart p = editor->parts()->begin(); p != editor->parts()->end(); ++p)
+		updatePartItems(p->second);
+}
+
+//---------------------------------------------------------
+//   updatePartItems
+//    brings the items of part up to date with its events
+//---------------------------------------------------------
+
+void EventCanvas::updatePartItems(Part* part)
+{
+	EventList* el = part->events();
+	int revision = el->revision();
+	QHash<Part*, PartItems>::iterator pi = m_partItems.find(part);
+	if (pi == m_partItems.end())
+	{
+		PartItems pitems;
+		pitems.events = el;
+		pitems.revision = -1;
+		pitems.tick = part->tick();
+		pi = m_partItems.insert(part, pitems);
+	}
+	PartItems& pitems = pi.value();
+	if (pitems.events == el && pitems.revision == revision && pitems.tick == part->tick())
+		return;
+
+	ItemRefMap old;
+	if (pitems.events == el && pitems.tick == part->tick())
+		old.swap(pitems.items);
+	else
+	{
+		// moved or given another list, no item can be kept
+		dropPartItems(pitems);
+		pitems.events = el;
+		pitems.tick = part->tick();
+	}
+	pitems.revision = revision;
+
+	for (iEvent i = el->begin(); i != el->end(); ++i)
+	{
+		Event e = i->second;
+		if (!e.isNote())
+			continue;
+		bool kept = false;
+		std::pair<ItemRefMap::iterator, ItemRefMap::iterator> range = old.equal_range(e.tick());
+		for (ItemRefMap::iterator r = range.first; r != range.second; ++r)
+		{
+			const ItemRef& ref = r->second;
+			CItem* ci = ref.item;
+			// same event, and neither it nor its item was changed in place
+			if (ci->event() == e && ci->part() == part && !ci->isMoving() && ci->bbox() == ref.bbox
+					&& e.pitch() == ref.pitch && e.lenTick() == ref.len)
+			{
+				pitems.items.insert(*r);
+				old.erase(r);
+				kept = true;
+				break;
+			}
+		}
+		if (!kept)
+			addPartItem(pitems, part, e);
+	}
+
+	for (ItemRefMap::iterator r = old.begin(); r != old.end(); ++r)
+	{
+		_items.remove(r->second.item, r->second.bbox.x());
+		m_modelItems.remove(r->second.item);
+	}
+}
+
+//---------------------------------------------------------
+//   addPartItem
+//---------------------------------------------------------
+
+void EventCanvas::addPartItem(PartItems& pitems, Part* part, Event& event)
+{
+	CItem* ci = addItem(part, event);
+	if (!ci)
+		return;
+	ItemRef ref;
+	ref.item = ci;
+	ref.bbox = ci->bbox();
+	ref.pitch = event.pitch();
+	ref.len = event.lenTick();
+	pitems.items.insert(std::make_pair(event.tick(), ref));
+	m_modelItems.insert(ci);
+}
+
+//---------------------------------------------------------
+//   dropPartItems
+//---------------------------------------------------------
+
+void EventCanvas::dropPartItems(PartItems& pitems)
+{
+	for (ItemRefMap::iterator r = pitems.items.begin(); r != pitems.items.end(); ++r)
+	{
+		_items.remove(r->second.item, r->second.bbox.x());
+		m_modelItems.remove(r->second.item);
+	}
+	pitems.items.clear();
+}
+
+//---------------------------------------------------------
+//   removeForeignItems
+//    Items added to _items directly while editing (a note
+//    being drawn, multi part copies) stand in for events
+//    that are about to be added. The model makes its own
+//    items for those, so the stand-ins go.
+//---------------------------------------------------------
+
+void EventCanvas::removeForeignItems()
+{
+	if (_items.revision() == m_itemsRevision)
+		return;
+	QList<CItem*> foreign;
+	QSet<CItem*> seen;
+	for (iCItem i = _items.begin(); i != _items.end(); ++i)
+	{
+		// model items added a second time count as foreign too
+		if (!m_modelItems.contains(i->second) || seen.contains(i->second))
+			foreign.append(i->second);
+		seen.insert(i->second);
+	}
+	foreach(CItem* ci, foreign)
+		_items.remove(ci);
+}
+
 //---------------------------------------------------------
 //   selectAtTick
 //---------------------------------------------------------
@@ -11,14 +11,18 @@
 
 #include "canvas.h"
 #include "noteinfo.h"
+#include "songchange.h"
 #include <QEvent>
 #include <QKeyEvent>
+#include <QHash>
 #include <QList>
+#include <QSet>
 
 class MidiPart;
 class MidiTrack;
 class AbstractMidiEditor;
 class Part;
+class EventList;
 class QMimeData;
 class QDrag;
 class QString;
@@ -45,6 +49,44 @@ class EventCanvas : public Canvas
     Q_OBJECT
 
 	QList<CItem*> m_tempPlayItems;
+
+    //---------------------------------------------------------
+    //   item model
+    //    The items of every part together with the event
+    //    list revision they were made from. songChanged()
+    //    only revisits parts whose list has changed and only
+    //    replaces the items of events that were added,
+    //    removed or changed.
+    //---------------------------------------------------------
+
+    struct ItemRef
+    {
+        CItem* item;
+        QRect bbox;      // item geometry when it was made
+        int pitch;
+        unsigned len;
+    };
+    typedef std::multimap<unsigned, ItemRef> ItemRefMap; // by event tick
+
+    struct PartItems
+    {
+        const EventList* events;
+        int revision;
+        unsigned tick;
+        ItemRefMap items;
+    };
+
+    QHash<Part*, PartItems> m_partItems;
+    QSet<CItem*> m_modelItems;  // every item in m_partItems
+    int m_itemsRevision;        // _items.revision() after the last update
+
+    void rebuildItems();
+    void updatePartItems(Part*);
+    void addPartItem(PartItems&, Part*, Event&);
+    void dropPartItems(PartItems&);
+    void removeForeignItems();
+    bool touchesItems(const SongChange&);
+
     virtual void leaveEvent(QEvent*e);
     virtual void enterEvent(QEvent*e);
 
@@ -65,7 +107,7 @@ protected:
     void updateSelection();
     CItem* getRightMostSelected();
     CItem* getLeftMostSelected();
-    virtual void addItem(Part*, Event&) = 0;
+    virtual CItem* addItem(Part*, Event&) = 0; // returns the new item or 0
     // Added by T356.
     virtual QPoint raster(const QPoint&) const;
     virtual void viewMousePressEvent(QMouseEvent* event);
@@ -128,6 +170,7 @@ public:
     }
     QString getCaption() const;
     void songChanged(int);
+    void songChanged(const SongChange&);
 
     void range(int* s, int* e) const
     {
@@ -449,7 +449,7 @@ Performer::Performer(PartList* pl, QWidget* parent, const char* name, unsigned i
 
     connect(editTools, SIGNAL(toolChanged(int)), canvas, SLOT(setTool(int)));
 
-	connect(noteAlphaAction, SIGNAL(toggled(bool)), canvas, SLOT(update()));
+	connect(noteAlphaAction, SIGNAL(toggled(bool)), canvas, SLOT(invalidateContent()));
 	connect(pcbar, SIGNAL(drawSelectedProgram(int, bool)), canvas, SLOT(drawSelectedProgram(int, bool)));
     
 	connect(ctrl, SIGNAL(clicked()), SLOT(ctrlPopup()));
@@ -512,12 +512,12 @@ Performer::Performer(PartList* pl, QWidget* parent, const char* name, unsigned i
     canvas->setYPos(KH * 30);
     vscroll->setPos(KH * 30);
     info->enableTools(false);
-	connect(info, SIGNAL(alphaChanged()), canvas, SLOT(update()));
+	connect(info, SIGNAL(alphaChanged()), canvas, SLOT(invalidateContent()));
 
-    connect(song, SIGNAL(songChanged(int)), SLOT(songChanged1(int)));
-    connect(song, SIGNAL(punchinChanged(bool)), canvas, SLOT(update()));
-    connect(song, SIGNAL(punchoutChanged(bool)), canvas, SLOT(update()));
-    connect(song, SIGNAL(loopChanged(bool)), canvas, SLOT(update()));
+    song->subscribe(this, SLOT(songChanged1(const SongChange&)));
+    connect(song, SIGNAL(punchinChanged(bool)), canvas, SLOT(invalidateContent()));
+    connect(song, SIGNAL(punchoutChanged(bool)), canvas, SLOT(invalidateContent()));
+    connect(song, SIGNAL(loopChanged(bool)), canvas, SLOT(invalidateContent()));
 
     setWindowTitle("The Performer:     " + canvas->getCaption());
 
@@ -1570,8 +1570,9 @@ void Performer::setCurCanvasPart(Part* part)
 //   songChanged1
 //---------------------------------------------------------
 
-void Performer::songChanged1(int bits)/*{{{*/
+void Performer::songChanged1(const SongChange& change)/*{{{*/
 {
+	int bits = change.flags();
 
 	//if (bits & SC_SOLO)
 	//{
@@ -1580,7 +1581,7 @@ void Performer::songChanged1(int bits)/*{{{*/
 		m_soloAction->blockSignals(false);
 	//	return;
 	//}
-	songChanged(bits);
+	songChanged(change);
 	//midiConductor->songChanged(bits);
 	// We'll receive SC_SELECTION if a different part is selected.
 	if (bits & SC_SELECTION)
@@ -1967,7 +1968,7 @@ void Performer::updateCanvas()/*{{{*/
 		if(edit)
 			edit->updateCanvas();
 	}
-	canvas->update();
+	canvas->invalidateContent();
 }/*}}}*/
 
 //---------------------------------------------------------
@@ -2718,7 +2719,7 @@ void Performer::setKeyBindings(Patch* p)/*{{{*/
 		if(debugMsg)
 			printf("Debug: Updating patch - keys: %d, switches: %d\n", p->keys.size(), p->keyswitches.size());
 		piano->setMIDIKeyBindings(p->keys, p->keyswitches);
-		canvas->update();
+		canvas->invalidateContent();
 	//}
 }/*}}}*/
 
@@ -254,7 +254,7 @@ private slots:
     void setTime(unsigned);
     void setTimeFromSig(unsigned);
     void follow(int pos);
-    void songChanged1(int);
+    void songChanged1(const SongChange&);
     void configChanged();
     void updateConductor();
 	void dockAreaChanged(Qt::DockWidgetArea);
@@ -67,12 +67,12 @@ PerformerCanvas::PerformerCanvas(AbstractMidiEditor* pr, QWidget* parent, int sx
 //   addItem
 //---------------------------------------------------------
 
-void PerformerCanvas::addItem(Part* part, Event& event)
+CItem* PerformerCanvas::addItem(Part* part, Event& event)
 {
 	if (signed(event.tick()) < 0)
 	{
 		printf("ERROR: trying to add event before current part!\n");
-		return;
+		return 0;
 	}
 
 	NEvent* ev = new NEvent(event, part, pitch2y(event.pitch()));
@@ -89,6 +89,7 @@ void PerformerCanvas::addItem(Part* part, Event& event)
 		int endTick = song->roundUpBar(part->lenTick() + diff);
 		part->setLenTick(endTick + (editor->rasterStep(endTick)*2));
 	}
+	return ev;
 }
 
 //---------------------------------------------------------
@@ -135,7 +136,7 @@ int PerformerCanvas::y2pitch(int y) const
 void PerformerCanvas::toggleComments(bool state)
 {
 	m_showcomments = state;
-	update();
+	invalidateContent();
 }
 
 void PerformerCanvas::drawOverlay(QPainter&, const QRect&)
@@ -1976,7 +1977,7 @@ void PerformerCanvas::midiNote(int pitch, int velo)/*{{{*/
 		}
 	}
 
-	update();
+	invalidateContent();
 	
 	//TODO: emit a signal to flash keyboard here
 	emit pitchChanged(pitch);
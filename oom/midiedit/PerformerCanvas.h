@@ -70,7 +70,7 @@ class PerformerCanvas : public EventCanvas
     virtual void dragMoveEvent(QDragMoveEvent*);
     virtual void dragLeaveEvent(QDragLeaveEvent*);
     virtual void selectLasso(bool toggle);
-    virtual void addItem(Part*, Event&);
+    virtual CItem* addItem(Part*, Event&);
 
     int y2pitch(int) const;
     int pitch2y(int) const;
@@ -0,0 +1,134 @@
+//=========================================================
+//  OOMidi
+//  OpenOctave Midi and Audio Editor
+//=========================================================
+
+#include <algorithm>
+#include <QList>
+
+#include "midieventstore.h"
+
+QAtomicPointer<MidiEventStore> MidiEventStore::s_retired;
+
+//---------------------------------------------------------
+//   retired stores being aged by collectGarbage(),
+//   gui thread only
+//---------------------------------------------------------
+
+struct RetiredStore
+{
+    MidiEventStore* store;
+    int age;
+};
+
+static QList<RetiredStore> retiredStores;
+
+//---------------------------------------------------------
+//   MidiEventStore
+//---------------------------------------------------------
+
+MidiEventStore::MidiEventStore(const EventList* el, int revision)
+{
+    m_ref.storeRelease(1);
+    m_revision = revision;
+    m_nextRetired = 0;
+
+    size_t n = el->size();
+    m_tick.reserve(n);
+    m_len.reserve(n);
+    m_a.reserve(n);
+    m_b.reserve(n);
+    m_c.reserve(n);
+    m_type.reserve(n);
+
+    for (ciEvent i = el->begin(); i != el->end(); ++i)
+    {
+        const Event& e = i->second;
+        EventType t = e.type();
+        m_tick.push_back(i->first);
+        m_type.push_back((unsigned char)t);
+        if (t == Sysex || t == Meta)
+        {
+            m_len.push_back(0);
+            m_a.push_back((int)m_side.size());
+            m_b.push_back(0);
+            m_c.push_back(0);
+            m_side.push_back(e);
+        }
+        else
+        {
+            m_len.push_back(t == Note ? e.lenTick() : 0);
+            m_a.push_back(e.dataA());
+            m_b.push_back(e.dataB());
+            m_c.push_back(t == Note ? e.dataC() : 0);
+        }
+    }
+}
+
+//---------------------------------------------------------
+//   deref
+//    The last reference pushes the store onto s_retired.
+//    collectGarbage() only ever takes the whole list, so
+//    the push needs no lock.
+//---------------------------------------------------------
+
+void MidiEventStore::deref()
+{
+    if (m_ref.deref())
+        return;
+    MidiEventStore* head;
+    do
+    {
+        head = s_retired.loadAcquire();
+        m_nextRetired = head;
+    } while (!s_retired.testAndSetOrdered(head, this));
+}
+
+//---------------------------------------------------------
+//   bytes
+//---------------------------------------------------------
+
+size_t MidiEventStore::bytes() const
+{
+    return m_tick.capacity() * sizeof(unsigned) + m_len.capacity() * sizeof(unsigned)
+            + (m_a.capacity() + m_b.capacity() + m_c.capacity()) * sizeof(int)
+            + m_type.capacity() + m_side.capacity() * sizeof(Event);
+}
+
+//---------------------------------------------------------
+//   lowerBound
+//---------------------------------------------------------
+
+int MidiEventStore::lowerBound(unsigned tick) const
+{
+    return int(std::lower_bound(m_tick.begin(), m_tick.end(), tick) - m_tick.begin());
+}
+
+//---------------------------------------------------------
+//   collectGarbage
+//    called once per heartbeat. A store retired two beats
+//    ago can no longer be in use by the audio thread.
+//---------------------------------------------------------
+
+void MidiEventStore::collectGarbage()
+{
+    MidiEventStore* s = s_retired.fetchAndStoreOrdered(0);
+    while (s)
+    {
+        RetiredStore r;
+        r.store = s;
+        r.age = 0;
+        retiredStores.append(r);
+        s = s->m_nextRetired;
+    }
+    for (int i = 0; i < retiredStores.size();)
+    {
+        if (++retiredStores[i].age > 2)
+        {
+            delete retiredStores[i].store;
+            retiredStores.removeAt(i);
+        }
+        else
+            ++i;
+    }
+}
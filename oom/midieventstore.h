@@ -0,0 +1,146 @@
+//=========================================================
+//  OOMidi
+//  OpenOctave Midi and Audio Editor
+//
+//  compact struct of arrays copy of a midi EventList
+//=========================================================
+
+#ifndef __MIDIEVENTSTORE_H__
+#define __MIDIEVENTSTORE_H__
+
+#include <vector>
+#include <QAtomicInt>
+#include <QAtomicPointer>
+
+#include "event.h"
+
+//---------------------------------------------------------
+//   MidiEventView
+//    flat view of one midi event, filled either from a
+//    MidiEventStore or from an Event. event is only set for
+//    sysex and meta events when coming from a store.
+//---------------------------------------------------------
+
+struct MidiEventView
+{
+    EventType type;
+    unsigned tick;
+    unsigned lenTick;
+    int a, b, c;
+    const Event* event;
+
+    void set(const Event& e)
+    {
+        type = e.type();
+        tick = e.tick();
+        lenTick = e.lenTick();
+        a = e.dataA();
+        b = e.dataB();
+        c = e.dataC();
+        event = &e;
+    }
+};
+
+//---------------------------------------------------------
+//   MidiEventStore
+//    Immutable, tick sorted arrays built from an EventList
+//    by the gui thread and read by the audio thread.
+//
+//    This is a read copy next to the map, which stays the
+//    list editors work on. It costs bytes() on top of the
+//    map, 21 bytes per event plus an Event handle for each
+//    sysex and meta, and is only built for lists of at
+//    least MIN_EVENTS events where walking the map costs.
+//
+//    Stores are reference counted so copies of an EventList
+//    share them until either list changes. Stores which are
+//    no longer current are not deleted at once but retired
+//    and freed by collectGarbage() a few heartbeats later,
+//    when no audio cycle can still be reading them.
+//---------------------------------------------------------
+
+class MidiEventStore
+{
+    QAtomicInt m_ref;
+    int m_revision; // EventList revision this was built from
+    MidiEventStore* m_nextRetired;
+
+    std::vector<unsigned> m_tick;
+    std::vector<unsigned> m_len;
+    std::vector<int> m_a;
+    std::vector<int> m_b;
+    std::vector<int> m_c;
+    std::vector<unsigned char> m_type;
+    std::vector<Event> m_side; // sysex and meta, indexed by m_a
+
+    // retired stores not yet seen by collectGarbage()
+    static QAtomicPointer<MidiEventStore> s_retired;
+
+    MidiEventStore(const MidiEventStore&);
+    MidiEventStore& operator=(const MidiEventStore&);
+
+public:
+    enum { MIN_EVENTS = 64 };
+
+    MidiEventStore(const EventList* el, int revision);
+
+    void ref()
+    {
+        m_ref.ref();
+    }
+    // drops a reference, the last one retires the store.
+    // May be called from any thread.
+    void deref();
+
+    int revision() const
+    {
+        return m_revision;
+    }
+
+    //! memory held by the arrays
+    size_t bytes() const;
+
+    int size() const
+    {
+        return (int)m_tick.size();
+    }
+
+    // index of the first event at or after tick
+    int lowerBound(unsigned tick) const;
+
+    unsigned tick(int i) const
+    {
+        return m_tick[i];
+    }
+
+    EventType type(int i) const
+    {
+        return EventType(m_type[i]);
+    }
+
+    void view(int i, MidiEventView& v) const
+    {
+        v.type = EventType(m_type[i]);
+        v.tick = m_tick[i];
+        v.lenTick = m_len[i];
+        if (v.type == Sysex || v.type == Meta)
+        {
+            const Event& e = m_side[m_a[i]];
+            v.a = e.dataA();
+            v.b = e.dataB();
+            v.c = e.dataC();
+            v.event = &e;
+        }
+        else
+        {
+            v.a = m_a[i];
+            v.b = m_b[i];
+            v.c = m_c[i];
+            v.event = 0;
+        }
+    }
+
+    static void collectGarbage();
+};
+
+#endif
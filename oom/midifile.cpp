@@ -9,6 +9,13 @@
 #include <errno.h>
 #include <values.h>
 #include <assert.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <vector>
+
+#include <QByteArray>
+#include <QRunnable>
+#include <QThreadPool>
 
 #include "song.h"
 #include "midi.h"
@@ -60,7 +67,6 @@ QString MidiFile::error()
 MidiFile::MidiFile(FILE* f)
 {
 	fp = f;
-	curPos = 0;
 	_mtype = MT_UNKNOWN;
 	_error = MF_NO_ERROR;
 	_tracks = new MidiFileTrackList;
@@ -71,30 +77,6 @@ MidiFile::~MidiFile()
 	delete _tracks;
 }
 
-//---------------------------------------------------------
-//   read
-//    return true on error
-//---------------------------------------------------------
-
-bool MidiFile::read(void* p, size_t len)
-{
-	for (;;)
-	{
-		curPos += len;
-		size_t rv = fread(p, 1, len, fp);
-		if (rv == len)
-			return false;
-		if (feof(fp))
-		{
-			_error = MF_EOF;
-			return true;
-		}
-		_error = MF_READ;
-		return true;
-	}
-	return false;
-}
-
 //---------------------------------------------------------
 //   write
 //    return true on error
@@ -131,39 +113,106 @@ bool MidiFile::writeLong(int i)
 	return write(&format, 4);
 }
 
+/*---------------------------------------------------------
+ *    putvl
+ *    Write variable-length number (7 bits per byte, MSB first)
+ *---------------------------------------------------------*/
+
+void MidiFile::putvl(unsigned val)
+{
+	unsigned long buf = val & 0x7f;
+	while ((val >>= 7) > 0)
+	{
+		buf <<= 8;
+		buf |= 0x80;
+		buf += (val & 0x7f);
+	}
+	for (;;)
+	{
+		put(buf);
+		if (buf & 0x80)
+			buf >>= 8;
+		else
+			break;
+	}
+}
+
 //---------------------------------------------------------
-//   readShort
+//   beShort
+//   beLong
+//    big endian values of the file image
 //---------------------------------------------------------
 
-int MidiFile::readShort()
+static inline unsigned beShort(const uchar* p)
+{
+	return (p[0] << 8) | p[1];
+}
+
+static inline unsigned beLong(const uchar* p)
 {
-	short format;
-	read(&format, 2);
-	return BE_SHORT(format);
+	return (unsigned(p[0]) << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
 }
 
 //---------------------------------------------------------
-//   readLong
-//   writeLong
+//   MidiFileTrackReader
+//    Decodes one MTrk chunk from the file image in memory.
+//    Readers share no state, so all chunks of a file are
+//    decoded in parallel into plain arrays. Song type hints
+//    from sysex messages depend on the order of the whole
+//    file, they are recorded here and applied by
+//    MidiFile::read().
 //---------------------------------------------------------
 
-int MidiFile::readLong()
+class MidiFileTrackReader : public QRunnable
 {
-	int format;
-	read(&format, 4);
-	return BE_LONG(format);
-}
+	const uchar* _p;
+	const uchar* _end;
+	int _readError;
+	int status, sstatus, click;
+	int lastport, lastchannel;
+
+	bool read(void*, size_t);
+	int getvl();
+	int readEvent(MidiPlayEvent*);
+
+public:
+	enum SysexHint { GM_ON, GS_ON, XG_ON, ROLAND, YAMAHA };
+
+	std::vector<MidiPlayEvent> events;
+	std::vector<int> hints;
+	bool isDrumTrack;
+	bool failed;
+	int error;
+
+	MidiFileTrackReader(const uchar* p, const uchar* end)
+	{
+		_p = p;
+		_end = end;
+		_readError = MF_NO_ERROR;
+		isDrumTrack = false;
+		failed = false;
+		error = MF_NO_ERROR;
+		setAutoDelete(false);
+	}
+	virtual void run();
+};
 
-/*---------------------------------------------------------
- *    skip
- *    This is meant for skipping a few bytes in a
- *    file or fifo.
- *---------------------------------------------------------*/
+//---------------------------------------------------------
+//   read
+//    return true on error
+//---------------------------------------------------------
 
-bool MidiFile::skip(size_t len)
+bool MidiFileTrackReader::read(void* p, size_t len)
 {
-	char tmp[len];
-	return read(tmp, len);
+	if (size_t(_end - _p) < len)
+	{
+		_p = _end;
+		_readError = MF_EOF;
+		return true;
+	}
+	memcpy(p, _p, len);
+	_p += len;
+	return false;
 }
 
 /*---------------------------------------------------------
@@ -171,14 +220,17 @@ bool MidiFile::skip(size_t len)
  *    Read variable-length number (7 bits per byte, MSB first)
  *---------------------------------------------------------*/
 
-int MidiFile::getvl()
+int MidiFileTrackReader::getvl()
 {
 	int l = 0;
 	for (int i = 0; i < 16; i++)
 	{
-		uchar c;
-		if (read(&c, 1))
+		if (_p == _end)
+		{
+			_readError = MF_EOF;
 			return -1;
+		}
+		uchar c = *_p++;
 		l += (c & 0x7f);
 		if (!(c & 0x80))
 			return l;
@@ -187,48 +239,13 @@ int MidiFile::getvl()
 	return -1;
 }
 
-/*---------------------------------------------------------
- *    putvl
- *    Write variable-length number (7 bits per byte, MSB first)
- *---------------------------------------------------------*/
-
-void MidiFile::putvl(unsigned val)
-{
-	unsigned long buf = val & 0x7f;
-	while ((val >>= 7) > 0)
-	{
-		buf <<= 8;
-		buf |= 0x80;
-		buf += (val & 0x7f);
-	}
-	for (;;)
-	{
-		put(buf);
-		if (buf & 0x80)
-			buf >>= 8;
-		else
-			break;
-	}
-}
-
 //---------------------------------------------------------
-//   readTrack
-//    return true on error
+//   run
+//    decode the chunk, events are in file order
 //---------------------------------------------------------
 
-bool MidiFile::readTrack(MidiFileTrack* t)
+void MidiFileTrackReader::run()
 {
-	MPEventList* el = &(t->events);
-	char tmp[4];
-	if (read(tmp, 4))
-		return true;
-	if (memcmp(tmp, "MTrk", 4))
-	{
-		_error = MF_MTRK;
-		return true;
-	}
-	int len = readLong(); // len
-	int endPos = curPos + len;
 	status = -1;
 	sstatus = -1; // running status, not reset scanning meta or sysex
 	click = 0;
@@ -236,13 +253,14 @@ bool MidiFile::readTrack(MidiFileTrack* t)
 	int port = 0;
 	int channel = 0;
 
+	events.reserve((_end - _p) / 3);
 	for (;;)
 	{
 		MidiPlayEvent event;
 		lastport = -1;
 		lastchannel = -1;
 
-		int rv = readEvent(&event, t);
+		int rv = readEvent(&event);
 		if (lastport != -1)
 		{
 			port = lastport;
@@ -266,24 +284,21 @@ bool MidiFile::readTrack(MidiFileTrack* t)
 		else if (rv == -1)
 			continue;
 		else if (rv == -2) // error
-			return true;
+		{
+			failed = true;
+			error = _readError;
+			return;
+		}
 
 		event.setPort(port);
 		if (event.type() == ME_SYSEX || event.type() == ME_META)
 			event.setChannel(channel);
 		else
 			channel = event.channel();
-		el->add(event);
+		events.push_back(event);
 	}
-	int end = curPos;
-	if (end != endPos)
-	{
-		printf("MidiFile::readTrack(): TRACKLEN does not fit %d+%d != %d, %d too much\n",
-				endPos - len, len, end, endPos - end);
-		if (end < endPos)
-			skip(endPos - end);
-	}
-	return false;
+	if (_p != _end)
+		printf("MidiFileTrackReader: TRACKLEN does not fit, %d bytes after end of track\n", int(_end - _p));
 }
 
 //---------------------------------------------------------
@@ -294,7 +309,7 @@ bool MidiFile::readTrack(MidiFileTrack* t)
 //          -2    Error
 //---------------------------------------------------------
 
-int MidiFile::readEvent(MidiPlayEvent* event, MidiFileTrack* t)
+int MidiFileTrackReader::readEvent(MidiPlayEvent* event)
 {
 	uchar me, type, a, b;
 
@@ -354,28 +369,26 @@ int MidiFile::readEvent(MidiPlayEvent* event, MidiFileTrack* t)
 			event->setData(buffer, len);
 			if (((unsigned) len == gmOnMsgLen) && memcmp(buffer, gmOnMsg, gmOnMsgLen) == 0)
 			{
-				setMType(MT_GM);
+				hints.push_back(GM_ON);
 				return -1;
 			}
 			if (((unsigned) len == gsOnMsgLen) && memcmp(buffer, gsOnMsg, gsOnMsgLen) == 0)
 			{
-				setMType(MT_GS);
+				hints.push_back(GS_ON);
 				return -1;
 			}
 			if (((unsigned) len == xgOnMsgLen) && memcmp(buffer, xgOnMsg, xgOnMsgLen) == 0)
 			{
-				setMType(MT_XG);
+				hints.push_back(XG_ON);
 				return -1;
 			}
 			if (buffer[0] == 0x41)
 			{ // Roland
-				if (mtype() != MT_UNKNOWN)
-					setMType(MT_GS);
+				hints.push_back(ROLAND);
 			}
 			else if (buffer[0] == 0x43)
 			{ // Yamaha
-				if (mtype() == MT_UNKNOWN || mtype() == MT_GM)
-					setMType(MT_XG);
+				hints.push_back(YAMAHA);
 				int type = buffer[1] & 0xf0;
 				switch (type)
 				{
@@ -398,7 +411,7 @@ int MidiFile::readEvent(MidiPlayEvent* event, MidiFileTrack* t)
 							// 5 - DRUM 4
 							printf("xg set part mode channel %d to %d\n", buffer[4] + 1, buffer[6]);
 							if (buffer[6] != 0)
-								t->isDrumTrack = true;
+								isDrumTrack = true;
 						}
 						break;
 					case 0x20:
@@ -685,49 +698,178 @@ bool MidiFile::write()
 bool MidiFile::read()
 {
 	_error = MF_NO_ERROR;
-	int i;
-	char tmp[4];
 
-	if (read(tmp, 4))
+	// Regular files are mapped, compressed files come
+	// through a pipe and are read into memory first.
+	uchar* map = 0;
+	size_t mapLen = 0;
+	const uchar* data = 0;
+	size_t size = 0;
+	QByteArray buffer;
+
+	struct stat st;
+	long offset = ftell(fp);
+	if (offset >= 0 && fstat(fileno(fp), &st) == 0 && S_ISREG(st.st_mode) && st.st_size > offset)
+	{
+		void* m = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fileno(fp), 0);
+		if (m != MAP_FAILED)
+		{
+			map = (uchar*) m;
+			mapLen = st.st_size;
+			data = map + offset;
+			size = mapLen - offset;
+		}
+	}
+	if (!map)
+	{
+		char tmp[65536];
+		size_t n;
+		while ((n = fread(tmp, 1, sizeof(tmp), fp)) > 0)
+			buffer.append(tmp, n);
+		if (ferror(fp))
+		{
+			_error = MF_READ;
+			return true;
+		}
+		data = (const uchar*) buffer.constData();
+		size = buffer.size();
+	}
+
+	bool rv = read(data, size);
+	if (map)
+		munmap(map, mapLen);
+	return rv;
+}
+
+//---------------------------------------------------------
+//   read
+//    parse a file image. The track chunks are located
+//    first, decoded in parallel and merged in file order.
+//    returns true on error
+//---------------------------------------------------------
+
+bool MidiFile::read(const uchar* data, size_t size)
+{
+	const uchar* p = data;
+	const uchar* end = data + size;
+
+	if (size < 14)
+	{
+		_error = MF_EOF;
 		return true;
-	int len = readLong();
-	if (memcmp(tmp, "MThd", 4) || len < 6)
+	}
+	unsigned len = beLong(p + 4);
+	if (memcmp(p, "MThd", 4) || len < 6)
 	{
 		_error = MF_MTHD;
 		return true;
 	}
-	format = readShort();
-	ntracks = readShort();
-	_division = readShort();
+	format = beShort(p + 8);
+	ntracks = beShort(p + 10);
+	_division = short(beShort(p + 12));
 
 	if (_division < 0)
 		_division = (-(_division / 256)) * (_division & 0xff);
-	if (len > 6)
-		skip(len - 6); // skip excess bytes
+	p += 8 + qMin(size_t(len), size - 8); // skip excess bytes
 
+	int n;
 	switch (format)
 	{
 		case 0:
-		{
-			MidiFileTrack* t = new MidiFileTrack;
-			_tracks->push_back(t);
-			if (readTrack(t))
-				return true;
-		}
+			n = 1;
 			break;
 		case 1:
-			for (i = 0; i < ntracks; i++)
-			{
-				MidiFileTrack* t = new MidiFileTrack;
-				_tracks->push_back(t);
-				if (readTrack(t))
-					return true;
-			}
+			n = ntracks;
 			break;
 		default:
 			_error = MF_FORMAT;
 			return true;
 	}
-	return false;
-}
 
+	std::vector<MidiFileTrackReader*> readers;
+	int chunkError = MF_NO_ERROR;
+	for (int i = 0; i < n; ++i)
+	{
+		if (end - p < 8)
+		{
+			chunkError = MF_EOF;
+			break;
+		}
+		if (memcmp(p, "MTrk", 4))
+		{
+			chunkError = MF_MTRK;
+			break;
+		}
+		size_t tlen = beLong(p + 4);
+		p += 8;
+		const uchar* tend = tlen > size_t(end - p) ? end : p + tlen;
+		readers.push_back(new MidiFileTrackReader(p, tend));
+		p = tend;
+	}
+
+	if (readers.size() > 1)
+	{
+		QThreadPool pool;
+		for (size_t i = 0; i < readers.size(); ++i)
+			pool.start(readers[i]);
+		pool.waitForDone();
+	}
+	else if (readers.size() == 1)
+		readers[0]->run();
+
+	bool rv = false;
+	for (size_t i = 0; i < readers.size(); ++i)
+	{
+		MidiFileTrackReader* r = readers[i];
+		if (rv)
+		{
+			delete r;
+			continue;
+		}
+		MidiFileTrack* t = new MidiFileTrack;
+		_tracks->push_back(t);
+		t->isDrumTrack = r->isDrumTrack;
+
+		for (std::vector<int>::const_iterator h = r->hints.begin(); h != r->hints.end(); ++h)
+		{
+			switch (*h)
+			{
+				case MidiFileTrackReader::GM_ON:
+					setMType(MT_GM);
+					break;
+				case MidiFileTrackReader::GS_ON:
+					setMType(MT_GS);
+					break;
+				case MidiFileTrackReader::XG_ON:
+					setMType(MT_XG);
+					break;
+				case MidiFileTrackReader::ROLAND:
+					if (mtype() != MT_UNKNOWN)
+						setMType(MT_GS);
+					break;
+				case MidiFileTrackReader::YAMAHA:
+					if (mtype() == MT_UNKNOWN || mtype() == MT_GM)
+						setMType(MT_XG);
+					break;
+			}
+		}
+
+		// events are in time order, append at the end
+		MPEventList* el = &(t->events);
+		for (std::vector<MidiPlayEvent>::const_iterator e = r->events.begin(); e != r->events.end(); ++e)
+			el->insert(el->end(), *e);
+
+		if (r->failed)
+		{
+			_error = r->error;
+			rv = true;
+		}
+		delete r;
+	}
+	if (!rv && chunkError != MF_NO_ERROR)
+	{
+		_error = chunkError;
+		rv = true;
+	}
+	return rv;
+}
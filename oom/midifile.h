@@ -50,31 +50,21 @@ class MidiFile
     MType _mtype;
     MidiFileTrackList* _tracks;
 
-    int status, click;
-    int sstatus;
-    int lastport, lastchannel;
+    int status; // running status when writing
     FILE* fp;
-    int curPos;
 
-    bool read(void*, size_t);
+    bool read(const unsigned char*, size_t);
     bool write(const void*, size_t);
 
     void put(unsigned char c)
     {
         write(&c, 1);
     }
-    bool skip(size_t);
-    int readShort();
     bool writeShort(int);
-    int readLong();
     bool writeLong(int);
-    int getvl();
     void putvl(unsigned);
 
-    bool readTrack(MidiFileTrack*);
     bool writeTrack(const MidiFileTrack*);
-
-    int readEvent(MidiPlayEvent*, MidiFileTrack*);
     void writeEvent(const MidiPlayEvent*);
 
 public:
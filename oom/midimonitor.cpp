@@ -19,6 +19,9 @@
 #include "midi.h"
 #include "audio.h"
 #include "song.h"
+#include "songchange.h"
+#include "track.h"
+#include "part.h"
 #include "utils.h"
 #include "midimonitor.h"
 #include "ccinfo.h"
@@ -87,6 +90,58 @@ void MidiMonitor::updateLater()
     updateNow = true;
 }
 
+//---------------------------------------------------------
+//   updateLater
+//    a controller event was sent to the song, called in
+//    the monitor thread
+//---------------------------------------------------------
+
+void MidiMonitor::updateLater(MidiTrack* track, unsigned tick, int controller)
+{
+    RecordedController r;
+    r.track = track->id();
+    r.tick = tick;
+    r.controller = controller;
+    m_recordedMutex.lock();
+    m_recorded.append(r);
+    m_recordedMutex.unlock();
+    updateNow = true;
+}
+
+//---------------------------------------------------------
+//   recordedChange
+//    What was recorded since the last update, so the
+//    editors only look at the lanes and parts it touched.
+//    The events are made again from what was sent, they
+//    carry the controller and tick of the real ones.
+//---------------------------------------------------------
+
+SongChange MidiMonitor::recordedChange()
+{
+    QList<RecordedController> recorded;
+    m_recordedMutex.lock();
+    recorded.swap(m_recorded);
+    m_recordedMutex.unlock();
+
+    SongChange change;
+    change.addFlags(SC_EVENT_INSERTED, false);
+    foreach(const RecordedController& r, recorded)
+    {
+        Track* track = song->findTrackById(r.track);
+        if (!track)
+            continue;
+        // the song only takes events that fall into a part
+        Part* part = track->parts()->findAtTick(r.tick);
+        if (!part)
+            continue;
+        Event event(Controller);
+        event.setTick(r.tick - part->tick());
+        event.setA(r.controller);
+        change.addEvent(event, part);
+    }
+    return change;
+}
+
 void MidiMonitor::updateSongNow()
 {
     bool updateEvents;
@@ -155,7 +210,7 @@ void MidiMonitor::updateSongNow()
     if (updateNow)
     {
         updateNow = false;
-        song->update(SC_EVENT_INSERTED);
+        song->update(recordedChange());
     }
 }
 
@@ -255,6 +310,7 @@ void MidiMonitor::deletePreviousMidiInEvents(MidiTrack* track, int controller, u
                     event.setA(controller);
                     event.setB(lastMsg->lastValue);
                     audio->msgAddEventCheck(track, event, false, true, false, false);
+                    updateLater(track, iTick, controller);
                 }
             }
         }
@@ -639,7 +695,7 @@ void MidiMonitor::processMsg1(const void* m)/*{{{*/
                                             audio->msgAddEventCheck(track, event, false, true, false, false);
 
                                             setLastMidiInMessage(track->outPort(), track->outChannel(), mdata.controller, mdata.value, tick);
-                                            updateLater();
+                                            updateLater(track, tick, mdata.controller);
 
 											/*PartList* pl = track->parts();
 											if(pl && !pl->empty())
@@ -701,7 +757,7 @@ void MidiMonitor::processMsg1(const void* m)/*{{{*/
                                             audio->msgAddEventCheck(track, event, false, true, false, false);
 
                                             setLastMidiInMessage(track->outPort(), track->outChannel(), mdata.controller, mdata.value, tick);
-                                            updateLater();
+                                            updateLater(track, tick, mdata.controller);
 
 											/*PartList* pl = track->parts();
 											if(pl && !pl->empty())
@@ -792,7 +848,7 @@ void MidiMonitor::processMsg1(const void* m)/*{{{*/
                                             audio->msgAddEventCheck(track, event, false, true, false, false);
 
                                             setLastMidiInMessage(track->outPort(), track->outChannel(), mdata.controller, mdata.value, tick);
-                                            updateLater();
+                                            updateLater(track, tick, mdata.controller);
 
 											/*PartList* pl = track->parts();
 											if(pl && !pl->empty())
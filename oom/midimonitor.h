@@ -8,6 +8,7 @@
 #include <QHash>
 #include <QMultiHash>
 #include <QList>
+#include <QMutex>
 #include <QTimer>
 
 class Track;
@@ -15,6 +16,7 @@ class MidiTrack;
 class MidiAssignData;
 class QString;
 class CCInfo;
+class SongChange;
 
 enum { 
 	MONITOR_AUDIO_OUT,	//Used to process outgoing midi from audio tracks
@@ -80,6 +82,13 @@ struct LastMidiInMessage
     unsigned lastTick;
 };
 
+struct RecordedController
+{
+    qint64 track;
+    unsigned tick;
+    int controller;
+};
+
 struct LastFeedbackMessage
 {
     int port;
@@ -107,6 +116,9 @@ class MidiMonitor : public Thread
 
     bool updateNow;
     QTimer updateNowTimer;
+    // controllers recorded since the last song update
+    QMutex m_recordedMutex;
+    QList<RecordedController> m_recorded;
 
 	QMultiHash<int, QString> m_inputports;
 	QMultiHash<int, QString> m_outputports;
@@ -121,6 +133,8 @@ class MidiMonitor : public Thread
 	void addMonitoredTrack(Track*);
     void deleteMonitoredTrack(Track*);
     void updateLater();
+    void updateLater(MidiTrack* track, unsigned tick, int controller);
+    SongChange recordedChange();
 
     LastMidiInMessage* getLastMidiInMessage(int controller);
     LastMidiInMessage* getLastMidiInMessage(int port, int channel, int controller);
@@ -0,0 +1,495 @@
+//=========================================================
+//  OOMidi
+//  OpenOctave Midi and Audio Editor
+//
+//  realtime midi recording buffer
+//=========================================================
+
+#include <stdio.h>
+#include <algorithm>
+#include <vector>
+
+#include "midirecordbuffer.h"
+#include "track.h"
+#include "song.h"
+#include "audio.h"
+#include "al/sig.h"
+#include "midi.h"
+#include "midictrl.h"
+#include "midiport.h"
+#include "drummap.h"
+#include "globals.h"
+
+//---------------------------------------------------------
+//   playOrder
+//    events of one cycle are appended per device and
+//    channel, restore time order. Note offs go first so a
+//    retriggered note does not close itself.
+//---------------------------------------------------------
+
+static bool playOrder(const MidiPlayEvent& a, const MidiPlayEvent& b)
+{
+    if (a.time() != b.time())
+        return a.time() < b.time();
+    return a.isNoteOff() && !b.isNoteOff();
+}
+
+//---------------------------------------------------------
+//   MidiRecordBuffer
+//---------------------------------------------------------
+
+MidiRecordBuffer::MidiRecordBuffer()
+: m_free(MAX_POOL)
+{
+    m_wchunk = 0;
+    m_windex = 0;
+    m_count = 0;
+    m_first = 0;
+    m_published.storeRelease(0);
+    m_dropped.storeRelease(0);
+    m_poolSize.storeRelease(POOL_SIZE);
+    m_rchunk = 0;
+    m_rindex = 0;
+    m_read = 0;
+    resetState();
+}
+
+MidiRecordBuffer::~MidiRecordBuffer()
+{
+    clear();
+    QMutexLocker locker(&m_reserveLock);
+    Chunk* c;
+    while (m_free.get(c))
+        delete c;
+}
+
+//---------------------------------------------------------
+//   reserve
+//    Fill the chunk pool of the audio thread. Called when
+//    the track is armed and from the audio recorder thread
+//    while recording.
+//---------------------------------------------------------
+
+void MidiRecordBuffer::reserve()
+{
+    QMutexLocker locker(&m_reserveLock);
+    int size = m_poolSize.loadAcquire();
+    while (m_free.getSize() < size)
+    {
+        Chunk* c = new Chunk;
+        if (m_free.put(c))
+        {
+            delete c;
+            break;
+        }
+    }
+}
+
+//---------------------------------------------------------
+//   resetState
+//---------------------------------------------------------
+
+void MidiRecordBuffer::resetState()
+{
+    m_events.clear();
+    m_origin = 0;
+    m_endTick = 0;
+    for (int i = 0; i < 128; ++i)
+        m_open[i].clear();
+    m_hbank = 0xff;
+    m_lbank = 0xff;
+    m_rpnh = -1;
+    m_rpnl = -1;
+    m_datah = 0;
+    m_datal = 0;
+    m_dataType = 0;
+    m_pendingData = Event();
+}
+
+//---------------------------------------------------------
+//   put
+//    audio thread, returns false if the pool ran dry and
+//    the event was dropped
+//---------------------------------------------------------
+
+bool MidiRecordBuffer::put(const MidiPlayEvent& ev)
+{
+    if (!m_wchunk || m_windex == CHUNK_SIZE)
+    {
+        Chunk* c;
+        if (!m_free.get(c))
+        {
+            m_dropped.ref();
+            return false;
+        }
+        c->next = 0;
+        if (m_wchunk)
+            m_wchunk->next = c;
+        else
+            m_first = c;
+        m_wchunk = c;
+        m_windex = 0;
+    }
+    m_wchunk->events[m_windex++] = ev;
+    ++m_count;
+    return true;
+}
+
+//---------------------------------------------------------
+//   commit
+//    audio thread, end of cycle. Publishes the events put
+//    since the last commit to the gui thread.
+//---------------------------------------------------------
+
+void MidiRecordBuffer::commit()
+{
+    if (m_published.loadAcquire() != m_count)
+        m_published.storeRelease(m_count);
+}
+
+//---------------------------------------------------------
+//   process
+//    gui thread. Converts the events published since the
+//    last call.
+//---------------------------------------------------------
+
+void MidiRecordBuffer::process(MidiTrack* track, unsigned /*curTick*/)
+{
+    int n = m_published.loadAcquire() - m_read;
+    if (n > 0)
+    {
+        // first events of the take, a new part for it
+        // would start here
+        if (m_read == 0)
+            m_origin = AL::sigmap.raster1(audio->getStartRecordPos().tick(), song->composerRaster());
+
+        std::vector<MidiPlayEvent> batch;
+        batch.reserve(n);
+        for (; n; --n)
+        {
+            if (!m_rchunk)
+            {
+                m_rchunk = m_first;
+                m_rindex = 0;
+            }
+            else if (m_rindex == CHUNK_SIZE)
+            {
+                m_rchunk = m_rchunk->next;
+                m_rindex = 0;
+            }
+            batch.push_back(m_rchunk->events[m_rindex++]);
+            ++m_read;
+        }
+        std::stable_sort(batch.begin(), batch.end(), playOrder);
+        for (std::vector<MidiPlayEvent>::const_iterator i = batch.begin(); i != batch.end(); ++i)
+            convert(*i, track);
+    }
+
+    int dropped = m_dropped.fetchAndStoreOrdered(0);
+    if (dropped)
+    {
+        int size = m_poolSize.loadAcquire() * 2;
+        if (size > MAX_POOL)
+            size = MAX_POOL;
+        m_poolSize.storeRelease(size);
+        printf("MidiRecordBuffer: <%s> chunk pool ran dry, %d events dropped, pool raised to %d chunks\n",
+               track->name().toLatin1().constData(), dropped, size);
+    }
+}
+
+//---------------------------------------------------------
+//   heldNotes
+//    gui thread, copies of the notes still held, reaching
+//    up to curTick, for the recording preview
+//---------------------------------------------------------
+
+void MidiRecordBuffer::heldNotes(EventList* el, unsigned curTick) const
+{
+    for (int pitch = 0; pitch < 128; ++pitch)
+    {
+        const QList<OpenNote>& ol = m_open[pitch];
+        for (QList<OpenNote>::const_iterator i = ol.begin(); i != ol.end(); ++i)
+        {
+            Event held = i->event;
+            Event event = held.clone();
+            event.setLenTick(curTick > i->tick ? curTick - i->tick : 1);
+            el->add(event);
+        }
+    }
+}
+
+//---------------------------------------------------------
+//   finish
+//    gui thread, after recording stopped. Notes without
+//    note off are switched off at the end of the measure.
+//---------------------------------------------------------
+
+void MidiRecordBuffer::finish()
+{
+    flushPendingData();
+    for (int pitch = 0; pitch < 128; ++pitch)
+    {
+        QList<OpenNote>& ol = m_open[pitch];
+        for (QList<OpenNote>::iterator i = ol.begin(); i != ol.end(); ++i)
+        {
+            if (debugMsg)
+                printf("-no note-off! %d pitch %d velo %d\n", i->tick, pitch, i->event.velo());
+            unsigned endTick = song->roundUpBar(i->tick + 1);
+            i->event.setLenTick(endTick - i->tick);
+            m_events.add(i->event);
+            if (endTick > m_endTick)
+                m_endTick = endTick;
+        }
+        ol.clear();
+    }
+}
+
+//---------------------------------------------------------
+//   copyTo
+//    gui thread, all published events of the take
+//---------------------------------------------------------
+
+void MidiRecordBuffer::copyTo(MPEventList* el) const
+{
+    int n = m_published.loadAcquire();
+    for (Chunk* c = m_first; c && n; c = c->next)
+    {
+        for (int i = 0; i < CHUNK_SIZE && n; ++i, --n)
+            el->add(c->events[i]);
+    }
+}
+
+//---------------------------------------------------------
+//   copyTo
+//    gui thread, the converted events at song ticks
+//---------------------------------------------------------
+
+void MidiRecordBuffer::copyTo(EventList* el) const
+{
+    for (ciEvent i = m_events.begin(); i != m_events.end(); ++i)
+    {
+        Event event = i->second.clone();
+        event.setTick(i->second.tick() + m_origin);
+        el->add(event);
+    }
+}
+
+//---------------------------------------------------------
+//   clear
+//    gui thread, the audio thread must be idle
+//---------------------------------------------------------
+
+void MidiRecordBuffer::clear()
+{
+    Chunk* c = m_first;
+    while (c)
+    {
+        Chunk* next = c->next;
+        delete c;
+        c = next;
+    }
+    m_first = 0;
+    m_wchunk = 0;
+    m_windex = 0;
+    m_count = 0;
+    m_published.storeRelease(0);
+    m_rchunk = 0;
+    m_rindex = 0;
+    m_read = 0;
+    resetState();
+}
+
+//---------------------------------------------------------
+//   flushPendingData
+//    a CTRL_HDATA which was not followed by CTRL_LDATA is
+//    a 7 bit RPN/NRPN value
+//---------------------------------------------------------
+
+void MidiRecordBuffer::flushPendingData()
+{
+    if (m_pendingData.empty())
+        return;
+    m_events.add(m_pendingData);
+    unsigned tick = m_pendingData.tick() + m_origin;
+    if (tick > m_endTick)
+        m_endTick = tick;
+    m_pendingData = Event();
+}
+
+//---------------------------------------------------------
+//   convert
+//    the streaming counterpart of buildMidiEventList(),
+//    without loop handling
+//---------------------------------------------------------
+
+void MidiRecordBuffer::convert(const MidiPlayEvent& ev, MidiTrack* track)
+{
+    if (!(ev.type() == ME_SYSEX || ev.type() == ME_META || ev.channel() == track->outChannel()))
+        return;
+    if (ev.port() != track->outPort())
+        return;
+
+    // open notes keep song ticks, events get take ticks
+    unsigned tick = ev.time() > m_origin ? ev.time() : m_origin;
+    bool drum = track->type() == Track::DRUM;
+
+    if (ev.type() == ME_CONTROLLER && ev.dataA() != CTRL_LDATA)
+        flushPendingData();
+
+    Event e;
+    switch (ev.type())
+    {
+        case ME_NOTEON:
+        case ME_NOTEOFF:
+        {
+            int pitch = (drum ? drumInmap[ev.dataA()] : ev.dataA()) & 0x7f;
+            QList<OpenNote>& ol = m_open[pitch];
+            if (ev.isNoteOff())
+            {
+                if (ol.isEmpty())
+                {
+                    if (debugMsg)
+                        printf("+extra note-off! %d pitch %d velo %d\n", tick, pitch, ev.dataB());
+                    return;
+                }
+                OpenNote on = ol.takeFirst();
+                on.event.setLenTick(tick > on.tick ? tick - on.tick : 1);
+                if (tick > m_endTick)
+                    m_endTick = tick;
+                on.event.setVeloOff(ev.type() == ME_NOTEOFF ? ev.dataB() : 0);
+                m_events.add(on.event);
+                return;
+            }
+            // enters m_events complete, at its note off
+            e.setType(Note);
+            e.setTick(tick - m_origin);
+            e.setPitch(pitch);
+            e.setVelo(ev.dataB());
+            e.setLenTick(1);
+            OpenNote on;
+            on.event = e;
+            on.tick = tick;
+            ol.append(on);
+        }
+            return;
+
+        case ME_POLYAFTER:
+            e.setType(PAfter);
+            e.setA(ev.dataA());
+            e.setB(ev.dataB());
+            break;
+
+        case ME_CONTROLLER:
+        {
+            int val = ev.dataB();
+            switch (ev.dataA())
+            {
+                case CTRL_HBANK:
+                    m_hbank = val;
+                    break;
+
+                case CTRL_LBANK:
+                    m_lbank = val;
+                    break;
+
+                case CTRL_HDATA:
+                    m_datah = val;
+                    if (m_rpnh == -1 || m_rpnl == -1)
+                    {
+                        if (debugMsg)
+                            printf("parameter number not defined, data 0x%x\n", m_datah);
+                        break;
+                    }
+                    // held back until we know no CTRL_LDATA follows
+                    m_pendingData = Event(Controller);
+                    m_pendingData.setTick(tick - m_origin);
+                    m_pendingData.setA(m_dataType | (m_rpnh << 8) | m_rpnl);
+                    m_pendingData.setB(m_datah);
+                    break;
+
+                case CTRL_LDATA:
+                    m_pendingData = Event();
+                    m_datal = val;
+                    if (m_rpnh == -1 || m_rpnl == -1)
+                    {
+                        if (debugMsg)
+                            printf("parameter number not defined, data 0x%x 0x%x, tick %d, channel %d\n",
+                                    m_datah, m_datal, tick, track->outChannel());
+                        break;
+                    }
+                    // 14 Bit RPN/NRPN
+                    e.setType(Controller);
+                    e.setA((m_dataType + 0x30000) | (m_rpnh << 8) | m_rpnl);
+                    e.setB((m_datah << 7) | m_datal);
+                    break;
+
+                case CTRL_HNRPN:
+                    m_rpnh = val;
+                    m_dataType = 0x30000;
+                    break;
+
+                case CTRL_LNRPN:
+                    m_rpnl = val;
+                    m_dataType = 0x30000;
+                    break;
+
+                case CTRL_HRPN:
+                    m_rpnh = val;
+                    m_dataType = 0x20000;
+                    break;
+
+                case CTRL_LRPN:
+                    m_rpnl = val;
+                    m_dataType = 0x20000;
+                    break;
+
+                default:
+                {
+                    int ctl = ev.dataA();
+                    e.setType(Controller);
+                    e.setA(ctl);
+                    if (drum && midiPorts[track->outPort()].drumController(ctl))
+                        e.setA((ctl & ~0xff) | drumInmap[ctl & 0x7f]);
+                    e.setB(val);
+                }
+                    break;
+            }
+        }
+            break;
+
+        case ME_PROGRAM:
+            e.setType(Controller);
+            e.setA(CTRL_PROGRAM);
+            e.setB((m_hbank << 16) | (m_lbank << 8) | ev.dataA());
+            break;
+
+        case ME_AFTERTOUCH:
+            e.setType(CAfter);
+            e.setA(ev.dataA());
+            break;
+
+        case ME_PITCHBEND:
+            e.setType(Controller);
+            e.setA(CTRL_PITCH);
+            e.setB(ev.dataA());
+            break;
+
+        case ME_SYSEX:
+            e.setType(Sysex);
+            e.setData(ev.data(), ev.len());
+            break;
+
+        // meta events do not come from a live input, they
+        // change song state and are left to buildMidiEventList()
+        case ME_META:
+        default:
+            break;
+    }
+    if (!e.empty())
+    {
+        e.setTick(tick - m_origin);
+        m_events.add(e);
+        if (tick > m_endTick)
+            m_endTick = tick;
+    }
+}
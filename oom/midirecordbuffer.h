@@ -0,0 +1,146 @@
+//=========================================================
+//  OOMidi
+//  OpenOctave Midi and Audio Editor
+//
+//  realtime midi recording buffer
+//=========================================================
+
+#ifndef __MIDIRECORDBUFFER_H__
+#define __MIDIRECORDBUFFER_H__
+
+#include <QAtomicInt>
+#include <QList>
+#include <QMutex>
+
+#include "event.h"
+#include "mpevent.h"
+#include "lockfree.h"
+
+class MidiTrack;
+
+//---------------------------------------------------------
+//   MidiRecordBuffer
+//    Per track store for the events of a midi take.
+//
+//    The audio thread appends to a list of fixed size
+//    chunks taken from a pool, so recording does not
+//    allocate nor insert into a tree in the audio thread.
+//    Appended events become visible to the gui once per
+//    cycle with commit().
+//
+//    The pool holds several seconds of dense input. It is
+//    filled when the track is armed and topped up by the
+//    audio recorder thread while recording. Should it run
+//    dry anyway the audio thread drops the event rather
+//    than allocate, the overrun is reported and the pool
+//    grows for the next top up.
+//
+//    At the gui heartbeat process() turns the new events
+//    into the final Event list: note on/off pairing,
+//    RPN/NRPN and bank state and drum mapping are kept
+//    between calls. A note enters the list at its note
+//    off, while held it stays private to the buffer and
+//    heldNotes() gives copies for the preview. No event
+//    of the list is changed after it was added.
+//    Event ticks are relative to origin(),
+//    the start of the take rounded down to the part
+//    raster, so stopping the take can hand the list over
+//    to a new part as it is, see
+//    Song::cmdAddRecordedTake().
+//
+//    Takes which cycled need the loop number of every
+//    event, those still go through buildMidiEventList()
+//    with copyTo().
+//---------------------------------------------------------
+
+class MidiRecordBuffer
+{
+    // POOL_SIZE chunks take 8192 events, about four seconds
+    // of a saturated usb port
+    enum { CHUNK_SIZE = 256, POOL_SIZE = 32, MAX_POOL = 512 };
+
+    struct Chunk
+    {
+        MidiPlayEvent events[CHUNK_SIZE];
+        Chunk* next;
+    };
+
+    struct OpenNote
+    {
+        Event event;
+        unsigned tick;
+    };
+
+    // audio thread
+    Chunk* m_wchunk;
+    int m_windex;
+    int m_count;
+
+    // shared
+    LockFreeFifo<Chunk*> m_free;
+    Chunk* m_first;
+    QAtomicInt m_published;
+    QAtomicInt m_dropped; // events lost to an empty pool
+    QAtomicInt m_poolSize;
+    QMutex m_reserveLock;
+
+    // gui thread
+    Chunk* m_rchunk;
+    int m_rindex;
+    int m_read;
+
+    EventList m_events;
+    unsigned m_origin;
+    unsigned m_endTick;
+    QList<OpenNote> m_open[128];
+    int m_hbank, m_lbank;
+    int m_rpnh, m_rpnl;
+    int m_datah, m_datal;
+    int m_dataType;
+    Event m_pendingData;
+
+    MidiRecordBuffer(const MidiRecordBuffer&);
+    MidiRecordBuffer& operator=(const MidiRecordBuffer&);
+
+    void resetState();
+    void convert(const MidiPlayEvent& ev, MidiTrack* track);
+    void flushPendingData();
+
+public:
+    MidiRecordBuffer();
+    ~MidiRecordBuffer();
+
+    // audio thread, returns false if the event was dropped
+    bool put(const MidiPlayEvent& ev);
+    void commit();
+
+    // any thread but the audio thread
+    void reserve();
+
+    // gui thread
+    void process(MidiTrack* track, unsigned curTick);
+    void finish();
+    void copyTo(MPEventList* el) const;
+    void copyTo(EventList* el) const;
+    void heldNotes(EventList* el, unsigned curTick) const;
+    void clear();
+
+    //! events of the take, ticks relative to origin()
+    EventList* events()
+    {
+        return &m_events;
+    }
+
+    unsigned origin() const
+    {
+        return m_origin;
+    }
+
+    //! song tick of the last note off, valid after finish()
+    unsigned endTick() const
+    {
+        return m_endTick;
+    }
+};
+
+#endif
@@ -52,6 +52,7 @@
 #include "mididev.h"
 #include "midiport.h"
 #include "midimonitor.h"
+#include "meterbus.h"
 
 //---------------------------------------------------------
 //   AudioStrip
@@ -376,11 +377,18 @@ void AudioStrip::heartBeat()
 {
 	if(song->invalid)
 		return;
+	// strips scrolled out of the mixer or in a hidden mixer cost nothing
+	if (!isVisible() || visibleRegion().isEmpty())
+		return;
+	const MeterSnapshot* ms = meterBus->levels(m_track);
 	for (int ch = 0; ch < m_track->channels(); ++ch)
 	{
 		if (meter[ch])
 		{
-			meter[ch]->setVal(m_track->meter(ch), m_track->peak(ch), false);
+			if (ms)
+				meter[ch]->setVal(ms->peak[ch], ms->peakHold[ch], ms->clips[ch] > 0);
+			else
+				meter[ch]->setVal(m_track->meter(ch), m_track->peak(ch), false);
 		}
 	}
 	Strip::heartBeat();
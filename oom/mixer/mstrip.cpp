@@ -657,6 +657,8 @@ void MidiStrip::routeClicked()
 
 void MidiStrip::heartBeat()
 {
+	if (!isVisible() || visibleRegion().isEmpty())
+		return;
 	inHeartBeat = true;
 
 	int act = track->activity();
@@ -0,0 +1,733 @@
+//=========================================================
+//  OOMidi
+//  OpenOctave Midi and Audio Editor
+//
+//  pipelined LinuxSampler LSCP client
+//=========================================================
+
+#include <QDir>
+#include <QEventLoop>
+#include <QTcpSocket>
+#include <QTimer>
+
+#include "globals.h"
+#include "instruments/minstrument.h"
+#include "lsasyncclient.h"
+
+static const char* SOUND_PATH = "@@OOM_SOUNDS@@";
+static const char* DEVICE_NAME = "LinuxSampler";
+
+//---------------------------------------------------------
+//   LSAsyncClient
+//---------------------------------------------------------
+
+LSAsyncClient::LSAsyncClient(const QString& host, int port, QObject* parent)
+: QObject(parent)
+{
+    m_host = host;
+    m_port = port;
+    m_maxInFlight = DEFAULT_IN_FLIGHT;
+    m_mapsValid = false;
+    m_batchRunning = false;
+    m_batchQueued = false;
+    m_phaseWait = 0;
+    m_done = 0;
+    m_failed = 0;
+    m_midiPorts = -1;
+    m_audioChannels = -1;
+
+    m_socket = new QTcpSocket(this);
+    connect(m_socket, SIGNAL(connected()), this, SLOT(socketConnected()));
+    connect(m_socket, SIGNAL(disconnected()), this, SLOT(socketDisconnected()));
+    connect(m_socket, SIGNAL(error(QAbstractSocket::SocketError)), this, SLOT(socketError()));
+    connect(m_socket, SIGNAL(readyRead()), this, SLOT(readReplies()));
+}
+
+LSAsyncClient::~LSAsyncClient()
+{
+    m_socket->abort();
+}
+
+//---------------------------------------------------------
+//   connectToSampler
+//---------------------------------------------------------
+
+void LSAsyncClient::connectToSampler()
+{
+    if (m_socket->state() == QAbstractSocket::UnconnectedState)
+        m_socket->connectToHost(m_host, m_port);
+}
+
+bool LSAsyncClient::isConnected() const
+{
+    return m_socket->state() == QAbstractSocket::ConnectedState;
+}
+
+void LSAsyncClient::setMaxInFlight(int n)
+{
+    m_maxInFlight = qMax(1, n);
+}
+
+void LSAsyncClient::socketConnected()
+{
+    emit connected();
+    flush();
+}
+
+//---------------------------------------------------------
+//   socketDisconnected
+//    everything outstanding is lost, fail the batch
+//---------------------------------------------------------
+
+void LSAsyncClient::socketDisconnected()
+{
+    m_queue.clear();
+    m_inFlight.clear();
+    m_readBuffer.clear();
+    m_resultSet.clear();
+    clearCache();
+    if (m_batchRunning)
+    {
+        for (int i = 0; i < m_jobs.size(); ++i)
+        {
+            if (m_jobs[i].channel != -2)
+                finishJob(i, false);
+        }
+    }
+    emit disconnected();
+}
+
+void LSAsyncClient::socketError()
+{
+    qDebug("LSAsyncClient: %s", m_socket->errorString().toUtf8().constData());
+    emit error(m_socket->errorString());
+    if (m_socket->state() != QAbstractSocket::ConnectedState)
+        socketDisconnected();
+}
+
+//---------------------------------------------------------
+//   send
+//---------------------------------------------------------
+
+void LSAsyncClient::send(const QByteArray& line, bool resultSet, int reply, int arg)
+{
+    Command cmd;
+    cmd.line = line;
+    cmd.resultSet = resultSet;
+    cmd.reply = reply;
+    cmd.arg = arg;
+    m_queue.enqueue(cmd);
+    if (isConnected())
+        flush();
+    else
+        connectToSampler();
+}
+
+//---------------------------------------------------------
+//   flush
+//    write queued commands up to the in flight limit
+//---------------------------------------------------------
+
+void LSAsyncClient::flush()
+{
+    if (!isConnected())
+        return;
+    while (!m_queue.isEmpty() && m_inFlight.size() < m_maxInFlight)
+    {
+        Command cmd = m_queue.dequeue();
+        if (debugMsg)
+            qDebug("LSAsyncClient: > %s", cmd.line.constData());
+        m_socket->write(cmd.line + "\r\n");
+        m_inFlight.enqueue(cmd);
+    }
+}
+
+//---------------------------------------------------------
+//   readReplies
+//    OK, OK[id], WRN and ERR come on one line, result sets
+//    end with a line holding a single dot
+//---------------------------------------------------------
+
+void LSAsyncClient::readReplies()
+{
+    m_readBuffer += m_socket->readAll();
+    int pos = 0;
+    int eol;
+    while ((eol = m_readBuffer.indexOf('\n', pos)) >= 0)
+    {
+        QByteArray line = m_readBuffer.mid(pos, eol - pos);
+        pos = eol + 1;
+        if (line.endsWith('\r'))
+            line.chop(1);
+        if (line.startsWith("NOTIFY:") || m_inFlight.isEmpty())
+            continue;
+
+        const Command& head = m_inFlight.head();
+        bool ok;
+        if (!head.resultSet)
+            ok = !line.startsWith("ERR");
+        else if (m_resultSet.isEmpty() && (line.startsWith("ERR") || line.startsWith("WRN")))
+            ok = line.startsWith("WRN");
+        else if (line == ".")
+            ok = true;
+        else
+        {
+            m_resultSet.append(QString::fromUtf8(line));
+            continue;
+        }
+
+        Command cmd = m_inFlight.dequeue();
+        QStringList set = m_resultSet;
+        m_resultSet.clear();
+        if (!ok)
+            qDebug("LSAsyncClient: %s: %s", cmd.line.constData(), line.constData());
+        dispatch(cmd, ok, line, set);
+    }
+    m_readBuffer.remove(0, pos);
+    flush();
+}
+
+//---------------------------------------------------------
+//   helpers
+//---------------------------------------------------------
+
+int LSAsyncClient::replyId(const QByteArray& line)
+{
+    int b = line.indexOf('[');
+    int e = line.indexOf(']');
+    if (b < 0 || e < b)
+        return -1;
+    return line.mid(b + 1, e - b - 1).toInt();
+}
+
+QString LSAsyncClient::value(const QStringList& set, const char* key)
+{
+    QString prefix = QString(key) + ":";
+    for (int i = 0; i < set.size(); ++i)
+    {
+        if (set[i].startsWith(prefix))
+        {
+            QString v = set[i].mid(prefix.size()).trimmed();
+            if (v.size() >= 2 && v.startsWith('\'') && v.endsWith('\''))
+                v = v.mid(1, v.size() - 2);
+            return v;
+        }
+    }
+    return QString();
+}
+
+QByteArray LSAsyncClient::quote(const QString& s)
+{
+    QByteArray b = s.toUtf8();
+    b.replace('\\', "\\\\");
+    b.replace('\'', "\\'");
+    return "'" + b + "'";
+}
+
+//---------------------------------------------------------
+//   loadChannel
+//---------------------------------------------------------
+
+void LSAsyncClient::loadChannel(const LSChannelRequest& request)
+{
+    m_pending.append(request);
+    if (!m_batchRunning && !m_batchQueued)
+    {
+        // collect everything asked for until we are back in
+        // the event loop, a song load queues all its tracks
+        m_batchQueued = true;
+        QTimer::singleShot(0, this, SLOT(runQueued()));
+    }
+}
+
+void LSAsyncClient::loadChannels(const QList<LSChannelRequest>& requests)
+{
+    for (int i = 0; i < requests.size(); ++i)
+        loadChannel(requests[i]);
+}
+
+//---------------------------------------------------------
+//   waitForBatch
+//    user input stays blocked meanwhile, the replies and
+//    timers of the batch are served
+//---------------------------------------------------------
+
+bool LSAsyncClient::waitForBatch(int msecs)
+{
+    if (!loading())
+        return true;
+    QEventLoop loop;
+    QTimer timeout;
+    timeout.setSingleShot(true);
+    connect(&timeout, SIGNAL(timeout()), &loop, SLOT(quit()));
+    connect(this, SIGNAL(batchFinished(int, int)), &loop, SLOT(quit()));
+    timeout.start(msecs);
+    // a batch finishing can start the next queued one
+    while (loading() && timeout.isActive())
+        loop.exec(QEventLoop::ExcludeUserInputEvents);
+    return !loading();
+}
+
+void LSAsyncClient::runQueued()
+{
+    m_batchQueued = false;
+    if (!m_batchRunning && !m_pending.isEmpty())
+        startBatch();
+}
+
+//---------------------------------------------------------
+//   startBatch
+//    first phase: read the devices, their ports and the
+//    instrument maps
+//---------------------------------------------------------
+
+void LSAsyncClient::startBatch()
+{
+    m_jobs.clear();
+    for (int i = 0; i < m_pending.size(); ++i)
+    {
+        Job job;
+        job.request = m_pending[i];
+        job.midiPort = -1;
+        job.audioChannel = -1;
+        job.channel = -1;
+        job.failed = false;
+        m_jobs.append(job);
+    }
+    m_pending.clear();
+    m_batchRunning = true;
+    m_done = 0;
+    m_failed = 0;
+    m_midiPorts = -1;
+    m_audioChannels = -1;
+    m_midiPortFree.clear();
+    m_audioChannelFree.clear();
+    m_mapRequests.clear();
+    emit loadProgress(0, m_jobs.size());
+
+    m_phaseWait = 2;
+    send("GET MIDI_INPUT_DEVICE INFO 0", true, R_MIDI_DEVICE, 0);
+    send("GET AUDIO_OUTPUT_DEVICE INFO 0", true, R_AUDIO_DEVICE, 0);
+    if (!m_mapsValid)
+    {
+        ++m_phaseWait;
+        send("LIST MIDI_INSTRUMENT_MAPS", false, R_MAP_LIST);
+    }
+}
+
+void LSAsyncClient::phaseDone()
+{
+    if (--m_phaseWait == 0)
+        allocate();
+}
+
+//---------------------------------------------------------
+//   allocate
+//    second phase: hand out ports and audio channels, name
+//    them, create missing maps and add all channels
+//---------------------------------------------------------
+
+void LSAsyncClient::allocate()
+{
+    if (m_midiPorts < 0 || m_audioChannels < 0)
+    {
+        qDebug("LSAsyncClient: no sampler devices, cannot create channels");
+        for (int i = 0; i < m_jobs.size(); ++i)
+            finishJob(i, false);
+        return;
+    }
+
+    int midiPorts = m_midiPorts;
+    int audioChannels = m_audioChannels;
+    for (int i = 0; i < m_jobs.size(); ++i)
+    {
+        Job& job = m_jobs[i];
+        job.midiPort = m_midiPortFree.indexOf(true);
+        if (job.midiPort == -1)
+        {
+            job.midiPort = midiPorts++;
+            m_midiPortFree.append(false);
+        }
+        m_midiPortFree[job.midiPort] = false;
+        job.audioChannel = m_audioChannelFree.indexOf(true);
+        if (job.audioChannel == -1)
+        {
+            job.audioChannel = audioChannels++;
+            m_audioChannelFree.append(false);
+        }
+        m_audioChannelFree[job.audioChannel] = false;
+    }
+    if (midiPorts != m_midiPorts)
+        send("SET MIDI_INPUT_DEVICE_PARAMETER 0 PORTS=" + QByteArray::number(midiPorts), false, R_SYNC);
+    if (audioChannels != m_audioChannels)
+        send("SET AUDIO_OUTPUT_DEVICE_PARAMETER 0 CHANNELS=" + QByteArray::number(audioChannels), false, R_SYNC);
+    m_midiPorts = midiPorts;
+    m_audioChannels = audioChannels;
+
+    for (int i = 0; i < m_jobs.size(); ++i)
+    {
+        const Job& job = m_jobs[i];
+        send("SET MIDI_INPUT_PORT_PARAMETER 0 " + QByteArray::number(job.midiPort)
+                + " NAME=" + quote(job.request.name), false, R_SYNC);
+        send("SET AUDIO_OUTPUT_CHANNEL_PARAMETER 0 " + QByteArray::number(job.audioChannel)
+                + " NAME=" + quote(job.request.name + "-audio"), false, R_SYNC);
+
+        const QString& map = job.request.mapName;
+        if (!m_maps.contains(map) && !m_mapRequests.contains(map))
+        {
+            m_mapRequests.insert(map, i);
+            send("ADD MIDI_INSTRUMENT_MAP " + quote(map), false, R_ADD_MAP, i);
+        }
+    }
+
+    // the maps are answered before any of these
+    for (int i = 0; i < m_jobs.size(); ++i)
+        send("ADD CHANNEL", false, R_ADD_CHANNEL, i);
+}
+
+//---------------------------------------------------------
+//   setupChannel
+//    third phase, runs per channel as its id arrives
+//---------------------------------------------------------
+
+void LSAsyncClient::setupChannel(int i)
+{
+    const Job& job = m_jobs[i];
+    int map = m_maps.value(job.request.mapName, -1);
+    if (map < 0)
+    {
+        qDebug("LSAsyncClient: no instrument map %s", job.request.mapName.toUtf8().constData());
+        finishJob(i, false);
+        return;
+    }
+    QByteArray chan = QByteArray::number(job.channel);
+    QByteArray port = QByteArray::number(job.midiPort);
+    QByteArray audio = QByteArray::number(job.audioChannel);
+
+    send("LOAD ENGINE " + job.request.engine.toUtf8() + " " + chan, false, R_CHANNEL_STEP, i);
+    send("SET CHANNEL MIDI_INPUT_DEVICE " + chan + " 0", false, R_SYNC);
+    send("SET CHANNEL MIDI_INPUT_PORT " + chan + " " + port, false, R_SYNC);
+    send("SET CHANNEL MIDI_INPUT_CHANNEL " + chan + " ALL", false, R_SYNC);
+    send("SET CHANNEL MIDI_INSTRUMENT_MAP " + chan + " " + QByteArray::number(map), false, R_SYNC);
+    send("SET CHANNEL VOLUME " + chan + " 1.0", false, R_SYNC);
+    send("SET CHANNEL AUDIO_OUTPUT_DEVICE " + chan + " 0", false, R_SYNC);
+    send("SET CHANNEL AUDIO_OUTPUT_CHANNEL " + chan + " 0 " + audio, false, R_SYNC);
+    send("SET CHANNEL AUDIO_OUTPUT_CHANNEL " + chan + " 1 " + audio, false, R_SYNC);
+    send("LOAD INSTRUMENT NON_MODAL " + quote(job.request.filename) + " "
+            + QByteArray::number(job.request.index) + " " + chan, false, R_CHANNEL_DONE, i);
+}
+
+//---------------------------------------------------------
+//   finishJob
+//---------------------------------------------------------
+
+void LSAsyncClient::finishJob(int i, bool ok)
+{
+    Job& job = m_jobs[i];
+    if (job.channel == -2)
+        return;
+    int chan = job.channel;
+    job.channel = -2; // done
+    ++m_done;
+    if (ok)
+        emit channelLoaded(job.request.trackId, chan, job.midiPort, job.audioChannel);
+    else
+    {
+        ++m_failed;
+        emit channelFailed(job.request.trackId);
+    }
+    emit loadProgress(m_done, m_jobs.size());
+
+    if (m_done == m_jobs.size())
+    {
+        m_batchRunning = false;
+        emit batchFinished(m_done - m_failed, m_failed);
+        if (!m_pending.isEmpty() && !m_batchQueued)
+        {
+            m_batchQueued = true;
+            QTimer::singleShot(0, this, SLOT(runQueued()));
+        }
+    }
+}
+
+//---------------------------------------------------------
+//   dispatch
+//---------------------------------------------------------
+
+void LSAsyncClient::dispatch(const Command& cmd, bool ok, const QByteArray& line, const QStringList& set)
+{
+    switch (cmd.reply)
+    {
+        case R_MIDI_DEVICE:
+            if (ok)
+            {
+                int ports = value(set, "PORTS").toInt();
+                m_midiPorts = ports;
+                for (int p = 0; p < ports; ++p)
+                {
+                    m_midiPortFree.append(false);
+                    ++m_phaseWait;
+                    send("GET MIDI_INPUT_PORT INFO 0 " + QByteArray::number(p), true, R_MIDI_PORT, p);
+                }
+            }
+            else if (cmd.arg == 0)
+            {
+                ++m_phaseWait;
+                send(QByteArray("CREATE MIDI_INPUT_DEVICE JACK NAME=") + quote(DEVICE_NAME) + " PORTS=1",
+                        false, R_CREATE_MIDI_DEVICE);
+            }
+            phaseDone();
+            break;
+
+        case R_AUDIO_DEVICE:
+            if (ok)
+            {
+                int channels = value(set, "CHANNELS").toInt();
+                m_audioChannels = channels;
+                for (int c = 0; c < channels; ++c)
+                {
+                    m_audioChannelFree.append(false);
+                    ++m_phaseWait;
+                    send("GET AUDIO_OUTPUT_CHANNEL INFO 0 " + QByteArray::number(c), true, R_AUDIO_CHANNEL, c);
+                }
+            }
+            else if (cmd.arg == 0)
+            {
+                ++m_phaseWait;
+                send(QByteArray("CREATE AUDIO_OUTPUT_DEVICE JACK ACTIVE=true CHANNELS=1 SAMPLERATE=48000 NAME=")
+                        + quote(DEVICE_NAME), false, R_CREATE_AUDIO_DEVICE);
+            }
+            phaseDone();
+            break;
+
+        case R_CREATE_MIDI_DEVICE:
+            if (ok)
+            {
+                ++m_phaseWait;
+                send("GET MIDI_INPUT_DEVICE INFO 0", true, R_MIDI_DEVICE, 1);
+            }
+            phaseDone();
+            break;
+
+        case R_CREATE_AUDIO_DEVICE:
+            if (ok)
+            {
+                ++m_phaseWait;
+                send("GET AUDIO_OUTPUT_DEVICE INFO 0", true, R_AUDIO_DEVICE, 1);
+            }
+            phaseDone();
+            break;
+
+        case R_MIDI_PORT:
+            if (ok && cmd.arg < m_midiPortFree.size())
+                m_midiPortFree[cmd.arg] = value(set, "NAME").startsWith("midi_in_");
+            phaseDone();
+            break;
+
+        case R_AUDIO_CHANNEL:
+            if (ok && cmd.arg < m_audioChannelFree.size())
+            {
+                bool numeric;
+                value(set, "NAME").toInt(&numeric);
+                m_audioChannelFree[cmd.arg] = numeric;
+            }
+            phaseDone();
+            break;
+
+        case R_MAP_LIST:
+            m_maps.clear();
+            if (ok)
+            {
+                QList<QByteArray> ids = line.split(',');
+                for (int i = 0; i < ids.size(); ++i)
+                {
+                    if (ids[i].trimmed().isEmpty())
+                        continue;
+                    ++m_phaseWait;
+                    send("GET MIDI_INSTRUMENT_MAP INFO " + ids[i].trimmed(), true, R_MAP_INFO, ids[i].trimmed().toInt());
+                }
+                m_mapsValid = true;
+            }
+            phaseDone();
+            break;
+
+        case R_MAP_INFO:
+            if (ok)
+            {
+                QString name = value(set, "NAME");
+                if (!m_maps.contains(name))
+                    m_maps.insert(name, cmd.arg);
+            }
+            phaseDone();
+            break;
+
+        case R_ADD_MAP:
+        {
+            const LSChannelRequest& request = m_jobs[cmd.arg].request;
+            int map = ok ? replyId(line) : -1;
+            if (map < 0)
+                break;
+            m_maps.insert(request.mapName, map);
+            for (int i = 0; i < request.patches.size(); ++i)
+            {
+                const LSPatchMapping& p = request.patches[i];
+                QByteArray mode;
+                switch (p.loadmode)
+                {
+                    case 1: mode = " ON_DEMAND"; break;
+                    case 2: mode = " ON_DEMAND_HOLD"; break;
+                    case 3: mode = " PERSISTENT"; break;
+                    default: break;
+                }
+                send("MAP MIDI_INSTRUMENT NON_MODAL " + QByteArray::number(map) + " " + QByteArray::number(p.bank)
+                        + " " + QByteArray::number(p.prog) + " " + p.engine.toUtf8() + " " + quote(p.filename)
+                        + " " + QByteArray::number(p.index) + " " + QByteArray::number(p.volume) + mode
+                        + " " + quote(p.name), false, R_SYNC);
+            }
+            break;
+        }
+
+        case R_ADD_CHANNEL:
+            if (m_jobs[cmd.arg].channel == -2)
+                break;
+            if (ok && replyId(line) >= 0)
+            {
+                m_jobs[cmd.arg].channel = replyId(line);
+                setupChannel(cmd.arg);
+            }
+            else
+                finishJob(cmd.arg, false);
+            break;
+
+        case R_CHANNEL_STEP:
+            if (!ok)
+                m_jobs[cmd.arg].failed = true;
+            break;
+
+        case R_CHANNEL_DONE:
+            finishJob(cmd.arg, !m_jobs[cmd.arg].failed);
+            break;
+
+        case R_ENGINES:
+            if (ok)
+            {
+                m_engines.clear();
+                QList<QByteArray> names = line.split(',');
+                for (int i = 0; i < names.size(); ++i)
+                {
+                    QString name = QString::fromUtf8(names[i].trimmed());
+                    name.remove('\'');
+                    if (!name.isEmpty())
+                        m_engines.append(name);
+                }
+                for (int i = 0; i < m_engines.size(); ++i)
+                    send("GET ENGINE INFO " + m_engines[i].toUtf8(), true, R_ENGINE_INFO, i);
+                if (m_engines.isEmpty())
+                    emit enginesChanged();
+            }
+            break;
+
+        case R_ENGINE_INFO:
+            if (cmd.arg < m_engines.size())
+            {
+                LSEngineInfo info;
+                info.name = m_engines[cmd.arg];
+                info.description = value(set, "DESCRIPTION");
+                info.version = value(set, "VERSION");
+                m_engineInfo.insert(info.name, info);
+                if (cmd.arg == m_engines.size() - 1)
+                    emit enginesChanged();
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+//---------------------------------------------------------
+//   requestEngines
+//    engines and their info are fetched once and kept
+//---------------------------------------------------------
+
+void LSAsyncClient::requestEngines()
+{
+    if (!m_engines.isEmpty())
+    {
+        emit enginesChanged();
+        return;
+    }
+    send("LIST AVAILABLE_ENGINES", false, R_ENGINES);
+}
+
+bool LSAsyncClient::engineInfo(const QString& name, LSEngineInfo* info) const
+{
+    QHash<QString, LSEngineInfo>::const_iterator i = m_engineInfo.find(name);
+    if (i == m_engineInfo.end())
+        return false;
+    *info = i.value();
+    return true;
+}
+
+//---------------------------------------------------------
+//   reset
+//---------------------------------------------------------
+
+void LSAsyncClient::reset()
+{
+    send("RESET", false, R_SYNC);
+    clearCache();
+}
+
+void LSAsyncClient::clearCache()
+{
+    m_maps.clear();
+    m_mapsValid = false;
+    m_engines.clear();
+    m_engineInfo.clear();
+}
+
+//---------------------------------------------------------
+//   channelRequest
+//    fill request from the default patch and map of an
+//    oom instrument, return false if it has none
+//---------------------------------------------------------
+
+bool LSAsyncClient::channelRequest(MidiInstrument* instrument, const QString& name, qint64 trackId, LSChannelRequest* request)
+{
+    if (!instrument || !instrument->isOOMInstrument())
+        return false;
+    Patch* def = instrument->getDefaultPatch();
+    if (!def)
+        return false;
+
+    QString sounds = QDir::homePath() + QDir::separator() + ".sounds";
+    request->trackId = trackId;
+    request->name = name;
+    request->mapName = instrument->iname();
+    request->engine = def->engine;
+    request->filename = QString(def->filename).replace(SOUND_PATH, sounds);
+    request->index = def->index;
+    request->patches.clear();
+
+    PatchGroupList* pgl = instrument->groups();
+    for (iPatchGroup ipg = pgl->begin(); ipg != pgl->end(); ++ipg)
+    {
+        const PatchList& patches = (*ipg)->patches;
+        for (ciPatch ip = patches.begin(); ip != patches.end(); ++ip)
+        {
+            Patch* p = *ip;
+            LSPatchMapping m;
+            m.bank = p->lbank;
+            m.prog = p->prog;
+            m.engine = p->engine;
+            m.filename = QString(p->filename).replace(SOUND_PATH, sounds);
+            m.index = p->index;
+            m.volume = p->volume;
+            m.loadmode = p->loadmode;
+            m.name = p->name;
+            request->patches.append(m);
+        }
+    }
+    return true;
+}
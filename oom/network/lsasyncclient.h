@@ -0,0 +1,224 @@
+//=========================================================
+//  OOMidi
+//  OpenOctave Midi and Audio Editor
+//
+//  pipelined LinuxSampler LSCP client
+//=========================================================
+
+#ifndef __LSASYNCCLIENT_H__
+#define __LSASYNCCLIENT_H__
+
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QQueue>
+#include <QString>
+#include <QStringList>
+
+class QTcpSocket;
+class MidiInstrument;
+
+//---------------------------------------------------------
+//   LSPatchMapping
+//    one MAP MIDI_INSTRUMENT entry of an instrument map
+//---------------------------------------------------------
+
+struct LSPatchMapping
+{
+    int bank;
+    int prog;
+    QString engine;
+    QString filename;
+    int index;
+    float volume;
+    int loadmode;
+    QString name;
+};
+
+//---------------------------------------------------------
+//   LSChannelRequest
+//    a sampler channel to create for a track, the map is
+//    created from patches when the sampler has none of
+//    that name yet
+//---------------------------------------------------------
+
+struct LSChannelRequest
+{
+    qint64 trackId;
+    QString name;
+    QString mapName;
+    QList<LSPatchMapping> patches;
+    QString engine;
+    QString filename;
+    int index;
+};
+
+//---------------------------------------------------------
+//   LSEngineInfo
+//---------------------------------------------------------
+
+struct LSEngineInfo
+{
+    QString name;
+    QString description;
+    QString version;
+};
+
+//---------------------------------------------------------
+//   LSAsyncClient
+//    Talks LSCP over its own socket without blocking the
+//    gui thread. Commands are written back to back and
+//    matched to their replies in order, the server answers
+//    a connection strictly in sequence.
+//
+//    loadChannels() creates sampler channels for many
+//    tracks at once: device and map state is read once,
+//    ports and audio channels are assigned locally, all
+//    ADD CHANNEL commands go out together and each
+//    channel is set up as soon as its id comes back. The
+//    whole batch costs a handful of round trips instead of
+//    a dozen per instrument.
+//
+//    Map ids and engine info are cached until reset() or
+//    clearCache().
+//
+//    LSClient reads the free ports and channels from the
+//    sampler for every channel it creates, so it waits with
+//    waitForBatch() while a batch is assigning them.
+//---------------------------------------------------------
+
+class LSAsyncClient : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum { DEFAULT_IN_FLIGHT = 64 };
+
+private:
+    enum Reply
+    {
+        R_NONE, R_MIDI_DEVICE, R_AUDIO_DEVICE, R_CREATE_MIDI_DEVICE, R_CREATE_AUDIO_DEVICE,
+        R_MIDI_PORT, R_AUDIO_CHANNEL, R_MAP_LIST, R_MAP_INFO, R_ADD_MAP,
+        R_ADD_CHANNEL, R_CHANNEL_STEP, R_CHANNEL_DONE, R_ENGINES, R_ENGINE_INFO, R_SYNC
+    };
+
+    struct Command
+    {
+        QByteArray line;
+        bool resultSet;
+        int reply;
+        int arg;
+    };
+
+    struct Job
+    {
+        LSChannelRequest request;
+        int midiPort;
+        int audioChannel;
+        int channel;
+        bool failed;
+    };
+
+    QTcpSocket* m_socket;
+    QString m_host;
+    int m_port;
+    int m_maxInFlight;
+
+    QQueue<Command> m_queue;    // not written yet
+    QQueue<Command> m_inFlight; // written, waiting for the reply
+    QByteArray m_readBuffer;
+    QStringList m_resultSet;
+
+    // cache
+    QHash<QString, int> m_maps;
+    bool m_mapsValid;
+    QStringList m_engines;
+    QHash<QString, LSEngineInfo> m_engineInfo;
+
+    // loader, one batch at a time
+    QList<LSChannelRequest> m_pending;
+    QList<Job> m_jobs;
+    bool m_batchRunning;
+    bool m_batchQueued;
+    int m_phaseWait;
+    int m_done;
+    int m_failed;
+    int m_midiPorts;
+    int m_audioChannels;
+    QList<bool> m_midiPortFree;
+    QList<bool> m_audioChannelFree;
+    // map name -> job whose patches create it
+    QHash<QString, int> m_mapRequests;
+
+    LSAsyncClient(const LSAsyncClient&);
+    LSAsyncClient& operator=(const LSAsyncClient&);
+
+    void send(const QByteArray& line, bool resultSet, int reply, int arg = -1);
+    void flush();
+    void dispatch(const Command&, bool ok, const QByteArray& line, const QStringList& set);
+    static int replyId(const QByteArray& line);
+    static QString value(const QStringList& set, const char* key);
+    static QByteArray quote(const QString&);
+
+    void startBatch();
+    void phaseDone();
+    void allocate();
+    void setupChannel(int job);
+    void finishJob(int job, bool ok);
+
+private slots:
+    void socketConnected();
+    void socketDisconnected();
+    void socketError();
+    void readReplies();
+    void runQueued();
+
+public:
+    LSAsyncClient(const QString& host = "localhost", int port = 8888, QObject* parent = 0);
+    ~LSAsyncClient();
+
+    void connectToSampler();
+    bool isConnected() const;
+    //! commands written before their predecessors replied,
+    //! 1 gives the old one round trip per command
+    void setMaxInFlight(int n);
+    int pending() const
+    {
+        return m_queue.size() + m_inFlight.size();
+    }
+
+    void loadChannel(const LSChannelRequest&);
+    void loadChannels(const QList<LSChannelRequest>&);
+    bool loading() const
+    {
+        return m_batchRunning || m_batchQueued;
+    }
+    //! runs the event loop until no batch is loading or msecs
+    //! passed, returns false on timeout
+    bool waitForBatch(int msecs = 30000);
+
+    void requestEngines();
+    QStringList engines() const
+    {
+        return m_engines;
+    }
+    bool engineInfo(const QString& name, LSEngineInfo* info) const;
+
+    void reset();
+    void clearCache();
+
+    static bool channelRequest(MidiInstrument*, const QString& name, qint64 trackId, LSChannelRequest* request);
+
+signals:
+    void connected();
+    void disconnected();
+    void error(const QString&);
+    void enginesChanged();
+    void channelLoaded(qint64 trackId, int samplerChannel, int midiPort, int audioChannel);
+    void channelFailed(qint64 trackId);
+    void loadProgress(int done, int total);
+    void batchFinished(int loaded, int failed);
+};
+
+#endif
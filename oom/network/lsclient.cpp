@@ -6,6 +6,7 @@
 #include "instruments/minstrument.h"
 #include "midictrl.h"
 #include "lsclient.h"
+#include "lsasyncclient.h"
 #include <ctype.h>
 #include <QStringListIterator>
 #include <QStringList>
@@ -709,8 +710,22 @@ int LSClient::createMidiInputDevice(char* name, const char* type, int ports)/*{{
 	return rv;
 }/*}}}*/
 
+//---------------------------------------------------------
+//   waitForAsyncLoad
+//    LSAsyncClient assigns ports and audio channels of its
+//    own while it loads a batch, the two must not allocate
+//    at the same time
+//---------------------------------------------------------
+
+static void waitForAsyncLoad()
+{
+	if(lsAsyncClient && !lsAsyncClient->waitForBatch())
+		qDebug("LSClient: sampler channel batch still loading, going ahead");
+}
+
 bool LSClient::createInstrumentChannel(const char* name, const char* engine, const char* filename, int index, int map, SamplerData** data)/*{{{*/
 {
+	waitForAsyncLoad();
 	bool rv = false;
 	if(_client != NULL)
 	{
@@ -912,6 +927,7 @@ bool LSClient::createInstrumentChannel(const char* name, const char* engine, con
 
 bool LSClient::updateInstrumentChannel(SamplerData* data, const char* engine, const char* filename, int index, int map)/*{{{*/
 {
+	waitForAsyncLoad();
 	bool rv = false;
 	if(_client != NULL && data)
 	{
@@ -982,6 +998,7 @@ bool LSClient::updateInstrumentChannel(SamplerData* data, const char* engine, co
 
 bool LSClient::removeInstrumentChannel(SamplerData* data)/*{{{*/
 {
+	waitForAsyncLoad();
 	bool rv = false;
 	if(_client != NULL && data)
 	{
@@ -1050,6 +1067,8 @@ bool LSClient::loadInstrument(MidiInstrument* instrument)/*{{{*/
 					qDebug("LSClient::loadInstrument: MIDI Map not found for %s, Creating MIDI Map ", instrument->iname().toUtf8().constData());
 				//Create midiMap with the patchgroup name
 				map = ::lscp_add_midi_instrument_map(_client, instrument->iname().toUtf8().constData());
+				if(lsAsyncClient)
+					lsAsyncClient->clearCache();
 				if(map >= 0)
 				{
 					PatchGroupList *pgl = instrument->groups();/*{{{*/
@@ -1340,6 +1359,8 @@ bool LSClient::removeMidiMap(int map)
 {
 	if(_client != NULL)
 	{
+		if(lsAsyncClient)
+			lsAsyncClient->clearCache();
 		return (lscp_remove_midi_instrument_map(_client, map) == LSCP_OK);
 	}
 	return false;
@@ -1385,10 +1406,13 @@ QString LSClient::getMapName(int mid)/*{{{*/
 
 bool LSClient::resetSampler()
 {
+	waitForAsyncLoad();
 	bool rv = false;
 	if(_client != NULL)
 	{
 		rv = (lscp_reset_sampler(_client) == LSCP_OK);
+		if(lsAsyncClient)
+			lsAsyncClient->clearCache();
 	}
 	return rv;
 }
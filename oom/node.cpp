@@ -27,6 +27,7 @@
 #include "mididev.h"
 #include "midiport.h"
 #include "midimonitor.h"
+#include "dspprofiler.h"
 
 // Uncomment this (and make sure to set Jack buffer size high like 2048) 
 //  to see process flow messages.
@@ -318,6 +319,8 @@ void Track::setOff(bool val)
 
 void AudioTrack::copyData(unsigned pos, int dstChannels, int srcStartChan, int srcChannels, unsigned nframes, float** dstBuffer)
 {
+	DspProbe probe(this, DspProfiler::TRACK);
+
 	//Changed by T356. 12/12/09.
 	// Overhaul and streamline to eliminate multiple processing during one process loop.
 	// Was causing ticking sound with synths + multiple out routes because synths were being processed multiple times.
@@ -353,7 +356,6 @@ void AudioTrack::copyData(unsigned pos, int dstChannels, int srcStartChan, int s
 	double _pan = pan();
 	vol[0] = _volume * (1.0 - _pan);
 	vol[1] = _volume * (1.0 + _pan);
-	float meter[srcChans];
 
 	// Have we been here already during this process cycle?
 	if (processed())
@@ -423,6 +425,8 @@ void AudioTrack::copyData(unsigned pos, int dstChannels, int srcStartChan, int s
 			for (i = 0; i < srcChans; ++i)
 			{
 				_meter[i] = 0.0;
+				_rms[i] = 0.0;
+				_truePeak[i] = 0.0;
 			}
 
 			_haveData = false;
@@ -498,20 +502,7 @@ void AudioTrack::copyData(unsigned pos, int dstChannels, int srcStartChan, int s
 		if (_prefader)
 		{
 			for (i = 0; i < srcChans; ++i)
-			{
-				float* p = buffer[i];
-				meter[i] = 0.0;
-				for (unsigned k = 0; k < nframes; ++k)
-				{
-					double f = fabs(*p);
-					if (f > meter[i])
-						meter[i] = f;
-					++p;
-				}
-				_meter[i] = meter[i];
-				if (_meter[i] > _peak[i])
-					_peak[i] = _meter[i];
-			}
+				meterChannel(i, buffer[i], nframes, 1.0);
 		}
 
 		if (isMute())
@@ -542,6 +533,9 @@ void AudioTrack::copyData(unsigned pos, int dstChannels, int srcStartChan, int s
 
 		// We have some data! Set to true.
 		_haveData = true;
+
+		if (_renderTap)
+			renderTap(buffer, nframes, vol);
 	}
 
 	// Sanity check. Is source starting channel out of range? Just zero and return.
@@ -588,22 +582,12 @@ void AudioTrack::copyData(unsigned pos, int dstChannels, int srcStartChan, int s
 		{
 			for (int c = 0; c < dstChannels; ++c)
 			{
-				meter[c] = 0.0;
-
 				float* sp = buffer[c + srcStartChan];
 
 				float* dp = dstBuffer[c];
 				for (unsigned k = 0; k < nframes; ++k)
-				{
-					float val = *sp++ * vol[c];
-					*dp++ = val;
-					double f = fabs(val);
-					if (f > meter[c])
-						meter[c] = f;
-				}
-				_meter[c] = meter[c];
-				if (_meter[c] > _peak[c])
-					_peak[c] = _meter[c];
+					*dp++ = (*sp++ * vol[c]);
+				meterChannel(c, buffer[c + srcStartChan], nframes, vol[c]);
 			}
 		}
 	}
@@ -622,19 +606,13 @@ void AudioTrack::copyData(unsigned pos, int dstChannels, int srcStartChan, int s
 		}
 		else
 		{
-			meter[0] = 0.0;
 			for (unsigned k = 0; k < nframes; ++k)
 			{
-				float val = *sp++;
-				double f = fabs(val) * _volume;
-				if (f > meter[0])
-					meter[0] = f;
+				float val = sp[k];
 				*(dstBuffer[0] + k) = val * vol[0];
 				*(dstBuffer[1] + k) = val * vol[1];
 			}
-			_meter[0] = meter[0];
-			if (_meter[0] > _peak[0])
-				_peak[0] = _meter[0];
+			meterChannel(0, sp, nframes, _volume);
 		}
 	}
 	else if (srcChans == 2 && dstChannels == 1)
@@ -651,38 +629,44 @@ void AudioTrack::copyData(unsigned pos, int dstChannels, int srcStartChan, int s
 		else
 		{
 			float* dp = dstBuffer[0];
-			meter[0] = 0.0;
-			meter[1] = 0.0;
 			for (unsigned k = 0; k < nframes; ++k)
-			{
-				float val1 = *sp1++ * vol[0];
-				float val2 = *sp2++ * vol[1];
-				double f1 = fabs(val1);
-				if (f1 > meter[0])
-					meter[0] = f1;
-				double f2 = fabs(val2);
-				if (f2 > meter[1])
-					meter[1] = f2;
-				*dp++ = (val1 + val2);
-			}
-			_meter[0] = meter[0];
-			if (_meter[0] > _peak[0])
-				_peak[0] = _meter[0];
-			_meter[1] = meter[1];
-			if (_meter[1] > _peak[1])
-				_peak[1] = _meter[1];
+				*dp++ = (sp1[k] * vol[0] + sp2[k] * vol[1]);
+			meterChannel(0, sp1, nframes, vol[0]);
+			meterChannel(1, sp2, nframes, vol[1]);
 		}
 	}
 
 	_processed = true;
 }
 
+//---------------------------------------------------------
+//   renderTap
+//    copy the post-effect data through the fader into the
+//    offline render buffers. Tracks which produce no data
+//    leave them alone, the renderer clears them each cycle.
+//---------------------------------------------------------
+
+void AudioTrack::renderTap(float** buffer, unsigned nframes, const double* vol)
+{
+	int chans = channels();
+	for (int c = 0; c < chans; ++c)
+	{
+		float v = (chans == 1) ? volume() : vol[c];
+		float* sp = buffer[c];
+		float* dp = _renderTap[c];
+		for (unsigned k = 0; k < nframes; ++k)
+			dp[k] = sp[k] * v;
+	}
+}
+
 //---------------------------------------------------------
 //   addData
 //---------------------------------------------------------
 
 void AudioTrack::addData(unsigned pos, int dstChannels, int srcStartChan, int srcChannels, unsigned nframes, float** dstBuffer)
 {
+	DspProbe probe(this, DspProfiler::TRACK);
+
 	// Overhaul and streamline to eliminate multiple processing during one process loop.
 	// Was causing ticking sound with synths + multiple out routes because synths were being processed multiple times.
 	// Make better use of AudioTrack::outBuffers as a post-effect pre-volume cache system for multiple calls here during processing.
@@ -721,7 +705,6 @@ void AudioTrack::addData(unsigned pos, int dstChannels, int srcStartChan, int sr
 	double _pan = pan();
 	vol[0] = _volume * (1.0 - _pan);
 	vol[1] = _volume * (1.0 + _pan);
-	float meter[srcChans];
 
 	// Have we been here already during this process cycle?
 	if (processed())
@@ -764,6 +747,8 @@ void AudioTrack::addData(unsigned pos, int dstChannels, int srcStartChan, int sr
 				//  during this process cycle will see zeros.
 
 				_meter[i] = 0.0;
+				_rms[i] = 0.0;
+				_truePeak[i] = 0.0;
 			}
 
 			_haveData = false;
@@ -844,21 +829,7 @@ void AudioTrack::addData(unsigned pos, int dstChannels, int srcStartChan, int sr
 		if (_prefader)
 		{
 			for (i = 0; i < srcChans; ++i)
-			{
-				float* p = buffer[i];
-				meter[i] = 0.0;
-				for (unsigned k = 0; k < nframes; ++k)
-				{
-					double f = fabs(*p);
-					if (f > meter[i])
-						meter[i] = f;
-					++p;
-				}
-				//_meter[i] = lrint(meter[i] * 32767.0);
-				_meter[i] = meter[i];
-				if (_meter[i] > _peak[i])
-					_peak[i] = _meter[i];
-			}
+				meterChannel(i, buffer[i], nframes, 1.0);
 		}
 
 		if (isMute())
@@ -877,6 +848,9 @@ void AudioTrack::addData(unsigned pos, int dstChannels, int srcStartChan, int sr
 
 		// We have some data! Set to true.
 		_haveData = true;
+
+		if (_renderTap)
+			renderTap(buffer, nframes, vol);
 	}
 
 	// Sanity check. Is source starting channel out of range? Just zero and return.
@@ -922,21 +896,12 @@ void AudioTrack::addData(unsigned pos, int dstChannels, int srcStartChan, int sr
 		{
 			for (int c = 0; c < dstChannels; ++c)
 			{
-				meter[c] = 0.0;
 				float* sp = buffer[c + srcStartChan];
 
 				float* dp = dstBuffer[c];
 				for (unsigned k = 0; k < nframes; ++k)
-				{
-					float val = *sp++ * vol[c];
-					*dp++ += val;
-					double f = fabs(val);
-					if (f > meter[c])
-						meter[c] = f;
-				}
-				_meter[c] = meter[c];
-				if (_meter[c] > _peak[c])
-					_peak[c] = _meter[c];
+					*dp++ += (*sp++ * vol[c]);
+				meterChannel(c, buffer[c + srcStartChan], nframes, vol[c]);
 			}
 		}
 	}
@@ -955,19 +920,13 @@ void AudioTrack::addData(unsigned pos, int dstChannels, int srcStartChan, int sr
 		}
 		else
 		{
-			meter[0] = 0.0;
 			for (unsigned k = 0; k < nframes; ++k)
 			{
-				float val = *sp++;
-				double f = fabs(val) * _volume;
-				if (f > meter[0])
-					meter[0] = f;
+				float val = sp[k];
 				*(dstBuffer[0] + k) += val * vol[0];
 				*(dstBuffer[1] + k) += val * vol[1];
 			}
-			_meter[0] = meter[0];
-			if (_meter[0] > _peak[0])
-				_peak[0] = _meter[0];
+			meterChannel(0, sp, nframes, _volume);
 		}
 	}
 	else if (srcChans == 2 && dstChannels == 1)
@@ -984,26 +943,10 @@ void AudioTrack::addData(unsigned pos, int dstChannels, int srcStartChan, int sr
 		else
 		{
 			float* dp = dstBuffer[0];
-			meter[0] = 0.0;
-			meter[1] = 0.0;
 			for (unsigned k = 0; k < nframes; ++k)
-			{
-				float val1 = *sp1++ * vol[0];
-				float val2 = *sp2++ * vol[1];
-				double f1 = fabs(val1);
-				if (f1 > meter[0])
-					meter[0] = f1;
-				double f2 = fabs(val2);
-				if (f2 > meter[1])
-					meter[1] = f2;
-				*dp++ += (val1 + val2);
-			}
-			_meter[0] = meter[0];
-			if (_meter[0] > _peak[0])
-				_peak[0] = _meter[0];
-			_meter[1] = meter[1];
-			if (_meter[1] > _peak[1])
-				_peak[1] = _meter[1];
+				*dp++ += (sp1[k] * vol[0] + sp2[k] * vol[1]);
+			meterChannel(0, sp1, nframes, vol[0]);
+			meterChannel(1, sp2, nframes, vol[1]);
 		}
 	}
 
@@ -1057,6 +1000,9 @@ void Track::setChannels(int n)
 	{
 		_meter[i] = 0.0;
 		_peak[i] = 0.0;
+		_rms[i] = 0.0;
+		_truePeak[i] = 0.0;
+		_clips[i] = 0;
 	}
 }
 
@@ -1214,7 +1160,58 @@ void AudioInput::setName(const QString& s)
 void Track::resetMeter()
 {
 	for (int i = 0; i < _channels; ++i)
+	{
 		_meter[i] = 0.0;
+		_rms[i] = 0.0;
+		_truePeak[i] = 0.0;
+	}
+}
+
+//---------------------------------------------------------
+//   meterChannel
+//    peak, rms and true peak of one channel of this cycle,
+//    the samples scaled by gain. The true peak is estimated
+//    from the cubic interpolated midpoint between samples,
+//    which is good for about 0.5 dB on program material.
+//    real time part (executed in audio thread)
+//---------------------------------------------------------
+
+void Track::meterChannel(int ch, const float* buffer, unsigned nframes, double gain)
+{
+	float* h = _meterHistory[ch];
+	float x0 = h[0];
+	float x1 = h[1];
+	float x2 = h[2];
+	double peak = 0.0;
+	double tp = 0.0;
+	double sumSq = 0.0;
+	for (unsigned k = 0; k < nframes; ++k)
+	{
+		float x3 = buffer[k];
+		double f = fabs(x3);
+		if (f > peak)
+			peak = f;
+		sumSq += double(x3) * x3;
+		double mid = fabs((9.0f * (x1 + x2) - x0 - x3) * 0.0625f);
+		if (mid > tp)
+			tp = mid;
+		x0 = x1;
+		x1 = x2;
+		x2 = x3;
+	}
+	h[0] = x0;
+	h[1] = x1;
+	h[2] = x2;
+
+	peak *= gain;
+	tp *= gain;
+	_meter[ch] = peak;
+	_rms[ch] = nframes ? sqrt(sumSq / nframes) * gain : 0.0;
+	_truePeak[ch] = tp > peak ? tp : peak;
+	if (peak >= 1.0)
+		++_clips[ch];
+	if (_meter[ch] > _peak[ch])
+		_peak[ch] = _meter[ch];
 }
 
 //---------------------------------------------------------
@@ -1224,7 +1221,10 @@ void Track::resetMeter()
 void Track::resetPeaks()
 {
 	for (int i = 0; i < _channels; ++i)
+	{
 		_peak[i] = 0.0;
+		_clips[i] = 0;
+	}
 	_lastActivity = 0;
 }
 
@@ -1307,23 +1307,34 @@ bool WaveTrack::canEnableRecord() const
 
 //---------------------------------------------------------
 //   record
+//    called from the audio recorder thread. Consecutive
+//    fifo buffers are copied into stage and written with a
+//    single seek and write. Nothing is done until at least
+//    minBlocks buffers are queued.
+//    returns the number of frames written
 //---------------------------------------------------------
 
-void AudioTrack::record()
+unsigned AudioTrack::record(float** stage, unsigned stageFrames, int minBlocks)
 {
 	unsigned pos = 0;
 	float* buffer[_channels];
+	unsigned runPos = 0; // file position of the staged frames
+	unsigned runFrames = 0; // frames staged
+	unsigned written = 0;
 
 	//printf("AudioTrack: record() fifo %p, count=%d\n", &fifo, fifo.getCount());
 
+	if (fifo.getCount() < minBlocks)
+		return 0;
+
 	while (fifo.getCount())
 	{
 
-		if (fifo.get(_channels, segmentSize, buffer, &pos))
+		if (fifo.peek(_channels, segmentSize, buffer, &pos))
 		{
 			if(debugMsg)
 				printf("AudioTrack::record(): empty fifo\n");
-			return;
+			break;
 		}
 		if (_recFile)
 		{
@@ -1371,15 +1382,33 @@ void AudioTrack::record()
 			{
 				pos -= fr;
 
-				_recFile->seek(pos, 0);
-				_recFile->write(_channels, buffer, segmentSize);
+				if (runFrames && (pos != runPos + runFrames || runFrames + segmentSize > stageFrames))
+				{
+					_recFile->seek(runPos, 0);
+					_recFile->write(_channels, stage, runFrames);
+					written += runFrames;
+					runFrames = 0;
+				}
+				if (runFrames == 0)
+					runPos = pos;
+				for (int ch = 0; ch < _channels; ++ch)
+					memcpy(stage[ch] + runFrames, buffer[ch], segmentSize * sizeof(float));
+				runFrames += segmentSize;
 			}
 		}
 		else
 		{
 			printf("AudioNode::record(): no recFile\n");
 		}
+		fifo.remove();
+	}
+	if (runFrames)
+	{
+		_recFile->seek(runPos, 0);
+		_recFile->write(_channels, stage, runFrames);
+		written += runFrames;
 	}
+	return written;
 }
 
 //---------------------------------------------------------
@@ -1418,9 +1447,10 @@ void AudioOutput::process(unsigned pos, unsigned offset, unsigned n)
 	printf("OOMidi: AudioOutput::process name:%s processed:%d\n", name().toLatin1().constData(), processed());
 #endif
 
+	float** out = _renderBuffers ? _renderBuffers : buffer;
 	for (int i = 0; i < _channels; ++i)
 	{
-		buffer1[i] = buffer[i] + offset;
+		buffer1[i] = out[i] + offset;
 	}
 
 	copyData(pos, _channels, -1, -1, n, buffer1);
@@ -1549,6 +1579,7 @@ bool Fifo::put(int segs, unsigned long samples, float** src, unsigned pos)
 
 	if (oom_atomic_read(&count) == nbuffer)
 	{
+		++_overruns;
 		if(debugMsg)
 			printf("FIFO %p overrun... %d\n", this, count.counter);
 		return true;
@@ -1586,6 +1617,9 @@ bool Fifo::put(int segs, unsigned long samples, float** src, unsigned pos)
 		//memcpy(b->buffer + i * samples, src[i], samples * sizeof(float));
 		AL::dsp->cpy(b->buffer + i * samples, src[i], samples);
 	add();
+	int c = oom_atomic_read(&count);
+	if (c > _highWater)
+		_highWater = c;
 	return false;
 }
 
@@ -1595,9 +1629,23 @@ bool Fifo::put(int segs, unsigned long samples, float** src, unsigned pos)
 //---------------------------------------------------------
 
 bool Fifo::get(int segs, unsigned long samples, float** dst, unsigned* pos)
+{
+	if (peek(segs, samples, dst, pos))
+		return true;
+	remove();
+	return false;
+}
+
+//---------------------------------------------------------
+//   peek
+//    like get() but leaves the buffer in the fifo, the
+//    reader calls remove() when it is done with the data
+//---------------------------------------------------------
+
+bool Fifo::peek(int segs, unsigned long samples, float** dst, unsigned* pos)
 {
 #ifdef FIFO_DEBUG
-	printf("FIFO::get segs:%d samples:%lu\n", segs, samples);
+	printf("FIFO::peek segs:%d samples:%lu\n", segs, samples);
 #endif
 
 	if (oom_atomic_read(&count) == 0)
@@ -1619,7 +1667,6 @@ bool Fifo::get(int segs, unsigned long samples, float** dst, unsigned* pos)
 
 	for (int i = 0; i < segs; ++i)
 		dst[i] = b->buffer + samples * (i % b->segs);
-	remove();
 	return false;
 }
 
@@ -125,6 +125,8 @@ class Fifo {
     int widx; // write index; only touched by writer
     oom_atomic_t count; // buffer count; writer increments, reader decrements
     FifoBuffer** buffer;
+    volatile int _highWater; // most buffers ever queued; only touched by writer
+    volatile int _overruns;  // buffers dropped because the fifo was full
 
 public:
     Fifo();
@@ -134,13 +136,30 @@ public:
         ridx = 0;
         widx = 0;
         oom_atomic_set(&count, 0);
+        resetStats();
     }
     bool put(int, unsigned long, float** buffer, unsigned pos);
     bool getWriteBuffer(int, unsigned long, float** buffer, unsigned pos);
     void add();
     bool get(int, unsigned long, float** buffer, unsigned* pos);
+    bool peek(int, unsigned long, float** buffer, unsigned* pos);
     void remove();
     int getCount();
+
+    int size() const {
+        return nbuffer;
+    }
+    int highWater() const {
+        return _highWater;
+    }
+    int overruns() const {
+        return _overruns;
+    }
+    // only while the writer is idle
+    void resetStats() {
+        _highWater = 0;
+        _overruns = 0;
+    }
 };
 
 #endif
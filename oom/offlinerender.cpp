@@ -0,0 +1,299 @@
+//=========================================================
+//  OOMidi
+//  OpenOctave Midi and Audio Editor
+//=========================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sndfile.h>
+
+#include "offlinerender.h"
+#include "audio.h"
+#include "globals.h"
+#include "song.h"
+#include "track.h"
+#include "wave.h"
+
+//---------------------------------------------------------
+//   StemWriter
+//---------------------------------------------------------
+
+StemWriter::StemWriter()
+: m_fifo(64)
+{
+    m_done.storeRelease(0);
+    m_failed.storeRelease(0);
+}
+
+//---------------------------------------------------------
+//   put
+//    blocks while the writer is behind
+//---------------------------------------------------------
+
+void StemWriter::put(const RenderChunk& chunk)
+{
+    while (m_fifo.put(chunk))
+        usleep(1000);
+}
+
+//---------------------------------------------------------
+//   finish
+//    writes what is queued and stops the thread
+//---------------------------------------------------------
+
+void StemWriter::finish()
+{
+    m_done.fetchAndStoreOrdered(1);
+    wait();
+}
+
+//---------------------------------------------------------
+//   run
+//---------------------------------------------------------
+
+void StemWriter::run()
+{
+    for (;;)
+    {
+        bool done = m_done.loadAcquire();
+        RenderChunk c;
+        if (m_fifo.get(c))
+        {
+            if (!m_failed.loadAcquire())
+            {
+                float* buffer[MAX_CHANNELS];
+                for (int ch = 0; ch < c.channels; ++ch)
+                    buffer[ch] = c.data + ch * OfflineRender::CHUNK_FRAMES;
+                if (c.file->write(c.channels, buffer, c.frames) != c.frames)
+                {
+                    printf("OfflineRender: write to <%s> failed: %s\n",
+                           c.file->path().toLocal8Bit().constData(),
+                           c.file->strerror().toLocal8Bit().constData());
+                    m_failed.storeRelease(1);
+                }
+            }
+            free(c.data);
+            continue;
+        }
+        if (done)
+            break;
+        usleep(1000);
+    }
+}
+
+//---------------------------------------------------------
+//   OfflineRender
+//---------------------------------------------------------
+
+OfflineRender::OfflineRender()
+{
+    for (int ch = 0; ch < MAX_CHANNELS; ++ch)
+        m_outBuffer[ch] = 0;
+}
+
+OfflineRender::~OfflineRender()
+{
+    cleanup();
+}
+
+//---------------------------------------------------------
+//   addStem
+//    returns true if the file could not be created
+//---------------------------------------------------------
+
+bool OfflineRender::addStem(AudioTrack* track, const QString& path)
+{
+    Stem s;
+    s.track = track;
+    s.channels = track->channels();
+    s.file = new SndFile(path);
+    s.file->setFormat(SF_FORMAT_WAV | SF_FORMAT_FLOAT, s.channels, sampleRate);
+    if (s.file->openWrite())
+    {
+        printf("OfflineRender: cannot create <%s>\n", path.toLocal8Bit().constData());
+        delete s.file;
+        return true;
+    }
+    for (int ch = 0; ch < MAX_CHANNELS; ++ch)
+        s.tap[ch] = 0;
+    for (int ch = 0; ch < s.channels; ++ch)
+        s.tap[ch] = (float*) calloc(segmentSize, sizeof (float));
+    s.chunk = 0;
+    s.chunkFrames = 0;
+    s.writer = 0;
+    m_stems.append(s);
+    return false;
+}
+
+//---------------------------------------------------------
+//   flushChunk
+//---------------------------------------------------------
+
+void OfflineRender::flushChunk(Stem& s)
+{
+    if (!s.chunk || !s.chunkFrames)
+        return;
+    RenderChunk c;
+    c.file = s.file;
+    c.channels = s.channels;
+    c.frames = s.chunkFrames;
+    c.data = s.chunk;
+    s.writer->put(c);
+    s.chunk = 0;
+    s.chunkFrames = 0;
+}
+
+//---------------------------------------------------------
+//   writeFailed
+//---------------------------------------------------------
+
+bool OfflineRender::writeFailed() const
+{
+    for (int i = 0; i < m_writers.size(); ++i)
+    {
+        if (m_writers[i]->failed())
+            return true;
+    }
+    return false;
+}
+
+//---------------------------------------------------------
+//   render
+//    gui thread. Blocks until all stems are written and
+//    closed. Returns true on error, also if a stem could
+//    not be written completely.
+//---------------------------------------------------------
+
+bool OfflineRender::render(unsigned startFrame, unsigned endFrame)
+{
+    if (m_stems.isEmpty() || endFrame <= startFrame)
+        return true;
+
+    int nwriters = QThread::idealThreadCount() - 1;
+    if (nwriters < 1)
+        nwriters = 1;
+    if (nwriters > m_stems.size())
+        nwriters = m_stems.size();
+    for (int i = 0; i < nwriters; ++i)
+    {
+        StemWriter* w = new StemWriter();
+        m_writers.append(w);
+        w->start();
+    }
+    for (int i = 0; i < m_stems.size(); ++i)
+    {
+        m_stems[i].writer = m_writers[i % nwriters];
+        m_stems[i].track->setRenderTap(m_stems[i].tap);
+    }
+
+    for (int ch = 0; ch < MAX_CHANNELS; ++ch)
+        m_outBuffer[ch] = (float*) calloc(segmentSize, sizeof (float));
+    OutputList* ol = song->outputs();
+    for (iAudioOutput i = ol->begin(); i != ol->end(); ++i)
+        (*i)->setRenderBuffers(m_outBuffer);
+
+    audio->msgIdle(true);
+    audio->renderStart(startFrame);
+
+    QList<AudioTrack*> unrouted;
+    bool err = false;
+    for (unsigned pos = startFrame; pos < endFrame; pos += segmentSize)
+    {
+        if (writeFailed())
+        {
+            err = true;
+            break;
+        }
+        for (int i = 0; i < m_stems.size(); ++i)
+        {
+            Stem& s = m_stems[i];
+            for (int ch = 0; ch < s.channels; ++ch)
+                memset(s.tap[ch], 0, sizeof (float) * segmentSize);
+        }
+
+        audio->renderCycle(segmentSize);
+
+        // A track routed only into tracks nothing pulls (an
+        // off group for example) was skipped by the cycle. The
+        // outputs are done, so their buffers serve as scratch.
+        for (int i = 0; i < m_stems.size(); ++i)
+        {
+            AudioTrack* t = m_stems[i].track;
+            if (t->processed())
+                continue;
+            if (!unrouted.contains(t))
+            {
+                printf("OfflineRender: no output pulls <%s>, rendering it on its own\n",
+                       t->name().toLocal8Bit().constData());
+                unrouted.append(t);
+            }
+            t->copyData(pos, m_stems[i].channels, -1, -1, segmentSize, m_outBuffer);
+        }
+
+        unsigned n = endFrame - pos;
+        if (n > segmentSize)
+            n = segmentSize;
+        for (int i = 0; i < m_stems.size(); ++i)
+        {
+            Stem& s = m_stems[i];
+            if (!s.chunk)
+                s.chunk = (float*) malloc(sizeof (float) * s.channels * CHUNK_FRAMES);
+            for (int ch = 0; ch < s.channels; ++ch)
+                memcpy(s.chunk + ch * CHUNK_FRAMES + s.chunkFrames, s.tap[ch], sizeof (float) * n);
+            s.chunkFrames += n;
+            if (s.chunkFrames + segmentSize > CHUNK_FRAMES)
+                flushChunk(s);
+        }
+    }
+
+    audio->renderStop();
+    for (iAudioOutput i = ol->begin(); i != ol->end(); ++i)
+        (*i)->setRenderBuffers(0);
+    for (int i = 0; i < m_stems.size(); ++i)
+        m_stems[i].track->setRenderTap(0);
+    audio->msgIdle(false);
+
+    for (int i = 0; i < m_stems.size(); ++i)
+        flushChunk(m_stems[i]);
+    if (cleanup())
+        err = true;
+    return err;
+}
+
+//---------------------------------------------------------
+//   cleanup
+//    waits for the writers and closes the stem files,
+//    returns true if a stem could not be written
+//---------------------------------------------------------
+
+bool OfflineRender::cleanup()
+{
+    bool err = false;
+    for (int i = 0; i < m_writers.size(); ++i)
+    {
+        m_writers[i]->finish();
+        if (m_writers[i]->failed())
+            err = true;
+        delete m_writers[i];
+    }
+    m_writers.clear();
+
+    for (int i = 0; i < m_stems.size(); ++i)
+    {
+        Stem& s = m_stems[i];
+        free(s.chunk);
+        for (int ch = 0; ch < s.channels; ++ch)
+            free(s.tap[ch]);
+        delete s.file; // closes
+    }
+    m_stems.clear();
+
+    for (int ch = 0; ch < MAX_CHANNELS; ++ch)
+    {
+        free(m_outBuffer[ch]);
+        m_outBuffer[ch] = 0;
+    }
+    return err;
+}
@@ -0,0 +1,114 @@
+//=========================================================
+//  OOMidi
+//  OpenOctave Midi and Audio Editor
+//
+//  faster than realtime rendering of stems without jack
+//=========================================================
+
+#ifndef __OFFLINERENDER_H__
+#define __OFFLINERENDER_H__
+
+#include <QList>
+#include <QString>
+#include <QThread>
+
+#include "globaldefs.h"
+#include "lockfree.h"
+
+class AudioTrack;
+class SndFile;
+
+//---------------------------------------------------------
+//   RenderChunk
+//    planar samples of one stem handed to a writer
+//---------------------------------------------------------
+
+struct RenderChunk
+{
+    SndFile* file;
+    int channels;
+    unsigned frames;
+    float* data; // channels * OfflineRender::CHUNK_FRAMES, owned by the writer
+};
+
+//---------------------------------------------------------
+//   StemWriter
+//    background thread writing the chunks of the stems
+//    assigned to it. Every stem belongs to exactly one
+//    writer, so its chunks stay in order. A failed write
+//    is sticky, later chunks are dropped.
+//---------------------------------------------------------
+
+class StemWriter : public QThread
+{
+    LockFreeFifo<RenderChunk> m_fifo;
+    QAtomicInt m_done;
+    QAtomicInt m_failed;
+
+    virtual void run();
+
+public:
+    StemWriter();
+
+    void put(const RenderChunk& chunk);
+    void finish();
+
+    bool failed() const
+    {
+        return m_failed.loadAcquire();
+    }
+};
+
+//---------------------------------------------------------
+//   OfflineRender
+//    Renders any number of audio tracks or outputs in one
+//    pass by driving Audio::renderCycle() directly, as fast
+//    as the cpu allows. Every stem taps the post fader
+//    output of its track; encoding and writing the files
+//    is spread over one StemWriter per spare core. The
+//    mixing graph itself stays single threaded, it relies
+//    on the per cycle processed flags of the tracks.
+//    A stem whose track no output pulls is processed on
+//    its own after the cycle.
+//    Midi sent to external devices is not rendered.
+//---------------------------------------------------------
+
+class OfflineRender
+{
+    struct Stem
+    {
+        AudioTrack* track;
+        SndFile* file;
+        int channels;
+        float* tap[MAX_CHANNELS]; // one cycle
+        float* chunk;             // planar, CHUNK_FRAMES per channel
+        unsigned chunkFrames;
+        StemWriter* writer;
+    };
+
+    QList<Stem> m_stems;
+    QList<StemWriter*> m_writers;
+    float* m_outBuffer[MAX_CHANNELS]; // scratch output for every AudioOutput
+
+    OfflineRender(const OfflineRender&);
+    OfflineRender& operator=(const OfflineRender&);
+
+    void flushChunk(Stem& s);
+    bool writeFailed() const;
+    bool cleanup();
+
+public:
+    enum { CHUNK_FRAMES = 65536 };
+
+    OfflineRender();
+    ~OfflineRender();
+
+    bool addStem(AudioTrack* track, const QString& path); // returns true on error
+    int stems() const
+    {
+        return m_stems.size();
+    }
+    bool render(unsigned startFrame, unsigned endFrame); // returns true on error
+};
+
+#endif
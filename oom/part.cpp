@@ -25,6 +25,7 @@
 #include "StretchDialog.h"
 
 int Part::snGen;
+QAtomicInt partsGeneration;
 
 //---------------------------------------------------------
 //   unchainClone
@@ -884,6 +885,7 @@ float WavePart::getFadeInValue(unsigned pos, QList<FadeCurve *> fades)
 
 Part::~Part()
 {
+	partsGeneration.ref();
 	_events->incRef(-1);
 	if (_events->refCount() <= 0)
 		delete _events;
@@ -973,6 +975,7 @@ iPart PartList::add(Part* part)
 	// Note that in a oom file, the tempo list is loaded AFTER all the tracks.
 	// There was a bug that all the wave parts' tick values were not correct,
 	// since they were computed BEFORE the tempo map was loaded.
+	partsGeneration.ref();
 	if (part->type() == Pos::FRAMES)
 		return insert(std::pair<const int, Part*> (part->frame(), part));
 	else
@@ -985,6 +988,7 @@ iPart PartList::add(Part* part)
 
 void PartList::remove(Part* part)
 {
+	partsGeneration.ref();
 	iPart i;
 	for (i = begin(); i != end(); ++i)
 	{
@@ -1069,10 +1073,10 @@ void Song::cmdResizePart(Track* track, Part* oPart, unsigned int len)/*{{{*/
 					SndFileR file = e.sndFile();
 					if (!file.isNull())
 					{
-						clipframes = (file.samples() - e.spos());
+						clipframes = (file.sessionSamples() - e.spos());
 						//printf("SndFileR samples=%d channels=%d event samplepos=%d event frame=%d clipframes=%d \n", file.samples(), file.channels(), e.spos(), e.frame(), clipframes);
 					}
-					unsigned int samples = file.samples();
+					unsigned int samples = file.sessionSamples();
 					unsigned int samplepos = e.spos();
 					unsigned maxsamples = samples - samplepos;
 					unsigned int maxpos = part_start + maxsamples;
@@ -1142,7 +1146,7 @@ void Song::cmdResizePart(Track* track, Part* oPart, unsigned int len)/*{{{*/
 					if (file.isNull())
 						return;
 
-					unsigned int samples = file.samples();
+					unsigned int samples = file.sessionSamples();
 					unsigned int samplepos = last.spos();
 					unsigned maxsamples = samples - samplepos;
 					unsigned int maxpos = part_start + maxsamples;
@@ -1151,7 +1155,7 @@ void Song::cmdResizePart(Track* track, Part* oPart, unsigned int len)/*{{{*/
 						new_partlength = maxpos;
 					}
 					printf("Part start: %d, Event start: %d\n", part_start, last_start);
-					unsigned clipframes = (file.samples() - last.spos());
+					unsigned clipframes = (file.sessionSamples() - last.spos());
 					Event newEvent = last.clone();
 					//printf("SndFileR samples=%d channels=%d event samplepos=%d clipframes=%d\n", file.samples(), file.channels(), last.spos(), clipframes);
 
@@ -1285,7 +1289,7 @@ void Song::cmdResizePartLeft(Track* track, Part* oPart, unsigned int len, unsign
 						song->update(SC_SELECTION);
 						return;
 					}
-					unsigned totalFrames = file.samples();
+					unsigned totalFrames = file.sessionSamples();
 					unsigned currentFrames = old_length;//totalFrames - (e.spos()+e.rightClip());
 					unsigned remainingFrames = (totalFrames - currentFrames);
 					int min = (old_start - remainingFrames)+oPart->rightClip();
@@ -1440,7 +1444,7 @@ void Track::splitPart(Part* part, int tickpos, Part*& p1, Part*& p2)
 				SndFileR file = si.sndFile();
 				if (!file.isNull())
 				{
-					clipframes = (file.samples() - si.spos());
+					clipframes = (file.sessionSamples() - si.spos());
 					rclip = clipframes - si.lenFrame();
 					si.setRightClip(rclip);
 					p1->setRightClip(rclip);
@@ -1455,7 +1459,7 @@ void Track::splitPart(Part* part, int tickpos, Part*& p1, Part*& p2)
 				SndFileR file = si.sndFile();
 				if (!file.isNull())
 				{
-					clipframes = (file.samples() - si.spos());
+					clipframes = (file.sessionSamples() - si.spos());
 					rclip = clipframes - si.lenFrame();
 					si.setRightClip(rclip);
 				}
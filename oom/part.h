@@ -12,6 +12,7 @@
 #include <map>
 
 #include <uuid/uuid.h>
+#include <QAtomicInt>
 #include <QList>
 
 #include "event.h"
@@ -149,6 +150,12 @@ public:
         return _events;
     }
 
+    //! the caller moves the references, see Song::swapPartEvents()
+    void setEvents(EventList* el)
+    {
+        _events = el;
+    }
+
     int colorIndex() const
     {
         return _colorIndex;
@@ -318,6 +325,11 @@ extern void addPortCtrlEvents(Event& event, Part* part, bool doClones);
 extern void removePortCtrlEvents(Part* part, bool doClones);
 extern void removePortCtrlEvents(Event& event, Part* part, bool doClones);
 extern CloneList cloneList;
+
+//! moves whenever a part list gains or loses a part, a part is
+//! deleted or a track is added to or removed from the song.
+//! Caches holding Part pointers rebuild when it changed
+extern QAtomicInt partsGeneration;
 extern Part* readXmlPart(Xml&, Track*, bool doClone = false, bool toTrack = true);
 
 #endif
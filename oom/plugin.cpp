@@ -55,6 +55,7 @@
 #include "audiodev.h"
 #include "track.h"
 #include "al/dsp.h"
+#include "dspprofiler.h"
 
 #include "lib_functions.h"
 
@@ -119,7 +120,7 @@ QString BasePlugin::getAudioOutputPortName(uint32_t index)
 
 void BasePlugin::processSynth(MPEventList* eventList)
 {
-    if (m_enabled && m_aoutsCount > 0)
+    if (m_gate.isOpen() && m_aoutsCount > 0)
     {
         float* ains_buffer[m_ainsCount];
         float* aouts_buffer[m_aoutsCount];
@@ -143,6 +144,194 @@ void BasePlugin::processSynth(MPEventList* eventList)
     }
 }
 
+//---------------------------------------------------------
+//   updateControllers
+//    gui thread. Sets the track controllers of all
+//    parameters in one audio message, a plugin may have
+//    more parameters than the event fifo holds.
+//---------------------------------------------------------
+
+void BasePlugin::updateControllers()
+{
+    if (! m_track || m_id == -1)
+        return;
+
+    audio->msgSetPluginCtrlVals(this);
+}
+
+//---------------------------------------------------------
+//   applyControllers
+//    called by the audio thread for msgSetPluginCtrlVals(),
+//    the gui thread waits meanwhile
+//---------------------------------------------------------
+
+void BasePlugin::applyControllers()
+{
+    if (! m_track || m_id == -1)
+        return;
+
+    for (uint32_t i = 0; i < m_paramCount; i++)
+        m_track->setPluginCtrlVal(genACnum(m_id, i), m_params[i].value);
+}
+
+//---------------------------------------------------------
+//   queueParameterEvent
+//    called from the gui thread. The value is applied by
+//    the audio thread at the start of the next process()
+//    cycle, or directly if the plugin is not running.
+//---------------------------------------------------------
+
+void BasePlugin::queueParameterEvent(uint32_t index, double value, unsigned int flags)
+{
+    if (index >= m_paramCount)
+        return;
+
+    ParameterEvent ev;
+    ev.index  = index;
+    ev.flags  = flags;
+    ev.serial = m_params[index].serial + 1;
+    ev.value  = value;
+
+    if (m_gate.isOpen())
+    {
+        // the serial only moves for events the audio thread
+        // will see, else idleParameters() would wait forever
+        // for it to catch up
+        if (! m_paramsIn.put(ev))
+        {
+            m_params[index].serial = ev.serial;
+            return;
+        }
+
+        qWarning("BasePlugin::queueParameterEvent - fifo overflow, %s parameter %i dropped", m_name.toUtf8().constData(), index);
+    }
+    else
+    {
+        // not processing, safe to touch the plugin from here
+        m_params[index].serial = m_params[index].rtSerial = ev.serial;
+        if (flags & PARAMETER_EVENT_NATIVE)
+        {
+            m_params[index].tmpValue = value;
+            setNativeParameterValue(index, value);
+        }
+    }
+
+    if ((flags & PARAMETER_EVENT_CONTROLLER) && m_track && m_id != -1)
+        audio->msgSetPluginCtrlVal(m_track, genACnum(m_id, index), value, false);
+}
+
+//---------------------------------------------------------
+//   processParameterEvents
+//    called from process() in the audio thread before the
+//    plugin runs, applies all queued events
+//---------------------------------------------------------
+
+void BasePlugin::processParameterEvents()
+{
+    ParameterEvent ev;
+
+    while (m_paramsIn.get(ev))
+    {
+        if (ev.index >= m_paramCount)
+            continue;
+
+        ParameterPort* param = &m_params[ev.index];
+        param->rtSerial = ev.serial;
+
+        if (ev.flags & PARAMETER_EVENT_NATIVE)
+        {
+            param->tmpValue = ev.value;
+            setNativeParameterValue(ev.index, ev.value);
+            postParameterValue(ev.index, ev.value);
+        }
+
+        if ((ev.flags & PARAMETER_EVENT_CONTROLLER) && m_track && m_id != -1)
+            m_track->setPluginCtrlVal(genACnum(m_id, ev.index), ev.value);
+    }
+}
+
+//---------------------------------------------------------
+//   postParameterValue
+//    called from the audio thread when a parameter was
+//    changed by automation, by the plugin or an output
+//    port changed
+//---------------------------------------------------------
+
+void BasePlugin::postParameterValue(uint32_t index, double value, unsigned int flags)
+{
+    ParameterEvent ev;
+    ev.index  = index;
+    ev.flags  = flags;
+    ev.serial = m_params[index].rtSerial;
+    ev.value  = value;
+
+    if (m_paramsOut.put(ev))
+        m_paramsOutOverflow = true;
+}
+
+//---------------------------------------------------------
+//   idleParameters
+//    called from the gui thread at heartbeat rate, takes
+//    the values sent by the audio thread.
+//    Values older than the last gui change are ignored so
+//    a dragged control does not jump back.
+//---------------------------------------------------------
+
+void BasePlugin::idleParameters()
+{
+    ParameterEvent ev;
+
+    while (m_paramsOut.get(ev))
+    {
+        if (ev.index >= m_paramCount)
+            continue;
+
+        ParameterPort* param = &m_params[ev.index];
+
+        if (ev.flags & PARAMETER_EVENT_AUTOMATE)
+            recordParameterAutomation(ev.index, ev.value);
+
+        if (ev.serial != param->serial || param->value == ev.value)
+            continue;
+
+        param->value  = ev.value;
+        param->update = true;
+    }
+
+    if (m_paramsOutOverflow)
+    {
+        m_paramsOutOverflow = false;
+
+        for (uint32_t i = 0; i < m_paramCount; i++)
+        {
+            if (m_params[i].rtSerial == m_params[i].serial && m_params[i].value != m_params[i].tmpValue)
+            {
+                m_params[i].value  = m_params[i].tmpValue;
+                m_params[i].update = true;
+            }
+        }
+    }
+}
+
+//---------------------------------------------------------
+//   recordParameterAutomation
+//    gui thread, a parameter the plugin changed itself is
+//    written to the track automation
+//---------------------------------------------------------
+
+void BasePlugin::recordParameterAutomation(uint32_t index, double value)
+{
+    if (! m_track || m_id == -1)
+        return;
+
+    AutomationType at = m_track->automationType();
+
+    if (at == AUTO_WRITE || (audio->isPlaying() && at == AUTO_TOUCH))
+        enableController(index, false);
+
+    m_track->recordAutomation(genACnum(m_id, index), value);
+}
+
 //---------------------------------------------------------
 //   makeGui
 //---------------------------------------------------------
@@ -543,6 +732,9 @@ void SynthPluginDevice::showNativeGui(bool yesno)
 
 void SynthPluginDevice::updateNativeGui()
 {
+    if (m_plugin)
+        m_plugin->idleParameters();
+
     if (m_plugin && m_plugin->active() && m_plugin->hasNativeGui())
     //if (m_plugin && m_plugin->hasNativeGui())
         return m_plugin->updateNativeGui();
@@ -940,6 +1132,7 @@ void Pipeline::apply(int ports, uint32_t nframes, float** buffer1)
         BasePlugin* p = *ip;
         if (p && p->enabled())
         {
+            DspProbe probe(p, DspProfiler::PLUGIN);
             p->setChannels(ports);
 
             if (p->hints() & PLUGIN_HAS_IN_PLACE_BROKEN)
@@ -1081,6 +1274,7 @@ void Pipeline::updateGuis()
         BasePlugin* p = (BasePlugin*)*i;
         if(p)
         {
+            p->idleParameters();
             p->updateNativeGui();
             //if (p->gui())
             //    p->gui()->updateValues();
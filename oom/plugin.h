@@ -14,6 +14,7 @@
 #include "ctrl.h"
 #include "globals.h"
 #include "lib_functions.h"
+#include "lockfree.h"
 
 #include "mididev.h"
 #include "instruments/minstrument.h"
@@ -28,7 +29,6 @@
 #include <math.h>
 #include <stdint.h>
 #include <QFileInfo>
-#include <QMutex>
 
 // ladspa includes
 #include "ladspa.h"
@@ -99,6 +99,29 @@ enum ParameterType {
     PARAMETER_OUTPUT  = 2
 };
 
+// parameter event flags
+const unsigned int PARAMETER_EVENT_NATIVE     = 0x01; // set the plugin port
+const unsigned int PARAMETER_EVENT_CONTROLLER = 0x02; // set the track controller value
+const unsigned int PARAMETER_EVENT_AUTOMATE   = 0x04; // changed by the plugin itself, record it
+
+// parameter fifo sizes
+const int PARAMETER_FIFO_IN_SIZE  = 512;
+const int PARAMETER_FIFO_OUT_SIZE = 1024;
+
+//---------------------------------------------------------
+//   ParameterEvent
+//    a parameter change passed between the gui and the
+//    audio thread, applied at the start of the next
+//    process cycle
+//---------------------------------------------------------
+
+struct ParameterEvent {
+    uint32_t index;
+    unsigned int flags;
+    uint32_t serial;
+    double value;
+};
+
 //---------------------------------------------------------
 //   Control/Parameter Port
 //---------------------------------------------------------
@@ -112,6 +135,7 @@ public:
         hints  = 0;
         rindex = 0;
         value  = tmpValue = 0.0;
+        serial = rtSerial = 0;
 
         ranges.def = 0.0;
         ranges.min = 0.0;
@@ -137,8 +161,10 @@ public:
     ParameterType type;
     unsigned int hints;
     int32_t rindex;
-    double value;
-    double tmpValue;
+    double value;    // gui thread copy
+    double tmpValue; // audio thread copy
+    uint32_t serial;   // last change queued by the gui
+    uint32_t rtSerial; // last gui change seen by the audio thread
 
     struct {
         double def;
@@ -162,6 +188,8 @@ class BasePlugin
 {
 public:
     BasePlugin()
+        : m_paramsIn(PARAMETER_FIFO_IN_SIZE),
+          m_paramsOut(PARAMETER_FIFO_OUT_SIZE)
     {
         m_type = PLUGIN_NONE;
         m_hints = 0;
@@ -179,8 +207,9 @@ public:
         m_track = 0;
         m_gui = 0;
 
-        m_enabled = false; // wait for a reload() call
+        // m_gate starts closed, wait for a reload() call
         m_lib = 0;
+        m_paramsOutOverflow = false;
 
         // synths only
         m_ainsCount  = 0;
@@ -295,7 +324,7 @@ public:
 
     bool enabled()
     {
-        return m_enabled;
+        return m_gate.isOpen();
     }
 
     uint32_t getParameterCount()
@@ -372,14 +401,8 @@ public:
             m_params[i].en2Ctrl = yesno;
     }
 
-    void updateControllers()
-    {
-        if (! m_track)
-            return;
-
-        for (uint32_t i = 0; i < m_paramCount; i++)
-            audio->msgSetPluginCtrlVal(m_track, genACnum(m_id, i), m_params[i].value);
-    }
+    void updateControllers();
+    void applyControllers();
 
     CtrlValueType valueType() const
     {
@@ -403,13 +426,18 @@ public:
             if (m_params[index].hints & PARAMETER_IS_INTEGER)
                 value = rint(value);
 
-            m_params[index].value    = value;
-            m_params[index].tmpValue = value;
-            m_params[index].update   = true;
-            setNativeParameterValue(index, value);
+            m_params[index].value  = value;
+            m_params[index].update = true;
+            queueParameterEvent(index, value, PARAMETER_EVENT_NATIVE);
         }
     }
 
+    void setControllerValue(uint32_t index, double value)
+    {
+        if (index < m_paramCount && m_track && m_id != -1)
+            queueParameterEvent(index, value, PARAMETER_EVENT_CONTROLLER);
+    }
+
     void setId(int id)
     {
         m_id = id;
@@ -427,15 +455,17 @@ public:
 
     void aboutToRemove()
     {
-        bool blocked = m_proc_lock.tryLock();
-        m_enabled = false;
-        if (blocked) m_proc_lock.unlock();
+        m_gate.close();
     }
     
     // needed for synths
     QString getAudioOutputPortName(uint32_t index);
     void processSynth(MPEventList* eventList);
 
+    // parameter fifos
+    void queueParameterEvent(uint32_t index, double value, unsigned int flags);
+    void idleParameters();
+
     void makeGui();
     void deleteGui();
     void showGui(bool yesno);
@@ -466,6 +496,13 @@ public:
     virtual void writeConfiguration(int level, Xml& xml) = 0;
 
 protected:
+    // audio thread only
+    void processParameterEvents();
+    void postParameterValue(uint32_t index, double value, unsigned int flags = PARAMETER_EVENT_NATIVE);
+
+    // gui thread
+    void recordParameterAutomation(uint32_t index, double value);
+
 	PluginType m_type;
     unsigned int m_hints;
 
@@ -488,9 +525,11 @@ protected:
     AudioTrack* m_track;
     PluginGui* m_gui;
 
-    bool m_enabled;
     void* m_lib;
-    QMutex m_proc_lock;
+    ProcessGate m_gate;
+    LockFreeFifo<ParameterEvent> m_paramsIn;  // gui -> audio
+    LockFreeFifo<ParameterEvent> m_paramsOut; // audio -> gui
+    volatile bool m_paramsOutOverflow;
 
     // synths only
     uint32_t m_ainsCount;
@@ -142,9 +142,9 @@ bool LadspaPlugin::init(QString filename, QString label)
 void LadspaPlugin::reload()
 {
     // safely disable plugin during reload
-    m_proc_lock.lock();
-    m_enabled = false;
-    m_proc_lock.unlock();
+    m_gate.close();
+    m_paramsIn.clear();
+    m_paramsOut.clear();
 
     // delete old data
     if (m_paramCount > 0)
@@ -396,9 +396,7 @@ void LadspaPlugin::reload()
     }
 
     // enable it again
-    m_proc_lock.lock();
-    m_enabled = true;
-    m_proc_lock.unlock();
+    m_gate.open();
 }
 
 void LadspaPlugin::reloadPrograms(bool)
@@ -458,24 +456,20 @@ void LadspaPlugin::updateNativeGui()
 
 void LadspaPlugin::process(uint32_t frames, float** src, float** dst, MPEventList*)
 {
-    if (descriptor && m_enabled)
+    if (descriptor && m_gate.enter())
     {
-        m_proc_lock.lock();
         // --------------------------
 
         if (m_active)
         {
-            // connect ports
             int ains  = m_audioInIndexes.size();
             int aouts = m_audioOutIndexes.size();
             bool need_buffer_copy  = false;
             bool need_extra_buffer = false;
+            int max = m_channels;
 
             if (ains == aouts)
             {
-                uint32_t pin, pout;
-                int max = m_channels;
-
                 if (aouts < m_channels)
                 {
                     max = aouts;
@@ -485,19 +479,18 @@ void LadspaPlugin::process(uint32_t frames, float** src, float** dst, MPEventLis
                 {
                     need_extra_buffer = true;
                 }
-
-                for (int i=0; i < max; i++)
-                {
-                    pin  = m_audioInIndexes.at(i);
-                    pout = m_audioOutIndexes.at(i);
-                    descriptor->connect_port(handle, pin, src[i]);
-                    descriptor->connect_port(handle, pout, dst[i]);
-                }
             }
             else
             {
                 // cannot proccess (this should not happen)
-                m_proc_lock.unlock();
+                m_gate.leave();
+                return;
+            }
+
+            if (need_extra_buffer && (m_hints & PLUGIN_HAS_IN_PLACE_BROKEN))
+            {
+                // cannot proccess
+                m_gate.leave();
                 return;
             }
 
@@ -513,48 +506,57 @@ void LadspaPlugin::process(uint32_t frames, float** src, float** dst, MPEventLis
             {
                 for (uint32_t i = 0; i < m_paramCount; i++)
                 {
+                    double value = m_params[i].tmpValue;
+
                     if (m_params[i].enCtrl && m_params[i].en2Ctrl)
-                    {
-                        m_params[i].tmpValue = m_track->pluginCtrlVal(genACnum(m_id, i));
-                    }
+                        value = m_track->pluginCtrlVal(genACnum(m_id, i));
 
-                    if (m_params[i].value != m_params[i].tmpValue)
+                    if (value != m_params[i].tmpValue)
                     {
-                        m_params[i].value = m_paramsBuffer[i] = m_params[i].tmpValue;
-                        m_params[i].update = true;
+                        m_params[i].tmpValue = m_paramsBuffer[i] = value;
+                        postParameterValue(i, value);
                     }
                 }
             }
 
-            // process
+            float extra_buffer[need_extra_buffer ? frames : 1];
             if (need_extra_buffer)
-            {
-                if (m_hints & PLUGIN_HAS_IN_PLACE_BROKEN)
-                {
-                    // cannot proccess
-                    m_proc_lock.unlock();
-                    return;
-                }
-
-                float extra_buffer[frames];
                 memset(extra_buffer, 0, sizeof(float)*frames);
 
+            // apply the queued parameter changes
+            processParameterEvents();
+
+            // connect ports
+            for (int i=0; i < max; i++)
+            {
+                descriptor->connect_port(handle, m_audioInIndexes.at(i), src[i]);
+                descriptor->connect_port(handle, m_audioOutIndexes.at(i), dst[i]);
+            }
+
+            if (need_extra_buffer)
+            {
                 for (int i=m_channels; i < aouts ; i++)
                 {
                     descriptor->connect_port(handle, m_audioInIndexes.at(i), extra_buffer);
                     descriptor->connect_port(handle, m_audioOutIndexes.at(i), extra_buffer);
                 }
-
-                descriptor->run(handle, frames);
             }
-            else
+
+            descriptor->run(handle, frames);
+
+            if (need_buffer_copy)
             {
-                descriptor->run(handle, frames);
+                for (int i=aouts; i < m_channels ; i++)
+                    memcpy(dst[i], dst[i-1], sizeof(float)*frames);
+            }
 
-                if (need_buffer_copy)
+            // send output ports to the gui
+            for (uint32_t i = 0; i < m_paramCount; i++)
+            {
+                if (m_params[i].type == PARAMETER_OUTPUT && m_paramsBuffer[i] != m_params[i].tmpValue)
                 {
-                    for (int i=aouts; i < m_channels ; i++)
-                        memcpy(dst[i], dst[i-1], sizeof(float)*frames);
+                    m_params[i].tmpValue = m_paramsBuffer[i];
+                    postParameterValue(i, m_paramsBuffer[i]);
                 }
             }
         }
@@ -565,12 +567,14 @@ void LadspaPlugin::process(uint32_t frames, float** src, float** dst, MPEventLis
                 if (descriptor->deactivate)
                     descriptor->deactivate(handle);
             }
+
+            processParameterEvents();
         }
 
         m_activeBefore = m_active;
 
         // --------------------------
-        m_proc_lock.unlock();
+        m_gate.leave();
     }
 }
 
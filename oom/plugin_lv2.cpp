@@ -1019,9 +1019,9 @@ bool Lv2Plugin::init(QString filename, QString label)
 void Lv2Plugin::reload()
 {
     // safely disable plugin during reload
-    m_proc_lock.lock();
-    m_enabled = false;
-    m_proc_lock.unlock();
+    m_gate.close();
+    m_paramsIn.clear();
+    m_paramsOut.clear();
 
     // delete old data
     if (m_paramCount > 0)
@@ -1328,11 +1328,7 @@ void Lv2Plugin::reload()
 
     // enable it again (only if jack is active, otherwise non-needed)
     if (audioDevice && audioDevice->isJackAudio())
-    {
-        m_proc_lock.lock();
-        m_enabled = true;
-        m_proc_lock.unlock();
-    }
+        m_gate.open();
 }
 
 void Lv2Plugin::reloadPrograms(bool /*init*/)
@@ -1659,7 +1655,10 @@ void Lv2Plugin::updateGuiPorts(bool onlyOutput)
                     m_gui->setParameterValue(i, m_params[i].value);
 
                 if (update_native)
-                    ui.descriptor->port_event(ui.handle, m_params[i].rindex, sizeof(float), 0, &m_paramsBuffer[i]);
+                {
+                    float value = m_params[i].value;
+                    ui.descriptor->port_event(ui.handle, m_params[i].rindex, sizeof(float), 0, &value);
+                }
 
                 m_params[i].update = false;
             }
@@ -1725,7 +1724,7 @@ void Lv2Plugin::ui_write_function(uint32_t port_index, uint32_t buffer_size, uin
                     value = rint(value);
 
                 // same as setParameteValue
-                m_params[param_id].value = m_params[param_id].tmpValue = m_paramsBuffer[param_id] = value;
+                m_params[param_id].value = value;
                 m_params[param_id].update = true;
 
                 // Record automation from plugin's native UI
@@ -1736,11 +1735,11 @@ void Lv2Plugin::ui_write_function(uint32_t port_index, uint32_t buffer_size, uin
                     if (at == AUTO_WRITE || (audio->isPlaying() && at == AUTO_TOUCH))
                         enableController(param_id, false);
 
-                    int id = genACnum(m_id, param_id);
-
-                    audio->msgSetPluginCtrlVal(m_track, id, value, false);
-                    m_track->recordAutomation(id, value);
+                    queueParameterEvent(param_id, value, PARAMETER_EVENT_NATIVE|PARAMETER_EVENT_CONTROLLER);
+                    m_track->recordAutomation(genACnum(m_id, param_id), value);
                 }
+                else
+                    queueParameterEvent(param_id, value, PARAMETER_EVENT_NATIVE);
             }
         }
     }
@@ -1749,34 +1748,22 @@ void Lv2Plugin::ui_write_function(uint32_t port_index, uint32_t buffer_size, uin
 
 void Lv2Plugin::process(uint32_t frames, float** src, float** dst, MPEventList* eventList)
 {
-    if (descriptor && m_enabled)
+    if (descriptor && m_gate.enter())
     {
-        m_proc_lock.lock();
         // --------------------------
 
         if (m_active)
         {
-            // connect ports
             int ains  = m_audioInIndexes.size();
             int aouts = m_audioOutIndexes.size();
             bool need_buffer_copy  = false;
             bool need_extra_buffer = false;
+            int max = m_channels;
 
-            if (m_hints & PLUGIN_IS_SYNTH)
-            {
-                for (uint32_t i=0; i < m_ainsCount; i++)
-                    descriptor->connect_port(handle, m_audioInIndexes.at(i), src[i]);
-                
-                for (uint32_t i=0; i < m_aoutsCount; i++)
-                    descriptor->connect_port(handle, m_audioOutIndexes.at(i), dst[i]);
-            }
-            else if (m_hints & PLUGIN_IS_FX)
+            if ((m_hints & PLUGIN_IS_SYNTH) == 0 && (m_hints & PLUGIN_IS_FX))
             {
                 if (ains == aouts)
                 {
-                    uint32_t pin, pout;
-                    int max = m_channels;
-                    
                     if (aouts < m_channels)
                     {
                         max = aouts;
@@ -1786,26 +1773,25 @@ void Lv2Plugin::process(uint32_t frames, float** src, float** dst, MPEventList*
                     {
                         need_extra_buffer = true;
                     }
-                    
-                    for (int i=0; i < max; i++)
-                    {
-                        pin  = m_audioInIndexes.at(i);
-                        pout = m_audioOutIndexes.at(i);
-                        descriptor->connect_port(handle, pin, src[i]);
-                        descriptor->connect_port(handle, pout, dst[i]);
-                    }
                 }
                 else
                 {
                     // cannot proccess
-                    m_proc_lock.unlock();
+                    m_gate.leave();
                     return;
                 }
             }
-            else
+            else if ((m_hints & PLUGIN_IS_SYNTH) == 0)
+            {
+                // cannot proccess
+                m_gate.leave();
+                return;
+            }
+
+            if (need_extra_buffer && (m_hints & PLUGIN_HAS_IN_PLACE_BROKEN))
             {
                 // cannot proccess
-                m_proc_lock.unlock();
+                m_gate.leave();
                 return;
             }
 
@@ -1931,48 +1917,68 @@ void Lv2Plugin::process(uint32_t frames, float** src, float** dst, MPEventList*
             {
                 for (uint32_t i = 0; i < m_paramCount; i++)
                 {
+                    double value = m_params[i].tmpValue;
+
                     if (m_params[i].enCtrl && m_params[i].en2Ctrl)
-                    {
-                        m_params[i].tmpValue = m_track->pluginCtrlVal(genACnum(m_id, i));
-                    }
+                        value = m_track->pluginCtrlVal(genACnum(m_id, i));
 
-                    if (m_params[i].value != m_params[i].tmpValue)
+                    if (value != m_params[i].tmpValue)
                     {
-                        m_params[i].value = m_paramsBuffer[i] = m_params[i].tmpValue;
-                        m_params[i].update = true;
+                        m_params[i].tmpValue = m_paramsBuffer[i] = value;
+                        postParameterValue(i, value);
                     }
                 }
             }
 
-            // process
+            float extra_buffer[need_extra_buffer ? frames : 1];
             if (need_extra_buffer)
+                memset(extra_buffer, 0, sizeof(float)*frames);
+
+            // apply the queued parameter changes
+            processParameterEvents();
+
+            // connect ports
+            if (m_hints & PLUGIN_IS_SYNTH)
+            {
+                for (uint32_t i=0; i < m_ainsCount; i++)
+                    descriptor->connect_port(handle, m_audioInIndexes.at(i), src[i]);
+
+                for (uint32_t i=0; i < m_aoutsCount; i++)
+                    descriptor->connect_port(handle, m_audioOutIndexes.at(i), dst[i]);
+            }
+            else
             {
-                if (m_hints & PLUGIN_HAS_IN_PLACE_BROKEN)
+                for (int i=0; i < max; i++)
                 {
-                    // cannot proccess
-                    m_proc_lock.unlock();
-                    return;
+                    descriptor->connect_port(handle, m_audioInIndexes.at(i), src[i]);
+                    descriptor->connect_port(handle, m_audioOutIndexes.at(i), dst[i]);
                 }
 
-                float extra_buffer[frames];
-                memset(extra_buffer, 0, sizeof(float)*frames);
-
-                for (int i=m_channels; i < aouts ; i++)
+                if (need_extra_buffer)
                 {
-                    descriptor->connect_port(handle, m_audioInIndexes.at(i), extra_buffer);
-                    descriptor->connect_port(handle, m_audioOutIndexes.at(i), extra_buffer);
+                    for (int i=m_channels; i < aouts ; i++)
+                    {
+                        descriptor->connect_port(handle, m_audioInIndexes.at(i), extra_buffer);
+                        descriptor->connect_port(handle, m_audioOutIndexes.at(i), extra_buffer);
+                    }
                 }
-
-                descriptor->run(handle, frames);
             }
-            else
+
+            descriptor->run(handle, frames);
+
+            if (need_buffer_copy)
             {
-                descriptor->run(handle, frames);
+                for (int i=aouts; i < m_channels ; i++)
+                    memcpy(dst[i], dst[i-1], sizeof(float)*frames);
+            }
 
-                if (need_buffer_copy)
+            // send output ports to the gui
+            for (uint32_t i = 0; i < m_paramCount; i++)
+            {
+                if (m_params[i].type == PARAMETER_OUTPUT && m_paramsBuffer[i] != m_params[i].tmpValue)
                 {
-                    for (int i=aouts; i < m_channels ; i++)
-                        memcpy(dst[i], dst[i-1], sizeof(float)*frames);
+                    m_params[i].tmpValue = m_paramsBuffer[i];
+                    postParameterValue(i, m_paramsBuffer[i]);
                 }
             }
         }
@@ -1983,12 +1989,14 @@ void Lv2Plugin::process(uint32_t frames, float** src, float** dst, MPEventList*
                 if (descriptor->deactivate)
                     descriptor->deactivate(handle);
             }
+
+            processParameterEvents();
         }
 
         m_activeBefore = m_active;
 
         // --------------------------
-        m_proc_lock.unlock();
+        m_gate.leave();
     }
 }
 
@@ -33,6 +33,10 @@ struct VstTimeInfo_R
 };
 #endif
 
+// set while the current thread runs VstPlugin::process(), the
+// host callback then comes from the audio thread
+static __thread bool vstInProcess = false;
+
 VstPlugin* VstHostUserCheck(AEffect* effect)
 {
     if (effect && effect->user)
@@ -407,9 +411,9 @@ bool VstPlugin::init(QString filename, QString label)
 void VstPlugin::reload()
 {    
     // safely disable plugin during reload
-    m_proc_lock.lock();
-    m_enabled = false;
-    m_proc_lock.unlock();
+    m_gate.close();
+    m_paramsIn.clear();
+    m_paramsOut.clear();
 
     // delete old data
     if (m_paramCount > 0)
@@ -571,11 +575,7 @@ void VstPlugin::reload()
 
     // enable it again (only if jack is active, otherwise non-needed)
     if (audioDevice && audioDevice->isJackAudio())
-    {
-        m_proc_lock.lock();
-        m_enabled = true;
-        m_proc_lock.unlock();
-    }
+        m_gate.open();
 }
 
 void VstPlugin::reloadPrograms(bool)
@@ -667,24 +667,29 @@ void VstPlugin::setAutomatedParameterValue(uint32_t index, double value)
         if (m_params[index].hints & PARAMETER_IS_INTEGER)
             value = rint(value);
 
-        m_params[index].value = m_params[index].tmpValue = value;
-        m_params[index].update = true;
+        if (vstInProcess)
+        {
+            // Called back from processReplacing(). The plugin
+            // already has the value, the audio thread keeps it
+            // and tells the gui, which records the automation.
+            m_params[index].tmpValue = value;
+            if (m_track && m_id != -1)
+                m_track->setPluginCtrlVal(genACnum(m_id, index), value);
+            postParameterValue(index, value, PARAMETER_EVENT_NATIVE|PARAMETER_EVENT_AUTOMATE);
+            return;
+        }
 
-        effect->setParameter(effect, index, value);        
+        m_params[index].value = value;
+        m_params[index].update = true;
 
         // Record automation from plugin's native UI
         if (m_track && m_id != -1)
         {
-            AutomationType at = m_track->automationType();
-
-            if (at == AUTO_WRITE || (audio->isPlaying() && at == AUTO_TOUCH))
-                enableController(index, false);
-
-            int id = genACnum(m_id, index);
-
-            audio->msgSetPluginCtrlVal(m_track, id, value, false);
-            m_track->recordAutomation(id, value);
+            recordParameterAutomation(index, value);
+            queueParameterEvent(index, value, PARAMETER_EVENT_NATIVE|PARAMETER_EVENT_CONTROLLER);
         }
+        else
+            queueParameterEvent(index, value, PARAMETER_EVENT_NATIVE);
     }
 }
 
@@ -833,9 +838,9 @@ intptr_t VstPlugin::dispatcher(int32_t opcode, int32_t index, intptr_t value, vo
 
 void VstPlugin::process(uint32_t frames, float** src, float** dst, MPEventList* eventList)
 {
-    if (effect && m_enabled)
+    if (effect && m_gate.enter())
     {
-        m_proc_lock.lock();
+        vstInProcess = true;
         // --------------------------
 
         if (m_active)
@@ -843,7 +848,8 @@ void VstPlugin::process(uint32_t frames, float** src, float** dst, MPEventList*
             if ((m_hints & PLUGIN_IS_SYNTH) == 0 && (effect->numInputs != effect->numOutputs || effect->numOutputs != m_channels))
             {
                 // cannot proccess
-                m_proc_lock.unlock();
+                vstInProcess = false;
+                m_gate.leave();
                 return;
             }
 
@@ -914,20 +920,23 @@ void VstPlugin::process(uint32_t frames, float** src, float** dst, MPEventList*
             {
                 for (uint32_t i = 0; i < m_paramCount; i++)
                 {
+                    double value = m_params[i].tmpValue;
+
                     if (m_params[i].enCtrl && m_params[i].en2Ctrl)
-                    {
-                        m_params[i].tmpValue = m_track->pluginCtrlVal(genACnum(m_id, i));
-                    }
+                        value = m_track->pluginCtrlVal(genACnum(m_id, i));
 
-                    if (m_params[i].value != m_params[i].tmpValue)
+                    if (value != m_params[i].tmpValue)
                     {
-                        m_params[i].value = m_params[i].tmpValue;
-                        m_params[i].update = true;
-                        effect->setParameter(effect, i, m_params[i].value);
+                        m_params[i].tmpValue = value;
+                        effect->setParameter(effect, i, value);
+                        postParameterValue(i, value);
                     }
                 }
             }
 
+            // apply the queued parameter changes
+            processParameterEvents();
+
             effect->processReplacing(effect, src, dst, frames);
         }
         else
@@ -937,12 +946,15 @@ void VstPlugin::process(uint32_t frames, float** src, float** dst, MPEventList*
                 effect->dispatcher(effect, effStopProcess, 0, 0, 0, 0.0f);
                 effect->dispatcher(effect, effMainsChanged, 0, 0, 0, 0.0f);
             }
+
+            processParameterEvents();
         }
 
         m_activeBefore = m_active;
 
         // --------------------------
-        m_proc_lock.unlock();
+        vstInProcess = false;
+        m_gate.leave();
     }
 }
 
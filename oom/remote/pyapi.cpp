@@ -10,6 +10,8 @@
 #include <pthread.h>
 
 #include <QApplication>
+#include <QHash>
+#include <QMutex>
 
 #include "pyapi.h"
 #include "song.h"
@@ -131,24 +133,37 @@ PyObject* getTrackNames(PyObject*, PyObject*)
 }
 //------------------------------------------------------------
 // Find part by serial nr
+//  the index is rebuilt from the tracks whenever
+//  partsGeneration says parts or tracks were added or
+//  removed
 //------------------------------------------------------------
 
+static QMutex partIndexMutex;
+static QHash<int, Part*> partIndex;
+static int partIndexGeneration = -1;
+
 Part* findPartBySerial(int sn)
 {
-	TrackList* tracks = song->tracks();
-	for (ciTrack t = tracks->begin(); t != tracks->end(); ++t)
+	QMutexLocker locker(&partIndexMutex);
+	int generation = partsGeneration.loadAcquire();
+	if (generation != partIndexGeneration)
 	{
-		Track* track = *t;
-		PartList* parts = track->parts();
-		for (ciPart p = parts->begin(); p != parts->end(); p++)
+		partIndex.clear();
+		TrackList* tracks = song->tracks();
+		for (ciTrack t = tracks->begin(); t != tracks->end(); ++t)
 		{
-			Part* part = p->second;
-			if (part->sn() == sn)
-				return part;
+			PartList* parts = (*t)->parts();
+			for (ciPart p = parts->begin(); p != parts->end(); p++)
+			{
+				Part* part = p->second;
+				if (!partIndex.contains(part->sn()))
+					partIndex.insert(part->sn(), part);
+			}
 		}
+		partIndexGeneration = generation;
 	}
 
-	return NULL;
+	return partIndex.value(sn, NULL);
 }
 //------------------------------------------------------------
 // Get parts from track
@@ -395,22 +410,8 @@ PyObject* modifyPart(PyObject*, PyObject* part)
 {
 	int id = getPythonPartId(part);
 
-	Part* opart = NULL;
 	// Verify a part with that id actually exists, then get it
-	TrackList* tracks = song->tracks();
-	for (ciTrack t = tracks->begin(); t != tracks->end(); ++t)
-	{
-		Track* track = *t;
-		for (ciPart p = track->parts()->begin(); p != track->parts()->end(); p++)
-		{
-			if (p->second->sn() == id)
-			{
-				opart = p->second;
-				break;
-			}
-		}
-	}
-
+	Part* opart = findPartBySerial(id);
 	if (opart == NULL)
 	{
 		printf("Part doesn't exist!\n");
@@ -470,6 +471,218 @@ PyObject* deletePart(PyObject*, PyObject* args)
 	return Py_None;
 }
 
+//------------------------------------------------------------
+// Bulk event transfer
+//  notes and controllers of a part as packed records of
+//  native int32, readable with array.array('i', buf) or
+//  numpy.frombuffer(buf, 'int32').reshape(-1, 6):
+//
+//    type  0 note, 1 controller
+//    tick  relative to the part start
+//    len   note length in ticks, 0 for controllers
+//    a b c pitch velo veloOff / ctrl number value -
+//------------------------------------------------------------
+
+struct PyEventRecord
+{
+	qint32 type;
+	qint32 tick;
+	qint32 len;
+	qint32 a, b, c;
+};
+
+enum { PY_EVENT_NOTE = 0, PY_EVENT_CTRL = 1 };
+
+//------------------------------------------------------------
+// getPartIds
+//  [id, tick, len] of every part of a track, without events
+//------------------------------------------------------------
+
+PyObject* getPartIds(PyObject*, PyObject* args)
+{
+	const char* trackname;
+	if (!PyArg_ParseTuple(args, "s", &trackname))
+	{
+		return NULL;
+	}
+
+	Track* track = song->findTrack(trackname);
+	if (track == NULL)
+	{
+		PyErr_Format(PyExc_KeyError, "no track %s", trackname);
+		return NULL;
+	}
+
+	PartList* parts = track->parts();
+	PyObject* pyparts = PyList_New(0);
+	for (ciPart p = parts->begin(); p != parts->end(); p++)
+	{
+		Part* part = p->second;
+		PyObject* pypart = Py_BuildValue("[i,i,i]", part->sn(), part->tick(), part->lenTick());
+		PyList_Append(pyparts, pypart);
+		Py_DECREF(pypart);
+	}
+	return pyparts;
+}
+
+//------------------------------------------------------------
+// getPartEvents
+//  return a bytearray of records for part with serial nr
+//------------------------------------------------------------
+
+PyObject* getPartEvents(PyObject*, PyObject* args)
+{
+	int id;
+	if (!PyArg_ParseTuple(args, "i", &id))
+	{
+		return NULL;
+	}
+
+	Part* part = findPartBySerial(id);
+	if (part == NULL)
+	{
+		PyErr_Format(PyExc_KeyError, "no part with id %d", id);
+		return NULL;
+	}
+
+	EventList* events = part->events();
+	Py_ssize_t n = 0;
+	for (ciEvent e = events->begin(); e != events->end(); e++)
+	{
+		if (e->second.type() == Note || e->second.type() == Controller)
+			++n;
+	}
+
+	PyObject* buf = PyByteArray_FromStringAndSize(NULL, n * sizeof(PyEventRecord));
+	if (buf == NULL)
+		return NULL;
+	PyEventRecord* r = (PyEventRecord*) PyByteArray_AS_STRING(buf);
+	for (ciEvent e = events->begin(); e != events->end() && n; e++)
+	{
+		const Event& event = e->second;
+		if (event.type() == Note)
+		{
+			r->type = PY_EVENT_NOTE;
+			r->len = event.lenTick();
+		}
+		else if (event.type() == Controller)
+		{
+			r->type = PY_EVENT_CTRL;
+			r->len = 0;
+		}
+		else
+			continue;
+		r->tick = e->first;
+		r->a = event.dataA();
+		r->b = event.dataB();
+		r->c = event.dataC();
+		++r;
+		--n;
+	}
+	return buf;
+}
+
+//------------------------------------------------------------
+// postPartEvents
+//  hand a record buffer to the gui thread, which applies it
+//  to the part as one undoable step
+//------------------------------------------------------------
+
+static PyObject* postPartEvents(PyObject* args, bool replace)
+{
+	int id;
+	const char* data;
+	int size;
+	if (!PyArg_ParseTuple(args, "is#", &id, &data, &size))
+	{
+		return NULL;
+	}
+
+	if (size % sizeof(PyEventRecord))
+	{
+		PyErr_Format(PyExc_ValueError, "buffer size %d is not a multiple of %d", size, (int) sizeof(PyEventRecord));
+		return NULL;
+	}
+	if (findPartBySerial(id) == NULL)
+	{
+		PyErr_Format(PyExc_KeyError, "no part with id %d", id);
+		return NULL;
+	}
+
+	QPybridgeEvent* pyevent = new QPybridgeEvent(QPybridgeEvent::SONG_SET_PART_EVENTS, id, replace);
+	pyevent->setData(QByteArray(data, size));
+	QApplication::postEvent(song, pyevent);
+	Py_INCREF(Py_None);
+	return Py_None;
+}
+
+PyObject* setPartEvents(PyObject*, PyObject* args)
+{
+	return postPartEvents(args, true);
+}
+
+PyObject* addPartEvents(PyObject*, PyObject* args)
+{
+	return postPartEvents(args, false);
+}
+
+//------------------------------------------------------------
+// applyPartEvents
+//  gui thread side of setPartEvents/addPartEvents
+//------------------------------------------------------------
+
+static void applyPartEvents(int id, bool replace, const QByteArray& data)
+{
+	Part* part = findPartBySerial(id);
+	if (part == NULL)
+		return;
+
+	QList<PartEventsEdit> edits;
+	edits.append(PartEventsEdit());
+	PartEventsEdit& edit = edits.back();
+	edit.part = part;
+	if (replace)
+	{
+		EventList* events = part->events();
+		for (iEvent e = events->begin(); e != events->end(); e++)
+		{
+			if (e->second.type() == Note || e->second.type() == Controller)
+				edit.remove.append(e->second);
+		}
+	}
+
+	int n = data.size() / sizeof(PyEventRecord);
+	const PyEventRecord* r = (const PyEventRecord*) data.constData();
+	edit.add.reserve(n);
+	for (int i = 0; i < n; ++i, ++r)
+	{
+		if (r->type == PY_EVENT_NOTE)
+		{
+			Event event(Note);
+			event.setTick(r->tick);
+			event.setLenTick(r->len);
+			event.setA(r->a);
+			event.setB(r->b);
+			event.setC(r->c);
+			edit.add.append(event);
+		}
+		else if (r->type == PY_EVENT_CTRL)
+		{
+			Event event(Controller);
+			event.setTick(r->tick);
+			event.setA(r->a);
+			event.setB(r->b);
+			edit.add.append(event);
+		}
+		else
+			printf("Unhandled event type from python: %d\n", r->type);
+	}
+
+	song->startUndo();
+	audio->msgReplaceEvents(edits, false);
+	song->endUndo(SC_EVENT_REMOVED | SC_EVENT_INSERTED);
+}
+
 //------------------------------------------------------------
 // setPos
 //------------------------------------------------------------
@@ -1020,6 +1233,10 @@ PyMethodDef g_methodDefinitions[] ={
 	{ "createPart", createPart, METH_VARARGS, "Create a part"},
 	{ "modifyPart", modifyPart, METH_O, "Modify a particular part"},
 	{ "deletePart", deletePart, METH_VARARGS, "Remove part with a particular serial nr"},
+	{ "getPartIds", getPartIds, METH_VARARGS, "Get [id, tick, len] of the parts of a track"},
+	{ "getPartEvents", getPartEvents, METH_VARARGS, "Get notes and controllers of a part as packed int32 records"},
+	{ "setPartEvents", setPartEvents, METH_VARARGS, "Replace notes and controllers of a part from packed int32 records"},
+	{ "addPartEvents", addPartEvents, METH_VARARGS, "Add packed int32 records to a part"},
 	{ "getSelectedTrack", getSelectedTrack, METH_NOARGS, "Get first selected track"},
 	{ "importPart", importPart, METH_VARARGS, "Import part file to a track at a particular position"},
 	{ "changeTrackName", changeTrackName, METH_VARARGS, "Change track name"},
@@ -1231,6 +1448,9 @@ bool Song::event(QEvent* _e)
 			audio->msgRemoveTrack(t);
 			break;
 		}
+		case QPybridgeEvent::SONG_SET_PART_EVENTS:
+			applyPartEvents(e->getP1(), e->getP2(), e->getData());
+			break;
 		default:
 			printf("Unknown pythonthread event received: %d\n", e->getType());
 			break;
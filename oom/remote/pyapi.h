@@ -6,6 +6,7 @@
 #ifndef PYAPI_H
 #define PYAPI_H
 
+#include <QByteArray>
 #include <QEvent>
 
 class QPybridgeEvent : public QEvent
@@ -16,7 +17,7 @@ public:
     {
         SONG_UPDATE = 0, SONGLEN_CHANGE, SONG_POSCHANGE, SONG_SETPLAY, SONG_SETSTOP, SONG_REWIND, SONG_SETMUTE,
         SONG_SETCTRL, SONG_SETAUDIOVOL, SONG_IMPORT_PART, SONG_TOGGLE_EFFECT, SONG_ADD_TRACK, SONG_CHANGE_TRACKNAME,
-        SONG_DELETE_TRACK
+        SONG_DELETE_TRACK, SONG_SET_PART_EVENTS
     };
     QPybridgeEvent(QPybridgeEvent::EventType _type, int _p1 = 0, int _p2 = 0);
 
@@ -65,12 +66,23 @@ public:
         d1 = _d1;
     }
 
+    const QByteArray& getData()
+    {
+        return data;
+    }
+
+    void setData(const QByteArray& in)
+    {
+        data = in;
+    }
+
 private:
     EventType type;
     int p1, p2;
     double d1;
     QString s1;
     QString s2;
+    QByteArray data;
 
 };
 
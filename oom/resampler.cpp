@@ -0,0 +1,508 @@
+//=========================================================
+//  OOMidi
+//  OpenOctave Midi and Audio Editor
+//
+//  streaming sample rate conversion
+//=========================================================
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <sndfile.h>
+
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QThreadPool>
+
+#include "resampler.h"
+#include "gconfig.h"
+
+// filter phases, coefficients in between are interpolated
+static const int PHASES = 256;
+// taps on each side of the output position, when upsampling
+static const int HALF_TAPS = 16;
+// stopband about -90dB
+static const double KAISER_BETA = 8.6;
+// cutoff relative to the lower of the two nyquist rates
+static const double PASSBAND = 0.91;
+// output frames converted per step of a background render
+static const int RENDER_FRAMES = 4096;
+
+//---------------------------------------------------------
+//   Filter
+//    PHASES + 1 rows of taps coefficients, the last row is
+//    the first one delayed by a frame
+//---------------------------------------------------------
+
+struct Resampler::Filter
+{
+    int taps;
+    int phases;
+    std::vector<float> coeffs;
+};
+
+//---------------------------------------------------------
+//   besselI0
+//---------------------------------------------------------
+
+static double besselI0(double x)
+{
+    double sum = 1.0;
+    double term = 1.0;
+    double h = x * 0.5;
+    for (int k = 1; k < 64; ++k)
+    {
+        term *= (h / k) * (h / k);
+        sum += term;
+        if (term < sum * 1e-12)
+            break;
+    }
+    return sum;
+}
+
+//---------------------------------------------------------
+//   makeFilter
+//    kaiser windowed sinc, widened when downsampling so the
+//    cutoff follows the output rate
+//---------------------------------------------------------
+
+static Resampler::Filter* makeFilter(unsigned inRate, unsigned outRate)
+{
+    double scale = outRate < inRate ? double(outRate) / double(inRate) : 1.0;
+    double fc = PASSBAND * scale;
+    int quarter = Resampler::LANES / 2;
+    int half = int(ceil(HALF_TAPS / scale));
+    half = (half + quarter - 1) / quarter * quarter;
+
+    Resampler::Filter* f = new Resampler::Filter;
+    f->taps = 2 * half;
+    f->phases = PHASES;
+    f->coeffs.resize((PHASES + 1) * f->taps);
+
+    double i0beta = besselI0(KAISER_BETA);
+    for (int p = 0; p <= PHASES; ++p)
+    {
+        double frac = double(p) / PHASES;
+        float* row = &f->coeffs[p * f->taps];
+        double sum = 0.0;
+        for (int k = 0; k < f->taps; ++k)
+        {
+            double x = (k - (half - 1)) - frac;
+            double t = x / half;
+            double w = fabs(t) < 1.0 ? besselI0(KAISER_BETA * sqrt(1.0 - t * t)) / i0beta : 0.0;
+            double s = x == 0.0 ? 1.0 : sin(M_PI * fc * x) / (M_PI * fc * x);
+            row[k] = float(fc * s * w);
+            sum += row[k];
+        }
+        // unity gain at dc for every phase
+        for (int k = 0; k < f->taps; ++k)
+            row[k] = float(row[k] / sum);
+    }
+    return f;
+}
+
+//---------------------------------------------------------
+//   filter
+//    filters are never freed, there is one per rate pair
+//---------------------------------------------------------
+
+static const Resampler::Filter* filter(unsigned inRate, unsigned outRate)
+{
+    static QMutex lock;
+    static QHash<quint64, Resampler::Filter*> filters;
+
+    quint64 key = (quint64(inRate) << 32) | outRate;
+    QMutexLocker locker(&lock);
+    Resampler::Filter* f = filters.value(key);
+    if (!f)
+    {
+        f = makeFilter(inRate, outRate);
+        filters.insert(key, f);
+    }
+    return f;
+}
+
+//---------------------------------------------------------
+//   dot
+//---------------------------------------------------------
+
+static inline float dot(const float* x, const float* h, int n)
+{
+    float acc[Resampler::LANES];
+    for (int j = 0; j < Resampler::LANES; ++j)
+        acc[j] = 0.0f;
+    for (int k = 0; k < n; k += Resampler::LANES)
+    {
+        for (int j = 0; j < Resampler::LANES; ++j)
+            acc[j] += x[k + j] * h[k + j];
+    }
+    float sum = 0.0f;
+    for (int j = 0; j < Resampler::LANES; ++j)
+        sum += acc[j];
+    return sum;
+}
+
+//---------------------------------------------------------
+//   Resampler
+//---------------------------------------------------------
+
+Resampler::Resampler(unsigned inRate, unsigned outRate, int channels)
+{
+    m_filter = filter(inRate, outRate);
+    m_inRate = inRate;
+    m_outRate = outRate;
+    m_channels = channels;
+    m_histCap = 0;
+    m_histStart = 0;
+    m_histLen = 0;
+    m_taps.resize(m_filter->taps);
+    seek(0);
+}
+
+//---------------------------------------------------------
+//   seek
+//---------------------------------------------------------
+
+void Resampler::seek(off_t frame)
+{
+    quint64 t = quint64(frame) * m_inRate;
+    m_outPos = frame;
+    m_ipos = off_t(t / m_outRate);
+    m_rem = unsigned(t % m_outRate);
+}
+
+//---------------------------------------------------------
+//   fill
+//    make the history hold input frames from up to to,
+//    keeping what was read before where possible
+//---------------------------------------------------------
+
+void Resampler::fill(Input& in, off_t from, off_t to)
+{
+    if (m_histLen && from >= m_histStart && from <= m_histStart + m_histLen)
+    {
+        int drop = int(from - m_histStart);
+        if (drop)
+        {
+            m_histLen -= drop;
+            for (int ch = 0; ch < m_channels; ++ch)
+            {
+                float* h = &m_hist[ch * m_histCap];
+                memmove(h, h + drop, m_histLen * sizeof(float));
+            }
+            m_histStart = from;
+        }
+    }
+    else
+    {
+        m_histStart = from;
+        m_histLen = 0;
+    }
+
+    int len = int(to - from);
+    if (len > m_histCap)
+    {
+        int cap = len + len / 2;
+        std::vector<float> hist(m_channels * cap);
+        for (int ch = 0; ch < m_channels; ++ch)
+        {
+            if (m_histLen)
+                memcpy(&hist[ch * cap], &m_hist[ch * m_histCap], m_histLen * sizeof(float));
+        }
+        m_hist.swap(hist);
+        m_histCap = cap;
+    }
+
+    int count = len - m_histLen;
+    if (count <= 0)
+        return;
+
+    off_t frame = m_histStart + m_histLen;
+    int zero = 0;
+    if (frame < 0)
+        zero = -frame < count ? int(-frame) : count;
+    int rn = 0;
+    if (zero < count)
+    {
+        if ((int) m_readBuf.size() < (count - zero) * m_channels)
+            m_readBuf.resize((count - zero) * m_channels);
+        rn = int(in.read(frame + zero, &m_readBuf[0], count - zero));
+    }
+    for (int ch = 0; ch < m_channels; ++ch)
+    {
+        float* h = &m_hist[ch * m_histCap + m_histLen];
+        const float* src = rn ? &m_readBuf[ch] : 0;
+        for (int i = 0; i < zero; ++i)
+            h[i] = 0.0f;
+        for (int i = 0; i < rn; ++i, src += m_channels)
+            h[zero + i] = *src;
+        for (int i = zero + rn; i < count; ++i)
+            h[i] = 0.0f;
+    }
+    m_histLen = len;
+}
+
+//---------------------------------------------------------
+//   process
+//    n interleaved frames in the file channel layout,
+//    beyond the end of the file the output is silent
+//---------------------------------------------------------
+
+void Resampler::process(Input& in, float* out, int n)
+{
+    if (n <= 0)
+        return;
+    const Filter* fl = m_filter;
+    int taps = fl->taps;
+    int half = taps / 2;
+    quint64 acc = m_rem + quint64(n - 1) * m_inRate;
+    off_t first = m_ipos - half + 1;
+    off_t last = m_ipos + off_t(acc / m_outRate) + half;
+    fill(in, first, last + 1);
+
+    float* h = &m_taps[0];
+    for (int i = 0; i < n; ++i)
+    {
+        double ph = double(m_rem) * fl->phases / m_outRate;
+        int p = int(ph);
+        float mu = float(ph - p);
+        const float* h0 = &fl->coeffs[p * taps];
+        const float* h1 = h0 + taps;
+        for (int k = 0; k < taps; ++k)
+            h[k] = h0[k] + mu * (h1[k] - h0[k]);
+
+        int base = int(m_ipos - half + 1 - m_histStart);
+        for (int ch = 0; ch < m_channels; ++ch)
+            *out++ = dot(&m_hist[ch * m_histCap + base], h, taps);
+
+        m_rem += m_inRate;
+        m_ipos += m_rem / m_outRate;
+        m_rem %= m_outRate;
+    }
+    m_outPos += n;
+}
+
+//---------------------------------------------------------
+//   ResampleCache
+//---------------------------------------------------------
+
+struct CacheKey
+{
+    QString path;
+    unsigned inRate;
+    unsigned outRate;
+
+    bool operator==(const CacheKey& k) const
+    {
+        return inRate == k.inRate && outRate == k.outRate && path == k.path;
+    }
+};
+
+static inline uint qHash(const CacheKey& k)
+{
+    return qHash(k.path) ^ (k.inRate * 31u) ^ k.outRate;
+}
+
+//---------------------------------------------------------
+//   CacheEntry
+//    An entry without data is either pending, failed or
+//    evicted. Failed and evicted files are not rendered
+//    again but converted while playing, until the cache is
+//    cleared or the file changes. Otherwise a loop over more
+//    files than fit would render them over and over.
+//---------------------------------------------------------
+
+struct CacheEntry
+{
+    ResampleCache::Data data;
+    unsigned frames; // of the file, to notice it was rewritten
+    int channels;
+    size_t bytes;
+    bool pending;
+};
+
+struct CacheState
+{
+    QMutex lock;
+    QHash<CacheKey, CacheEntry> entries;
+    QList<CacheKey> lru; // most recently used last
+    size_t bytes;
+    QThreadPool pool;
+
+    CacheState()
+    {
+        bytes = 0;
+        pool.setMaxThreadCount(1);
+    }
+};
+
+// lives until exit, renders may still be running then
+static CacheState* cacheState()
+{
+    static CacheState* state = new CacheState;
+    return state;
+}
+
+static size_t cacheLimit()
+{
+    return size_t(config.resampleCacheSize) << 20;
+}
+
+//---------------------------------------------------------
+//   SndInput
+//---------------------------------------------------------
+
+class SndInput : public Resampler::Input
+{
+    SNDFILE* m_sf;
+    off_t m_next;
+
+public:
+    SndInput(SNDFILE* sf)
+    {
+        m_sf = sf;
+        m_next = 0;
+    }
+
+    virtual size_t read(off_t frame, float* buffer, size_t n)
+    {
+        if (frame != m_next && sf_seek(m_sf, frame, SEEK_SET) == -1)
+            return 0;
+        size_t rn = sf_readf_float(m_sf, buffer, n);
+        m_next = frame + rn;
+        return rn;
+    }
+};
+
+//---------------------------------------------------------
+//   RenderJob
+//    converts a whole file through its own handle, the
+//    SndFile is used by the prefetch thread meanwhile
+//---------------------------------------------------------
+
+class RenderJob : public QRunnable
+{
+public:
+    CacheKey key;
+    int channels;
+    unsigned frames;
+
+    virtual void run();
+};
+
+void RenderJob::run()
+{
+    ResampleCache::Data data;
+    SF_INFO info;
+    memset(&info, 0, sizeof(info));
+    SNDFILE* sf = sf_open(key.path.toLatin1().constData(), SFM_READ, &info);
+    if (sf && info.channels == channels && (unsigned) info.samplerate == key.inRate)
+    {
+        unsigned outFrames = unsigned(quint64(frames) * key.outRate / key.inRate);
+        data = ResampleCache::Data(new std::vector<float>(size_t(outFrames) * channels));
+        SndInput in(sf);
+        Resampler r(key.inRate, key.outRate, channels);
+        for (unsigned done = 0; done < outFrames; done += RENDER_FRAMES)
+        {
+            int n = outFrames - done < (unsigned) RENDER_FRAMES ? outFrames - done : RENDER_FRAMES;
+            r.process(in, &(*data)[size_t(done) * channels], n);
+        }
+    }
+    else
+        printf("ResampleCache: cannot render <%s>\n", key.path.toLatin1().constData());
+    if (sf)
+        sf_close(sf);
+
+    CacheState* s = cacheState();
+    QMutexLocker locker(&s->lock);
+    QHash<CacheKey, CacheEntry>::iterator i = s->entries.find(key);
+    // dropped by clear() in the meantime
+    if (i == s->entries.end() || !i->pending)
+        return;
+    i->pending = false;
+    if (!data)
+        return;
+    i->data = data;
+    s->bytes += i->bytes;
+    s->lru.append(key);
+    // evicted entries stay, see CacheEntry
+    while (s->bytes > cacheLimit() && s->lru.size() > 1)
+    {
+        CacheEntry& old = s->entries[s->lru.takeFirst()];
+        s->bytes -= old.bytes;
+        old.data.clear();
+    }
+}
+
+//---------------------------------------------------------
+//   lookup
+//---------------------------------------------------------
+
+ResampleCache::Data ResampleCache::lookup(const QString& path, unsigned inRate, unsigned outRate, int channels, unsigned frames)
+{
+    if (config.resampleCacheSize <= 0)
+        return Data();
+    size_t bytes = size_t(quint64(frames) * outRate / inRate) * channels * sizeof(float);
+    if (bytes > cacheLimit())
+        return Data();
+
+    CacheKey key;
+    key.path = path;
+    key.inRate = inRate;
+    key.outRate = outRate;
+    CacheState* s = cacheState();
+    QMutexLocker locker(&s->lock);
+    QHash<CacheKey, CacheEntry>::iterator i = s->entries.find(key);
+    if (i != s->entries.end())
+    {
+        if (i->pending)
+            return Data();
+        if (i->frames == frames && i->channels == channels)
+        {
+            // failed and evicted files are not rendered again
+            if (i->data)
+            {
+                s->lru.removeOne(key);
+                s->lru.append(key);
+            }
+            return i->data;
+        }
+        if (i->data)
+        {
+            s->bytes -= i->bytes;
+            s->lru.removeOne(key);
+        }
+        s->entries.erase(i);
+    }
+
+    CacheEntry e;
+    e.frames = frames;
+    e.channels = channels;
+    e.bytes = bytes;
+    e.pending = true;
+    s->entries.insert(key, e);
+
+    RenderJob* job = new RenderJob;
+    job->key = key;
+    job->channels = channels;
+    job->frames = frames;
+    s->pool.start(job);
+    return Data();
+}
+
+//---------------------------------------------------------
+//   clear
+//    renders still running are discarded when done
+//---------------------------------------------------------
+
+void ResampleCache::clear()
+{
+    CacheState* s = cacheState();
+    QMutexLocker locker(&s->lock);
+    s->entries.clear();
+    s->lru.clear();
+    s->bytes = 0;
+}
@@ -0,0 +1,118 @@
+//=========================================================
+//  OOMidi
+//  OpenOctave Midi and Audio Editor
+//
+//  streaming sample rate conversion
+//=========================================================
+
+#ifndef __RESAMPLER_H__
+#define __RESAMPLER_H__
+
+#include <sys/types.h>
+#include <vector>
+
+#include <QSharedPointer>
+#include <QString>
+
+//---------------------------------------------------------
+//   Resampler
+//    Polyphase windowed sinc converter from the rate of a
+//    sound file to the session rate.
+//
+//    Output frame s is taken at input position
+//    s * inRate / outRate, kept as a frame plus a remainder
+//    in units of outRate. No error accumulates while
+//    streaming, and a seek lands on the very samples
+//    sequential reading would have produced. Input already
+//    read is kept when a seek stays near the last position.
+//
+//    The filter bank is built once per rate pair and shared.
+//    Coefficients are interpolated between two phases. The
+//    taps are summed in LANES independent accumulators, a
+//    loop the compiler vectorizes without -ffast-math.
+//---------------------------------------------------------
+
+class Resampler
+{
+public:
+    enum { LANES = 8 };
+
+    struct Filter;
+
+    //---------------------------------------------------------
+    //   Input
+    //    interleaved frames in the file channel layout,
+    //    returns the number of frames read
+    //---------------------------------------------------------
+
+    class Input
+    {
+    public:
+        virtual ~Input()
+        {
+        }
+        virtual size_t read(off_t frame, float* buffer, size_t n) = 0;
+    };
+
+private:
+    const Filter* m_filter;
+    unsigned m_inRate;
+    unsigned m_outRate;
+    int m_channels;
+
+    off_t m_outPos;
+    off_t m_ipos;
+    unsigned m_rem;
+
+    // planar input, m_histStart is the file frame of index 0
+    std::vector<float> m_hist;
+    int m_histCap;
+    off_t m_histStart;
+    int m_histLen;
+    std::vector<float> m_readBuf;
+    std::vector<float> m_taps;
+
+    void fill(Input& in, off_t from, off_t to);
+
+public:
+    Resampler(unsigned inRate, unsigned outRate, int channels);
+
+    bool matches(unsigned inRate, unsigned outRate, int channels) const
+    {
+        return inRate == m_inRate && outRate == m_outRate && channels == m_channels;
+    }
+
+    //! session frame of the next output frame
+    off_t pos() const
+    {
+        return m_outPos;
+    }
+    void seek(off_t frame);
+    void process(Input& in, float* out, int n);
+};
+
+//---------------------------------------------------------
+//   ResampleCache
+//    Files at another rate converted in one piece in the
+//    background, so playing them only has to copy. Bounded
+//    by config.resampleCacheSize, the least recently used
+//    file is dropped first. Files which do not fit, and
+//    files dropped once, are converted while playing.
+//
+//    Both use the same filter and positions, so switching
+//    from the streaming converter to a finished render is
+//    seamless.
+//---------------------------------------------------------
+
+class ResampleCache
+{
+public:
+    typedef QSharedPointer<std::vector<float> > Data;
+
+    //! returns a null pointer and schedules the render if not ready yet
+    static Data lookup(const QString& path, unsigned inRate, unsigned outRate, int channels, unsigned frames);
+    static void clear();
+};
+
+#endif
+
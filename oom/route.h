@@ -95,6 +95,27 @@ struct RouteList : public QList<Route>
 typedef RouteList::iterator iRoute;
 typedef RouteList::const_iterator ciRoute;
 
+//---------------------------------------------------------
+//   RouteChange
+//    one entry of a batched routing update
+//---------------------------------------------------------
+
+struct RouteChange
+{
+    Route src;
+    Route dst;
+    bool add; // false: remove
+
+    RouteChange() : add(false)
+    {
+    }
+    RouteChange(const Route& s, const Route& d, bool a) : src(s), dst(d), add(a)
+    {
+    }
+};
+
+typedef QList<RouteChange> RouteChangeList;
+
 extern void addRoute(Route, Route);
 extern void removeRoute(Route, Route);
 extern void removeAllRoutes(Route, Route); // p3.3.55
@@ -7,6 +7,7 @@
 //=========================================================
 
 #include <stdio.h>
+#include <QMultiMap>
 
 #include "song.h"
 #include "midiport.h"
@@ -213,6 +214,23 @@ void Audio::msgAddRoute1(Route src, Route dst)
 	sendMsg(&msg);
 }
 
+//---------------------------------------------------------
+//   msgChangeRoutes
+//    applies a whole list of route additions and removals
+//    in one audio cycle. Like msgAddRoute1() the jack
+//    connections are left alone.
+//---------------------------------------------------------
+
+void Audio::msgChangeRoutes(const RouteChangeList& changes)
+{
+	if (changes.isEmpty())
+		return;
+	AudioMsg msg;
+	msg.id = AUDIO_ROUTECHANGES;
+	msg.p1 = &changes;
+	sendMsg(&msg);
+}
+
 //---------------------------------------------------------
 //   msgAddPlugin
 //---------------------------------------------------------
@@ -439,6 +457,21 @@ void Audio::msgSetPluginCtrlVal(AudioTrack* track, int param, double val, bool w
 	//oom->composer->controllerChanged(track);
 }
 
+//---------------------------------------------------------
+//   msgSetPluginCtrlVals
+//    set the track controllers of all parameters of a
+//    plugin to the parameter values
+//---------------------------------------------------------
+
+void Audio::msgSetPluginCtrlVals(BasePlugin* plugin)
+{
+	AudioMsg msg;
+
+	msg.id = AUDIO_SET_PLUGIN_CTRL_VALS;
+	msg.plugin = plugin;
+	sendMsg(&msg);
+}
+
 //---------------------------------------------------------
 //   msgSwapControllerIDX
 //---------------------------------------------------------
@@ -917,6 +950,105 @@ void Audio::msgDeleteEvent(Event& event, Part* part, bool doUndoFlag, bool doCtr
     sendMessage(&msg, doUndoFlag, waitRead);
 }
 
+//---------------------------------------------------------
+//   netControllers
+//    drop the controller events removed and added back
+//    with the same tick, number and value, the port values
+//    stay as they are for those
+//---------------------------------------------------------
+
+static void netControllers(PartEventsChange* change)
+{
+	QMultiMap<unsigned, Event> added;
+	for (int i = 0; i < change->added.size(); ++i)
+	{
+		const Event& e = change->added.at(i);
+		if (e.type() == Controller)
+			added.insert(e.tick(), e);
+	}
+	for (int i = 0; i < change->removed.size(); ++i)
+	{
+		const Event& e = change->removed.at(i);
+		if (e.type() != Controller)
+			continue;
+		bool same = false;
+		QMultiMap<unsigned, Event>::iterator ia = added.find(e.tick());
+		for (; ia != added.end() && ia.key() == e.tick(); ++ia)
+		{
+			if (ia.value().dataA() == e.dataA() && ia.value().dataB() == e.dataB())
+			{
+				added.erase(ia);
+				same = true;
+				break;
+			}
+		}
+		if (!same)
+			change->oCtrls.append(e);
+	}
+	change->nCtrls = added.values();
+}
+
+//---------------------------------------------------------
+//   msgReplaceEvents
+//    Replace the events of several parts in one audio
+//    cycle. The new event lists are built here, the audio
+//    thread only swaps them in. Without doUndoFlag the
+//    caller has to have opened an undo step, which then
+//    owns the old lists.
+//---------------------------------------------------------
+
+void Audio::msgReplaceEvents(const QList<PartEventsEdit>& edits, bool doUndoFlag, bool doCtrls)
+{
+	QList<PartEventsChange*> changes;
+	for (int i = 0; i < edits.size(); ++i)
+	{
+		const PartEventsEdit& edit = edits.at(i);
+		PartEventsChange* change = new PartEventsChange;
+		change->part = edit.part;
+		change->oEvents = edit.part->events();
+		change->nEvents = new EventList(*change->oEvents);
+		change->nEvents->incRef(-change->nEvents->refCount());
+		change->nEvents->incARef(-change->nEvents->arefCount());
+		change->doCtrls = doCtrls;
+
+		EventList* el = change->nEvents;
+		for (int k = 0; k < edit.remove.size(); ++k)
+		{
+			iEvent ie = el->find(edit.remove.at(k));
+			if (ie == el->end())
+				continue;
+			change->removed.append(ie->second);
+			el->erase(ie);
+		}
+		for (int k = 0; k < edit.add.size(); ++k)
+		{
+			Event event = edit.add.at(k);
+			if (el->find(event) != el->end())
+				continue;
+			el->add(event);
+			change->added.append(event);
+		}
+		if (doCtrls)
+			netControllers(change);
+		if (edit.part->track() && edit.part->track()->isMidiTrack())
+			el->updateCompactStore();
+		changes.append(change);
+	}
+
+	if (doUndoFlag)
+		song->startUndo();
+	for (int i = 0; i < changes.size(); ++i)
+		song->undoOp(UndoOp::ModifyPartEvents, changes.at(i));
+
+	AudioMsg msg;
+	msg.id = SEQM_REPLACE_EVENTS;
+	msg.p1 = &changes;
+	sendMessage(&msg, false);
+
+	if (doUndoFlag)
+		song->endUndo(SC_EVENT_REMOVED | SC_EVENT_INSERTED);
+}
+
 //---------------------------------------------------------
 //   msgChangeEvent
 //---------------------------------------------------------
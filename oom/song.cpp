@@ -10,14 +10,19 @@
 #include <unistd.h>
 #include <stdio.h>
 #include <errno.h>
+#include <string.h>
 
 #include <QAction>
 #include <QDir>
+#include <QFile>
 #include <QMenu>
 #include <QMessageBox>
+#include <QMetaMethod>
 #include <QPoint>
 #include <QSignalMapper>
 #include <QTextStream>
+#include <QThread>
+#include <QTimer>
 #include <QUndoStack>
 
 #include "app.h"
@@ -52,6 +57,11 @@
 #include "traverso_shared/OOMCommand.h"
 #include "traverso_shared/TConfig.h"
 #include "CreateTrackDialog.h"
+#include "meterbus.h"
+#include "dspprofiler.h"
+#include "midieventstore.h"
+#include "midirecordbuffer.h"
+#include "resampler.h"
 //#include <omp.h>
 
 extern void clearMidiTransforms();
@@ -99,6 +109,7 @@ Song::Song(QUndoStack* stack, const char* name)
 	viewselected = false;
 	hasSelectedParts = false;
 	invalid = false;
+	m_changeQueued = false;
 	_replay = false;
 	_replayPos = 0;
 	//Master track ID
@@ -710,6 +721,58 @@ void Song::deleteEvent(Event& event, Part* part)
 	part->events()->erase(ev);
 }
 
+//---------------------------------------------------------
+//   swapPartEvents
+//    Move the part and its clones from one event list of
+//    the change to the other. Realtime safe: the lists
+//    were built by Audio::msgReplaceEvents(), only the
+//    pointers and the differing controllers are touched.
+//---------------------------------------------------------
+
+void Song::swapPartEvents(PartEventsChange* change, bool redo)
+{
+	EventList* from = redo ? change->oEvents : change->nEvents;
+	EventList* to = redo ? change->nEvents : change->oEvents;
+	const QList<Event>& fromCtrls = redo ? change->oCtrls : change->nCtrls;
+	const QList<Event>& toCtrls = redo ? change->nCtrls : change->oCtrls;
+	Part* part = change->part;
+
+	if (change->doCtrls)
+	{
+		for (int i = 0; i < fromCtrls.size(); ++i)
+		{
+			Event event = fromCtrls.at(i);
+			removePortCtrlEvents(event, part, true);
+		}
+	}
+
+	to->incARef(from->arefCount());
+	from->incARef(-from->arefCount());
+	// its events may have reported in place changes to the other
+	// list meanwhile, rebuilding its store claims them back
+	to->modified();
+	Part* p = part;
+	do
+	{
+		if (p->events() == from)
+		{
+			p->setEvents(to);
+			from->incRef(-1);
+			to->incRef(1);
+		}
+		p = p->nextClone();
+	} while (p && p != part);
+
+	if (change->doCtrls)
+	{
+		for (int i = 0; i < toCtrls.size(); ++i)
+		{
+			Event event = toCtrls.at(i);
+			addPortCtrlEvents(event, part, true);
+		}
+	}
+}
+
 //---------------------------------------------------------
 //   remapPortDrumCtrlEvents
 //   Called when drum map anote, channel, or port is changed.
@@ -845,6 +908,56 @@ void Song::changeAllPortDrumCtrlEvents(bool add, bool drumonly)
 	}
 }
 
+//---------------------------------------------------------
+//   cmdAddRecordedTake
+//    Add a midi take which was not cycled. The usual take
+//    starts a new part at the buffer's origin, the part
+//    then takes over the converted list as it is. Punch
+//    in/out and recording into an existing part go the
+//    long way through cmdAddRecordedEvents().
+//---------------------------------------------------------
+
+void Song::cmdAddRecordedTake(MidiTrack* mt, MidiRecordBuffer* rb, unsigned startTick)
+{
+	EventList* events = rb->events();
+	if (events->empty())
+	{
+		if (debugMsg)
+			printf("no events recorded\n");
+		return;
+	}
+	unsigned endTick = rb->endTick();
+	unsigned partTick = AL::sigmap.raster1(startTick, composerRaster());
+
+	bool direct = !(punchin() && startTick < lPos().tick())
+			&& !(punchout() && endTick > rPos().tick())
+			&& partTick == rb->origin();
+	PartList* pl = mt->parts();
+	for (iPart ip = pl->begin(); direct && ip != pl->end(); ++ip)
+	{
+		if (startTick >= ip->second->tick() && startTick < ip->second->endTick())
+			direct = false;
+	}
+	if (!direct)
+	{
+		EventList el;
+		rb->copyTo(&el);
+		cmdAddRecordedEvents(mt, &el, startTick);
+		return;
+	}
+
+	if (debugMsg)
+		printf("create new part for recorded events\n");
+	MidiPart* part = new MidiPart(mt);
+	part->setTick(partTick);
+	part->setLenTick(AL::sigmap.raster2(endTick, composerRaster()) - partTick);
+	part->setName(mt->name());
+	part->events()->swap(*events);
+	// msgAddPart adds the port controller values
+	audio->msgAddPart(part);
+	updateFlags |= SC_PART_INSERTED;
+}
+
 //---------------------------------------------------------
 //   cmdAddRecordedEvents
 //    add recorded Events into part
@@ -1496,7 +1609,10 @@ void Song::setMasterFlag(bool val)
 	if (tempomap.setMasterFlag(cpos(), val))
 	{
 		if(!invalid)
+		{
 			emit songChanged(SC_MASTER);
+			journal(SongChange(SC_MASTER));
+		}
 	}
 	masterEnableAction->blockSignals(true);
 	masterEnableAction->setChecked(song->masterFlag());
@@ -1724,6 +1840,12 @@ void Song::rewindStart()
 
 void Song::update(int flags)
 {
+	update(SongChange(flags));
+}
+
+void Song::update(const SongChange& change)
+{
+	int flags = change.flags();
 	static int level = 0; // DEBUG
 	if (level)
 	{
@@ -1741,10 +1863,167 @@ void Song::update(int flags)
 		emit composerViewChanged();
 	}*/
 	if(!invalid)
+	{
 		emit songChanged(flags);
+		journal(change);
+	}
 	--level;
 }
 
+//---------------------------------------------------------
+//   subscribe
+//    member (a SLOT()) of receiver is called with the sum
+//    of the song changes of one pass of the event loop
+//    that raised any of flags. The songChanged() signal
+//    still fires for each change, views which can make use
+//    of the details subscribe instead.
+//    return true on error
+//---------------------------------------------------------
+
+bool Song::subscribe(QObject* receiver, const char* member, int flags)
+{
+	// skip the code SLOT() puts in front
+	QByteArray sig = QMetaObject::normalizedSignature(member + 1);
+	int method = receiver->metaObject()->indexOfMethod(sig.constData());
+	if (method == -1)
+	{
+		printf("Song::subscribe: %s has no method %s\n", receiver->metaObject()->className(), sig.constData());
+		return true;
+	}
+	for (int i = 0; i < m_subscribers.size(); ++i)
+	{
+		if (m_subscribers[i].receiver == receiver && m_subscribers[i].method == method)
+		{
+			m_subscribers[i].flags = flags;
+			return false;
+		}
+	}
+	Subscriber s;
+	s.receiver = receiver;
+	s.method = method;
+	s.flags = flags;
+	m_subscribers.append(s);
+	connect(receiver, SIGNAL(destroyed(QObject*)), this, SLOT(subscriberDestroyed(QObject*)), Qt::UniqueConnection);
+	return false;
+}
+
+//---------------------------------------------------------
+//   unsubscribe
+//---------------------------------------------------------
+
+void Song::unsubscribe(QObject* receiver)
+{
+	for (int i = 0; i < m_subscribers.size();)
+	{
+		if (m_subscribers[i].receiver == receiver)
+			m_subscribers.removeAt(i);
+		else
+			++i;
+	}
+	disconnect(receiver, SIGNAL(destroyed(QObject*)), this, SLOT(subscriberDestroyed(QObject*)));
+}
+
+void Song::subscriberDestroyed(QObject* receiver)
+{
+	unsubscribe(receiver);
+}
+
+bool Song::isSubscribed(QObject* receiver, int method) const
+{
+	for (int i = 0; i < m_subscribers.size(); ++i)
+	{
+		if (m_subscribers[i].receiver == receiver && m_subscribers[i].method == method)
+			return true;
+	}
+	return false;
+}
+
+//---------------------------------------------------------
+//   journal
+//    Adds to the change the subscribers get once control
+//    is back in the event loop. Recording a controller
+//    sends many edits per pass, the views then only update
+//    once for all of them.
+//---------------------------------------------------------
+
+void Song::journal(const SongChange& change)
+{
+	if (change.isEmpty() || m_subscribers.isEmpty())
+		return;
+	m_pendingChange.merge(change);
+	if (!m_changeQueued)
+	{
+		m_changeQueued = true;
+		QTimer::singleShot(0, this, SLOT(deliverChanges()));
+	}
+}
+
+//---------------------------------------------------------
+//   journalUndo
+//    takes the details of the current updateFlags from the
+//    ops of an undo step, flags no op accounts for stay
+//    vague
+//---------------------------------------------------------
+
+void Song::journalUndo(const Undo& u)
+{
+	SongChange change;
+	int known = 0;
+	for (Undo::const_iterator i = u.begin(); i != u.end(); ++i)
+		known |= change.addUndoOp(*i);
+	change.addFlags(updateFlags & known, false);
+	change.addFlags(updateFlags & ~known, true);
+	journal(change);
+}
+
+//---------------------------------------------------------
+//   deliverChanges
+//    Changes made by a subscriber while it is being told
+//    go out with the next pass.
+//---------------------------------------------------------
+
+void Song::deliverChanges()
+{
+	m_changeQueued = false;
+	SongChange change = m_pendingChange;
+	m_pendingChange.clear();
+	if (invalid)
+		return;
+	QList<Subscriber> subscribers = m_subscribers;
+	for (int i = 0; i < subscribers.size(); ++i)
+	{
+		const Subscriber& s = subscribers[i];
+		if (!(s.flags & change.flags()))
+			continue;
+		// an earlier one may have closed it
+		if (!isSubscribed(s.receiver, s.method))
+			continue;
+		QMetaMethod method = s.receiver->metaObject()->method(s.method);
+		method.invoke(s.receiver, Qt::DirectConnection, Q_ARG(SongChange, change));
+	}
+}
+
+//---------------------------------------------------------
+//   updateCompactStores
+//    Rebuilds the compact stores of changed midi parts
+//    right after an edit, so playback does not walk the
+//    map until the next heartbeat. Unchanged lists return
+//    at once.
+//---------------------------------------------------------
+
+void Song::updateCompactStores(int flags)
+{
+	if (!(flags & (SC_PART_INSERTED | SC_PART_MODIFIED | SC_EVENT_INSERTED
+		| SC_EVENT_REMOVED | SC_EVENT_MODIFIED | SC_TRACK_INSERTED)))
+		return;
+	for (ciMidiTrack i = _midis.begin(); i != _midis.end(); ++i)
+	{
+		PartList* pl = (*i)->parts();
+		for (iPart ip = pl->begin(); ip != pl->end(); ++ip)
+			ip->second->events()->updateCompactStore();
+	}
+}
+
 //---------------------------------------------------------
 //   updatePos
 //---------------------------------------------------------
@@ -1772,7 +2051,10 @@ void Song::setChannelMute(int channel, bool val)
 			track->setMute(val);
 	}
 	if(!invalid)
+	{
 		emit songChanged(SC_MUTE);
+		journal(SongChange(SC_MUTE));
+	}
 }
 
 //---------------------------------------------------------
@@ -1805,7 +2087,10 @@ void Song::initLen()
 void Song::tempoChanged()
 {
 	if(!invalid)
+	{
 		emit songChanged(SC_TEMPO);
+		journal(SongChange(SC_TEMPO));
+	}
 }
 
 //---------------------------------------------------------
@@ -1996,6 +2281,30 @@ void Song::beat()
 	if (audio->isPlaying())
 		setPos(0, tick, true, false, true);
 
+	// take one meter snapshot for all strips of this heartbeat
+	if (meterBus)
+		meterBus->fetch();
+
+	if (dspProfiler && dspProfiler->enabled())
+	{
+		dspProfiler->calibrate();
+		static int captures = 0;
+		if (dspProfileReport && dspProfiler->captures() != captures)
+		{
+			captures = dspProfiler->captures();
+			fprintf(stderr, "%s", dspProfiler->captureReport().toLocal8Bit().constData());
+		}
+	}
+
+	// catch whatever changed outside of an undo step
+	updateCompactStores(-1);
+	MidiEventStore::collectGarbage();
+
+	// convert what was recorded since the last heartbeat and
+	// keep the chunk pools of armed tracks filled
+	for (ciMidiTrack i = _midis.begin(); i != _midis.end(); ++i)
+		(*i)->recordBuffer()->process(*i, tick);
+
 	// p3.3.40 Update synth native guis at the heartbeat rate.
     //for (ciSynthI is = _synthIs.begin(); is != _synthIs.end(); ++is)
     //	(*is)->guiHeartBeat();
@@ -2018,6 +2327,13 @@ void Song::beat()
 			t->efxPipe()->updateGuis();
 	}
 
+	// synth plugins are not in the track list
+	for (iMidiDevice id = midiDevices.begin(); id != midiDevices.end(); ++id)
+	{
+		if ((*id)->isSynthPlugin())
+			((SynthPluginDevice*)*id)->updateNativeGui();
+	}
+
 	while (noteFifoSize)
 	{
 		int pv = recNoteFifo[noteFifoRindex];
@@ -2196,8 +2512,16 @@ void Song::endMsgCmd()
 			//printf("Song::endMsgCmd() calling updateTrackViews()\n");
 			//updateTrackViews();
 		}
+		updateCompactStores(updateFlags);
 		if(!invalid)
+		{
 			emit songChanged(updateFlags);
+			// called by endUndo(), the step is the last one
+			if (!undoList->empty())
+				journalUndo(undoList->back());
+			else
+				journal(SongChange(updateFlags));
+		}
 	}
 }
 
@@ -2221,8 +2545,12 @@ void Song::undo()
 	if(updateFlags && (SC_TRACK_REMOVED | SC_TRACK_INSERTED | SC_TRACK_MODIFIED))
 		updateTrackViews();
 
+	updateCompactStores(updateFlags);
 	if(!invalid)
+	{
 		emit songChanged(updateFlags);
+		journalUndo(redoList->back());
+	}
 }
 
 //---------------------------------------------------------
@@ -2244,8 +2572,12 @@ void Song::redo()
 
 	if(updateFlags && (SC_TRACK_REMOVED | SC_TRACK_INSERTED | SC_TRACK_MODIFIED))
 		updateTrackViews();
+	updateCompactStores(updateFlags);
 	if(!invalid)
+	{
 		emit songChanged(updateFlags);
+		journalUndo(undoList->back());
+	}
 }
 
 //---------------------------------------------------------
@@ -2366,6 +2698,14 @@ void Song::processMsg(AudioMsg* msg)
 			updateFlags = SC_EVENT_REMOVED;
 		}
 			break;
+		case SEQM_REPLACE_EVENTS:
+		{
+			const QList<PartEventsChange*>* changes = (const QList<PartEventsChange*>*) msg->p1;
+			for (int i = 0; i < changes->size(); ++i)
+				swapPartEvents(changes->at(i), true);
+			updateFlags = SC_EVENT_REMOVED | SC_EVENT_INSERTED;
+		}
+			break;
 		case SEQM_CHANGE_EVENT:
 			if (msg->a)
 				removePortCtrlEvents(msg->ev1, (MidiPart*) msg->p3, msg->b);
@@ -2530,6 +2870,7 @@ void Song::clear(bool signal)
 	_viewtracks.clear();
 	_midis.clearDelete();
 	_waves.clearDelete();
+	ResampleCache::clear();
 	_inputs.clearDelete(); // audio input ports
 	_outputs.clearDelete(); // audio output ports
 	_groups.clearDelete(); // mixer groups
@@ -3889,6 +4230,8 @@ void Song::insertTrackRealtime(Track* track, int idx)
 {
 	//printf("Song::insertTrackRealtime track:%lx\n", track);
 
+	// the track's parts become reachable
+	partsGeneration.ref();
 	int n;
 	iTrack ia;
 	switch (track->type())
@@ -4080,6 +4423,8 @@ void Song::removeTrackRealtime(Track* track)
 {
 	//printf("Song::removeTrackRealtime track:%s\n", track->name().toLatin1().constData());
 	midiMonitor->msgDeleteMonitoredTrack(track);
+	// the track's parts stay alive for undo but are gone from the song
+	partsGeneration.ref();
 
 	switch (track->type())
 	{
@@ -4203,6 +4548,69 @@ void Song::removeTrackRealtime(Track* track)
 	}
 }
 
+//---------------------------------------------------------
+//   ScriptJob
+//    one part handed to an external script
+//---------------------------------------------------------
+
+struct ScriptJob
+{
+	QByteArray file;
+	pid_t pid;
+	int status;
+};
+
+//---------------------------------------------------------
+//   readScriptOutput
+//    return true on error
+//---------------------------------------------------------
+
+static bool readScriptOutput(const QByteArray& path, QList<Event>& events)
+{
+	QFile file(QString::fromLocal8Bit(path));
+	if (!file.open(QIODevice::ReadOnly))
+		return true;
+	QByteArray data = file.readAll();
+	file.close();
+
+	const char* p = data.constData();
+	const char* end = p + data.size();
+	while (p < end)
+	{
+		const char* eol = (const char*) memchr(p, '\n', end - p);
+		if (!eol)
+			eol = end;
+		QByteArray line(p, eol - p);
+		int tick, a, b, c;
+		if (line.startsWith("NOTE"))
+		{
+			if (sscanf(line.constData(), "NOTE %d %d %d %d", &tick, &a, &b, &c) == 4)
+			{
+				Event e(Note);
+				e.setTick(tick);
+				e.setPitch(a);
+				e.setLenTick(b);
+				e.setVelo(c);
+				events.append(e);
+			}
+		}
+		else if (line.startsWith("CONTROLLER"))
+		{
+			if (sscanf(line.constData(), "CONTROLLER %d %d %d %d", &tick, &a, &b, &c) == 4)
+			{
+				Event e(Controller);
+				e.setTick(tick);
+				e.setA(a);
+				e.setB(b);
+				e.setC(c);
+				events.append(e);
+			}
+		}
+		p = eol + 1;
+	}
+	return false;
+}
+
 //---------------------------------------------------------
 //   executeScript
 //---------------------------------------------------------
@@ -4219,25 +4627,50 @@ void Song::executeScript(const char* scriptfile, PartList* parts, int quant, boo
 	// NOTE <tick> <nr> <len in ticks> <velocity>
 	// CONTROLLER <tick> <a> <b> <c>
 	//
-	song->startUndo(); // undo this entire block
+	// Every part goes to its own file and the script runs on
+	// up to idealThreadCount() of them at once. The parts are
+	// only touched when all runs succeeded, then their events
+	// are swapped in a single audio message.
+	//
+	int z, n;
+	AL::sigmap.timesig(0, z, n);
+	int beatLen = AL::sigmap.ticksBeat(0);
+	QByteArray tmpl = QString(QDir::tempPath() + "/oom-tmp-XXXXXX").toLocal8Bit();
+
+	QList<ScriptJob> jobs;
+	QList<PartEventsEdit> edits;
+	bool failed = false;
 	for (iPart i = parts->begin(); i != parts->end(); i++)
 	{
-		//const char* tmp = tmpnam(NULL);
-		char tmp[16] = "oom-tmp-XXXXXX";
-		int fd = mkstemp(tmp);
-		printf("script input filename=%s\n", tmp);
-		//FILE *fp = fopen(tmp, "w");
+		ScriptJob job;
+		job.file = tmpl;
+		job.pid = -1;
+		job.status = -1;
+		int fd = mkstemp(job.file.data());
+		if (fd == -1)
+		{
+			perror("cannot create script input file");
+			failed = true;
+			break;
+		}
 		FILE *fp = fdopen(fd, "w");
+		if (!fp)
+		{
+			perror("cannot open script input file");
+			close(fd);
+			remove(job.file.constData());
+			failed = true;
+			break;
+		}
 		MidiPart *part = (MidiPart*) (i->second);
+		PartEventsEdit edit;
+		edit.part = part;
 		int partStart = part->endTick() - part->lenTick();
-		int z, n;
-		AL::sigmap.timesig(0, z, n);
 		fprintf(fp, "TIMESIG %d %d\n", z, n);
 		fprintf(fp, "PART %d %d\n", partStart, part->lenTick());
-		fprintf(fp, "BEATLEN %d\n", AL::sigmap.ticksBeat(0));
+		fprintf(fp, "BEATLEN %d\n", beatLen);
 		fprintf(fp, "QUANTLEN %d\n", quant);
 
-		//for (iCItem i = items.begin(); i != items.end(); ++i) {
 		for (iEvent e = part->events()->begin(); e != part->events()->end(); e++)
 		{
 			Event ev = e->second;
@@ -4248,103 +4681,68 @@ void Song::executeScript(const char* scriptfile, PartList* parts, int quant, boo
 					continue;
 
 				fprintf(fp, "NOTE %d %d %d %d\n", ev.tick(), ev.dataA(), ev.lenTick(), ev.dataB());
-				// Indicate no undo, and do not do port controller values and clone parts.
-				audio->msgDeleteEvent(ev, part, false, false, false);
+				edit.remove.append(ev);
 			}
 			else if (ev.type() == Controller)
 			{
 				fprintf(fp, "CONTROLLER %d %d %d %d\n", ev.tick(), ev.dataA(), ev.dataB(), ev.dataC());
-				// Indicate no undo, and do not do port controller values and clone parts.
-				audio->msgDeleteEvent(ev, part, false, false, false);
+				edit.remove.append(ev);
 			}
 		}
 		fclose(fp);
+		jobs.append(job);
+		edits.append(edit);
+	}
 
-		// Call external program, let it manipulate the file
-		int pid = fork();
-		if (pid == 0)
+	// Call external program, let it manipulate the files
+	int maxRunning = qMax(1, QThread::idealThreadCount());
+	int next = 0;
+	int done = 0;
+	while (done < next || (!failed && next < jobs.size()))
+	{
+		if (!failed && next < jobs.size() && next - done < maxRunning)
 		{
-			if (execlp(scriptfile, scriptfile, tmp, NULL) == -1)
+			int pid = fork();
+			if (pid == 0)
 			{
+				execlp(scriptfile, scriptfile, jobs[next].file.constData(), (char*) NULL);
 				perror("Failed to launch script!");
-				// Get out of here
-
 				// cannot report error through gui, we are in another fork!
-				//@!TODO: Handle unsuccessful attempts
-				exit(99);
+				_exit(99);
 			}
-			exit(0);
-		}
-		else if (pid == -1)
-		{
-			perror("fork failed");
-		}
-		else
-		{
-			int status;
-			waitpid(pid, &status, 0);
-			if (WEXITSTATUS(status) != 0)
+			else if (pid == -1)
 			{
-				QMessageBox::warning(oom, tr("OOMidi - external script failed"),
-						tr("OOMidi was unable to launch the script\n")
-						);
-				endUndo(SC_EVENT_REMOVED);
-				return;
+				perror("fork failed");
+				failed = true;
 			}
 			else
-			{ // d0 the fun55or5!
-				// TODO: Create a new part, update the entire editor from it, hehh....
-
-				QFile file(tmp);
-				if (file.open(QIODevice::ReadOnly))
-				{
-					QTextStream stream(&file);
-					QString line;
-					while (!stream.atEnd())
-					{
-						line = stream.readLine(); // line of text excluding '\n'
-						if (line.startsWith("NOTE"))
-						{
-							QStringList sl = line.split(" ");
-
-							Event e(Note);
-							int tick = sl[1].toInt();
-							int pitch = sl[2].toInt();
-							int len = sl[3].toInt();
-							int velo = sl[4].toInt();
-							printf("tick=%d pitch=%d velo=%d len=%d\n", tick, pitch, velo, len);
-							e.setTick(tick);
-							e.setPitch(pitch);
-							e.setVelo(velo);
-							e.setLenTick(len);
-							// Indicate no undo, and do not do port controller values and clone parts.
-							audio->msgAddEvent(e, part, false, false, false);
-						}
-						if (line.startsWith("CONTROLLER"))
-						{
-							QStringList sl = line.split(" ");
-
-							Event e(Controller);
-							int tick = sl[1].toInt();
-							int a = sl[2].toInt();
-							int b = sl[3].toInt();
-							int c = sl[4].toInt();
-							printf("tick=%d a=%d b=%d c=%d\n", tick, a, b, c);
-							e.setA(a);
-							e.setB(b);
-							e.setB(c);
-							// Indicate no undo, and do not do port controller values and clone parts.
-							audio->msgAddEvent(e, part, false, false, false);
-						}
-					}
-					file.close();
-				}
-			}
+				jobs[next++].pid = pid;
+			continue;
 		}
-		remove(tmp);
+		ScriptJob& job = jobs[done++];
+		waitpid(job.pid, &job.status, 0);
+		if (!WIFEXITED(job.status) || WEXITSTATUS(job.status) != 0)
+			failed = true;
+	}
+
+	for (int i = 0; !failed && i < jobs.size(); ++i)
+		failed = readScriptOutput(jobs[i].file, edits[i].add);
+
+	for (int i = 0; i < jobs.size(); ++i)
+		remove(jobs[i].file.constData());
+
+	if (failed)
+	{
+		QMessageBox::warning(oom, tr("OOMidi - external script failed"),
+				tr("OOMidi was unable to launch the script\n")
+				);
+		return;
 	}
 
-	endUndo(SC_EVENT_REMOVED);
+	song->startUndo(); // undo this entire block
+	// Do not do port controller values and clone parts.
+	audio->msgReplaceEvents(edits, false, false);
+	endUndo(SC_EVENT_REMOVED | SC_EVENT_INSERTED);
 }
 
 void Song::populateScriptMenu(QMenu* menuPlugins, QObject* receiver)
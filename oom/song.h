@@ -20,6 +20,7 @@
 #include "undo.h"
 #include "track.h"
 #include "trackview.h"
+#include "songchange.h"
 
 class QAction;
 class QFont;
@@ -36,6 +37,7 @@ class Sequencer;
 class Track;
 class Part;
 class MidiPart;
+class MidiRecordBuffer;
 class PartList;
 class MPEventList;
 class EventList;
@@ -89,6 +91,12 @@ class AudioDevice;
 #define SC_VIEW_ADDED		   0X80000000
 #define SC_VIEW_DELETED		   0X90000000
 
+// flags a SongChange can carry details for
+#define SC_DETAIL_FLAGS (SC_TRACK_INSERTED | SC_TRACK_REMOVED | SC_TRACK_MODIFIED \
+	| SC_PART_INSERTED | SC_PART_REMOVED | SC_PART_MODIFIED \
+	| SC_EVENT_INSERTED | SC_EVENT_REMOVED | SC_EVENT_MODIFIED \
+	| SC_SIG | SC_TEMPO)
+
 /*
 enum 
 {
@@ -150,6 +158,21 @@ private:
 
     int updateFlags;
 
+    struct Subscriber
+    {
+        QObject* receiver;
+        int method;
+        int flags;
+    };
+    QList<Subscriber> m_subscribers;
+    SongChange m_pendingChange;
+    bool m_changeQueued;
+
+    void journal(const SongChange&);
+    void journalUndo(const Undo&);
+    bool isSubscribed(QObject* receiver, int method) const;
+    void updateCompactStores(int flags);
+
 	QHash<qint64, Track*> m_tracks; //New indexed list of tracks
 	QHash<qint64, Track*> m_composerTracks;
 	QHash<qint64, Track*> m_viewTracks;
@@ -277,6 +300,9 @@ public:
 
     void clear(bool signal);
     void update(int flags = -1);
+    void update(const SongChange&);
+    bool subscribe(QObject* receiver, const char* member, int flags = -1);
+    void unsubscribe(QObject* receiver);
     void cleanupForQuit();
 
     int globalPitchShift() const {
@@ -409,9 +435,11 @@ public:
     //void cmdAddRecordedWave(WaveTrack* track, const Pos&, const Pos&);
     void cmdAddRecordedWave(WaveTrack* track, Pos, Pos);
     void cmdAddRecordedEvents(MidiTrack*, EventList*, unsigned);
+    void cmdAddRecordedTake(MidiTrack*, MidiRecordBuffer*, unsigned);
     bool addEvent(Event&, Part*);
     void changeEvent(Event&, Event&, Part*);
     void deleteEvent(Event&, Part*);
+    void swapPartEvents(PartEventsChange*, bool redo);
     void cmdChangeWave(QString original, QString tmpfile, unsigned sx, unsigned ex);
     void remapPortDrumCtrlEvents(int mapidx, int newnote, int newchan, int newport);
     void changeAllPortDrumCtrlEvents(bool add, bool drumonly = false);
@@ -650,6 +678,7 @@ public:
     void undoOp(UndoOp::UndoType, Event& oevent, Event& nevent, Part*, bool doCtrls, bool doClones);
     void undoOp(UndoOp::UndoType, SigEvent* oevent, SigEvent* nevent);
     void undoOp(UndoOp::UndoType, int channel, int ctrl, int oval, int nval);
+    void undoOp(UndoOp::UndoType, PartEventsChange*);
     //void undoOp(UndoOp::UndoType, Part* oPart, Part* nPart);
     void undoOp(UndoOp::UndoType, Part* oPart, Part* nPart, bool doCtrls, bool doClones);
     void undoOp(UndoOp::UndoType type, const char* changedFile, const char* changeData, int startframe, int endframe);
@@ -692,6 +721,7 @@ public:
 
 public slots:
     void beat();
+    void samplerChannelLoaded(qint64 trackId, int samplerChannel, int midiPort, int audioChannel);
 
     void undo();
     void redo();
@@ -743,6 +773,10 @@ public slots:
 	void toggleFeedback(bool);
 	void newTrackAdded(qint64);
 
+private slots:
+	void deliverChanges();
+	void subscriberDestroyed(QObject*);
+
 signals:
 	void replayChanged(bool, unsigned);
     void songChanged(int);
@@ -0,0 +1,192 @@
+//=========================================================
+//  OOMidi
+//  OpenOctave Midi and Audio Editor
+//
+//  journal of song changes
+//=========================================================
+
+#include "songchange.h"
+#include "song.h"
+#include "part.h"
+#include "track.h"
+#include "undo.h"
+
+const unsigned SongChange::END_TICK;
+
+//---------------------------------------------------------
+//   SongChange
+//---------------------------------------------------------
+
+SongChange::SongChange(int flags)
+: m_flags(0), m_vague(0), m_startTick(END_TICK), m_endTick(0), m_allEvents(true)
+{
+    addFlags(flags, true);
+}
+
+//---------------------------------------------------------
+//   addFlags
+//---------------------------------------------------------
+
+void SongChange::addFlags(int flags, bool vague)
+{
+    m_flags |= flags;
+    if (vague)
+        m_vague |= flags & SC_DETAIL_FLAGS;
+}
+
+//---------------------------------------------------------
+//   addTrack
+//---------------------------------------------------------
+
+void SongChange::addTrack(Track* track)
+{
+    if (track)
+        m_tracks.insert(track->id());
+}
+
+//---------------------------------------------------------
+//   addPart
+//    the part, its track and the ticks it covers
+//---------------------------------------------------------
+
+void SongChange::addPart(Part* part)
+{
+    if (!part)
+        return;
+    m_parts.insert(part->sn());
+    addTrack(part->track());
+    addTicks(part->tick(), part->endTick());
+}
+
+//---------------------------------------------------------
+//   addTicks
+//---------------------------------------------------------
+
+void SongChange::addTicks(unsigned from, unsigned to)
+{
+    if (to <= from)
+        to = from + 1;
+    if (from < m_startTick)
+        m_startTick = from;
+    if (to > m_endTick)
+        m_endTick = to;
+}
+
+//---------------------------------------------------------
+//   addEvent
+//    Clones share the event list, so the event changed in
+//    every part of the clone chain.
+//---------------------------------------------------------
+
+void SongChange::addEvent(const Event& event, Part* part)
+{
+    if (m_allEvents)
+    {
+        if (m_events.size() < MAX_EVENTS)
+            m_events.append(event);
+        else
+        {
+            m_events.clear();
+            m_allEvents = false;
+        }
+    }
+    if (!part)
+        return;
+    Part* p = part;
+    do
+    {
+        m_parts.insert(p->sn());
+        addTrack(p->track());
+        unsigned tick = p->tick() + event.tick();
+        addTicks(tick, tick + event.lenTick());
+        p = p->nextClone();
+    } while (p && p != part);
+}
+
+//---------------------------------------------------------
+//   addUndoOp
+//    returns the flags the op gave details for
+//---------------------------------------------------------
+
+int SongChange::addUndoOp(const UndoOp& op)
+{
+    switch (op.type)
+    {
+        case UndoOp::AddTrack:
+        case UndoOp::DeleteTrack:
+            addTrack(op.oTrack);
+            return SC_TRACK_INSERTED | SC_TRACK_REMOVED;
+        case UndoOp::ModifyTrack:
+            addTrack(op.oTrack);
+            addTrack(op.nTrack);
+            return SC_TRACK_MODIFIED;
+        case UndoOp::AddPart:
+        case UndoOp::DeletePart:
+            addPart(op.oPart);
+            return SC_PART_INSERTED | SC_PART_REMOVED;
+        case UndoOp::ModifyPart:
+            addPart(op.oPart);
+            addPart(op.nPart);
+            return SC_PART_MODIFIED;
+        case UndoOp::AddEvent:
+        case UndoOp::DeleteEvent:
+            addEvent(op.nEvent, op.part);
+            return SC_EVENT_INSERTED | SC_EVENT_REMOVED;
+        case UndoOp::ModifyEvent:
+            addEvent(op.oEvent, op.part);
+            addEvent(op.nEvent, op.part);
+            return SC_EVENT_MODIFIED;
+        case UndoOp::ModifyPartEvents:
+        {
+            const PartEventsChange* c = op.eventsChange;
+            for (int i = 0; i < c->removed.size(); ++i)
+                addEvent(c->removed.at(i), c->part);
+            for (int i = 0; i < c->added.size(); ++i)
+                addEvent(c->added.at(i), c->part);
+            return SC_EVENT_INSERTED | SC_EVENT_REMOVED;
+        }
+        case UndoOp::AddTempo:
+        case UndoOp::DeleteTempo:
+            // everything after a tempo change moves in time
+            addTicks(op.a, END_TICK);
+            return SC_TEMPO;
+        case UndoOp::AddSig:
+        case UndoOp::DeleteSig:
+            addTicks(op.a, END_TICK);
+            return SC_SIG;
+        default:
+            return 0;
+    }
+}
+
+//---------------------------------------------------------
+//   merge
+//---------------------------------------------------------
+
+void SongChange::merge(const SongChange& c)
+{
+    m_flags |= c.m_flags;
+    m_vague |= c.m_vague;
+    m_tracks.unite(c.m_tracks);
+    m_parts.unite(c.m_parts);
+    if (c.m_startTick < m_startTick)
+        m_startTick = c.m_startTick;
+    if (c.m_endTick > m_endTick)
+        m_endTick = c.m_endTick;
+    if (m_allEvents && c.m_allEvents && m_events.size() + c.m_events.size() <= MAX_EVENTS)
+        m_events.append(c.m_events);
+    else
+    {
+        m_events.clear();
+        m_allEvents = false;
+    }
+}
+
+//---------------------------------------------------------
+//   clear
+//---------------------------------------------------------
+
+void SongChange::clear()
+{
+    *this = SongChange();
+}
@@ -0,0 +1,132 @@
+//=========================================================
+//  OOMidi
+//  OpenOctave Midi and Audio Editor
+//
+//  journal of song changes
+//=========================================================
+
+#ifndef __SONGCHANGE_H__
+#define __SONGCHANGE_H__
+
+#include <QList>
+#include <QSet>
+
+#include "event.h"
+
+class Part;
+class Track;
+struct UndoOp;
+
+//---------------------------------------------------------
+//   SongChange
+//    What changed in the song: the SC_* flags and, where
+//    known, the tracks, parts, song ticks and events
+//    behind them. Song collects these for one pass of the
+//    event loop and hands the sum to its subscribers, see
+//    Song::subscribe().
+//
+//    The details are taken from the undo step of an edit.
+//    Flags raised without details, like a plain
+//    Song::update(SC_EVENT_MODIFIED), make the change vague
+//    for them and a view has to treat it as it always did:
+//    anything may have changed.
+//---------------------------------------------------------
+
+class SongChange
+{
+public:
+    enum
+    {
+        MAX_EVENTS = 1024 // beyond this only tracks, parts and ticks are kept
+    };
+    static const unsigned END_TICK = 0xffffffff;
+
+private:
+    int m_flags;
+    int m_vague;
+    QSet<qint64> m_tracks;
+    QSet<int> m_parts;
+    unsigned m_startTick;
+    unsigned m_endTick;
+    QList<Event> m_events;
+    bool m_allEvents;
+
+public:
+    explicit SongChange(int flags = 0);
+
+    int flags() const
+    {
+        return m_flags;
+    }
+
+    bool isEmpty() const
+    {
+        return m_flags == 0;
+    }
+
+    //! true if any of flags was raised without details
+    bool isVague(int flags = -1) const
+    {
+        return m_vague & flags;
+    }
+
+    const QSet<qint64>& tracks() const
+    {
+        return m_tracks;
+    }
+
+    const QSet<int>& parts() const
+    {
+        return m_parts;
+    }
+
+    //! song ticks, start is END_TICK if no ticks were touched
+    unsigned startTick() const
+    {
+        return m_startTick;
+    }
+
+    unsigned endTick() const
+    {
+        return m_endTick;
+    }
+
+    //! the added, removed and changed events, old and new
+    const QList<Event>& events() const
+    {
+        return m_events;
+    }
+
+    //! false if there were more than MAX_EVENTS
+    bool allEvents() const
+    {
+        return m_allEvents;
+    }
+
+    bool touchesTrack(qint64 id) const
+    {
+        return m_tracks.contains(id);
+    }
+
+    bool touchesPart(int sn) const
+    {
+        return m_parts.contains(sn);
+    }
+
+    //! true if any touched song tick is in [from, to)
+    bool touchesTicks(unsigned from, unsigned to) const
+    {
+        return m_startTick < to && m_endTick > from;
+    }
+
+    void addFlags(int flags, bool vague);
+    void addTrack(Track*);
+    void addPart(Part*);
+    void addTicks(unsigned from, unsigned to);
+    void addEvent(const Event&, Part*);
+    int addUndoOp(const UndoOp&);
+    void merge(const SongChange&);
+    void clear();
+};
+
+#endif
@@ -30,6 +30,7 @@
 #include "driver/jackmidi.h"
 #include "trackview.h"
 #include "instruments/minstrument.h"
+#include "network/lsasyncclient.h"
 
 //---------------------------------------------------------
 //   ClonePart
@@ -679,25 +680,17 @@ void Song::read(Xml& xml)/*{{{*/
 									lsClient->resetSampler();
 								}
 							}
-							if(lsClientStarted)
+							LSChannelRequest request;
+							if(lsClientStarted && LSAsyncClient::channelRequest(ins, track->name(), track->id(), &request))
 							{
-								//qDebug("Loading Instrument to LinuxSampler");
-								if(lsClient->loadInstrument(ins))
+								//The channels of all tracks are created together once we are
+								//back in the event loop, see samplerChannelLoaded()
+								if(!lsAsyncClient)
 								{
-									//qDebug("Instrument Map Loaded");
-									int map = lsClient->findMidiMap(ins->iname().toUtf8().constData());
-									Patch* p = ins->getDefaultPatch();
-									if(p && map >= 0)
-									{
-										SamplerData* data;
-										if(lsClient->createInstrumentChannel(track->name().toUtf8().constData(), p->engine.toUtf8().constData(), p->filename.toUtf8().constData(), p->index, map, &data))
-										{
-											if(data)
-												track->setSamplerData(data);
-											//qDebug("Created Channel for track");
-										}
-									}
+									lsAsyncClient = new LSAsyncClient(config.lsClientHost, config.lsClientPort);
+									connect(lsAsyncClient, SIGNAL(channelLoaded(qint64, int, int, int)), this, SLOT(samplerChannelLoaded(qint64, int, int, int)));
 								}
+								lsAsyncClient->loadChannel(request);
 							}
 						}
 					}
@@ -835,6 +828,25 @@ void Song::read(Xml& xml)/*{{{*/
 	cloneList.clear();
 }/*}}}*/
 
+//---------------------------------------------------------
+//   samplerChannelLoaded
+//    a LinuxSampler channel queued by read() is ready
+//---------------------------------------------------------
+
+void Song::samplerChannelLoaded(qint64 trackId, int samplerChannel, int midiPort, int audioChannel)
+{
+	Track* track = findTrackById(trackId);
+	if(!track || !track->isMidiTrack())
+		return;
+	SamplerData* data = new SamplerData;
+	data->samplerChannel = samplerChannel;
+	data->midiDevice = 0;
+	data->midiPort = midiPort;
+	data->audioDevice = 0;
+	data->audioChannel = audioChannel;
+	((MidiTrack*)track)->setSamplerData(data);
+}
+
 //---------------------------------------------------------
 //   read
 //    read song
@@ -23,6 +23,8 @@
 #include "route.h"
 #include "midimonitor.h"
 #include "ccinfo.h"
+#include "meterbus.h"
+#include "midirecordbuffer.h"
 
 unsigned int Track::_soloRefCnt = 0;
 Track* Track::_tmpSoloChainTrack = 0;
@@ -184,7 +186,13 @@ void Track::init()
 	{
 		_meter[i] = 0.0;
 		_peak[i] = 0.0;
+		_rms[i] = 0.0;
+		_truePeak[i] = 0.0;
+		_clips[i] = 0;
+		for (int k = 0; k < 3; ++k)
+			_meterHistory[i][k] = 0.0;
 	}
+	_meterSlot = meterBus ? meterBus->allocSlot() : -1;
 	m_midiassign.enabled = false;
 	m_midiassign.port = 0;
 	m_midiassign.preset = 0;
@@ -295,7 +303,23 @@ Track::Track(const Track& t, bool cloneParts)
 		//_peak[i]  = 0;
 		_meter[i] = 0.0;
 		_peak[i] = 0.0;
+		_rms[i] = 0.0;
+		_truePeak[i] = 0.0;
+		_clips[i] = 0;
+		for (int k = 0; k < 3; ++k)
+			_meterHistory[i][k] = 0.0;
 	}
+	_meterSlot = meterBus ? meterBus->allocSlot() : -1;
+}
+
+//---------------------------------------------------------
+//   ~Track
+//---------------------------------------------------------
+
+Track::~Track()
+{
+	if (meterBus)
+		meterBus->freeSlot(_meterSlot);
 }
 
 //---------------------------------------------------------
@@ -604,6 +628,7 @@ MidiTrack::MidiTrack()
 	init();
 	_events = new EventList;
 	_mpevents = new MPEventList;
+	_recordBuffer = new MidiRecordBuffer;
 }
 
 //MidiTrack::MidiTrack(const MidiTrack& mt)
@@ -619,6 +644,9 @@ MidiTrack::MidiTrack(const MidiTrack& mt, bool cloneParts)
 	m_samplerData = mt.m_samplerData;
 	_events = new EventList;
 	_mpevents = new MPEventList;
+	_recordBuffer = new MidiRecordBuffer;
+	if (_recordFlag)
+		_recordBuffer->reserve();
 	transposition = mt.transposition;
 	transpose = mt.transpose;
 	velocity = mt.velocity;
@@ -632,6 +660,7 @@ MidiTrack::~MidiTrack()
 {
 	delete _events;
 	delete _mpevents;
+	delete _recordBuffer;
 	if(_wantsAutomation)
 	{
     	if (_outPort >= 0 && _outPort < MIDI_PORTS)
@@ -923,6 +952,10 @@ void MidiTrack::setAutomationType(AutomationType t)
 bool MidiTrack::setRecordFlag1(bool f, bool monitor)
 {
     _recordFlag = f;
+    // armed tracks have the record pool ready before the
+    // first event comes in
+    if (f)
+        _recordBuffer->reserve();
 	if(!monitor)
 	{
 		//Call the monitor here if it was not called from the monitor
@@ -28,6 +28,7 @@ class Pipeline;
 class Xml;
 class SndFile;
 class MPEventList;
+class MidiRecordBuffer;
 class BasePlugin;
 class MidiAssignData;
 class MidiPort;
@@ -119,6 +120,11 @@ protected:
     int _lastActivity;
     double _meter[MAX_CHANNELS];
     double _peak[MAX_CHANNELS];
+    double _rms[MAX_CHANNELS];
+    double _truePeak[MAX_CHANNELS];
+    int _clips[MAX_CHANNELS];
+    float _meterHistory[MAX_CHANNELS][3]; // last samples of the previous cycle, for true peak
+    int _meterSlot; // MeterBus slot, -1 if none
 
     int _y;
     int _height; // visual height in Composer
@@ -141,9 +147,7 @@ public:
     Track(TrackType);
     Track(const Track&, bool cloneParts);
 
-    virtual ~Track()
-    {
-    };
+    virtual ~Track();
     virtual Track & operator=(const Track& t);
 
     static const char* _cname[];
@@ -455,7 +459,28 @@ public:
     {
         return _peak[ch];
     }
+
+    double rms(int ch) const
+    {
+        return _rms[ch];
+    }
+
+    double truePeak(int ch) const
+    {
+        return _truePeak[ch];
+    }
+
+    int clips(int ch) const
+    {
+        return _clips[ch];
+    }
+
+    int meterSlot() const
+    {
+        return _meterSlot;
+    }
     void resetMeter();
+    void meterChannel(int ch, const float* buffer, unsigned nframes, double gain);
 
     bool readProperty(Xml& xml, const QString& tag);
     void setDefaultName();
@@ -505,6 +530,7 @@ class MidiTrack : public Track
 
     EventList* _events; // tmp Events during midi import
     MPEventList* _mpevents; // tmp Events druring recording
+    MidiRecordBuffer* _recordBuffer;
 	QHash<int, QList<MonitorLog> > m_monitorBuffer;
 	SamplerData* m_samplerData;
 
@@ -550,6 +576,11 @@ public:
         return _mpevents;
     }
 
+    MidiRecordBuffer* recordBuffer() const
+    {
+        return _recordBuffer;
+    }
+
     virtual void read(Xml&);
     virtual void write(int, Xml&) const;
 
@@ -641,6 +672,8 @@ typedef QPair<bool, double> AuxInfo;
 class AudioTrack : public Track
 {
     bool _haveData;
+    float** _renderTap; // offline render copy of the post fader output
+    void renderTap(float** buffer, unsigned nframes, const double* vol);
 
     CtrlListList _controller;
     CtrlRecList _recEvents; // recorded automation events
@@ -738,7 +771,18 @@ public:
 
     void putFifo(int channels, unsigned long n, float** bp);
 
-    void record();
+    unsigned record(float** stage, unsigned stageFrames, int minBlocks);
+
+    // offline render, see OfflineRender
+    void setRenderTap(float** buffer)
+    {
+        _renderTap = buffer;
+    }
+
+    Fifo* recordFifo()
+    {
+        return &fifo;
+    }
 
     virtual void setMute(bool val, bool monitor = false);
     virtual void setOff(bool val);
@@ -907,6 +951,7 @@ class AudioOutput : public AudioTrack
     void* jackPorts[MAX_CHANNELS];
     float* buffer[MAX_CHANNELS];
     float* buffer1[MAX_CHANNELS];
+    float** _renderBuffers; // replaces the driver buffers during offline render
     unsigned long _nframes;
 
     float* _monitorBuffer[MAX_CHANNELS];
@@ -961,6 +1006,11 @@ public:
     void processWrite();
     void silence(unsigned);
 
+    void setRenderBuffers(float** buffers)
+    {
+        _renderBuffers = buffers;
+    }
+
     virtual bool canRecord() const
     {
         return true;
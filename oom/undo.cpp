@@ -11,7 +11,9 @@
 
 #include "undo.h"
 #include "song.h"
+#include "part.h"
 #include "globals.h"
+#include "gconfig.h"
 #include <QUndoStack>
 #include "traverso_shared/OOMCommand.h"
 
@@ -32,9 +34,10 @@ const char* UndoOp::typeName()
 		"AddPart", "DeletePart", "ModifyPart",
 		"AddEvent", "DeleteEvent", "ModifyEvent",
 		"AddTempo", "DeleteTempo", "AddSig", "DeleteSig",
-		"SwapTrack", "ModifyClip",
+		"SwapTrack", "ModifyClip", "ModifyMarker",
 		"AddTrackView", "DeleteTrackView", "ModifyTrackView",
-		"AddAutomation", "DeleteAutomation", "ModifyAutomation"
+		"AddAutomation", "DeleteAutomation", "ModifyAutomation",
+		"AddOOMCommand", "ModifyPartEvents"
 	};
 	return name[type];
 }
@@ -84,109 +87,250 @@ void UndoOp::dump()
 		case AddAutomation:
 		case DeleteAutomation:
 		case ModifyAutomation:
+		case ModifyPartEvents:
 			break;
 	}
 }
 
+//---------------------------------------------------------
+//   memoryUsage
+//    rough estimate of what keeping this op costs. Event
+//    lists shared with a live part (clones, ModifyPart
+//    copies) only count the part itself.
+//---------------------------------------------------------
+
+static const size_t EVENT_BYTES = 96;
+static const size_t PART_BYTES = 256;
+static const size_t TRACK_BYTES = 2048;
+static const size_t NODE_BYTES = 48;
+
+static size_t eventMemory(const Event& e)
+{
+	if (e.empty())
+		return 0;
+	return EVENT_BYTES + e.dataLen();
+}
+
+static size_t partMemory(Part* p)
+{
+	if (!p)
+		return 0;
+	size_t bytes = PART_BYTES;
+	EventList* el = p->events();
+	if (el && el->refCount() <= 1)
+	{
+		for (ciEvent i = el->begin(); i != el->end(); ++i)
+			bytes += eventMemory(i->second);
+	}
+	return bytes;
+}
+
+static size_t trackMemory(Track* t)
+{
+	if (!t)
+		return 0;
+	size_t bytes = TRACK_BYTES;
+	PartList* pl = t->parts();
+	for (iPart ip = pl->begin(); ip != pl->end(); ++ip)
+		bytes += partMemory(ip->second);
+	return bytes;
+}
+
+size_t UndoOp::memoryUsage() const
+{
+	size_t bytes = sizeof(UndoOp);
+	switch (type)
+	{
+		case DeleteTrack:
+		case ModifyTrack:
+			bytes += trackMemory(oTrack);
+			break;
+		case DeletePart:
+			bytes += partMemory(oPart);
+			break;
+		case ModifyPart:
+			// the dormant part usually shares the live part's list
+			if (oPart && nPart && oPart->events() == nPart->events())
+				bytes += PART_BYTES;
+			else
+				bytes += partMemory(nPart);
+			break;
+		case AddEvent:
+		case DeleteEvent:
+		case ModifyEvent:
+			bytes += eventMemory(oEvent) + eventMemory(nEvent);
+			break;
+		case ModifyPartEvents:
+			// both lists share the events, the dormant one
+			// costs its map nodes
+			bytes += eventsChange->oEvents->size() * NODE_BYTES;
+			bytes += (eventsChange->removed.size() + eventsChange->added.size()) * EVENT_BYTES;
+			break;
+		default:
+			break;
+	}
+	return bytes;
+}
+
+//---------------------------------------------------------
+//   measure
+//---------------------------------------------------------
+
+void Undo::measure()
+{
+	_memory = 0;
+	for (const_iterator i = begin(); i != end(); ++i)
+		_memory += i->memoryUsage();
+}
+
 //---------------------------------------------------------
 //    clearDelete
 //---------------------------------------------------------
 
 void UndoList::clearDelete()
 {
-	if (!empty())
+	for (iUndo iu = begin(); iu != end(); ++iu)
+		deleteOps(iu);
+	clear();
+}
+
+//---------------------------------------------------------
+//    deleteOps
+//    free what the ops of one step own and clear
+//    references to it from the following steps
+//---------------------------------------------------------
+
+void UndoList::deleteOps(iterator iu)
+{
+	Undo& u = *iu;
+	for (riUndoOp i = u.rbegin(); i != u.rend(); ++i)
 	{
-		for (iUndo iu = begin(); iu != end(); ++iu)
+		switch (i->type)
 		{
-			Undo& u = *iu;
-			for (riUndoOp i = u.rbegin(); i != u.rend(); ++i)
-			{
-				switch (i->type)
+			case UndoOp::DeleteTrack:
+				if (i->oTrack)
 				{
-					case UndoOp::DeleteTrack:
-						if (i->oTrack)
+					delete i->oTrack;
+					iUndo iu2 = iu;
+					++iu2;
+					for (; iu2 != end(); ++iu2)
+					{
+						Undo& u2 = *iu2;
+						for (riUndoOp i2 = u2.rbegin(); i2 != u2.rend(); ++i2)
 						{
-							delete i->oTrack;
-							iUndo iu2 = iu;
-							++iu2;
-							for (; iu2 != end(); ++iu2)
+							if (i2->type == UndoOp::DeleteTrack)
 							{
-								Undo& u2 = *iu2;
-								for (riUndoOp i2 = u2.rbegin(); i2 != u2.rend(); ++i2)
-								{
-									if (i2->type == UndoOp::DeleteTrack)
-									{
-										if (i2->oTrack == i->oTrack)
-											i2->oTrack = 0;
-									}
-								}
+								if (i2->oTrack == i->oTrack)
+									i2->oTrack = 0;
 							}
 						}
-						break;
-					case UndoOp::ModifyTrack:
-						if (i->oTrack)
+					}
+				}
+				break;
+			case UndoOp::ModifyTrack:
+				if (i->oTrack)
+				{
+					// Prevent delete i->oTrack from crashing.
+					switch (i->oTrack->type())
+					{
+						case Track::AUDIO_OUTPUT:
 						{
-							// Prevent delete i->oTrack from crashing.
-							switch (i->oTrack->type())
-							{
-								case Track::AUDIO_OUTPUT:
-								{
-									AudioOutput* ao = (AudioOutput*) i->oTrack;
-									for (int ch = 0; ch < ao->channels(); ++ch)
-										ao->setJackPort(ch, 0);
-								}
-									break;
-								case Track::AUDIO_INPUT:
-								{
-									AudioInput* ai = (AudioInput*) i->oTrack;
-									for (int ch = 0; ch < ai->channels(); ++ch)
-										ai->setJackPort(ch, 0);
-								}
-									break;
-								default:
-									break;
-							}
-							if (!i->oTrack->isMidiTrack())
-								((AudioTrack*) i->oTrack)->clearEfxList();
-							//FIXME: I suspect this is causing a double free error in the destructor 
-							//of AudioAux, testin just commenting for now and seeing the side effects
-							delete i->oTrack;
-
-							iUndo iu2 = iu;
-							++iu2;
-							for (; iu2 != end(); ++iu2)
+							AudioOutput* ao = (AudioOutput*) i->oTrack;
+							for (int ch = 0; ch < ao->channels(); ++ch)
+								ao->setJackPort(ch, 0);
+						}
+							break;
+						case Track::AUDIO_INPUT:
+						{
+							AudioInput* ai = (AudioInput*) i->oTrack;
+							for (int ch = 0; ch < ai->channels(); ++ch)
+								ai->setJackPort(ch, 0);
+						}
+							break;
+						default:
+							break;
+					}
+					if (!i->oTrack->isMidiTrack())
+						((AudioTrack*) i->oTrack)->clearEfxList();
+					//FIXME: I suspect this is causing a double free error in the destructor 
+					//of AudioAux, testin just commenting for now and seeing the side effects
+					delete i->oTrack;
+
+					iUndo iu2 = iu;
+					++iu2;
+					for (; iu2 != end(); ++iu2)
+					{
+						Undo& u2 = *iu2;
+						for (riUndoOp i2 = u2.rbegin(); i2 != u2.rend(); ++i2)
+						{
+							if (i2->type == UndoOp::ModifyTrack)
 							{
-								Undo& u2 = *iu2;
-								for (riUndoOp i2 = u2.rbegin(); i2 != u2.rend(); ++i2)
-								{
-									if (i2->type == UndoOp::ModifyTrack)
-									{
-										if (i2->oTrack == i->oTrack)
-											i2->oTrack = 0;
-									}
-								}
+								if (i2->oTrack == i->oTrack)
+									i2->oTrack = 0;
 							}
 						}
-						break;
-						//case UndoOp::DeletePart:
-						//delete i->oPart;
-						//      break;
-						//case UndoOp::DeleteTempo:
-						//      break;
-						//case UndoOp::DeleteSig:
-						//      break;
-					case UndoOp::ModifyMarker:
-						if (i->copyMarker)
-							delete i->copyMarker;
-					default:
-						break;
+					}
 				}
+				break;
+				//case UndoOp::DeletePart:
+				//delete i->oPart;
+				//      break;
+				//case UndoOp::DeleteTempo:
+				//      break;
+				//case UndoOp::DeleteSig:
+				//      break;
+			case UndoOp::ModifyMarker:
+				if (i->copyMarker)
+					delete i->copyMarker;
+				break;
+			case UndoOp::ModifyPartEvents:
+			{
+				// an undone step keeps the new list dormant,
+				// a done one the old list
+				PartEventsChange* c = i->eventsChange;
+				if (c->oEvents->refCount() <= 0)
+					delete c->oEvents;
+				if (c->nEvents != c->oEvents && c->nEvents->refCount() <= 0)
+					delete c->nEvents;
+				delete c;
 			}
-			u.clear();
+				break;
+			default:
+				break;
 		}
 	}
+	u.clear();
+}
 
-	clear();
+//---------------------------------------------------------
+//    memory
+//---------------------------------------------------------
+
+size_t UndoList::memory() const
+{
+	size_t bytes = 0;
+	for (const_iterator iu = begin(); iu != end(); ++iu)
+		bytes += iu->memory();
+	return bytes;
+}
+
+//---------------------------------------------------------
+//    trim
+//    returns the number of steps dropped
+//---------------------------------------------------------
+
+int UndoList::trim(size_t budget)
+{
+	size_t bytes = memory();
+	int n = 0;
+	while (size() > 1 && bytes > budget)
+	{
+		bytes -= front().memory();
+		deleteOps(begin());
+		pop_front();
+		++n;
+	}
+	return n;
 }
 
 void Song::pushToHistoryStack(OOMCommand *cmd)
@@ -227,6 +371,17 @@ void Song::endUndo(int flags)
 	updateFlags |= flags;
 	endMsgCmd();
 	undoMode = false;
+
+	if (!undoList->empty())
+	{
+		undoList->back().measure();
+		if (config.undoMemoryLimit > 0)
+		{
+			int n = undoList->trim(size_t(config.undoMemoryLimit) << 20);
+			if (n && debugMsg)
+				printf("undo memory limit reached, dropped %d oldest steps\n", n);
+		}
+	}
 }
 
 //---------------------------------------------------------
@@ -392,6 +547,10 @@ void Song::doUndo2()
 					addPortCtrlEvents(i->nEvent, i->part, i->doClones);
 				updateFlags |= SC_EVENT_MODIFIED;
 				break;
+			case UndoOp::ModifyPartEvents:
+				swapPartEvents(i->eventsChange, false);
+				updateFlags |= SC_EVENT_REMOVED | SC_EVENT_INSERTED;
+				break;
 			case UndoOp::AddTempo:
 				//printf("doUndo2: UndoOp::AddTempo. deleting tempo at: %d\n", i->a);
 				tempomap.delTempo(i->a);
@@ -570,6 +729,10 @@ void Song::doRedo2()
 					addPortCtrlEvents(i->oEvent, i->part, i->doClones);
 				updateFlags |= SC_EVENT_MODIFIED;
 				break;
+			case UndoOp::ModifyPartEvents:
+				swapPartEvents(i->eventsChange, true);
+				updateFlags |= SC_EVENT_REMOVED | SC_EVENT_INSERTED;
+				break;
 			case UndoOp::AddTempo:
 				//printf("doRedo2: UndoOp::AddTempo. adding tempo at: %d with tempo=%d\n", i->a, i->b);
 				tempomap.addTempo(i->a, i->b);
@@ -694,6 +857,14 @@ void Song::undoOp(UndoOp::UndoType type, Part* oPart, Part* nPart, bool doCtrls,
 	addUndo(i);
 }
 
+void Song::undoOp(UndoOp::UndoType type, PartEventsChange* change)
+{
+	UndoOp i;
+	i.type = type;
+	i.eventsChange = change;
+	addUndo(i);
+}
+
 void Song::undoOp(UndoOp::UndoType type, int c, int ctrl, int ov, int nv)
 {
 	UndoOp i;
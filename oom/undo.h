@@ -10,6 +10,7 @@
 #define __UNDO_H__
 
 #include <list>
+#include <QList>
 
 #include "event.h"
 #include "marker/marker.h"
@@ -22,6 +23,28 @@ class SigEvent;
 class Part;
 class OOMCommand;
 
+//---------------------------------------------------------
+//   PartEventsChange
+//    A part's event list replaced as a whole. The gui
+//    thread builds nEvents from oEvents, the audio thread
+//    only moves the part and its clones from one list to
+//    the other. oCtrls and nCtrls are the controller events
+//    only found in the old or the new list, the ones the
+//    port controller values have to follow.
+//---------------------------------------------------------
+
+struct PartEventsChange
+{
+    Part* part;
+    EventList* oEvents;
+    EventList* nEvents;
+    QList<Event> removed;
+    QList<Event> added;
+    QList<Event> oCtrls;
+    QList<Event> nCtrls;
+    bool doCtrls;
+};
+
 extern std::list<QString> temporaryWavFiles; //!< Used for storing all tmp-files, for cleanup on shutdown
 //---------------------------------------------------------
 //   UndoOp
@@ -42,7 +65,8 @@ struct UndoOp
         ModifyMarker,
         AddTrackView, DeleteTrackView, ModifyTrackView,
 		AddAutomation, DeleteAutomation, ModifyAutomation,
-	    AddOOMCommand
+	    AddOOMCommand,
+        ModifyPartEvents
     };
     UndoType type;
 
@@ -79,6 +103,11 @@ struct UndoOp
 		OOMCommand* cmd;
 	};
 
+        struct
+        {
+            PartEventsChange* eventsChange;
+        };
+
         struct
         {
             SigEvent* nSignature;
@@ -120,20 +149,50 @@ struct UndoOp
     bool doClones;
     const char* typeName();
     void dump();
+    size_t memoryUsage() const;
 };
 
+//---------------------------------------------------------
+//   Undo
+//    one undo step. The memory estimate is taken once by
+//    Song::endUndo() when the step is complete.
+//---------------------------------------------------------
+
 class Undo : public std::list<UndoOp>
 {
+    size_t _memory;
     void undoOp(UndoOp::UndoType, int data);
+
+public:
+    Undo() : _memory(0)
+    {
+    }
+
+    size_t memory() const
+    {
+        return _memory;
+    }
+    void measure();
 };
 
 typedef Undo::iterator iUndoOp;
 typedef Undo::reverse_iterator riUndoOp;
 
+//---------------------------------------------------------
+//   UndoList
+//    trim() drops the oldest steps until the estimated
+//    size of the list fits the budget. The newest step is
+//    always kept.
+//---------------------------------------------------------
+
 class UndoList : public std::list<Undo>
 {
+    void deleteOps(iterator);
+
 public:
     void clearDelete();
+    size_t memory() const;
+    int trim(size_t budget);
 };
 
 typedef UndoList::iterator iUndo;
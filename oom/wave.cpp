@@ -15,6 +15,7 @@
 #include <QFileInfo>
 #include <QMessageBox>
 #include <QProgressDialog>
+#include <QReadWriteLock>
 
 #include "xml.h"
 #include "song.h"
@@ -43,6 +44,11 @@ const char* audioFilePattern[] = {
  */
 const int cacheMag = 128;
 
+// guards the peak caches, the Composer reads peaks from
+// its tile render threads. The gui file handle of each file
+// has a lock of its own, SndFile::uiLock.
+static QReadWriteLock peakLock;
+
 // ClipList* waveClips;
 
 SndFileList SndFile::sndFiles;
@@ -58,6 +64,7 @@ SndFile::SndFile(const QString& name)
 	sfUI = 0;
 	csize = 0;
 	cache = 0;
+	cacheSerial = 0;
 	openFlag = false;
 	sndFiles.push_back(this);
 	refCount = 0;
@@ -139,21 +146,27 @@ void SndFile::readCache(const QString& path, bool showProgress)
 	//      printf("readCache %s for %d samples channel %d\n",
 	//         path.toLatin1().constData(), samples(), channels());
 
-	if (cache)
-	{
-		for (unsigned i = 0; i < channels(); ++i)
-			delete cache[i];
-		delete[] cache;
-	}
-	if (samples() == 0)
 	{
-		//            printf("SndFile::readCache: file empty\n");
-		return;
+		QWriteLocker locker(&peakLock);
+		++cacheSerial;
+		if (cache)
+		{
+			for (unsigned i = 0; i < channels(); ++i)
+				delete cache[i];
+			delete[] cache;
+			cache = 0;
+			csize = 0;
+		}
+		if (samples() == 0)
+		{
+			//            printf("SndFile::readCache: file empty\n");
+			return;
+		}
+		csize = (samples() + cacheMag - 1) / cacheMag;
+		cache = new SampleV*[channels()];
+		for (unsigned ch = 0; ch < channels(); ++ch)
+			cache[ch] = new SampleV[csize];
 	}
-	csize = (samples() + cacheMag - 1) / cacheMag;
-	cache = new SampleV*[channels()];
-	for (unsigned ch = 0; ch < channels(); ++ch)
-		cache[ch] = new SampleV[csize];
 
 	FILE* cfile = fopen(path.toLatin1().constData(), "r");
 	if (cfile)
@@ -161,6 +174,7 @@ void SndFile::readCache(const QString& path, bool showProgress)
 		for (unsigned ch = 0; ch < channels(); ++ch)
 			fread(cache[ch], csize * sizeof (SampleV), 1, cfile);
 		fclose(cfile);
+		++cacheSerial;
 		return;
 	}
 
@@ -215,6 +229,7 @@ void SndFile::readCache(const QString& path, bool showProgress)
 	if (showProgress)
 		progress->setValue(csize);
 	writeCache(path);
+	++cacheSerial;
 	if (showProgress)
 		delete progress;
 }
@@ -254,6 +269,8 @@ void SndFile::read(SampleV* s, int mag, unsigned pos, bool overwrite)
 
 	if (mag < cacheMag)
 	{
+		// sfUI is shared by all readers of this file
+		QMutexLocker locker(&uiLock);
 		float data[channels()][mag];
 		float* fp[channels()];
 //#pragma omp parallel for
@@ -339,6 +356,7 @@ void SndFile::read(SampleV* s, int mag, unsigned pos, bool overwrite)
 	}
 	else
 	{
+		QReadLocker locker(&peakLock);
 		mag /= cacheMag;
 		int rest = csize - (pos / cacheMag);
 		int end = mag;
@@ -403,7 +421,11 @@ void SndFile::close()
 	}
 	sf_close(sf);
 	if (sfUI)
+	{
+		QMutexLocker locker(&uiLock);
 		sf_close(sfUI);
+		sfUI = 0;
+	}
 	openFlag = false;
 }
 
@@ -452,6 +474,19 @@ unsigned SndFile::samples() const
 	return frames;
 }
 
+//---------------------------------------------------------
+//   sessionSamples
+//    files at another rate are resampled while playing
+//---------------------------------------------------------
+
+unsigned SndFile::sessionSamples() const
+{
+	unsigned rate = samplerate();
+	if (rate == 0 || sampleRate == 0 || rate == (unsigned) sampleRate)
+		return samples();
+	return (unsigned) ((unsigned long long) samples() * sampleRate / rate);
+}
+
 //---------------------------------------------------------
 //   channels
 //---------------------------------------------------------
@@ -508,6 +543,17 @@ size_t SndFile::readInternal(int srcChannels, float** dst, size_t n, bool overwr
 {
 //	if (part->getZIndex() > 0) return 0;
 	size_t rn = sf_readf_float(sf, buffer, n);
+	return mix(srcChannels, dst, buffer, rn, offset, overwrite, part);
+}
+
+//---------------------------------------------------------
+//   mix
+//    copy or add interleaved frames in the file channel
+//    layout to dst, applying the part fades
+//---------------------------------------------------------
+
+size_t SndFile::mix(int srcChannels, float** dst, const float* buffer, size_t rn, unsigned offset, bool overwrite, WavePart* part)
+{
 	//TODO: Apply fadein/fadeout curve to signal comming from file
 	bool procFade = false;
 	unsigned startPos = offset;
@@ -517,7 +563,7 @@ size_t SndFile::readInternal(int srcChannels, float** dst, size_t n, bool overwr
 		procFade = true;
 		startPos += part->frame();
 	}
-	float* src = buffer;
+	const float* src = buffer;
 	int dstChannels = sfinfo.channels;
 	if (srcChannels == dstChannels)
 	{
@@ -978,7 +1024,7 @@ bool OOMidi::importWaveToTrack(QString& name, unsigned tick, Track* track)
 		printf("import audio file failed\n");
 		return true;
 	}
-	int samples = f->samples();
+	int samples = f->sessionSamples();
 	/*if ((unsigned) sampleRate != f->samplerate())
 	{
 		if (QMessageBox::question(this, tr("Import Audio file"),
@@ -12,6 +12,7 @@
 #include <list>
 #include <sndfile.h>
 
+#include <QMutex>
 #include <QString>
 
 class QFileInfo;
@@ -54,9 +55,11 @@ class SndFile
     QFileInfo* finfo;
     SNDFILE* sf;
     SNDFILE* sfUI;
+    QMutex uiLock; // sfUI serves one peak reader at a time
     SF_INFO sfinfo;
     SampleV** cache;
     int csize; //!< frames in cache
+    int cacheSerial;
 
     void writeCache(const QString& path);
 
@@ -82,6 +85,12 @@ public:
 
     void readCache(const QString& path, bool progress);
 
+    //! changes whenever the peak cache is read or rebuilt
+    int cacheSN() const
+    {
+        return cacheSerial;
+    }
+
     bool openRead(); //!< returns true on error
     bool openWrite(); //!< returns true on error
     void close();
@@ -104,6 +113,7 @@ public:
     QString name() const; //!< filename
 
     unsigned samples() const;
+    unsigned sessionSamples() const; //!< length at the session sample rate
     unsigned channels() const;
     unsigned samplerate() const;
     unsigned format() const;
@@ -112,6 +122,7 @@ public:
 
     size_t read(int channel, float**, size_t, unsigned offset, bool overwrite = true, WavePart* part = 0);
     size_t readWithHeap(int channel, float**, size_t, bool overwrite = true);
+    size_t mix(int channel, float**, const float* buffer, size_t, unsigned offset, bool overwrite = true, WavePart* part = 0);
 
     size_t readDirect(float* buf, size_t n)
     {
@@ -227,11 +238,21 @@ public:
         return sf->samples();
     }
 
+    unsigned sessionSamples() const
+    {
+        return sf->sessionSamples();
+    }
+
     unsigned channels() const
     {
         return sf->channels();
     }
 
+    int cacheSN() const
+    {
+        return sf->cacheSN();
+    }
+
     unsigned samplerate() const
     {
         return sf->samplerate();
@@ -262,6 +283,11 @@ public:
         return sf->read(channel, f, n, offset, overwrite, part);
     }
 
+    size_t mix(int channel, float** f, const float* buffer, size_t n, unsigned offset, bool overwrite = true, WavePart* part = 0)
+    {
+        return sf->mix(channel, f, buffer, n, offset, overwrite, part);
+    }
+
     size_t readDirect(float* f, size_t n)
     {
         return sf->readDirect(f, n);
@@ -6,18 +6,16 @@
 //  (C) Copyright 2000-2003 Werner Schweer (ws@seh.de)
 //=========================================================
 
-#include "audioconvert.h"
 #include "globals.h"
 #include "event.h"
 #include "waveevent.h"
+#include "resampler.h"
 #include "xml.h"
 #include "wave.h"
 #include <iostream>
 #include <math.h>
+#include <string.h>
 
-// Added by Tim. p3.3.18
-//#define USE_SAMPLERATE
-//
 //#define WAVEEVENT_DEBUG
 //#define WAVEEVENT_DEBUG_PRC
 
@@ -29,6 +27,27 @@ WaveEventBase::WaveEventBase(EventType t)
 : EventBase(t)
 {
 	deleted = false;
+	m_resampler = 0;
+}
+
+//---------------------------------------------------------
+//   WaveEventBase
+//    copies start with a converter of their own
+//---------------------------------------------------------
+
+WaveEventBase::WaveEventBase(const WaveEventBase& ev)
+: EventBase(ev)
+{
+	_name = ev._name;
+	f = ev.f;
+	_spos = ev._spos;
+	deleted = ev.deleted;
+	m_resampler = 0;
+}
+
+WaveEventBase::~WaveEventBase()
+{
+	delete m_resampler;
 }
 
 //---------------------------------------------------------
@@ -155,38 +174,83 @@ void WaveEventBase::write(int level, Xml& xml, const Pos& offset, bool forcePath
     xml.etag(--level, "event");
 }
 
-void WaveEventBase::readAudio(WavePart* part, unsigned offset, float** buffer, int channel, int n, bool doSeek, bool overwrite)
+//---------------------------------------------------------
+//   SndFileInput
+//    input of the streaming resampler. The prefetch thread
+//    shares the file handle with other events, every read
+//    seeks.
+//---------------------------------------------------------
+
+class SndFileInput : public Resampler::Input
 {
-#ifdef WAVEEVENT_DEBUG_PRC
-	printf("WaveEventBase::readAudio audConv:%p sfCurFrame:%ld offset:%u channel:%d n:%d\n", audConv, sfCurFrame, offset, channel, n);
-#endif
+	SndFileR& m_file;
 
-#ifdef USE_SAMPLERATE
+public:
+	SndFileInput(SndFileR& f)
+	: m_file(f)
+	{
+	}
 
-	// TODO:
-	>> >> >> >> >> >+++++++++++++++++++++++++++++
-	// If we have a valid audio converter then use it to do the processing. Otherwise just a normal seek + read.
-	if (audConv)
-		sfCurFrame = audConv->readAudio(f, sfCurFrame, offset, buffer, channel, n, doSeek, overwrite);
-	else
+	virtual size_t read(off_t frame, float* buffer, size_t n)
 	{
-		if (!f.isNull())
-		{
-			sfCurFrame = f.seek(offset + _spos, 0);
-			sfCurFrame += f.read(channel, buffer, n, offset, overwrite, part);
-		}
+		if (m_file.seek(frame, 0) == -1)
+			return 0;
+		return m_file.readDirect(buffer, n);
 	}
-	return;
+};
 
-#else
+//---------------------------------------------------------
+//   readAudio
+//    Files at another rate than the session are converted
+//    here, _spos and offset are session frames for them.
+//    The converter stays with the event, so sequential
+//    reads continue from the filter history of the last
+//    one.
+//---------------------------------------------------------
+
+void WaveEventBase::readAudio(WavePart* part, unsigned offset, float** buffer, int channel, int n, bool /*doSeek*/, bool overwrite)
+{
+#ifdef WAVEEVENT_DEBUG_PRC
+	printf("WaveEventBase::readAudio offset:%u channel:%d n:%d\n", offset, channel, n);
+#endif
 	if (f.isNull())
 		return;
 
-	f.seek(offset + _spos, 0);
-	f.read(channel, buffer, n, offset, overwrite, part);
-
-	return;
-#endif
+	unsigned rate = f.samplerate();
+	if (rate == 0 || sampleRate == 0 || rate == (unsigned) sampleRate)
+	{
+		f.seek(offset + _spos, 0);
+		f.read(channel, buffer, n, offset, overwrite, part);
+		return;
+	}
 
+	off_t pos = offset + _spos;
+	int fchan = f.channels();
+	if ((int) m_converted.size() < n * fchan)
+		m_converted.resize(n * fchan);
+	float* data = &m_converted[0];
+	ResampleCache::Data cached = ResampleCache::lookup(f.path(), rate, sampleRate, fchan, f.samples());
+	if (cached)
+	{
+		off_t frames = cached->size() / fchan;
+		int rn = 0;
+		if (pos < frames)
+			rn = frames - pos < n ? int(frames - pos) : n;
+		if (rn)
+			memcpy(data, &(*cached)[pos * fchan], rn * fchan * sizeof(float));
+		memset(data + rn * fchan, 0, (n - rn) * fchan * sizeof(float));
+	}
+	else
+	{
+		if (!m_resampler || !m_resampler->matches(rate, sampleRate, fchan))
+		{
+			delete m_resampler;
+			m_resampler = new Resampler(rate, sampleRate, fchan);
+		}
+		if (m_resampler->pos() != pos)
+			m_resampler->seek(pos);
+		SndFileInput in(f);
+		m_resampler->process(in, data, n);
+	}
+	f.mix(channel, buffer, data, n, offset, overwrite, part);
 }
-
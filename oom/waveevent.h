@@ -11,10 +11,11 @@
 
 //#include <samplerate.h>
 #include <sys/types.h>
+#include <vector>
 
 #include "eventbase.h"
 
-class AudioConverter;
+class Resampler;
 class WavePart;
 
 //---------------------------------------------------------
@@ -27,17 +28,18 @@ class WaveEventBase : public EventBase
     SndFileR f;
     int _spos; // start sample position in WaveFile
     bool deleted;
+    Resampler* m_resampler; // prefetch thread, files at another rate
+    std::vector<float> m_converted; // prefetch thread, output of m_resampler
 
     // p3.3.31
     //virtual EventBase* clone() { return new WaveEventBase(*this); }
     virtual EventBase* clone();
+    WaveEventBase& operator=(const WaveEventBase&);
 
 public:
     WaveEventBase(EventType t);
-
-    virtual ~WaveEventBase()
-    {
-    }
+    WaveEventBase(const WaveEventBase&);
+    virtual ~WaveEventBase();
 
     virtual void read(Xml&);
     //virtual void write(int, Xml&, const Pos& offset) const;
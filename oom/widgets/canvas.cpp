@@ -46,6 +46,11 @@ Canvas::Canvas(QWidget* parent, int sx, int sy, const char* name)
 	_canvasTools = 0;
 	_itemPopupMenu = 0;
 	m_PartZIndex = false;
+	m_zOrderValid = false;
+	m_zOrderRevision = 0;
+	m_zOrderX = 0;
+	m_zOrderX2 = 0;
+	m_zOrderPart = 0;
 
 	_button = Qt::NoButton;
 	_keyState = 0;
@@ -73,6 +78,7 @@ Canvas::Canvas(QWidget* parent, int sx, int sy, const char* name)
 	_drawPartLines = false;
 	_drawPartEndLine = false;
 	connect(song, SIGNAL(posChanged(int, unsigned, bool)), this, SLOT(setPos(int, unsigned, bool)));
+	setContentCache(true);
 }
 
 //---------------------------------------------------------
@@ -152,8 +158,8 @@ void Canvas::setPos(int idx, unsigned val, bool adjustScrollbar)
 		x = opos;
 	}
 	_pos[idx] = val;
-	//redraw(QRect(x - 1, 0, w + 2, height()));
-	update();
+	// only the old and the new marker positions change
+	updatePositionLayer(QRect(x - 2, 0, w + 4, height()));
 }
 
 bool Canvas::smallerZValue(const CItem* first, const CItem* second)
@@ -161,6 +167,39 @@ bool Canvas::smallerZValue(const CItem* first, const CItem* second)
 	return first->zValue(PartZIndex) < second->zValue(PartZIndex);
 }
 
+//---------------------------------------------------------
+//   updateZOrder
+//    Collects the items that can reach into x..x2 in paint
+//    order. The result is kept until the item list, the
+//    range or the z values change, so repaints that do not
+//    scroll or edit (cursor, playhead, hover) skip the sort.
+//    Part z indexes are not tracked, so canvases that use
+//    them sort on every paint.
+//---------------------------------------------------------
+
+void Canvas::updateZOrder(int x, int x2)
+{
+	if (m_zOrderValid && !m_PartZIndex && m_zOrderRevision == _items.revision()
+			&& m_zOrderX == x && m_zOrderX2 == x2 && m_zOrderPart == _curPart)
+		return;
+
+	m_zOrder.clear();
+	iCItem to(_items.lower_bound(x2));
+	for (iCItem i = _items.lowerBoundVisible(x); i != to; ++i)
+	{
+		if (i->second->bbox().x() + i->second->width() >= x)
+			m_zOrder.append(i->second);
+	}
+	PartZIndex = m_PartZIndex;
+	qStableSort(m_zOrder.begin(), m_zOrder.end(), Canvas::smallerZValue);
+
+	m_zOrderValid = true;
+	m_zOrderRevision = _items.revision();
+	m_zOrderX = x;
+	m_zOrderX2 = x2;
+	m_zOrderPart = _curPart;
+}
+
 //---------------------------------------------------------
 //   draw
 //---------------------------------------------------------
@@ -184,23 +223,11 @@ void Canvas::draw(QPainter& p, const QRect& rect)/*{{{*/
 		// draw Canvas Items
 		//---------------------------------------------------
 
-		iCItem to(_items.lower_bound(x2));
-
-		// Draw items from other parts behind all others.
-		// Only for items with events (not Composer parts).
-		QList<CItem*> sortedByZValue;
-
 		// Draw items from other parts behind all others.
 		// Only for items with events (not Composer parts).
-		for (iCItem i = _items.begin(); i != to; ++i)
-		{
-			sortedByZValue.append(i->second);
-		}
-		PartZIndex = m_PartZIndex;
-
-		qSort(sortedByZValue.begin(), sortedByZValue.end(), Canvas::smallerZValue);
+		updateZOrder(x, x2);
 
-		foreach(CItem* ci, sortedByZValue)
+		foreach(CItem* ci, m_zOrder)
 		{
 			if (!ci->event().empty() && ci->part() != _curPart)
 			{
@@ -211,7 +238,7 @@ void Canvas::draw(QPainter& p, const QRect& rect)/*{{{*/
 				drawItem(p, ci, rect);
 			}
 		}
-		to = _moving.lower_bound(x2);
+		iCItem to = _moving.lower_bound(x2);
 		for (iCItem i = _moving.begin(); i != to; ++i)
 		{
 			drawItem(p, i->second, rect);
@@ -400,18 +427,6 @@ void Canvas::draw(QPainter& p, const QRect& rect)/*{{{*/
 			drawMoving(p, i->second, rect);
 		setPainter(p);
 	}
-	//---------------------------------------------------
-	//    draw location marker
-	//---------------------------------------------------
-
-	p.setPen(QColor(139, 225, 69));
-	if ((song->loop() || song->punchin()) && _pos[1] >= unsigned(x) && _pos[1] < unsigned(x2))
-	{
-		p.drawLine(_pos[1], y, _pos[1], y2);
-	}
-	if ((song->loop() || song->punchout()) && _pos[2] >= unsigned(x) && _pos[2] < unsigned(x2))
-		p.drawLine(_pos[2], y, _pos[2], y2);
-
 	//Draw part end start lines
 	if(_curPart && _drawPartLines)
 	{
@@ -429,6 +444,34 @@ void Canvas::draw(QPainter& p, const QRect& rect)/*{{{*/
 		if(_drawPartEndLine)
 			p.drawLine(_curPart->endTick(), y, _curPart->endTick(), y2);
 	}
+}/*}}}*/
+
+//---------------------------------------------------------
+//   drawPositionLayer
+//    location markers and play position, drawn over the
+//    cached content
+//---------------------------------------------------------
+
+void Canvas::drawPositionLayer(QPainter& p, const QRect& r)
+{
+	QRect rect(r);
+	if (virt())
+	{
+		setPainter(p);
+		rect = devToVirt(r);
+	}
+	int x = rect.x();
+	int y = rect.y();
+	int x2 = x + rect.width();
+	int y2 = y + rect.height();
+
+	p.setPen(QColor(139, 225, 69));
+	if ((song->loop() || song->punchin()) && _pos[1] >= unsigned(x) && _pos[1] < unsigned(x2))
+	{
+		p.drawLine(_pos[1], y, _pos[1], y2);
+	}
+	if ((song->loop() || song->punchout()) && _pos[2] >= unsigned(x) && _pos[2] < unsigned(x2))
+		p.drawLine(_pos[2], y, _pos[2], y2);
 
 	p.setPen(QColor(156,75,219));
 	if (_pos[3] != MAXINT)
@@ -438,12 +481,11 @@ void Canvas::draw(QPainter& p, const QRect& rect)/*{{{*/
 	}
 
 	p.setPen(QColor(0, 186, 255));
-    if (_pos[0] >= unsigned(x) && _pos[0] < unsigned(x2))
+	if (_pos[0] >= unsigned(x) && _pos[0] < unsigned(x2))
 	{
-    	p.drawLine(_pos[0], y, _pos[0], y2);
+		p.drawLine(_pos[0], y, _pos[0], y2);
 	}
-
-}/*}}}*/
+}
 
 void Canvas::drawSelectedProgram(int pos, bool set)
 {
@@ -1882,6 +1924,7 @@ void Canvas::setCurrentPart(Part* part)
 
 void Canvas::updateCItemsZValues()
 {
+	m_zOrderValid = false;
 	for (iCItem k = _items.begin(); k != _items.end(); ++k)
 	{
 		CItem* cItem = k->second;
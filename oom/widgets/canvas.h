@@ -16,6 +16,7 @@
 #include <QMouseEvent>
 #include <QKeyEvent>
 #include <QIcon>
+#include <QList>
 #include <QPixmap>
 #include <QRect>
 #include <QPainter>
@@ -99,6 +100,15 @@ protected:
 	bool _drawPartEndLine;
 	bool m_PartZIndex;
 
+	// paint order cache, see updateZOrder()
+	QList<CItem*> m_zOrder;
+	bool m_zOrderValid;
+	int m_zOrderRevision;
+	int m_zOrderX, m_zOrderX2;
+	Part* m_zOrderPart;
+
+	void updateZOrder(int x, int x2);
+
     void setCursor();
     virtual void viewKeyPressEvent(QKeyEvent* event);
     virtual void viewMousePressEvent(QMouseEvent* event);
@@ -127,6 +137,7 @@ protected:
     {
         return QRect(0, 0, 0, 0);
     }
+    virtual void drawPositionLayer(QPainter&, const QRect&);
     virtual void drawItem(QPainter&, const CItem*, const QRect&) = 0;
     virtual void drawMoving(QPainter&, const CItem*, const QRect&) = 0;
     virtual void updateSelection() = 0;
@@ -18,6 +18,9 @@ CItem::CItem()
 	_isMoving = false;
 	_part = 0;
 	_zValue = 0;
+	_list = 0;
+	_key = 0;
+	_reach = 0;
 }
 
 CItem::CItem(const QPoint&p, const QRect& r)
@@ -27,6 +30,9 @@ CItem::CItem(const QPoint&p, const QRect& r)
 	_isMoving = false;
 	_part = 0;
 	_zValue = 0;
+	_list = 0;
+	_key = 0;
+	_reach = 0;
 }
 
 CItem::CItem(const Event& e, Part* p)
@@ -34,6 +40,9 @@ CItem::CItem(const Event& e, Part* p)
 	_event = e;
 	_part = p;
 	_zValue = 0;
+	_list = 0;
+	_key = 0;
+	_reach = 0;
 	if(p)
 	{
 		_zValue = p->getZIndex();
@@ -63,6 +72,16 @@ void CItem::setPart(Part* p) {
 	}
 }
 
+//---------------------------------------------------------
+//   bboxChanged
+//---------------------------------------------------------
+
+void CItem::bboxChanged()
+{
+	if (_list)
+		_list->itemChanged(this);
+}
+
 //---------------------------------------------------------
 //   isSelected
 //---------------------------------------------------------
@@ -116,9 +135,134 @@ CItem* CItemList::find(const QPoint& pos) const/*{{{*/
 //   CItemList
 //---------------------------------------------------------
 
+CItemList::~CItemList()
+{
+	for (iCItem i = begin(); i != end(); ++i)
+	{
+		if (i->second->_list == this)
+			i->second->_list = 0;
+	}
+}
+
 void CItemList::add(CItem* item)
 {
 	std::multimap<int, CItem*, std::less<int> >::insert(std::pair<const int, CItem*> (item->bbox().x(), item));
+	if (!item->_list)
+	{
+		item->_list = this;
+		item->_key = item->bbox().x();
+		item->_reach = item->width();
+	}
+	if (_maxWidthValid && item->width() > _maxWidth)
+		_maxWidth = item->width();
+	++_revision;
+}
+
+//---------------------------------------------------------
+//   itemChanged
+//    the bbox of item changed in place, its key is stale
+//---------------------------------------------------------
+
+void CItemList::itemChanged(CItem* item)
+{
+	int reach = item->bbox().x() + item->width() - item->_key;
+	if (_maxWidthValid)
+	{
+		if (reach > _maxWidth)
+			_maxWidth = reach;
+		else if (reach < item->_reach && item->_reach >= _maxWidth)
+			_maxWidthValid = false;
+	}
+	item->_reach = reach;
+	++_revision;
+}
+
+//---------------------------------------------------------
+//   erased
+//---------------------------------------------------------
+
+void CItemList::erased(CItem* item, int key)
+{
+	if (item->bbox().x() + item->width() - key >= _maxWidth)
+		_maxWidthValid = false;
+	if (item->_list == this)
+		item->_list = 0;
+	++_revision;
+}
+
+//---------------------------------------------------------
+//   maxWidth
+//---------------------------------------------------------
+
+int CItemList::maxWidth() const
+{
+	if (!_maxWidthValid)
+	{
+		_maxWidth = 0;
+		for (std::multimap<int, CItem*, std::less<int> >::const_iterator i = begin(); i != end(); ++i)
+		{
+			int reach = i->second->bbox().x() + i->second->width() - i->first;
+			if (reach > _maxWidth)
+				_maxWidth = reach;
+		}
+		_maxWidthValid = true;
+	}
+	return _maxWidth;
+}
+
+//---------------------------------------------------------
+//   remove
+//    takes item out of the list without deleting it. key
+//    is the bbox x the item had when it was added.
+//    Returns false if it was not found.
+//---------------------------------------------------------
+
+bool CItemList::remove(CItem* item)
+{
+	return remove(item, item->bbox().x());
+}
+
+bool CItemList::remove(CItem* item, int key)
+{
+	std::pair<iCItem, iCItem> range = equal_range(key);
+	for (iCItem i = range.first; i != range.second; ++i)
+	{
+		if (i->second == item)
+		{
+			erase(i);
+			erased(item, key);
+			return true;
+		}
+	}
+	// the item was moved since it was added
+	for (iCItem i = begin(); i != end(); ++i)
+	{
+		if (i->second == item)
+		{
+			int k = i->first;
+			erase(i);
+			erased(item, k);
+			return true;
+		}
+	}
+	return false;
+}
+
+//---------------------------------------------------------
+//   clear
+//---------------------------------------------------------
+
+void CItemList::clear()
+{
+	for (iCItem i = begin(); i != end(); ++i)
+	{
+		if (i->second->_list == this)
+			i->second->_list = 0;
+	}
+	std::multimap<int, CItem*, std::less<int> >::clear();
+	_maxWidth = 0;
+	_maxWidthValid = true;
+	++_revision;
 }
 
 int CItemList::selectionCount()/*{{{*/
@@ -14,6 +14,7 @@
 
 #include "event.h"
 
+class CItemList;
 class Event;
 class Part;
 
@@ -23,11 +24,19 @@ class Part;
 //---------------------------------------------------------
 
 class CItem {
+    friend class CItemList;
+
 private:
     Event _event;
     Part* _part;
     int _zValue;
 
+    CItemList* _list; // first list holding the item, told about bbox changes
+    int _key;         // bbox x when _list added it
+    int _reach;       // bbox right edge minus _key
+
+    void bboxChanged();
+
 protected:
     bool _isMoving;
     QPoint moving;
@@ -60,10 +69,12 @@ public:
 	
     void setWidth(int l) {
         _bbox.setWidth(l);
+        bboxChanged();
     }
 
     void setHeight(int l) {
         _bbox.setHeight(l);
+        bboxChanged();
     }
 
     void setMp(const QPoint&p) {
@@ -84,6 +95,7 @@ public:
 
     void setY(int y) {
         _bbox.setY(y);
+        bboxChanged();
     }
 
     QPoint pos() const {
@@ -104,11 +116,13 @@ public:
 
     void setBBox(const QRect& r) {
         _bbox = r;
+        bboxChanged();
     }
 
     void move(const QPoint& tl) {
         _bbox.moveTopLeft(tl);
         _pos = tl;
+        bboxChanged();
     }
 
     bool contains(const QPoint& p) const {
@@ -141,13 +155,47 @@ typedef std::multimap<int, CItem*, std::less<int> >::const_reverse_iterator rciC
 //---------------------------------------------------------
 //   CItemList
 //    Canvas Item List
+//    Items are keyed by the left edge of their bbox. The
+//    farthest any item reaches right of its key (its width,
+//    unless it was resized or moved in place) bounds how
+//    far left of a viewport an item can start and still
+//    reach into it. Removing or shrinking the item with
+//    that reach makes the next maxWidth() look at all items
+//    again. Only the first list an item is added to hears
+//    about its bbox changes.
 //---------------------------------------------------------
 
 class CItemList : public std::multimap<int, CItem*, std::less<int> > {
+    mutable int _maxWidth;
+    mutable bool _maxWidthValid;
+    int _revision;
+
+    void erased(CItem*, int key);
+    void itemChanged(CItem*);
+
 public:
+    CItemList() : _maxWidth(0), _maxWidthValid(true), _revision(0) {
+    }
+    ~CItemList();
     void add(CItem*);
+    bool remove(CItem*);
+    bool remove(CItem*, int key);
+    void clear();
     CItem* find(const QPoint& pos) const;
 	int selectionCount();
+
+    // first item that may intersect x
+    iterator lowerBoundVisible(int x) {
+        return lower_bound(x - maxWidth());
+    }
+
+    int maxWidth() const;
+
+    // bumped by every add, remove and clear, and by bbox
+    // changes of the items this list heard of
+    int revision() const {
+        return _revision;
+    }
 };
 
 #endif
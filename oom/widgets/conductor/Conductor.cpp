@@ -194,6 +194,7 @@ Conductor::Conductor(QWidget* parent, Track* sel_track) : QFrame(parent)//QWidge
 	connect(_tableModel, SIGNAL(rowsRemoved(QModelIndex, int, int)), SLOT(patchSequenceRemoved(QModelIndex, int, int)));
 	connect(patchList, SIGNAL( doubleClicked(const QModelIndex&) ), this, SLOT(patchDoubleClicked(const QModelIndex&) ) );
 	connect(patchList, SIGNAL( clicked(const QModelIndex&) ), this, SLOT(patchClicked(const QModelIndex&) ) );
+	connect(patchList, SIGNAL( expanded(const QModelIndex&) ), this, SLOT(patchGroupExpanded(const QModelIndex&) ) );
 	//connect(_patchSelModel, SIGNAL(selectionChanged(QItemSelection, QItemSelection)), SLOT(patchSelectionChanged(QItemSelection, QItemSelection)));
 	//connect(chkAdvanced, SIGNAL(stateChanged(int)), SLOT(toggleAdvanced(int)));
 	connect(btnDelete, SIGNAL(clicked(bool)), SLOT(deleteSelectedPatches(bool)));
@@ -2229,6 +2230,17 @@ void Conductor::populatePatches()
         instr->populatePatchModel(_patchModel, channel, song->mtype(), track->type() == Track::DRUM);
 }
 
+void Conductor::patchGroupExpanded(const QModelIndex& index)
+{
+	if(!selected)
+		return;
+	MidiTrack* track = (MidiTrack*)selected;
+	MidiInstrument* instr = midiPorts[track->outPort()].instrument();
+	QStandardItem* dir = _patchModel->itemFromIndex(index);
+	if (instr && dir)
+		instr->populatePatchGroup(dir);
+}
+
 void Conductor::patchDoubleClicked(QModelIndex index)/*{{{*/
 {
 	if(!selected)
@@ -89,6 +89,7 @@ private slots:
     void clonePatchSequence();
     void patchDoubleClicked(QModelIndex);
     void patchClicked(QModelIndex);
+    void patchGroupExpanded(const QModelIndex&);
     void patchSelectionChanged(QItemSelection, QItemSelection);
     void editorPartChanged(Part*);
     void transposeStateChanged(bool);
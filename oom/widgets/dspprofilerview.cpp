@@ -0,0 +1,148 @@
+//=========================================================
+//  OOMidi
+//  OpenOctave Midi and Audio Editor
+//
+//  view of the audio thread time profile
+//=========================================================
+
+#include <QCheckBox>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QLabel>
+#include <QPlainTextEdit>
+#include <QPushButton>
+#include <QSplitter>
+#include <QTimer>
+#include <QTreeWidget>
+#include <QVBoxLayout>
+
+#include "dspprofilerview.h"
+#include "dspprofiler.h"
+
+static const char* kindNames[] = { "cycle", "track", "plugin", "midi", "output" };
+
+//---------------------------------------------------------
+//   DspProfilerView
+//---------------------------------------------------------
+
+DspProfilerView::DspProfilerView(QWidget* parent)
+: QWidget(parent, Qt::Window)
+{
+    setWindowTitle(tr("OOMidi: Audio Thread Profile"));
+    m_captures = -1;
+
+    QVBoxLayout* layout = new QVBoxLayout(this);
+    QHBoxLayout* bar = new QHBoxLayout;
+    m_enable = new QCheckBox(tr("Profile"), this);
+    m_enable->setChecked(dspProfiler && dspProfiler->enabled());
+    m_enable->setEnabled(dspProfiler);
+    bar->addWidget(m_enable);
+    QPushButton* reset = new QPushButton(tr("Reset"), this);
+    bar->addWidget(reset);
+    m_summary = new QLabel(this);
+    bar->addWidget(m_summary, 1);
+    layout->addLayout(bar);
+
+    QSplitter* split = new QSplitter(Qt::Vertical, this);
+    m_table = new QTreeWidget(split);
+    m_table->setRootIsDecorated(false);
+    m_table->setSortingEnabled(true);
+    QStringList columns;
+    columns << tr("Name") << tr("Kind") << tr("Calls") << tr("Total ms")
+            << tr("Avg us") << tr("Max us") << tr("p99 us");
+    m_table->setHeaderLabels(columns);
+    m_table->header()->setStretchLastSection(false);
+    m_table->sortByColumn(3, Qt::DescendingOrder);
+    m_capture = new QPlainTextEdit(split);
+    m_capture->setReadOnly(true);
+    m_capture->setLineWrapMode(QPlainTextEdit::NoWrap);
+    m_capture->setFont(QFont("monospace"));
+    layout->addWidget(split);
+
+    m_timer = new QTimer(this);
+    connect(m_timer, SIGNAL(timeout()), SLOT(update()));
+    connect(m_enable, SIGNAL(toggled(bool)), SLOT(enableToggled(bool)));
+    connect(reset, SIGNAL(clicked()), SLOT(resetClicked()));
+    resize(640, 480);
+}
+
+//---------------------------------------------------------
+//   showEvent
+//---------------------------------------------------------
+
+void DspProfilerView::showEvent(QShowEvent* ev)
+{
+    update();
+    m_timer->start(1000);
+    QWidget::showEvent(ev);
+}
+
+//---------------------------------------------------------
+//   hideEvent
+//---------------------------------------------------------
+
+void DspProfilerView::hideEvent(QHideEvent* ev)
+{
+    m_timer->stop();
+    QWidget::hideEvent(ev);
+}
+
+//---------------------------------------------------------
+//   enableToggled
+//---------------------------------------------------------
+
+void DspProfilerView::enableToggled(bool on)
+{
+    if (dspProfiler)
+        dspProfiler->setEnabled(on);
+}
+
+//---------------------------------------------------------
+//   resetClicked
+//---------------------------------------------------------
+
+void DspProfilerView::resetClicked()
+{
+    if (!dspProfiler)
+        return;
+    dspProfiler->reset();
+    m_table->clear();
+    m_capture->clear();
+    m_captures = dspProfiler->captures();
+}
+
+//---------------------------------------------------------
+//   update
+//---------------------------------------------------------
+
+void DspProfilerView::update()
+{
+    if (!dspProfiler)
+        return;
+    m_summary->setText(tr("%1 xruns").arg(dspProfiler->xruns()));
+
+    QList<DspStat> sl = dspProfiler->stats();
+    m_table->setSortingEnabled(false);
+    m_table->clear();
+    for (QList<DspStat>::const_iterator i = sl.begin(); i != sl.end(); ++i)
+    {
+        QTreeWidgetItem* item = new QTreeWidgetItem(m_table);
+        item->setText(0, i->name);
+        item->setText(1, kindNames[i->kind]);
+        item->setData(2, Qt::DisplayRole, i->count);
+        item->setData(3, Qt::DisplayRole, qRound(i->totalMs * 10.0) / 10.0);
+        item->setData(4, Qt::DisplayRole, qRound(i->avgUs * 10.0) / 10.0);
+        item->setData(5, Qt::DisplayRole, qRound(i->maxUs * 10.0) / 10.0);
+        item->setData(6, Qt::DisplayRole, qRound(i->p99Us * 10.0) / 10.0);
+        for (int col = 2; col < 7; ++col)
+            item->setTextAlignment(col, Qt::AlignRight);
+    }
+    m_table->setSortingEnabled(true);
+
+    int n = dspProfiler->captures();
+    if (n != m_captures)
+    {
+        m_captures = n;
+        m_capture->setPlainText(n ? dspProfiler->captureReport() : tr("no xrun captured yet"));
+    }
+}
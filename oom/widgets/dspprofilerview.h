@@ -0,0 +1,50 @@
+//=========================================================
+//  OOMidi
+//  OpenOctave Midi and Audio Editor
+//
+//  view of the audio thread time profile
+//=========================================================
+
+#ifndef __DSPPROFILERVIEW_H__
+#define __DSPPROFILERVIEW_H__
+
+#include <QWidget>
+
+class QCheckBox;
+class QLabel;
+class QPlainTextEdit;
+class QTimer;
+class QTreeWidget;
+
+//---------------------------------------------------------
+//   DspProfilerView
+//    top consumers of the audio cycle and the cycles
+//    around the last xrun
+//---------------------------------------------------------
+
+class DspProfilerView : public QWidget
+{
+    Q_OBJECT
+
+    QCheckBox* m_enable;
+    QLabel* m_summary;
+    QTreeWidget* m_table;
+    QPlainTextEdit* m_capture;
+    QTimer* m_timer;
+    int m_captures;
+
+private slots:
+    void enableToggled(bool);
+    void resetClicked();
+    void update();
+
+protected:
+    virtual void showEvent(QShowEvent*);
+    virtual void hideEvent(QHideEvent*);
+
+public:
+    DspProfilerView(QWidget* parent = 0);
+};
+
+#endif
+
@@ -26,6 +26,7 @@ InstrumentTree::InstrumentTree(QWidget* parent, MidiInstrument* i, bool popup) :
 	setModel(_patchModel);
 	connect(this, SIGNAL( doubleClicked(const QModelIndex&) ), this, SLOT(patchDoubleClicked(const QModelIndex&) ) );
 	connect(this, SIGNAL( clicked(const QModelIndex&) ), this, SLOT(patchClicked(const QModelIndex&) ) );
+	connect(this, SIGNAL( expanded(const QModelIndex&) ), this, SLOT(groupExpanded(const QModelIndex&) ) );
 	if(popup)
 	{
 		setWindowFlags(Qt::SplashScreen | Qt::WindowStaysOnTopHint);
@@ -133,6 +134,16 @@ void InstrumentTree::patchClicked(QModelIndex index)/*{{{*/
 	}
 }/*}}}*/
 
+//Fill the patch group folder on first expand
+void InstrumentTree::groupExpanded(const QModelIndex& index)
+{
+	if(!m_instrument)
+		return;
+	QStandardItem* dir = _patchModel->itemFromIndex(index);
+	if(dir)
+		m_instrument->populatePatchGroup(dir);
+}
+
 void InstrumentTree::focusOutEvent(QFocusEvent*)
 {
 	if(m_popup)
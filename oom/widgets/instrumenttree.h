@@ -42,6 +42,7 @@ protected:
 private slots:
 	void patchDoubleClicked(QModelIndex);
 	void patchClicked(QModelIndex);
+	void groupExpanded(const QModelIndex&);
 signals:
 	void patchSelected(int program, QString name);
 	void treeFocusLost();
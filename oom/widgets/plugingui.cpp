@@ -537,8 +537,7 @@ void PluginGui::sliderChanged(double val, int param)
 
     if (track)
     {
-        // p3.3.43
-        audio->msgSetPluginCtrlVal(track, id, val);
+        plugin->setControllerValue(param, val);
         track->recordAutomation(id, val);
     }
 }
@@ -581,8 +580,7 @@ void PluginGui::labelChanged(double val, int param)/*{{{*/
 
     if (track)
     {
-        // p3.3.43
-        audio->msgSetPluginCtrlVal(track, id, val);
+        plugin->setControllerValue(param, val);
         track->startAutoRecord(id, val);
     }
 }/*}}}*/
@@ -624,8 +622,7 @@ void PluginGui::ctrlPressed(int param)
 
         if (track)
         {
-            // p3.3.43
-            audio->msgSetPluginCtrlVal(track, id, val);
+            plugin->setControllerValue(param, val);
             track->startAutoRecord(id, val);
         }
     }
@@ -639,8 +636,7 @@ void PluginGui::ctrlPressed(int param)
 
         if (track)
         {
-            // p3.3.43
-            audio->msgSetPluginCtrlVal(track, id, val);
+            plugin->setControllerValue(param, val);
             track->startAutoRecord(id, val);
         }
     }
@@ -46,6 +46,7 @@
 #include "AutomationMenu.h"
 #include "TrackInstrumentMenu.h"
 #include "TrackEffects.h"
+#include "meterbus.h"
 
 static QString styletemplate = "QLineEdit { border-width:1px; border-radius: 0px; border-image: url(:/images/frame.png) 4; border-top-color: #1f1f22; border-bottom-color: #505050; color: #%1; background-color: #%2; font-family: fixed-width; font-weight: bold; font-size: 15px; padding-left: 15px; }";
 static QString trackHeaderStyle = "QFrame#TrackHeader { border-bottom: 1px solid #888888; border-right: 1px solid #888888; border-left: 1px solid #888888; background-color: #2e2e2e; }";
@@ -494,6 +495,9 @@ void TrackHeader::heartBeat()/*{{{*/
 		return;
 	if(song->invalid)
 		return;
+	// headers scrolled out of the track view are skipped entirely
+	if(!isVisible() || visibleRegion().isEmpty())
+		return;
 	inHeartBeat = true;
 	if(m_track->isMidiTrack())
 	{
@@ -504,11 +508,15 @@ void TrackHeader::heartBeat()/*{{{*/
 		{
 			if(m_meterVisible)
 			{
+				const MeterSnapshot* ms = meterBus->levels(in);
 				for (int ch = 0; ch < ((AudioTrack*)in)->channels(); ++ch)
 				{
 					if (!meter.isEmpty() && ch < meter.size())
 					{
-						meter.at(ch)->setVal(((AudioTrack*)in)->meter(ch), ((AudioTrack*)in)->peak(ch), false);
+						if(ms)
+							meter.at(ch)->setVal(ms->peak[ch], ms->peakHold[ch], ms->clips[ch] > 0);
+						else
+							meter.at(ch)->setVal(((AudioTrack*)in)->meter(ch), ((AudioTrack*)in)->peak(ch), false);
 					}
 				}
 			}
@@ -595,11 +603,15 @@ void TrackHeader::heartBeat()/*{{{*/
 	{
 		if(m_meterVisible)
 		{
+			const MeterSnapshot* ms = meterBus->levels(m_track);
 			for (int ch = 0; ch < ((AudioTrack*)m_track)->channels(); ++ch)
 			{
 				if (!meter.isEmpty() && ch < meter.size())
 				{
-					meter.at(ch)->setVal(((AudioTrack*)m_track)->meter(ch), ((AudioTrack*)m_track)->peak(ch), false);
+					if(ms)
+						meter.at(ch)->setVal(ms->peak[ch], ms->peakHold[ch], ms->clips[ch] > 0);
+					else
+						meter.at(ch)->setVal(((AudioTrack*)m_track)->meter(ch), ((AudioTrack*)m_track)->peak(ch), false);
 				}
 			}
 		}
@@ -16,6 +16,7 @@
 #include <QKeyEvent>
 #include <QPaintEvent>
 #include <QDebug>
+#include <QtCore/qmath.h>
 
 // Don't use this, it was just for debugging. 
 // It's much slower than oom-1 no matter how hard I tried.
@@ -48,6 +49,7 @@ View::View(QWidget* w, int xm, int ym, const char* name)
 	xorg = 0;
 	yorg = 0;
 	_virt = true;
+	_cacheContent = false;
 	setBackgroundRole(QPalette::NoRole);
 	brush.setStyle(Qt::SolidPattern);
 	brush.setColor(Qt::lightGray);
@@ -148,7 +150,10 @@ void View::setXPos(int x)
 	update();
 
 #else
-	scroll(delta, 0);
+	if (_cacheContent)
+		scrollContent(delta, 0);
+	else
+		scroll(delta, 0);
 #endif
 }
 
@@ -205,7 +210,56 @@ void View::setYPos(int y)
 	update();
 
 #else
-	scroll(0, delta);
+	if (_cacheContent)
+		scrollContent(0, delta);
+	else
+		scroll(0, delta);
+#endif
+}
+
+//---------------------------------------------------------
+//   scrollContent
+//    shifts the cached content, only the exposed area is
+//    drawn again
+//---------------------------------------------------------
+
+void View::scrollContent(int dx, int dy)
+{
+	int w = width();
+	int h = height();
+	qreal dpr = _content.devicePixelRatio();
+	// a fractional shift would resample the whole pixmap
+	if (_content.isNull() || dx >= w || dx <= -w || dy >= h || dy <= -h
+			|| dx * dpr != qRound(dx * dpr) || dy * dpr != qRound(dy * dpr))
+		_contentDirty = QRegion(rect());
+	else
+	{
+		_content.scroll(qRound(dx * dpr), qRound(dy * dpr), _content.rect());
+		_contentDirty.translate(dx, dy);
+		_contentDirty += QRegion(rect()) - QRegion(rect().translated(dx, dy));
+
+		// drawOverlay() paints at a fixed position
+		QRect olr = overlayRect();
+		_contentDirty += olr;
+		_contentDirty += olr.translated(dx, dy);
+	}
+	// the position layer has to move back
+	_layerOnly = QRegion(rect());
+	QWidget::update();
+}
+
+//---------------------------------------------------------
+//   contentRatio
+//    device pixels per logical pixel of the content cache,
+//    fractional on scaled displays
+//---------------------------------------------------------
+
+qreal View::contentRatio() const
+{
+#if QT_VERSION >= 0x050600
+	return devicePixelRatioF();
+#else
+	return devicePixelRatio();
 #endif
 }
 
@@ -250,12 +304,113 @@ void View::paintEvent(QPaintEvent* ev)
 	QPainter p(this);
 	//p.setCompositionMode(QPainter::CompositionMode_Source);
 	p.drawPixmap(ev->rect().topLeft(), pm, ev->rect());
+	paintPositionLayer(p, ev->rect());
 
 #else
-	paint(ev->rect());
+	QRect r = ev->rect();
+	if (!_cacheContent)
+	{
+		paint(r);
+		QPainter p(this);
+		paintPositionLayer(p, r);
+		return;
+	}
+
+	// Repaints not queued through updatePositionLayer() or
+	// scrollContent() may come from QWidget::update() called
+	// through a base pointer, or from Qt itself.
+	_contentDirty += ev->region() - _layerOnly;
+	_layerOnly = QRegion();
+
+	qreal dpr = contentRatio();
+	QSize ps(qCeil(width() * dpr), qCeil(height() * dpr));
+	if (_content.size() != ps || _content.devicePixelRatio() != dpr)
+	{
+		_content = QPixmap(ps);
+		_content.setDevicePixelRatio(dpr);
+		_contentDirty = QRegion(rect());
+	}
+	QRegion dirty = _contentDirty & ev->region();
+	if (!dirty.isEmpty())
+	{
+		QRect dr = dirty.boundingRect();
+		_contentDirty -= dr;
+		paint(dr);
+	}
+
+	QPainter p(this);
+	p.drawPixmap(QRectF(r), _content, QRectF(r.x() * dpr, r.y() * dpr,
+			r.width() * dpr, r.height() * dpr));
+	paintPositionLayer(p, r);
 #endif
 }
 
+//---------------------------------------------------------
+//   paintPositionLayer
+//---------------------------------------------------------
+
+void View::paintPositionLayer(QPainter& p, const QRect& r)
+{
+	p.setClipRect(r);
+	drawPositionLayer(p, r);
+}
+
+//---------------------------------------------------------
+//   invalidateContent
+//    the content changed, with a content cache it is
+//    painted again on the next paint event
+//---------------------------------------------------------
+
+void View::invalidateContent()
+{
+	if (_cacheContent)
+		_contentDirty = QRegion(rect());
+	QWidget::update();
+}
+
+void View::invalidateContent(const QRect& r)
+{
+	if (_cacheContent)
+		_contentDirty += r;
+	QWidget::update(r);
+}
+
+void View::invalidateContent(const QRegion& r)
+{
+	if (_cacheContent)
+		_contentDirty += r;
+	QWidget::update(r);
+}
+
+//---------------------------------------------------------
+//   updatePositionLayer
+//    only the position layer changed in r
+//---------------------------------------------------------
+
+void View::updatePositionLayer(const QRect& r)
+{
+	if (_cacheContent)
+		_layerOnly += r;
+	QWidget::update(r);
+}
+
+//---------------------------------------------------------
+//   setContentCache
+//    Keep the content in a pixmap between paint events.
+//    Content changes should go through invalidateContent()
+//    or redraw(), other repaints outside the position layer
+//    paint the content again as well.
+//---------------------------------------------------------
+
+void View::setContentCache(bool flag)
+{
+	_cacheContent = flag;
+	_content = QPixmap();
+	_contentDirty = QRegion();
+	_layerOnly = QRegion();
+	QWidget::update();
+}
+
 //---------------------------------------------------------
 //   redraw
 //---------------------------------------------------------
@@ -270,7 +425,7 @@ void View::redraw()
 	paint(r);
 #endif
 
-	update();
+	invalidateContent();
 }
 
 //---------------------------------------------------------
@@ -285,7 +440,7 @@ void View::redraw(const QRect& r)
 	paint(r);
 #endif
 
-	update(r);
+	invalidateContent(r);
 }
 
 //---------------------------------------------------------
@@ -313,7 +468,11 @@ void View::paint(const QRect& r)
 
 	QPainter p(&pm);
 #else
-	QPainter p(this);
+	QPainter p;
+	if (_cacheContent)
+		p.begin(&_content);
+	else
+		p.begin(this);
 #endif
 
 	p.setRenderHints(QPainter::Antialiasing | QPainter::SmoothPixmapTransform | QPainter::HighQualityAntialiasing, false);
@@ -435,50 +594,61 @@ void View::pdraw(QPainter& p, const QRect& r)
 	if (virt())
 	{
 		setPainter(p);
-		int x = r.x();
-		int y = r.y();
-		int w = r.width();
-		int h = r.height();
-		if (xmag <= 0)
-		{
-			x -= 1;
-			w += 2;
-			x = (x + xpos + rmapx(xorg)) * (-xmag);
-			w = w * (-xmag);
-		}
-		else
-		{
-			x = (x + xpos + rmapx(xorg)) / xmag;
-			w = (w + xmag - 1) / xmag;
-			x -= 1;
-			w += 2;
-		}
-		if (ymag <= 0)
-		{
-			y -= 1;
-			h += 2;
-			y = (y + ypos + rmapy(yorg)) * (-ymag);
-			h = h * (-ymag);
-		}
-		else
-		{
-			y = (y + ypos + rmapy(yorg)) / ymag;
-			h = (h + ymag - 1) / ymag;
-			y -= 1;
-			h += 2;
-		}
-
-		if (x < 0)
-			x = 0;
-		if (y < 0)
-			y = 0;
-
-		draw(p, QRect(x, y, w, h));
+		draw(p, devToVirt(r));
 	}
 	else
 		draw(p, r);
 }
 
+//---------------------------------------------------------
+//   devToVirt
+//    phys rectangle to the virtual one draw() gets, with a
+//    small margin
+//---------------------------------------------------------
+
+QRect View::devToVirt(const QRect& r) const
+{
+	int x = r.x();
+	int y = r.y();
+	int w = r.width();
+	int h = r.height();
+	if (xmag <= 0)
+	{
+		x -= 1;
+		w += 2;
+		x = (x + xpos + rmapx(xorg)) * (-xmag);
+		w = w * (-xmag);
+	}
+	else
+	{
+		x = (x + xpos + rmapx(xorg)) / xmag;
+		w = (w + xmag - 1) / xmag;
+		x -= 1;
+		w += 2;
+	}
+	if (ymag <= 0)
+	{
+		y -= 1;
+		h += 2;
+		y = (y + ypos + rmapy(yorg)) * (-ymag);
+		h = h * (-ymag);
+	}
+	else
+	{
+		y = (y + ypos + rmapy(yorg)) / ymag;
+		h = (h + ymag - 1) / ymag;
+		y -= 1;
+		h += 2;
+	}
+
+	if (x < 0)
+		x = 0;
+	if (y < 0)
+		y = 0;
+
+	return QRect(x, y, w, h);
+}
+
 //---------------------------------------------------------
 //   setPainter
 //---------------------------------------------------------
@@ -632,44 +802,3 @@ int View::rmapyDev(int y) const
 	else
 		return (y + ymag / 2) / ymag;
 }
-
-/*
-QRect View::devToVirt(const QRect& r)
-{
-	int x = r.x();
-	int y = r.y();
-	int w = r.width();
-	int h = r.height();
-	if (xmag <= 0) {
-		  x -= 1;
-		  w += 2;
-		  x = (x + xpos + rmapx(xorg)) * (-xmag);
-		  w = w * (-xmag);
-		  }
-	else {
-		  x = (x + xpos + rmapx(xorg)) / xmag;
-		  w = (w + xmag - 1) / xmag;
-		  x -= 1;
-		  w += 2;
-		  }
-	if (ymag <= 0) {
-		  y -= 1;
-		  h += 2;
-		  y = (y + ypos + rmapy(yorg)) * (-ymag);
-		  h = h * (-ymag);
-		  }
-	else {
-		  y = (y + ypos + rmapy(yorg)) / ymag;
-		  h = (h + ymag - 1) / ymag;
-		  y -= 1;
-		  h += 2;
-		  }
-
-	if (x < 0)
-		  x = 0;
-	if (y < 0)
-		  y = 0;
-    
-	return QRect(x, y, w, h);
-}
- */
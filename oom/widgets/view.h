@@ -8,6 +8,8 @@
 #ifndef __VIEW_H__
 #define __VIEW_H__
 
+#include <QPixmap>
+#include <QRegion>
 #include <QWidget>
 
 class QDropEvent;
@@ -32,6 +34,15 @@ class View : public QWidget
     QBrush brush;
     bool _virt;
 
+    QPixmap _content;       // cached content, without the position layer
+    QRegion _contentDirty;  // parts of _content to be painted again
+    QRegion _layerOnly;     // pending updates that leave _content valid
+    bool _cacheContent;
+
+    qreal contentRatio() const;
+    void scrollContent(int dx, int dy);
+    void paintPositionLayer(QPainter&, const QRect&);
+
 protected:
     int xorg;
     int yorg;
@@ -59,6 +70,19 @@ protected:
         return QRect(0, 0, 0, 0);
     }
 
+    //  The position layer (play position, loop markers,
+    //  recording previews) is drawn on top of the content
+    //  on every paint event. p is untransformed, r in phys
+    //  coords. Moving something on this layer only needs
+    //  updatePositionLayer(), which leaves a cached content
+    //  untouched. Any other repaint is taken as a content
+    //  change.
+    virtual void drawPositionLayer(QPainter&, const QRect&)
+    {
+    }
+    void updatePositionLayer(const QRect&);
+    void setContentCache(bool);
+
     virtual void pdraw(QPainter&, const QRect&);
 
     virtual void paintEvent(QPaintEvent* ev);
@@ -94,7 +118,7 @@ protected:
     int mapxDev(int x) const;
     int rmapy(int y) const;
     int rmapyDev(int y) const;
-    //QRect devToVirt(const QRect&);
+    QRect devToVirt(const QRect&) const;
 
     void setPainter(QPainter& p);
 
@@ -104,6 +128,9 @@ public slots:
     void setXMag(float xs);
     void setYMag(float ys);
     void redraw();
+    void invalidateContent();
+    void invalidateContent(const QRect&);
+    void invalidateContent(const QRegion&);
 
 public:
     View(QWidget*, int, int, const char* name = 0);
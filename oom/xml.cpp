@@ -8,6 +8,14 @@
 
 #include <stdio.h>
 #include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <float.h>
+#include <locale.h>
+#include <cmath>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include <QString>
 #include <QColor>
@@ -24,6 +32,16 @@
 //    - may not handle misformed XML (eg. when manually
 //      editing OOMidi output)
 
+//---------------------------------------------------------
+//   XmlBuffer
+//---------------------------------------------------------
+
+XmlBuffer::~XmlBuffer()
+{
+	if (map)
+		munmap(map, mapLen);
+}
+
 //---------------------------------------------------------
 //   Xml
 //---------------------------------------------------------
@@ -36,8 +54,11 @@ Xml::Xml(FILE* _f)
 	level = 0;
 	inTag = false;
 	inComment = false;
-	lbuffer[0] = 0;
-	bufptr = lbuffer;
+	bufptr = 0;
+	_end = 0;
+	_textB = 0;
+	_textE = 0;
+	_rawText = false;
 	_minorVersion = -1;
 	_majorVersion = -1;
 }
@@ -50,7 +71,13 @@ Xml::Xml(const char* buf)
 	level = 0;
 	inTag = false;
 	inComment = false;
+	_buffer = new XmlBuffer;
+	_buffer->data = QByteArray::fromRawData(buf, strlen(buf));
 	bufptr = buf;
+	_end = buf + _buffer->data.size();
+	_textB = 0;
+	_textE = 0;
+	_rawText = false;
 	_minorVersion = -1;
 	_majorVersion = -1;
 }
@@ -81,12 +108,15 @@ QString Xml::xmlString(const QString& ss)
 
 //---------------------------------------------------------
 //   parse
+//    Tokens are taken from the document in place. Tag and
+//    attribute names are shared per document, text and
+//    values are converted once from the document bytes.
 //---------------------------------------------------------
 
 Xml::Token Xml::parse()
 {
-	char buffer[1024 * 1024]; // increase buffer -rj
-	char* p;
+	const char* b;
+	const char* e;
 
 again:
 	bool endFlag = false;
@@ -107,7 +137,7 @@ again:
 		if (c == '/')
 		{
 			nextc();
-			token('>');
+			token('>', b, e);
 			if (c != '>')
 			{
 				printf("Xml: unexpected char '%c', expected '>'\n", c);
@@ -119,18 +149,20 @@ again:
 			return TagEnd;
 		}
 		_s2 = QString("");
-		token('=');
-		_s1 = _s2;
+		token('=', b, e);
+		_s1 = name(b, e);
 		nextc(); // skip space
 		if (c == '"')
 			stoken();
 		else
-			token('>');
+		{
+			token('>', b, e);
+			_s2 = QString::fromUtf8(b, e - b);
+		}
 		if (c == '>')
 			inTag = false;
 		else
 			--bufptr;
-		_s2 = strip(_s2);
 		return Attribut;
 	}
 	if (c == '<')
@@ -147,17 +179,14 @@ again:
 		if (c == '?')
 		{
 			next();
-			p = buffer;
+			b = cur();
 			for (;;)
 			{
 				if (c == '?' || c == EOF || c == '>')
 					break;
-				*p++ = c;
-				// TODO: check overflow
 				next();
 			}
-			*p = 0;
-			_s1 = QString(buffer);
+			_s1 = QString::fromUtf8(b, cur() - b);
 			if (c == EOF)
 			{
 				fprintf(stderr, "XML: unexpected EOF\n");
@@ -189,17 +218,14 @@ again:
 			}
 			goto again;
 		}
-		p = buffer;
+		b = cur();
 		for (;;)
 		{
 			if (c == '/' || c == ' ' || c == '\t' || c == '>' || c == '\n' || c == EOF)
 				break;
-			// TODO: check overflow
-			*p++ = c;
 			next();
 		}
-		*p = 0;
-		_s1 = QString(buffer);
+		_s1 = name(b, cur());
 		// skip white space:
 		while (c == ' ' || c == '\t' || c == '\n')
 			next();
@@ -256,7 +282,36 @@ again:
 			fprintf(stderr, "XML: level = 0\n");
 			goto error;
 		}
-		p = buffer;
+		text();
+
+		if (c == '<')
+			--bufptr;
+		return Text;
+	}
+error:
+	fprintf(stderr, "XML Parse Error at line %d col %d\n", _line, _col + 1);
+	return Error;
+}
+
+//---------------------------------------------------------
+//   text
+//    read text up to the next tag. Only text with entities
+//    is copied.
+//---------------------------------------------------------
+
+void Xml::text()
+{
+	const char* b = cur();
+	while (c != EOF && c != '<' && c != '&')
+		next();
+	if (c != '&')
+	{
+		_textB = b;
+		_textE = cur();
+	}
+	else
+	{
+		_textBuf = QByteArray(b, cur() - b);
 		for (;;)
 		{
 			if (c == EOF || c == '<')
@@ -266,13 +321,13 @@ again:
 				next();
 				if (c == '<')
 				{ // be tolerant with old oom files
-					*p++ = '&';
+					_textBuf.append('&');
 					continue;
 				}
-				char name[32];
-				char* dp = name;
+				char ename[32];
+				char* dp = ename;
 				*dp++ = c;
-				for (; dp - name < 31;)
+				for (; dp - ename < 31;)
 				{
 					next();
 					if (c == ';')
@@ -280,32 +335,45 @@ again:
 					*dp++ = c;
 				}
 				*dp = 0;
-				if (strcmp(name, "lt") == 0)
+				if (strcmp(ename, "lt") == 0)
 					c = '<';
-				else if (strcmp(name, "gt") == 0)
+				else if (strcmp(ename, "gt") == 0)
 					c = '>';
-				else if (strcmp(name, "apos") == 0)
+				else if (strcmp(ename, "apos") == 0)
 					c = '\\';
-				else if (strcmp(name, "quot") == 0)
+				else if (strcmp(ename, "quot") == 0)
 					c = '"';
-				else if (strcmp(name, "amp") == 0)
+				else if (strcmp(ename, "amp") == 0)
 					c = '&';
 				else
 					c = '?';
 			}
-			*p++ = c;
+			_textBuf.append(char(c));
 			next();
 		}
-		*p = 0;
-		_s1 = QString(buffer);
-
-		if (c == '<')
-			--bufptr;
-		return Text;
+		_textB = _textBuf.constData();
+		_textE = _textB + _textBuf.size();
 	}
-error:
-	fprintf(stderr, "XML Parse Error at line %d col %d\n", _line, _col + 1);
-	return Error;
+	if (!_rawText)
+		_s1 = QString::fromUtf8(_textB, _textE - _textB);
+}
+
+//---------------------------------------------------------
+//   name
+//    tag and attribute names repeat, keep one QString per
+//    name and document
+//---------------------------------------------------------
+
+QString Xml::name(const char* b, const char* e)
+{
+	QByteArray key(QByteArray::fromRawData(b, e - b));
+	QHash<QByteArray, QString>::const_iterator i = _buffer->names.constFind(key);
+	if (i != _buffer->names.constEnd())
+		return *i;
+	QByteArray n(b, e - b);
+	QString s(QString::fromUtf8(n));
+	_buffer->names.insert(n, s);
+	return s;
 }
 
 //---------------------------------------------------------
@@ -349,21 +417,160 @@ QString Xml::parse1()
 }
 
 //---------------------------------------------------------
-//   parseInt
+//   parseText
+//    like parse1(), but leaves the value as raw bytes
 //---------------------------------------------------------
 
-int Xml::parseInt()
+void Xml::parseText(const char*& b, const char*& e)
 {
-	QString s(parse1().simplified());
-	bool ok;
-	int base = 10;
-	if (s.startsWith("0x") || s.startsWith("0X"))
+	QString tag(_s1.simplified());
+	b = 0;
+	e = 0;
+	_rawText = true;
+	for (;;)
 	{
-		base = 16;
-		s = s.mid(2);
+		Token t = parse();
+		if (t == Error || t == End)
+			break;
+		if (t == Text)
+		{
+			b = _textB;
+			e = _textE;
+		}
+		else if (t == TagEnd && _s1 == tag)
+			break;
 	}
-	int n = s.toInt(&ok, base);
-	return n;
+	_rawText = false;
+}
+
+//---------------------------------------------------------
+//   skipSpace
+//    trim a value the way QString::simplified() would
+//---------------------------------------------------------
+
+static inline bool isSpace(char c)
+{
+	return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f';
+}
+
+static void skipSpace(const char*& b, const char*& e)
+{
+	while (b < e && isSpace(*b))
+		++b;
+	while (e > b && isSpace(e[-1]))
+		--e;
+}
+
+//---------------------------------------------------------
+//   toLongLong
+//    number in [b, e) with QString::toLongLong() rules,
+//    0 if it is not one
+//---------------------------------------------------------
+
+qint64 Xml::toLongLong(const char* b, const char* e, bool* ok, int base)
+{
+	if (ok)
+		*ok = false;
+	skipSpace(b, e);
+	bool neg = false;
+	if (b < e && (*b == '-' || *b == '+'))
+		neg = *b++ == '-';
+	if (b == e)
+		return 0;
+	quint64 val = 0;
+	const quint64 limit = neg ? quint64(1) << 63 : (quint64(1) << 63) - 1;
+	for (; b < e; ++b)
+	{
+		int d;
+		if (*b >= '0' && *b <= '9')
+			d = *b - '0';
+		else if (*b >= 'a' && *b <= 'z')
+			d = *b - 'a' + 10;
+		else if (*b >= 'A' && *b <= 'Z')
+			d = *b - 'A' + 10;
+		else
+			return 0;
+		if (d >= base || val > (limit - d) / base)
+			return 0;
+		val = val * base + d;
+	}
+	if (ok)
+		*ok = true;
+	return neg ? -qint64(val) : qint64(val);
+}
+
+//---------------------------------------------------------
+//   toInt
+//---------------------------------------------------------
+
+int Xml::toInt(const char* b, const char* e, bool* ok, int base)
+{
+	bool lok;
+	qint64 v = toLongLong(b, e, &lok, base);
+	if (lok && (v < INT_MIN || v > INT_MAX))
+	{
+		lok = false;
+		v = 0;
+	}
+	if (ok)
+		*ok = lok;
+	return int(v);
+}
+
+//---------------------------------------------------------
+//   toDouble
+//    always in the C locale, like QString::toDouble()
+//---------------------------------------------------------
+
+double Xml::toDouble(const char* b, const char* e, bool* ok)
+{
+	static locale_t cLocale = newlocale(LC_ALL_MASK, "C", (locale_t) 0);
+
+	if (ok)
+		*ok = false;
+	skipSpace(b, e);
+	char buffer[64];
+	int len = e - b;
+	if (len == 0 || len >= int(sizeof(buffer)))
+		return 0.0;
+	memcpy(buffer, b, len);
+	buffer[len] = 0;
+	char* ep;
+	double val = strtod_l(buffer, &ep, cLocale);
+	if (ep != buffer + len)
+		return 0.0;
+	if (ok)
+		*ok = true;
+	return val;
+}
+
+//---------------------------------------------------------
+//   hexBase
+//    values written as 0x.. are read in base 16
+//---------------------------------------------------------
+
+static int hexBase(const char*& b, const char*& e)
+{
+	skipSpace(b, e);
+	if (e - b > 2 && b[0] == '0' && (b[1] == 'x' || b[1] == 'X'))
+	{
+		b += 2;
+		return 16;
+	}
+	return 10;
+}
+
+//---------------------------------------------------------
+//   parseInt
+//---------------------------------------------------------
+
+int Xml::parseInt()
+{
+	const char* b;
+	const char* e;
+	parseText(b, e);
+	int base = hexBase(b, e);
+	return toInt(b, e, 0, base);
 }
 
 //---------------------------------------------------------
@@ -373,16 +580,18 @@ int Xml::parseInt()
 
 unsigned int Xml::parseUInt()
 {
-	QString s(parse1().simplified());
+	const char* b;
+	const char* e;
+	parseText(b, e);
+	int base = hexBase(b, e);
+	skipSpace(b, e);
+	if (b < e && *b == '-')
+		return 0;
 	bool ok;
-	int base = 10;
-	if (s.startsWith("0x") || s.startsWith("0X"))
-	{
-		base = 16;
-		s = s.mid(2);
-	}
-	unsigned int n = s.toUInt(&ok, base);
-	return n;
+	qint64 v = toLongLong(b, e, &ok, base);
+	if (!ok || v > UINT_MAX)
+		return 0;
+	return (unsigned int) v;
 }
 
 //---------------------------------------------------------
@@ -391,8 +600,13 @@ unsigned int Xml::parseUInt()
 
 float Xml::parseFloat()
 {
-	QString s(parse1().simplified());
-	return s.toFloat();
+	const char* b;
+	const char* e;
+	parseText(b, e);
+	double d = toDouble(b, e);
+	if (!std::isinf(d) && qAbs(d) > FLT_MAX)
+		return 0.0;
+	return float(d);
 }
 
 //---------------------------------------------------------
@@ -401,8 +615,10 @@ float Xml::parseFloat()
 
 double Xml::parseDouble()
 {
-	QString s(parse1().simplified());
-	return s.toDouble();
+	const char* b;
+	const char* e;
+	parseText(b, e);
+	return toDouble(b, e);
 }
 
 //---------------------------------------------------------
@@ -411,8 +627,10 @@ double Xml::parseDouble()
 
 qint64 Xml::parseLongLong()
 {
-	QString s(parse1().simplified());
-	return s.toLongLong();
+	const char* b;
+	const char* e;
+	parseText(b, e);
+	return toLongLong(b, e);
 }
 
 //---------------------------------------------------------
@@ -649,28 +867,63 @@ void Xml::dump(QString &dump)
 {
     if (f == 0)
         return;
+    char buffer[512];
     fpos_t pos;
     fgetpos(f, &pos);
     rewind(f);
-    while (fgets(lbuffer, 512, f) != 0)
-        dump.append(lbuffer);
+    while (fgets(buffer, 512, f) != 0)
+        dump.append(buffer);
     fsetpos(f, &pos);
 }
 
 //---------------------------------------------------------
-//   next
+//   load
+//    Read the rest of the file in one go. Regular files
+//    are mapped, anything else (compressed files come
+//    through a pipe) is copied into memory.
+//    returns false if there is nothing (more) to read
 //---------------------------------------------------------
 
-void Xml::next()
+bool Xml::load()
 {
-    if (*bufptr == 0)
+    if (f == 0 || _buffer)
+        return false;
+    _buffer = new XmlBuffer;
+
+    struct stat st;
+    long offset = ftell(f);
+    if (offset >= 0 && fstat(fileno(f), &st) == 0 && S_ISREG(st.st_mode) && st.st_size > offset)
     {
-        if (f == 0 || fgets(lbuffer, 512, f) == 0)
+        void* m = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fileno(f), 0);
+        if (m != MAP_FAILED)
         {
-            c = EOF;
-            return;
+            _buffer->map = m;
+            _buffer->mapLen = st.st_size;
+            _buffer->data = QByteArray::fromRawData((const char*) m + offset, st.st_size - offset);
         }
-        bufptr = lbuffer;
+    }
+    if (_buffer->map == 0)
+    {
+        char tmp[65536];
+        size_t n;
+        while ((n = fread(tmp, 1, sizeof(tmp), f)) > 0)
+            _buffer->data.append(tmp, n);
+    }
+    bufptr = _buffer->data.constData();
+    _end = bufptr + _buffer->data.size();
+    return bufptr != _end;
+}
+
+//---------------------------------------------------------
+//   next
+//---------------------------------------------------------
+
+void Xml::next()
+{
+    if (bufptr == _end && !load())
+    {
+        c = EOF;
+        return;
     }
     c = *bufptr++;
     if (c == '\n')
@@ -695,41 +948,43 @@ void Xml::nextc()
 
 //---------------------------------------------------------
 //   token
-//    read token into _s2
+//    find the end of a token, [b, e) is left in the
+//    document
 //---------------------------------------------------------
 
-void Xml::token(int cc)
+void Xml::token(int cc, const char*& b, const char*& e)
 {
-    char buffer[512];
-    int i = 0;
-    for (; i < 511;)
-    {
-        if (c == ' ' || c == '\t' || c == cc || c == '\n' || c == EOF)
-            break;
-        buffer[i++] = c;
+    b = cur();
+    while (!(c == ' ' || c == '\t' || c == cc || c == '\n' || c == EOF))
         next();
-    }
-    buffer[i] = 0;
-    _s2 = buffer; // deep copy !?
+    e = cur();
 }
 
 //---------------------------------------------------------
 //   stoken
-//    read string token into _s2
+//    read quoted string token into _s2, without the quotes
 //---------------------------------------------------------
 
 void Xml::stoken()
 {
-    char buffer[1024 * 4];
-    int i = 0;
-    buffer[i] = c;
-    ++i;
     next();
-    for (; i < 1024 * 4 - 1;)
+    const char* b = cur();
+    while (c != '"' && c != '&' && c != EOF)
+        next();
+    if (c != '&')
+    {
+        _s2 = QString::fromUtf8(b, cur() - b);
+        if (c == '"')
+            next();
+        return;
+    }
+
+    // entities, copy
+    QByteArray buffer(b, cur() - b);
+    for (;;)
     {
         if (c == '"')
         {
-            buffer[i++] = c;
             next();
             break;
         }
@@ -765,35 +1020,19 @@ void Xml::stoken()
             if (c == EOF || k == 6)
             {
                 // dump entity
-                int n = 0;
-                buffer[i++] = '&';
-                for (; (i < 511) && (n < k); ++i, ++n)
-                    buffer[i] = entity[n];
+                buffer.append('&');
+                buffer.append(entity, k);
             }
             else
-                buffer[i++] = c;
+                buffer.append(char(c));
         }
         else if (c != EOF)
-            buffer[i++] = c;
+            buffer.append(char(c));
         if (c == EOF)
             break;
         next();
     }
-    buffer[i] = 0;
-    _s2 = buffer;
-}
-
-//---------------------------------------------------------
-//   strip
-//    strip `"` from string
-//---------------------------------------------------------
-
-QString Xml::strip(const QString& s)
-{
-    int l = s.length();
-    if (l >= 2 && s[0] == '"')
-        return s.mid(1, l - 2);
-    return s;
+    _s2 = QString::fromUtf8(buffer);
 }
 
 void Xml::putLevel(int n)
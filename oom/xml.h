@@ -11,12 +11,37 @@
 
 #include <stdio.h>
 
+#include <QByteArray>
+#include <QHash>
+#include <QSharedData>
 #include <QString>
 
 class QColor;
 class QRect;
 class QWidget;
 
+//---------------------------------------------------------
+//   XmlBuffer
+//    the document being read: the mapped file, a copy of
+//    what came through a pipe or the caller's string.
+//    Shared by copies of an Xml.
+//---------------------------------------------------------
+
+struct XmlBuffer : public QSharedData
+{
+    QByteArray data;
+    void* map;
+    size_t mapLen;
+    QHash<QByteArray, QString> names; // tag and attribute names
+
+    XmlBuffer()
+    {
+        map = 0;
+        mapLen = 0;
+    }
+    ~XmlBuffer();
+};
+
 //---------------------------------------------------------
 //   Xml
 //    very simple XML-like parser
@@ -75,6 +100,22 @@ public:
         return _s2;
     }
 
+    // raw bytes of the last Text token, valid until the
+    // next parse()
+    const char* textBegin() const
+    {
+        return _textB;
+    }
+
+    const char* textEnd() const
+    {
+        return _textE;
+    }
+
+    static int toInt(const char* b, const char* e, bool* ok = 0, int base = 10);
+    static qint64 toLongLong(const char* b, const char* e, bool* ok = 0, int base = 10);
+    static double toDouble(const char* b, const char* e, bool* ok = 0);
+
     Token parse();
     QString parse(const QString&);
     QString parse1();
@@ -107,14 +148,23 @@ public:
     void dump(QString &dump);
 
 private:
+    bool load();
     void next();
     void nextc();
-    void token(int);
+    void token(int, const char*&, const char*&);
     void stoken();
-    QString strip(const QString& s);
+    void text();
+    void parseText(const char*&, const char*&);
+    QString name(const char*, const char*);
+
+    const char* cur() const
+    {
+        return c == EOF ? bufptr : bufptr - 1;
+    }
     void putLevel(int n);
 
     FILE* f;
+    QExplicitlySharedDataPointer<XmlBuffer> _buffer;
     int _line;
     int _col;
     QString _s1, _s2, _tag;
@@ -125,8 +175,13 @@ private:
     int _majorVersion;
 
     int c; // current char
-    char lbuffer[512];
     const char* bufptr;
+    const char* _end;
+
+    const char* _textB;
+    const char* _textE;
+    QByteArray _textBuf; // text with entities, decoded
+    bool _rawText;       // only parsing a number, skip _s1
 };
 
 extern QRect readGeometry(Xml&, const QString&);
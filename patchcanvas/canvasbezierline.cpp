@@ -3,6 +3,7 @@
 #include "canvasportglow.h"
 
 #include <QPainter>
+#include <QStyleOptionGraphicsItem>
 
 START_NAMESPACE_PATCHCANVAS
 
@@ -21,6 +22,7 @@ CanvasBezierLine::CanvasBezierLine(CanvasPort* item1_, CanvasPort* item2_, QGrap
 
     locked = false;
     line_selected = false;
+    path_cached = false;
 
     setBrush(QColor(0,0,0,0));
     setGraphicsEffect(0);
@@ -78,6 +80,16 @@ void CanvasBezierLine::updateLinePos()
         int item2_mid_x = abs(item1_x-item2_x)/2;
         int item2_new_x = item2_x-item2_mid_x;
 
+        // every layout of either box gets here, mostly without anything moved
+        QPointF pos1(item1_x, item1_y);
+        QPointF pos2(item2_x, item2_y);
+        if (path_cached && pos1 == last_pos1 && pos2 == last_pos2)
+            return;
+
+        path_cached = true;
+        last_pos1 = pos1;
+        last_pos2 = pos2;
+
         QPainterPath path(QPointF(item1_x, item1_y));
         path.cubicTo(item1_new_x, item1_y, item2_new_x, item2_y, item2_x, item2_y);
         setPath(path);
@@ -136,6 +148,20 @@ int CanvasBezierLine::type() const
 
 void CanvasBezierLine::paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget)
 {
+    qreal lod = option->levelOfDetailFromTransform(painter->worldTransform());
+    if (lod < CanvasLodSimple)
+    {
+        // zoomed out a thin aliased line looks the same, very far out a straight one does
+        painter->setRenderHint(QPainter::Antialiasing, false);
+        painter->setPen(QPen(pen().brush(), 0));
+        painter->setBrush(Qt::NoBrush);
+        if (lod >= CanvasLodMinimal)
+            painter->drawPath(path());
+        else if (path_cached)
+            painter->drawLine(last_pos1, last_pos2);
+        return;
+    }
+
     painter->setRenderHint(QPainter::Antialiasing, bool(options.antialiasing));
     QGraphicsPathItem::paint(painter, option, widget);
 }
@@ -36,6 +36,11 @@ private:
     bool locked;
     bool line_selected;
 
+    // end points the path was built for
+    bool path_cached;
+    QPointF last_pos1;
+    QPointF last_pos2;
+
     void paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget);
 };
 
@@ -12,6 +12,7 @@
 #include <QGraphicsSceneContextMenuEvent>
 #include <QGraphicsSceneMouseEvent>
 #include <QPainter>
+#include <QStyleOptionGraphicsItem>
 #include <QTimer>
 
 START_NAMESPACE_PATCHCANVAS
@@ -32,6 +33,7 @@ CanvasBox::CanvasBox(int group_id_, QString group_name_, Icon icon, QGraphicsIte
     box_width  = 50;
     box_height = 25;
     port_list_ids.clear();
+    port_widgets.clear();
     connection_lines.clear();
 
     last_pos = QPointF();
@@ -69,6 +71,7 @@ CanvasBox::CanvasBox(int group_id_, QString group_name_, Icon icon, QGraphicsIte
 
 CanvasBox::~CanvasBox()
 {
+    canvas.updated_boxes.remove(this);
     if (shadow)
         delete shadow;
     delete icon_svg;
@@ -133,15 +136,8 @@ CanvasPort* CanvasBox::addPortFromGroup(int port_id, QString port_name, PortMode
 
     CanvasPort* new_widget = new CanvasPort(port_id, port_name, port_mode, port_type, this);
 
-    port_dict_t port_dict;
-    port_dict.group_id  = group_id;
-    port_dict.port_id   = port_id;
-    port_dict.port_name = port_name;
-    port_dict.port_mode = port_mode;
-    port_dict.port_type = port_type;
-    port_dict.widget    = new_widget;
-
     port_list_ids.append(port_id);
+    port_widgets.append(new_widget);
 
     return new_widget;
 }
@@ -153,6 +149,7 @@ void CanvasBox::removePortFromGroup(int port_id)
         if (port_list_ids[i] == port_id)
         {
             port_list_ids.takeAt(i);
+            port_widgets.takeAt(i);
             break;
         }
     }
@@ -164,7 +161,7 @@ void CanvasBox::removePortFromGroup(int port_id)
     }
 
     if (port_list_ids.count() > 0)
-        updatePositions();
+        CanvasQueueBoxUpdate(this);
 
     else if (isVisible())
     {
@@ -243,14 +240,22 @@ void CanvasBox::updatePositions()
     if (app_name_size > box_width)
         box_width = app_name_size;
 
-    // Get Port List
+    // Get Port List, from the box's own ports instead of searching all of them
     QList<port_dict_t> port_list;
-    for (int i=0; i < canvas.port_list.count(); i++)
+    for (int i=0; i < port_widgets.count(); i++)
     {
-        if (port_list_ids.contains(canvas.port_list[i].port_id))
-            port_list.append(canvas.port_list[i]);
+        port_dict_t port_dict;
+        port_dict.group_id  = group_id;
+        port_dict.port_id   = port_list_ids[i];
+        port_dict.port_name = port_widgets[i]->getPortName();
+        port_dict.port_mode = port_widgets[i]->getPortMode();
+        port_dict.port_type = port_widgets[i]->getPortType();
+        port_dict.widget    = port_widgets[i];
+        port_list.append(port_dict);
     }
 
+    QFontMetrics port_metrics(font_port);
+
     // Get Max Box Width/Height
     for (int i=0; i < port_list.count(); i++)
     {
@@ -258,7 +263,7 @@ void CanvasBox::updatePositions()
         {
             max_in_height += 18;
 
-            int size = QFontMetrics(font_port).width(port_list[i].port_name);
+            int size = port_metrics.width(port_list[i].port_name);
             if (size > max_in_width)
                 max_in_width = size;
 
@@ -287,7 +292,7 @@ void CanvasBox::updatePositions()
         {
             max_out_height += 18;
 
-            int size = QFontMetrics(font_port).width(port_list[i].port_name);
+            int size = port_metrics.width(port_list[i].port_name);
             if (size > max_out_width)
                 max_out_width = size;
 
@@ -648,22 +653,35 @@ void CanvasBox::paint(QPainter* painter, const QStyleOptionGraphicsItem* option,
     else
         painter->setPen(canvas.theme->box_pen);
 
-    QLinearGradient box_gradient(0, 0, 0, box_height);
-    box_gradient.setColorAt(0, canvas.theme->box_bg_1);
-    box_gradient.setColorAt(1, canvas.theme->box_bg_2);
+    // zoomed out the gradient and name can not be made out anyway
+    qreal lod = option->levelOfDetailFromTransform(painter->worldTransform());
+
+    if (lod < CanvasLodSimple)
+    {
+        painter->setBrush(canvas.theme->box_bg_1);
+        painter->drawRect(0, 0, box_width, box_height);
+    }
+    else
+    {
+        QLinearGradient box_gradient(0, 0, 0, box_height);
+        box_gradient.setColorAt(0, canvas.theme->box_bg_1);
+        box_gradient.setColorAt(1, canvas.theme->box_bg_2);
 
-    painter->setBrush(box_gradient);
-    painter->drawRect(0, 0, box_width, box_height);
+        painter->setBrush(box_gradient);
+        painter->drawRect(0, 0, box_width, box_height);
+    }
 
-    QPointF text_pos(25, 16);
+    if (lod >= CanvasLodMinimal)
+    {
+        QPointF text_pos(25, 16);
 
-    painter->setFont(font_name);
-    painter->setPen(canvas.theme->box_text);
-    painter->drawText(text_pos, group_name);
+        painter->setFont(font_name);
+        painter->setPen(canvas.theme->box_text);
+        painter->drawText(text_pos, group_name);
+    }
 
     repaintLines();
 
-    Q_UNUSED(option);
     Q_UNUSED(widget);
 }
 
@@ -60,6 +60,7 @@ private:
     int box_height;
 
     QList<int> port_list_ids;
+    QList<CanvasPort*> port_widgets;
     QList<cb_line_t> connection_lines;
 
     QPointF last_pos;
@@ -2,6 +2,7 @@
 
 #include <QPainter>
 #include <QGraphicsColorizeEffect>
+#include <QStyleOptionGraphicsItem>
 #include <QSvgRenderer>
 
 START_NAMESPACE_PATCHCANVAS
@@ -104,6 +105,10 @@ QRectF CanvasIcon::boundingRect() const
 
 void CanvasIcon::paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget)
 {
+    // not worth rendering the svg when it is only a few pixels big
+    if (option->levelOfDetailFromTransform(painter->worldTransform()) < CanvasLodSimple)
+        return;
+
     if (renderer)
     {
         painter->setRenderHint(QPainter::Antialiasing, false);
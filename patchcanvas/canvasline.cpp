@@ -3,6 +3,7 @@
 #include "canvasportglow.h"
 
 #include <QPainter>
+#include <QStyleOptionGraphicsItem>
 
 START_NAMESPACE_PATCHCANVAS
 
@@ -21,6 +22,7 @@ CanvasLine::CanvasLine(CanvasPort* item1_, CanvasPort* item2_, QGraphicsItem* pa
 
     locked = false;
     line_selected = false;
+    line_cached = false;
 
     setGraphicsEffect(0);
     updateLinePos();
@@ -65,8 +67,14 @@ void CanvasLine::updateLinePos()
 {
     if (item1->getPortMode() == PORT_MODE_OUTPUT)
     {
-        QLineF line(item1->scenePos().x() + item1->getPortWidth()+12, item1->scenePos().y()+7.5, item2->scenePos().x(), item2->scenePos().y()+7.5);
-        setLine(line);
+        QLineF new_line(item1->scenePos().x() + item1->getPortWidth()+12, item1->scenePos().y()+7.5, item2->scenePos().x(), item2->scenePos().y()+7.5);
+
+        // every layout of either box gets here, mostly without anything moved
+        if (line_cached && new_line == line())
+            return;
+
+        line_cached = true;
+        setLine(new_line);
 
         line_selected = false;
         updateLineGradient(line_selected);
@@ -122,6 +130,15 @@ int CanvasLine::type() const
 
 void CanvasLine::paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget)
 {
+    if (option->levelOfDetailFromTransform(painter->worldTransform()) < CanvasLodSimple)
+    {
+        // zoomed out a thin aliased line looks the same
+        painter->setRenderHint(QPainter::Antialiasing, false);
+        painter->setPen(QPen(pen().brush(), 0));
+        painter->drawLine(line());
+        return;
+    }
+
     painter->setRenderHint(QPainter::Antialiasing, bool(options.antialiasing));
     QGraphicsLineItem::paint(painter, option, widget);
 }
@@ -35,6 +35,7 @@ private:
     CanvasPortGlow* glow;
     bool locked;
     bool line_selected;
+    bool line_cached;
 
     void paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget);
 };
@@ -11,6 +11,7 @@
 #include <QInputDialog>
 #include <QMenu>
 #include <QPainter>
+#include <QStyleOptionGraphicsItem>
 #include <QTimer>
 
 START_NAMESPACE_PATCHCANVAS
@@ -434,20 +435,33 @@ void CanvasPort::paint(QPainter* painter, const QStyleOptionGraphicsItem* option
         return;
     }
 
-    QPolygonF polygon;
-    polygon += QPointF(poly_locx[0], 0);
-    polygon += QPointF(poly_locx[1], 0);
-    polygon += QPointF(poly_locx[2], 7.5);
-    polygon += QPointF(poly_locx[3], 15);
-    polygon += QPointF(poly_locx[4], 15);
+    qreal lod = option->levelOfDetailFromTransform(painter->worldTransform());
 
-    painter->setBrush(poly_color);
-    painter->setPen(poly_pen);
-    painter->drawPolygon(polygon);
-
-    painter->setPen(canvas.theme->port_text);
-    painter->setFont(port_font);
-    painter->drawText(text_pos, port_name);
+    if (lod < CanvasLodMinimal)
+    {
+        // a few pixels high, the color is all that shows
+        painter->fillRect(QRectF(0, 0, port_width+12, port_height), poly_color);
+    }
+    else
+    {
+        QPolygonF polygon;
+        polygon += QPointF(poly_locx[0], 0);
+        polygon += QPointF(poly_locx[1], 0);
+        polygon += QPointF(poly_locx[2], 7.5);
+        polygon += QPointF(poly_locx[3], 15);
+        polygon += QPointF(poly_locx[4], 15);
+
+        painter->setBrush(poly_color);
+        painter->setPen(poly_pen);
+        painter->drawPolygon(polygon);
+
+        if (lod >= CanvasLodSimple)
+        {
+            painter->setPen(canvas.theme->port_text);
+            painter->setFont(port_font);
+            painter->drawText(text_pos, port_name);
+        }
+    }
 
     if (isSelected() != last_selected_state)
     {
@@ -465,7 +479,6 @@ void CanvasPort::paint(QPainter* painter, const QStyleOptionGraphicsItem* option
 
     last_selected_state = isSelected();
 
-    Q_UNUSED(option);
     Q_UNUSED(widget);
 }
 
@@ -91,24 +91,67 @@ QString get_full_port_name(int port_id)
     return group_name+":"+port_name;
 }
 
+// jack calls these from its own thread, the canvas belongs to
+// the gui thread. What is needed from jack is read here, the
+// rest is queued to the main window.
+
 void client_register_callback(const char* name, int register_, void *arg)
 {
-    QString qname(name);
+    QMetaObject::invokeMethod(main_gui, "jackClientRegistered", Qt::QueuedConnection,
+                              Q_ARG(QString, QString(name)), Q_ARG(bool, register_ != 0));
+    Q_UNUSED(arg);
+}
+
+void port_register_callback(jack_port_id_t port_id_jack, int register_, void *arg)
+{
+    jack_port_t* jack_port = jack_port_by_id(jack_client, port_id_jack);
+
+    PatchCanvas::PortMode port_mode;
+    PatchCanvas::PortType port_type;
+
+    if (jack_port_flags(jack_port) & JackPortIsInput)
+        port_mode = PatchCanvas::PORT_MODE_INPUT;
+    else
+        port_mode = PatchCanvas::PORT_MODE_OUTPUT;
+
+    if (strcmp(jack_port_type(jack_port), JACK_DEFAULT_AUDIO_TYPE) == 0)
+        port_type = PatchCanvas::PORT_TYPE_AUDIO_JACK;
+    else
+        port_type = PatchCanvas::PORT_TYPE_MIDI_JACK;
+
+    QMetaObject::invokeMethod(main_gui, "jackPortRegistered", Qt::QueuedConnection,
+                              Q_ARG(QString, QString(jack_port_name(jack_port))),
+                              Q_ARG(int, port_mode), Q_ARG(int, port_type), Q_ARG(bool, register_ != 0));
+    Q_UNUSED(arg);
+}
+
+void port_connect_callback(jack_port_id_t port_a, jack_port_id_t port_b, int connect, void* arg)
+{
+    jack_port_t* jack_port_a = jack_port_by_id(jack_client, port_a);
+    jack_port_t* jack_port_b = jack_port_by_id(jack_client, port_b);
 
-    if (register_)
+    QMetaObject::invokeMethod(main_gui, "jackPortConnected", Qt::QueuedConnection,
+                              Q_ARG(QString, QString(jack_port_name(jack_port_a))),
+                              Q_ARG(QString, QString(jack_port_name(jack_port_b))), Q_ARG(bool, connect != 0));
+    Q_UNUSED(arg);
+}
+
+void CanvasTestApp::jackClientRegistered(QString name, bool registered)
+{
+    if (registered)
     {
         group_name_to_id_t group_name_to_id;
         group_name_to_id.id = last_group_id;
-        group_name_to_id.name = qname;
+        group_name_to_id.name = name;
         used_group_names.append(group_name_to_id);
-        PatchCanvas::addGroup(last_group_id, qname);
+        PatchCanvas::addGroup(last_group_id, name);
         last_group_id++;
     }
     else
     {
         for (int i=0; i < used_group_names.count(); i++)
         {
-            if (used_group_names[i].name == qname)
+            if (used_group_names[i].name == name)
             {
                 PatchCanvas::removeGroup(used_group_names[i].id);
                 used_group_names.takeAt(i);
@@ -116,39 +159,22 @@ void client_register_callback(const char* name, int register_, void *arg)
             }
         }
     }
-    Q_UNUSED(arg);
 }
 
-void port_register_callback(jack_port_id_t port_id_jack, int register_, void *arg)
+void CanvasTestApp::jackPortRegistered(QString full_name, int port_mode, int port_type, bool registered)
 {
-    jack_port_t* jack_port = jack_port_by_id(jack_client, port_id_jack);
-
-    QString full_name(jack_port_name(jack_port));
     QString group_name = full_name.split(":").at(0);
     QString port_name = full_name.replace(group_name+":", "");
     int group_id = get_group_id(group_name);
 
-    if (register_)
+    if (registered)
     {
-        PatchCanvas::PortMode port_mode;
-        PatchCanvas::PortType port_type;
-
-        if (jack_port_flags(jack_port) & JackPortIsInput)
-            port_mode = PatchCanvas::PORT_MODE_INPUT;
-        else
-            port_mode = PatchCanvas::PORT_MODE_OUTPUT;
-
-        if (strcmp(jack_port_type(jack_port), JACK_DEFAULT_AUDIO_TYPE) == 0)
-            port_type = PatchCanvas::PORT_TYPE_AUDIO_JACK;
-        else
-            port_type = PatchCanvas::PORT_TYPE_MIDI_JACK;
-
         port_name_to_id_t port_name_to_id;
         port_name_to_id.group_id = group_id;
         port_name_to_id.port_id = last_port_id;
         port_name_to_id.name = port_name;
         used_port_names.append(port_name_to_id);
-        PatchCanvas::addPort(group_id, last_port_id, port_name, port_mode, port_type);
+        PatchCanvas::addPort(group_id, last_port_id, port_name, (PatchCanvas::PortMode)port_mode, (PatchCanvas::PortType)port_type);
         last_port_id++;
     }
     else
@@ -163,17 +189,14 @@ void port_register_callback(jack_port_id_t port_id_jack, int register_, void *ar
             }
         }
     }
-    Q_UNUSED(arg);
 }
 
-void port_connect_callback(jack_port_id_t port_a, jack_port_id_t port_b, int connect, void* arg)
+void CanvasTestApp::jackPortConnected(QString port_a, QString port_b, bool connected)
 {
-    jack_port_t* jack_port_a = jack_port_by_id(jack_client, port_a);
-    jack_port_t* jack_port_b = jack_port_by_id(jack_client, port_b);
-    int port_id_a = get_port_id(QString(jack_port_name(jack_port_a)));
-    int port_id_b = get_port_id(QString(jack_port_name(jack_port_b)));
+    int port_id_a = get_port_id(port_a);
+    int port_id_b = get_port_id(port_b);
 
-    if (connect)
+    if (connected)
     {
         connection_to_id_t connection;
         connection.id = last_connection_id;
@@ -195,7 +218,6 @@ void port_connect_callback(jack_port_id_t port_a, jack_port_id_t port_b, int con
             }
         }
     }
-    Q_UNUSED(arg);
 }
 
 void canvas_callback(PatchCanvas::CallbackAction action, int value1, int value2, QString value_str)
@@ -286,7 +308,9 @@ CanvasTestApp::CanvasTestApp(QWidget *parent) :
     jack_set_port_connect_callback(jack_client, port_connect_callback, 0);
     jack_activate(jack_client);
 
-    // query initial jack ports
+    // query initial jack ports, laid out once when all are in
+    PatchCanvas::beginUpdate();
+
     QList<QString> parsed_groups;
     const char** ports = jack_get_ports(jack_client, 0, 0, 0);
     if (ports) {
@@ -370,6 +394,8 @@ CanvasTestApp::CanvasTestApp(QWidget *parent) :
 
         jack_free(ports);
     }
+
+    PatchCanvas::endUpdate();
 }
 
 void CanvasTestApp::closeEvent(QCloseEvent* event)
@@ -20,6 +20,11 @@ public:
     explicit CanvasTestApp(QWidget *parent = nullptr);
     ~CanvasTestApp();
 
+private slots:
+    void jackClientRegistered(QString name, bool registered);
+    void jackPortRegistered(QString full_name, int port_mode, int port_type, bool registered);
+    void jackPortConnected(QString port_a, QString port_b, bool connected);
+
 private:
     Ui::CanvasTestApp* ui;
     PatchCanvas::PatchScene* scene;
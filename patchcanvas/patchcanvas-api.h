@@ -74,6 +74,11 @@ void set_features(features_t* features);
 void init(PatchScene* scene, Callback callback, bool debug=false);
 void clear();
 
+// Changes between these are laid out and repainted once, at endUpdate().
+// Without them changes are still collected for one frame.
+void beginUpdate();
+void endUpdate();
+
 void setInitialPos(int x, int y);
 void setCanvasSize(int x, int y, int width, int height);
 
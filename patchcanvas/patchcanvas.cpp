@@ -22,6 +22,11 @@ void CanvasObject::CanvasPostponedGroups()
     PatchCanvas::CanvasPostponedGroups();
 }
 
+void CanvasObject::CanvasUpdateBoxes()
+{
+    PatchCanvas::CanvasUpdateBoxes();
+}
+
 void CanvasObject::PortContextMenuDisconnect()
 {
     bool ok;
@@ -38,6 +43,8 @@ Canvas::Canvas()
     qobject = 0;
     settings = 0;
     theme = 0;
+    update_depth = 0;
+    update_timer = 0;
     initiated = false;
 }
 
@@ -129,7 +136,16 @@ void init(PatchScene* scene, Callback callback, bool debug)
     canvas.animation_list.clear();
 
     canvas.postponed_groups.clear();
+    canvas.updated_boxes.clear();
+    canvas.update_depth = 0;
     if (!canvas.qobject) canvas.qobject = new CanvasObject();
+    if (!canvas.update_timer)
+    {
+        canvas.update_timer = new QTimer(canvas.qobject);
+        canvas.update_timer->setSingleShot(true);
+        canvas.update_timer->setInterval(CanvasUpdateInterval);
+        QObject::connect(canvas.update_timer, SIGNAL(timeout()), canvas.qobject, SLOT(CanvasUpdateBoxes()));
+    }
     if (!canvas.settings) canvas.settings = new QSettings(PATCHCANVAS_ORGANISATION_NAME, "PatchCanvas");
 
     if (canvas.theme)
@@ -188,6 +204,8 @@ void clear()
 
     canvas.animation_list.clear();
 
+    beginUpdate();
+
     for (i=0; i < tmp_connection_list.count(); i++)
         disconnectPorts(tmp_connection_list[i]);
 
@@ -197,6 +215,8 @@ void clear()
     for (i=0; i < tmp_group_list.count(); i++)
         removeGroup(tmp_group_list[i]);
 
+    endUpdate();
+
     canvas.last_z_value = 0;
     canvas.last_group_id = 0;
     canvas.last_connection_id = 0;
@@ -209,6 +229,30 @@ void clear()
     canvas.initiated = false;
 }
 
+void beginUpdate()
+{
+    if (canvas.debug)
+        qDebug("PatchCanvas::beginUpdate()");
+
+    canvas.update_depth += 1;
+}
+
+void endUpdate()
+{
+    if (canvas.debug)
+        qDebug("PatchCanvas::endUpdate()");
+
+    if (canvas.update_depth == 0)
+    {
+        qCritical("PatchCanvas::endUpdate() - not in an update");
+        return;
+    }
+
+    canvas.update_depth -= 1;
+    if (canvas.update_depth == 0)
+        CanvasUpdateBoxes();
+}
+
 void setInitialPos(int x, int y)
 {
     if (canvas.debug)
@@ -294,7 +338,7 @@ void addGroup(int group_id, QString group_name, SplitOption split, Icon icon)
 
     canvas.group_list.append(group_dict);
 
-    QTimer::singleShot(0, canvas.scene, SIGNAL(update()));
+    CanvasQueueSceneUpdate();
 }
 
 void removeGroup(int group_id)
@@ -357,7 +401,7 @@ void removeGroup(int group_id)
 
             canvas.group_list.removeAt(i);
 
-            QTimer::singleShot(0, canvas.scene, SIGNAL(update()));
+            CanvasQueueSceneUpdate();
             return;
         }
     }
@@ -382,7 +426,7 @@ void renameGroup(int group_id, QString new_group_name)
                 canvas.group_list[i].widgets[1]->setGroupName(new_group_name);
             }
 
-            QTimer::singleShot(0, canvas.scene, SIGNAL(update()));
+            CanvasQueueSceneUpdate();
             return;
         }
     }
@@ -450,6 +494,8 @@ void splitGroup(int group_id)
     }
 
     // Step 2 - Remove Item and Children
+    beginUpdate();
+
     for (i=0; i < conns_data.count(); i++)
         disconnectPorts(conns_data[i].connection_id);
 
@@ -467,7 +513,7 @@ void splitGroup(int group_id)
     for (i=0; i < conns_data.count(); i++)
         connectPorts(conns_data[i].connection_id, conns_data[i].port_out_id, conns_data[i].port_in_id);
 
-    QTimer::singleShot(0, canvas.scene, SIGNAL(update()));
+    endUpdate();
 }
 
 void joinGroup(int group_id)
@@ -538,6 +584,8 @@ void joinGroup(int group_id)
     }
 
     // Step 2 - Remove Item and Children
+    beginUpdate();
+
     for (i=0; i < conns_data.count(); i++)
         disconnectPorts(conns_data[i].connection_id);
 
@@ -555,7 +603,7 @@ void joinGroup(int group_id)
     for (i=0; i < conns_data.count(); i++)
         connectPorts(conns_data[i].connection_id, conns_data[i].port_out_id, conns_data[i].port_in_id);
 
-    QTimer::singleShot(0, canvas.scene, SIGNAL(update()));
+    endUpdate();
 }
 
 void setGroupPos(int group_id, int group_pos_x, int group_pos_y)
@@ -579,7 +627,7 @@ void setGroupPos(int group_id, int group_pos_x, int group_pos_y, int group_pos_x
                 canvas.group_list[i].widgets[1]->setPos(group_pos_xs, group_pos_ys);
             }
 
-            QTimer::singleShot(0, canvas.scene, SIGNAL(update()));
+            CanvasQueueSceneUpdate();
             return;
         }
     }
@@ -602,7 +650,7 @@ void setGroupIcon(int group_id, Icon icon)
             if (canvas.group_list[i].split)
                 canvas.group_list[i].widgets[1]->setIcon(icon);
 
-            QTimer::singleShot(0, canvas.scene, SIGNAL(update()));
+            CanvasQueueSceneUpdate();
             return;
         }
     }
@@ -649,9 +697,7 @@ void addPort(int group_id, int port_id, QString port_name, PortMode port_mode, P
     port_dict.widget    = port_widget;
     canvas.port_list.append(port_dict);
 
-    box_widget->updatePositions();
-
-    QTimer::singleShot(0, canvas.scene, SIGNAL(update()));
+    CanvasQueueBoxUpdate(box_widget);
 }
 
 void removePort(int port_id)
@@ -673,7 +719,7 @@ void removePort(int port_id)
             }
             canvas.port_list.takeAt(i);
 
-            QTimer::singleShot(0, canvas.scene, SIGNAL(update()));
+            CanvasQueueSceneUpdate();
             return;
         }
     }
@@ -692,9 +738,7 @@ void renamePort(int port_id, QString new_port_name)
         {
             canvas.port_list[i].port_name = new_port_name;
             canvas.port_list[i].widget->setPortName(new_port_name);
-            ((CanvasBox*)canvas.port_list[i].widget->parentItem())->updatePositions();
-
-            QTimer::singleShot(0, canvas.scene, SIGNAL(update()));
+            CanvasQueueBoxUpdate((CanvasBox*)canvas.port_list[i].widget->parentItem());
             return;
         }
     }
@@ -757,7 +801,7 @@ void connectPorts(int connection_id, int port_out_id, int port_in_id)
     //if (options.fancy_eyecandy)
         //ItemFX(connection_dict.widget, true);
 
-    QTimer::singleShot(0, canvas.scene, SIGNAL(update()));
+    CanvasQueueSceneUpdate();
 }
 
 void disconnectPorts(int connection_id)
@@ -829,7 +873,7 @@ void disconnectPorts(int connection_id)
         delete line;
     }
 
-    QTimer::singleShot(0, canvas.scene, SIGNAL(update()));
+    CanvasQueueSceneUpdate();
 }
 
 void Arrange()
@@ -875,27 +919,26 @@ QPointF CanvasGetNewGroupPos(bool horizontal)
         qDebug("PatchCanvas::CanvasGetNewGroupPos(%s)", bool2str(horizontal));
 
     QPointF new_pos(canvas.initial_pos.x(), canvas.initial_pos.y());
-    QList<QGraphicsItem*> items = canvas.scene->items();
 
-    bool break_loop = false;
-    while (!break_loop)
+    // only boxes matter, asking the scene for all items gets slow with many ports
+    bool moved = true;
+    while (moved)
     {
-        bool break_for = false;
-        for (int i=0; i < items.count(); i++)
+        moved = false;
+        for (int i=0; i < canvas.group_list.count() && !moved; i++)
         {
-            if (items[i]->type() == CanvasBoxType)
+            for (int j=0; j < 2 && !moved; j++)
             {
-                if (items[i]->sceneBoundingRect().contains(new_pos))
+                CanvasBox* box = canvas.group_list[i].widgets[j];
+                if (box && box->sceneBoundingRect().contains(new_pos))
                 {
                     if (horizontal)
-                        new_pos += QPointF(items[i]->boundingRect().width()+15, 0);
+                        new_pos += QPointF(box->boundingRect().width()+15, 0);
                     else
-                        new_pos += QPointF(0, items[i]->boundingRect().height()+15);
-                    break;
+                        new_pos += QPointF(0, box->boundingRect().height()+15);
+                    moved = true;
                 }
             }
-            if (i >= items.count()-1 && !break_for)
-                break_loop = true;
         }
     }
 
@@ -996,6 +1039,38 @@ void CanvasPostponedGroups()
         QTimer::singleShot(100, canvas.qobject, SLOT(CanvasPostponedGroups()));
 }
 
+void CanvasQueueBoxUpdate(CanvasBox* box)
+{
+    canvas.updated_boxes.insert(box);
+    CanvasQueueSceneUpdate();
+}
+
+// like all of the canvas, gui thread only
+void CanvasQueueSceneUpdate()
+{
+    if (canvas.update_depth > 0 || !canvas.update_timer || canvas.update_timer->isActive())
+        return;
+
+    canvas.update_timer->start();
+}
+
+void CanvasUpdateBoxes()
+{
+    if (canvas.debug)
+        qDebug("PatchCanvas::CanvasUpdateBoxes() - %i boxes", canvas.updated_boxes.count());
+
+    if (canvas.update_timer)
+        canvas.update_timer->stop();
+
+    QSet<CanvasBox*> boxes;
+    boxes.swap(canvas.updated_boxes);
+
+    foreach (CanvasBox* box, boxes)
+        box->updatePositions();
+
+    canvas.scene->update();
+}
+
 void CanvasCallback(CallbackAction action, int value1, int value2, QString value_str)
 {
     if (canvas.debug)
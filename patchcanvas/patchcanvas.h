@@ -6,6 +6,7 @@
 
 #include <QGraphicsItem>
 #include <QGraphicsScene>
+#include <QSet>
 
 class QSettings;
 class QTimer;
@@ -18,6 +19,7 @@ public:
 
 public slots:
     void CanvasPostponedGroups();
+    void CanvasUpdateBoxes();
     void PortContextMenuDisconnect();
 };
 
@@ -28,6 +30,13 @@ class CanvasBox;
 class CanvasPort;
 class CanvasFadeAnimation;
 
+// box layout and repaints are collected for this long (ms)
+const int CanvasUpdateInterval = 16;
+
+// level of detail below which items are drawn simplified and plain
+const qreal CanvasLodSimple  = 0.6;
+const qreal CanvasLodMinimal = 0.35;
+
 // object types
 enum CanvasType {
     CanvasBoxType           = QGraphicsItem::UserType + 1,
@@ -87,6 +96,9 @@ public:
     QList<connection_dict_t> connection_list;
     QList<animation_dict_t> animation_list;
     QList<int> postponed_groups;
+    QSet<CanvasBox*> updated_boxes;
+    int update_depth;
+    QTimer* update_timer;
     CanvasObject* qobject;
     QSettings* settings;
     Theme* theme;
@@ -105,6 +117,9 @@ QList<int> CanvasGetPortConnectionList(int port_id);
 int CanvasGetConnectedPort(int connection_id, int port_id);
 
 void CanvasPostponedGroups();
+void CanvasQueueBoxUpdate(CanvasBox* box);
+void CanvasQueueSceneUpdate();
+void CanvasUpdateBoxes();
 void CanvasCallback(CallbackAction action, int value1, int value2, QString value_str);
 
 void ItemFX(QGraphicsItem* item, bool show, bool destroy=true);
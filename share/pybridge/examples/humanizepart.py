@@ -0,0 +1,28 @@
+"""
+//=========================================================
+//  OOMidi
+//  OpenOctave Midi and Audio Editor
+//=========================================================
+"""
+
+import Pyro.core
+import array
+import random
+oom=Pyro.core.getProxyForURI('PYRONAME://:Default.oom')
+
+#
+# Example on the bulk event calls: every part comes over as one buffer of
+# int32 records (type, tick, len, a, b, c), type 0 is a note and 1 a
+# controller. The whole part goes back in one call and one undo step.
+#
+
+RECORD = 6
+
+for partid, tick, length in oom.getPartIds("Track 1"):
+      ev = array.array('i', str(oom.getPartEvents(partid)))
+      for i in range(0, len(ev), RECORD):
+            if ev[i] != 0:
+                  continue
+            ev[i + 1] = max(0, ev[i + 1] + random.randint(-5, 5))
+            ev[i + 4] = min(127, max(1, ev[i + 4] + random.randint(-8, 8)))
+      oom.setPartEvents(partid, ev.tostring())
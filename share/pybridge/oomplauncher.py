@@ -65,6 +65,18 @@ class OOMidi:
       def deletePart(self, part): # delete a part
             return oom.deletePart((part))
 
+      def getPartIds(self, trackname): # [id, tick, len] of the parts in a track, without events
+            return oom.getPartIds(trackname)
+
+      def getPartEvents(self, partid): # notes and controllers of a part as packed int32 records (type, tick, len, a, b, c)
+            return oom.getPartEvents(partid)
+
+      def setPartEvents(self, partid, records): # replace notes and controllers of a part by packed records, one undo step
+            return oom.setPartEvents(partid, records)
+
+      def addPartEvents(self, partid, records): # add packed records to a part, one undo step
+            return oom.addPartEvents(partid, records)
+
       def getSelectedTrack(self): # get first selected track in arranger window
             return oom.getSelectedTrack()
 